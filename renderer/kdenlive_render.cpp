@@ -45,6 +45,16 @@ int main(int argc, char **argv)
             args.removeFirst();
         }
 
+        // Render the range in parallel segments starting at these frames
+        QList<int> segments;
+        if (args.count() > 1 && args.at(0) == QLatin1String("-segments")) {
+            args.removeFirst();
+            const QStringList starts = args.takeFirst().split(QLatin1Char(','), Qt::SkipEmptyParts);
+            for (const QString &start : starts) {
+                segments << start.toInt();
+            }
+        }
+
         // Do we want a split render
         if (args.count() > 5 && args.at(0) == QLatin1String("-split")) {
             args.removeFirst();
@@ -161,6 +171,7 @@ int main(int argc, char **argv)
             }
         }
         auto *rJob = new RenderJob(render, playlist, target, pid, in, out, subtitleFile, &app);
+        rJob->setSegments(segments);
         QObject::connect(rJob, &RenderJob::renderingFinished, rJob, [&]() {
             rJob->deleteLater();
             app.quit();
@@ -178,6 +189,7 @@ int main(int argc, char **argv)
                 "  -locale:LOCALE : set a locale for rendering. For example, -locale:fr_FR.UTF-8 will use a french locale (comma as numeric separator)\n"
                 "  in=pos: start rendering at frame pos\n"
                 "  out=pos: end rendering at frame pos\n"
+                "  -segments pos,pos: render in parallel processes starting at these frames, joined with FFmpeg\n"
                 "  render: path to MLT melt renderer\n"
                 "  profile: the MLT video profile\n"
                 "  rendermodule: the MLT consumer used for rendering, usually it is avformat\n"
@@ -0,0 +1,128 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "renderqueue.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QStandardPaths>
+#include <QThread>
+#include <QTimer>
+#include <csignal>
+
+namespace {
+// Set by the signal handler, polled from the event loop
+volatile std::sig_atomic_t terminationRequested = 0;
+
+void requestTermination(int)
+{
+    terminationRequested = 1;
+}
+
+// Quit the event loop on SIGTERM and SIGINT, so that the running renders are stopped and the socket removed
+void handleTermination(QCoreApplication &app)
+{
+    std::signal(SIGTERM, requestTermination);
+    std::signal(SIGINT, requestTermination);
+    auto *timer = new QTimer(&app);
+    QObject::connect(timer, &QTimer::timeout, &app, []() {
+        if (terminationRequested) {
+            QCoreApplication::quit();
+        }
+    });
+    timer->start(200);
+}
+
+// Send a request to a running queue and print the reply, returns the exit code
+int sendRequest(const QString &server, const QJsonObject &request, bool follow)
+{
+    QLocalSocket socket;
+    socket.connectToServer(server);
+    if (!socket.waitForConnected(3000)) {
+        fprintf(stderr, "Cannot connect to render queue %s: %s\n", server.toUtf8().constData(), socket.errorString().toUtf8().constData());
+        return 1;
+    }
+    socket.write(QJsonDocument(request).toJson(QJsonDocument::Compact) + '\n');
+    socket.flush();
+    bool ok = false;
+    bool replied = false;
+    // When following, print the events until the connection is closed
+    while (!replied || follow) {
+        if (!socket.canReadLine() && !socket.waitForReadyRead(-1)) {
+            break;
+        }
+        while (socket.canReadLine()) {
+            const QByteArray line = socket.readLine();
+            fprintf(stdout, "%s", line.constData());
+            if (!replied) {
+                replied = true;
+                ok = QJsonDocument::fromJson(line).object().value(QStringLiteral("ok")).toBool();
+            }
+        }
+        fflush(stdout);
+    }
+    return ok ? 0 : 1;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName(QStringLiteral("kdenlive"));
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Kdenlive render queue. Without a client option, runs the queue."));
+    parser.addHelpOption();
+    const QCommandLineOption serverOption(QStringLiteral("server"), QStringLiteral("Name of the local socket."), QStringLiteral("name"),
+                                          RenderQueue::defaultServerName());
+    const QCommandLineOption meltOption(QStringLiteral("melt"), QStringLiteral("Path to the melt executable."), QStringLiteral("path"));
+    const QCommandLineOption jobsOption(QStringLiteral("jobs"), QStringLiteral("Maximum number of concurrent renders."), QStringLiteral("count"),
+                                        QString::number(qMax(1, QThread::idealThreadCount() / 4)));
+    const QCommandLineOption memoryOption(QStringLiteral("min-memory"),
+                                          QStringLiteral("Free memory in MiB required to start a render while another one is running."),
+                                          QStringLiteral("MiB"), QStringLiteral("2048"));
+    const QCommandLineOption submitOption(QStringLiteral("submit"), QStringLiteral("Queue an MLT playlist with an embedded consumer."), QStringLiteral("playlist"));
+    const QCommandLineOption statusOption(QStringLiteral("status"), QStringLiteral("Print the queued jobs."));
+    const QCommandLineOption cancelOption(QStringLiteral("cancel"), QStringLiteral("Cancel a waiting or running job."), QStringLiteral("id"));
+    const QCommandLineOption clearOption(QStringLiteral("clear"), QStringLiteral("Remove the jobs that are over."));
+    const QCommandLineOption followOption(QStringLiteral("follow"), QStringLiteral("Print the progress events of all jobs."));
+    parser.addOptions({serverOption, meltOption, jobsOption, memoryOption, submitOption, statusOption, cancelOption, clearOption, followOption});
+    parser.process(app);
+
+    const QString server = parser.value(serverOption);
+    if (parser.isSet(submitOption)) {
+        return sendRequest(server, {{"command", "submit"}, {"playlist", QFileInfo(parser.value(submitOption)).absoluteFilePath()}}, false);
+    }
+    if (parser.isSet(statusOption)) {
+        return sendRequest(server, {{"command", "status"}}, false);
+    }
+    if (parser.isSet(cancelOption)) {
+        return sendRequest(server, {{"command", "cancel"}, {"id", parser.value(cancelOption).toInt()}}, false);
+    }
+    if (parser.isSet(clearOption)) {
+        return sendRequest(server, {{"command", "clear"}}, false);
+    }
+    if (parser.isSet(followOption)) {
+        return sendRequest(server, {{"command", "subscribe"}}, true);
+    }
+
+    QString melt = parser.value(meltOption);
+    if (melt.isEmpty()) {
+        melt = QStandardPaths::findExecutable(QStringLiteral("melt"));
+    }
+    if (melt.isEmpty()) {
+        fprintf(stderr, "Cannot find melt, use the --melt option\n");
+        return 1;
+    }
+    RenderQueue queue(melt, parser.value(jobsOption).toInt(), parser.value(memoryOption).toLongLong() * 1024 * 1024);
+    if (!queue.listen(server)) {
+        fprintf(stderr, "Cannot listen on %s, is another queue running?\n", server.toUtf8().constData());
+        return 1;
+    }
+    handleTermination(app);
+    return app.exec();
+}
@@ -5,6 +5,7 @@
 */
 
 #include "renderjob.h"
+#include "rendersegments.h"
 
 #include <QStringList>
 #include <QThread>
@@ -16,6 +17,7 @@
 #endif
 #include <QDebug>
 #include <QDir>
+#include <QDomDocument>
 #include <QElapsedTimer>
 #include <QStandardPaths>
 #include <utility>
@@ -51,6 +53,8 @@ RenderJob::RenderJob(const QString &render, const QString &scenelist, const QStr
     , m_pid(pid)
     , m_dualpass(false)
     , m_subtitleFile(subtitleFile)
+    , m_runningSegments(0)
+    , m_concatProcess(nullptr)
 {
     m_renderProcess = new QProcess(&m_looper);
     m_renderProcess->setReadChannel(QProcess::StandardError);
@@ -119,9 +123,25 @@ void RenderJob::sendFinish(int status, const QString &error)
 #endif
 }
 
+void RenderJob::setSegments(const QList<int> &starts)
+{
+    m_segmentStarts = starts;
+}
+
 void RenderJob::slotAbort()
 {
     m_renderProcess->kill();
+    for (const Segment &segment : m_segments) {
+        segment.process->disconnect(this);
+        segment.process->kill();
+    }
+    if (m_concatProcess) {
+        m_concatProcess->disconnect(this);
+        m_concatProcess->kill();
+        m_concatProcess->waitForFinished(1000);
+        QFile::remove(m_dest + QStringLiteral(".parts.txt"));
+    }
+    removeSegmentFiles();
     sendFinish(-3, QString());
     if (m_erase) {
         QFile(m_scenelist).remove();
@@ -145,6 +165,7 @@ void RenderJob::receivedStderr()
     } else {
         int progress = result.section(QLatin1Char(' '), -1).toInt();
         int frame = result.section(QLatin1Char(','), 0, 0).section(QLatin1Char(' '), -1).toInt();
+        m_telemetry.addSample(0, frame);
         if (progress <= m_progress || progress <= 0 || progress > 100) {
             return;
         }
@@ -154,17 +175,22 @@ void RenderJob::receivedStderr()
         } else if (m_args.contains(QStringLiteral("pass=2"))) {
             m_progress = 50 + m_progress / 2;
         }
-        qint64 elapsedTime = m_startTime.secsTo(QDateTime::currentDateTime());
-        if (elapsedTime == m_seconds) {
-            return;
-        }
-        int speed = (frame - m_frame) / (elapsedTime - m_seconds);
-        m_seconds = elapsedTime;
-        m_frame = frame;
-        updateProgress(speed);
+        updateSpeed(frame);
     }
 }
 
+void RenderJob::updateSpeed(int frame)
+{
+    qint64 elapsedTime = m_startTime.secsTo(QDateTime::currentDateTime());
+    if (elapsedTime == m_seconds) {
+        return;
+    }
+    int speed = int((frame - m_frame) / (elapsedTime - m_seconds));
+    m_seconds = int(elapsedTime);
+    m_frame = frame;
+    updateProgress(speed);
+}
+
 void RenderJob::updateProgress(int speed)
 {
 #ifndef NODBUS
@@ -272,14 +298,229 @@ void RenderJob::start()
         slotIsOver(QProcess::NormalExit, false);
     }*/
 
+    m_telemetry.start();
     // Because of the logging, we connect to stderr in all cases.
-    connect(m_renderProcess, &QProcess::readyReadStandardError, this, &RenderJob::receivedStderr);
-    m_renderProcess->start(m_prog, m_args);
-    m_logstream << "Started render process: " << m_prog << ' ' << m_args.join(QLatin1Char(' ')) << "\n";
+    if (m_segmentStarts.isEmpty() || !startSegments()) {
+        connect(m_renderProcess, &QProcess::readyReadStandardError, this, &RenderJob::receivedStderr);
+        m_renderProcess->start(m_prog, m_args);
+        m_logstream << "Started render process: " << m_prog << ' ' << m_args.join(QLatin1Char(' ')) << "\n";
+    }
     m_logstream.flush();
     m_looper.exec();
 }
 
+QString RenderJob::playlistFile() const
+{
+    QString playlist = m_scenelist;
+    if (playlist.startsWith(QLatin1String("xml:"))) {
+        playlist.remove(0, 4);
+    }
+    if (playlist.endsWith(QLatin1String("?multi=1"))) {
+        playlist.chop(8);
+    }
+    return playlist;
+}
+
+bool RenderJob::startSegments()
+{
+    const QString ffmpegExe = QStandardPaths::findExecutable(QStringLiteral("ffmpeg"));
+    if (ffmpegExe.isEmpty()) {
+        m_logstream << "FFmpeg not found, cannot concatenate segments, rendering in one process\n";
+        return false;
+    }
+    // The playlist may be wrapped to use the xml producer with the multi consumer
+    const QString playlistFile = this->playlistFile();
+    const QString playlistPrefix = m_scenelist.startsWith(QLatin1String("xml:")) ? QStringLiteral("xml:") : QString();
+    const QString playlistSuffix = m_scenelist.endsWith(QLatin1String("?multi=1")) ? QStringLiteral("?multi=1") : QString();
+    QFile file(playlistFile);
+    QDomDocument doc;
+    if (!file.open(QIODevice::ReadOnly) || !doc.setContent(&file, false)) {
+        return false;
+    }
+    file.close();
+    QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    if (consumer.isNull() || consumer.hasAttribute(QStringLiteral("pass")) || !consumer.hasAttribute(QStringLiteral("out"))) {
+        // Multi pass encodings need the whole range
+        return false;
+    }
+    const int in = consumer.attribute(QStringLiteral("in"), QStringLiteral("0")).toInt();
+    const int out = consumer.attribute(QStringLiteral("out")).toInt();
+    const std::vector<RenderSegments::Part> parts = RenderSegments::split(in, out, m_segmentStarts, RenderSegments::hasAudio(consumer));
+    if (parts.empty()) {
+        return false;
+    }
+    // Share the processing threads between the segments
+    const int threads = qAbs(consumer.attribute(QStringLiteral("real_time"), QStringLiteral("-1")).toInt()) / int(parts.size());
+    const QFileInfo destination(m_dest);
+    const QString extension = destination.suffix();
+    m_segmentConsumer = consumer;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        const RenderSegments::Part &part = parts.at(i);
+        Segment segment;
+        segment.in = part.in;
+        segment.out = part.out;
+        segment.audio = part.audio;
+        segment.done = 0;
+        if (part.audio) {
+            segment.playlist = playlistFile.section(QLatin1Char('.'), 0, -2) + QStringLiteral("-audio.mlt");
+            segment.target = destination.absoluteDir().absoluteFilePath(QStringLiteral(".%1.audio.mka").arg(destination.completeBaseName()));
+        } else {
+            segment.playlist = playlistFile.section(QLatin1Char('.'), 0, -2) + QStringLiteral("-part%1.mlt").arg(i);
+            segment.target =
+                destination.absoluteDir().absoluteFilePath(QStringLiteral(".%1.part%2.%3").arg(destination.completeBaseName()).arg(i).arg(extension));
+        }
+        const QDomDocument partDoc = RenderSegments::partPlaylist(doc, part, segment.target, threads);
+        QFile segmentFile(segment.playlist);
+        if (!segmentFile.open(QIODevice::WriteOnly | QIODevice::Text) || segmentFile.write(partDoc.toString().toUtf8()) < 0) {
+            m_logstream << "Cannot write segment playlist " << segment.playlist << "\n";
+            removeSegmentFiles();
+            return false;
+        }
+        segmentFile.close();
+        segment.process = new QProcess(&m_looper);
+        segment.process->setReadChannel(QProcess::StandardError);
+        m_segments.push_back(segment);
+    }
+    for (int i = 0; i < int(m_segments.size()); ++i) {
+        Segment &segment = m_segments[size_t(i)];
+        connect(segment.process, &QProcess::readyReadStandardError, this, [this, i]() { receivedSegmentStderr(i); });
+        connect(segment.process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this,
+                [this, i]() { slotSegmentFinished(i); });
+        const QStringList args = {QStringLiteral("-progress"), playlistPrefix + segment.playlist + playlistSuffix};
+        segment.process->start(m_prog, args);
+        m_runningSegments++;
+        m_logstream << "Started render process: " << m_prog << ' ' << args.join(QLatin1Char(' ')) << "\n";
+    }
+    m_frame = in;
+    return true;
+}
+
+void RenderJob::receivedSegmentStderr(int index)
+{
+    Segment &segment = m_segments[size_t(index)];
+    QString result = QString::fromLocal8Bit(segment.process->readAllStandardError()).simplified();
+    if (!result.startsWith(QLatin1String("Current Frame"))) {
+        m_errorMessage.append(result + QStringLiteral("<br>"));
+        m_logstream << result;
+        return;
+    }
+    if (segment.audio) {
+        // The audio is much faster to render, only the video parts give the progress
+        return;
+    }
+    int frame = result.section(QLatin1Char(','), 0, 0).section(QLatin1Char(' '), -1).toInt();
+    if (frame < segment.in || frame > segment.out) {
+        return;
+    }
+    m_telemetry.addSample(index, frame);
+    segment.done = qMax(segment.done, frame - segment.in + 1);
+    // Aggregate the segments as if a single process rendered them one after the other
+    int done = 0;
+    int total = 0;
+    for (const Segment &s : m_segments) {
+        if (!s.audio) {
+            done += s.done;
+            total += s.out - s.in + 1;
+        }
+    }
+    // Keep the last percent for the concatenation
+    int progress = qMin(99, int(100. * done / total));
+    if (progress <= m_progress) {
+        return;
+    }
+    m_progress = progress;
+    updateSpeed(m_segments.front().in + done);
+}
+
+void RenderJob::slotSegmentFinished(int index)
+{
+    m_runningSegments--;
+    QProcess *process = m_segments[size_t(index)].process;
+    if (process->exitStatus() == QProcess::CrashExit || process->exitCode() != 0) {
+        if (m_runningSegments < 0) {
+            // Already failed
+            return;
+        }
+        // Stop the other segments, the render cannot complete
+        m_runningSegments = -1;
+        for (const Segment &segment : m_segments) {
+            segment.process->disconnect(this);
+            segment.process->kill();
+        }
+        m_frame = m_segments[size_t(index)].in + m_segments[size_t(index)].done;
+        removeSegmentFiles();
+        slotIsOver(QProcess::CrashExit);
+        return;
+    }
+    if (m_runningSegments > 0) {
+        return;
+    }
+    if (!concatSegments()) {
+        removeSegmentFiles();
+        slotIsOver(QProcess::CrashExit);
+    }
+}
+
+bool RenderJob::concatSegments()
+{
+    QFile list(m_dest + QStringLiteral(".parts.txt"));
+    if (!list.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        m_errorMessage.append(tr("Cannot write to %1, check permissions.").arg(list.fileName()));
+        return false;
+    }
+    QTextStream stream(&list);
+    QString audio;
+    for (const Segment &segment : m_segments) {
+        if (segment.audio) {
+            audio = segment.target;
+            continue;
+        }
+        QString path = segment.target;
+        stream << "file '" << path.replace(QLatin1Char('\''), QLatin1String("'\\''")) << "'\n";
+    }
+    stream.flush();
+    list.close();
+    const QStringList args = RenderSegments::concatArguments(m_segmentConsumer, list.fileName(), audio, m_dest);
+    m_concatProcess = new QProcess(&m_looper);
+    m_concatProcess->setProcessChannelMode(QProcess::MergedChannels);
+    connect(m_concatProcess, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &RenderJob::slotConcatFinished);
+    m_logstream << "Joining segments: ffmpeg " << args.join(QLatin1Char(' ')) << "\n";
+    m_concatProcess->start(QStandardPaths::findExecutable(QStringLiteral("ffmpeg")), args);
+    if (!m_concatProcess->waitForStarted()) {
+        m_concatProcess->disconnect(this);
+        m_errorMessage.append(m_concatProcess->errorString());
+        list.remove();
+        return false;
+    }
+    return true;
+}
+
+void RenderJob::slotConcatFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    QFile::remove(m_dest + QStringLiteral(".parts.txt"));
+    removeSegmentFiles();
+    if (exitStatus == QProcess::CrashExit || exitCode != 0) {
+        const QString output = QString::fromLocal8Bit(m_concatProcess->readAll()).simplified();
+        m_errorMessage.append(output);
+        m_logstream << output << "\n";
+        slotIsOver(QProcess::CrashExit);
+        return;
+    }
+    m_progress = 100;
+    m_frame = m_segments.back().out;
+    updateProgress();
+    slotIsOver(QProcess::NormalExit);
+}
+
+void RenderJob::removeSegmentFiles()
+{
+    for (const Segment &segment : m_segments) {
+        segment.process->waitForFinished(1000);
+        QFile::remove(segment.playlist);
+        QFile::remove(segment.target);
+    }
+}
+
 #ifndef NODBUS
 void RenderJob::initKdenliveDbusInterface()
 {
@@ -328,6 +569,9 @@ void RenderJob::slotIsOver(QProcess::ExitStatus status, bool isWritable)
         emit renderingFinished();
         // qApp->quit();
     }
+    if (m_telemetry.save(m_dest + QStringLiteral(".report.json"), playlistFile())) {
+        m_logstream << "Render report written to " << m_dest << ".report.json\n";
+    }
     if (m_erase) {
         QFile(m_scenelist).remove();
     }
@@ -6,18 +6,21 @@
 
 #pragma once
 
+#include "rendertelemetry.h"
 #ifdef NODBUS
 #include <QLocalSocket>
 #else
 #include <QDBusInterface>
 #endif
 #include <QDateTime>
+#include <QDomElement>
 #include <QEventLoop>
 #include <QFile>
 #include <QObject>
 #include <QProcess>
 // Testing
 #include <QTextStream>
+#include <vector>
 
 class RenderJob : public QObject
 {
@@ -27,6 +30,8 @@ public:
     RenderJob(const QString &render, const QString &scenelist, const QString &target, int pid = -1, int in = -1, int out = -1,
               const QString &subtitleFile = QString(), QObject *parent = nullptr);
     ~RenderJob() override;
+    /** @brief Render the range in parallel segments starting at the given frames, concatenated at the end */
+    void setSegments(const QList<int> &starts);
 
 public slots:
     void start();
@@ -39,6 +44,9 @@ private slots:
     void slotCheckProcess(QProcess::ProcessState state);
     void slotCheckSubtitleProcess(int exitCode, QProcess::ExitStatus exitStatus);
     void receivedSubtitleProgress();
+    void receivedSegmentStderr(int index);
+    void slotSegmentFinished(int index);
+    void slotConcatFinished(int exitCode, QProcess::ExitStatus exitStatus);
 
 private:
     QString m_scenelist;
@@ -74,6 +82,36 @@ private:
     QStringList m_args;
     /** @brief Used to write to the log file. */
     QTextStream m_logstream;
+    /** @brief A part of the range rendered by its own melt process */
+    struct Segment
+    {
+        int in;
+        int out;
+        /** @brief True for the process rendering the audio of the whole range */
+        bool audio;
+        /** @brief Number of frames already rendered */
+        int done;
+        QString playlist;
+        QString target;
+        QProcess *process;
+    };
+    /** @brief Frame timings, saved as a report next to the log when the render is over */
+    RenderTelemetry m_telemetry;
+    QList<int> m_segmentStarts;
+    std::vector<Segment> m_segments;
+    int m_runningSegments;
+    /** @brief Consumer of the rendered playlist, its audio settings are used when joining the segments */
+    QDomElement m_segmentConsumer;
+    /** @brief The ffmpeg process joining the segments */
+    QProcess *m_concatProcess;
+    /** @brief Write the playlists of the segments and start their processes, returns false if the range cannot be segmented */
+    bool startSegments();
+    /** @brief Path of the rendered playlist, without the xml producer prefix and options */
+    QString playlistFile() const;
+    /** @brief Start joining the rendered video segments and encoding the audio into the destination file, returns false if it cannot start */
+    bool concatSegments();
+    void removeSegmentFiles();
+    void updateSpeed(int frame);
 #ifdef NODBUS
     void fromServer();
 #else
@@ -0,0 +1,439 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "renderqueue.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDomDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+
+namespace {
+// Interval between two admission checks while jobs wait for memory or cores
+const int AdmissionInterval = 5000;
+// Only the end of the melt output of a job is kept
+const int MaxErrorLength = 16384;
+} // namespace
+
+RenderQueue::RenderQueue(const QString &melt, int maxJobs, qint64 minFreeMemory, const QString &queueFile, QObject *parent)
+    : QObject(parent)
+    , m_melt(melt)
+    , m_maxJobs(qMax(1, maxJobs))
+    , m_minFreeMemory(minFreeMemory)
+    , m_queueFile(queueFile.isEmpty()
+                      ? QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).absoluteFilePath(QStringLiteral("renderqueue.json"))
+                      : queueFile)
+{
+    // Disable VDPAU so that rendering will work even if there is a Kdenlive instance using VDPAU
+    qputenv("MLT_NO_VDPAU", "1");
+    m_admissionTimer.setInterval(AdmissionInterval);
+    connect(&m_admissionTimer, &QTimer::timeout, this, &RenderQueue::startJobs);
+    connect(&m_server, &QLocalServer::newConnection, this, &RenderQueue::clientConnected);
+    load();
+}
+
+RenderQueue::~RenderQueue()
+{
+    // Interrupted jobs will be rendered again on next start
+    for (auto &it : m_jobs) {
+        if (it.second.process) {
+            it.second.process->disconnect(this);
+            it.second.process->kill();
+            it.second.process->waitForFinished(1000);
+        }
+    }
+}
+
+// static
+QString RenderQueue::defaultServerName()
+{
+    return QStringLiteral("org.kde.kdenlive-renderqueue");
+}
+
+bool RenderQueue::listen(const QString &name)
+{
+    m_server.setSocketOptions(QLocalServer::UserAccessOption);
+    if (!m_server.listen(name) && m_server.serverError() == QAbstractSocket::AddressInUseError) {
+        // Remove the socket left by a queue that crashed, unless it is still answering
+        QLocalSocket socket;
+        socket.connectToServer(name);
+        if (!socket.waitForConnected(1000)) {
+            QLocalServer::removeServer(name);
+            m_server.listen(name);
+        }
+    }
+    if (!m_server.isListening()) {
+        qWarning() << "Render queue failed to listen on" << name << m_server.errorString();
+        return false;
+    }
+    QMetaObject::invokeMethod(this, "startJobs", Qt::QueuedConnection);
+    return true;
+}
+
+void RenderQueue::clientConnected()
+{
+    while (QLocalSocket *client = m_server.nextPendingConnection()) {
+        connect(client, &QLocalSocket::readyRead, this, &RenderQueue::clientData);
+        connect(client, &QLocalSocket::disconnected, this, [this, client]() {
+            m_subscribers.removeAll(client);
+            client->deleteLater();
+        });
+    }
+}
+
+void RenderQueue::clientData()
+{
+    auto *client = qobject_cast<QLocalSocket *>(sender());
+    if (!client) {
+        return;
+    }
+    // One request per line
+    while (client->canReadLine()) {
+        const QByteArray line = client->readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonParseError error;
+        const QJsonDocument request = QJsonDocument::fromJson(line, &error);
+        QJsonObject reply;
+        if (error.error != QJsonParseError::NoError || !request.isObject()) {
+            reply = {{QStringLiteral("ok"), false}, {QStringLiteral("error"), QStringLiteral("Invalid request: %1").arg(error.errorString())}};
+        } else {
+            reply = handleRequest(request.object(), client);
+        }
+        client->write(QJsonDocument(reply).toJson(QJsonDocument::Compact) + '\n');
+    }
+    client->flush();
+}
+
+QJsonObject RenderQueue::handleRequest(const QJsonObject &request, QLocalSocket *client)
+{
+    const QString command = request.value(QStringLiteral("command")).toString();
+    QJsonObject reply{{QStringLiteral("ok"), true}};
+    if (command == QLatin1String("submit")) {
+        const QString playlist = QFileInfo(request.value(QStringLiteral("playlist")).toString()).absoluteFilePath();
+        const QString target = playlistTarget(playlist);
+        if (target.isEmpty()) {
+            return {{QStringLiteral("ok"), false}, {QStringLiteral("error"), QStringLiteral("No consumer target in playlist %1").arg(playlist)}};
+        }
+        Job job;
+        job.playlist = playlist;
+        job.target = target;
+        job.submitted = QDateTime::currentDateTime();
+        const int id = m_nextId++;
+        m_jobs.emplace(id, job);
+        save();
+        reply.insert(QStringLiteral("id"), id);
+        QMetaObject::invokeMethod(this, "startJobs", Qt::QueuedConnection);
+    } else if (command == QLatin1String("status")) {
+        QJsonArray jobs;
+        const int id = request.value(QStringLiteral("id")).toInt(0);
+        for (const auto &it : m_jobs) {
+            if (id == 0 || it.first == id) {
+                jobs.append(jobObject(it.first, it.second));
+            }
+        }
+        reply.insert(QStringLiteral("jobs"), jobs);
+    } else if (command == QLatin1String("cancel")) {
+        auto it = m_jobs.find(request.value(QStringLiteral("id")).toInt());
+        if (it == m_jobs.end() || (it->second.status != JobStatus::Waiting && it->second.status != JobStatus::Running)) {
+            return {{QStringLiteral("ok"), false}, {QStringLiteral("error"), QStringLiteral("No pending job with this id")}};
+        }
+        Job &job = it->second;
+        if (job.process) {
+            // jobFinished() cleans up the partial file
+            job.status = JobStatus::Aborted;
+            job.process->kill();
+        } else {
+            job.status = JobStatus::Aborted;
+            save();
+            broadcast({{QStringLiteral("event"), QStringLiteral("finished")}, {QStringLiteral("job"), jobObject(it->first, job)}});
+        }
+    } else if (command == QLatin1String("clear")) {
+        // Forget the jobs that are over
+        for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+            if (it->second.status != JobStatus::Waiting && it->second.status != JobStatus::Running) {
+                it = m_jobs.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        save();
+    } else if (command == QLatin1String("subscribe")) {
+        if (!m_subscribers.contains(client)) {
+            m_subscribers << client;
+        }
+    } else {
+        return {{QStringLiteral("ok"), false}, {QStringLiteral("error"), QStringLiteral("Unknown command %1").arg(command)}};
+    }
+    return reply;
+}
+
+QJsonObject RenderQueue::jobObject(int id, const Job &job) const
+{
+    QJsonObject object{{QStringLiteral("id"), id},
+                       {QStringLiteral("playlist"), job.playlist},
+                       {QStringLiteral("target"), job.target},
+                       {QStringLiteral("status"), statusName(job.status)},
+                       {QStringLiteral("progress"), job.progress},
+                       {QStringLiteral("frame"), job.frame},
+                       {QStringLiteral("submitted"), job.submitted.toString(Qt::ISODate)}};
+    if (!job.error.isEmpty()) {
+        object.insert(QStringLiteral("error"), job.error);
+    }
+    return object;
+}
+
+bool RenderQueue::canStartJob() const
+{
+    if (m_runningJobs >= m_maxJobs) {
+        return false;
+    }
+    if (m_runningJobs == 0) {
+        // Always render something
+        return true;
+    }
+    const qint64 memory = availableMemory();
+    if (memory >= 0 && memory < m_minFreeMemory) {
+        return false;
+    }
+    // The running jobs already keep all the cores busy
+    const double load = loadAverage();
+    return load < 0 || load < QThread::idealThreadCount() - 1;
+}
+
+void RenderQueue::startJobs()
+{
+    // The load average and free memory take a while to show a new job, so admit at most one per check
+    bool started = false;
+    bool waiting = false;
+    for (auto &it : m_jobs) {
+        if (it.second.status != JobStatus::Waiting) {
+            continue;
+        }
+        if (started || !canStartJob()) {
+            waiting = true;
+            break;
+        }
+        startJob(it.first, it.second);
+        started = true;
+    }
+    // Check again later, when the load or memory use may have dropped
+    if (waiting && m_runningJobs > 0) {
+        m_admissionTimer.start();
+    } else {
+        m_admissionTimer.stop();
+    }
+}
+
+void RenderQueue::startJob(int id, Job &job)
+{
+    job.status = JobStatus::Running;
+    job.progress = 0;
+    job.frame = 0;
+    job.error.clear();
+    job.process = new QProcess(this);
+    job.process->setReadChannel(QProcess::StandardError);
+    connect(job.process, &QProcess::readyReadStandardError, this, [this, id]() { jobOutput(id); });
+    connect(job.process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, [this, id]() { jobFinished(id); });
+    connect(job.process, &QProcess::errorOccurred, this, [this, id](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            jobFinished(id);
+        }
+    });
+    m_runningJobs++;
+    job.process->start(m_melt, {QStringLiteral("-progress"), job.playlist});
+    save();
+    broadcast({{QStringLiteral("event"), QStringLiteral("started")}, {QStringLiteral("job"), jobObject(id, job)}});
+}
+
+void RenderQueue::jobOutput(int id)
+{
+    Job &job = m_jobs.at(id);
+    const QString result = QString::fromLocal8Bit(job.process->readAllStandardError()).simplified();
+    if (!result.startsWith(QLatin1String("Current Frame"))) {
+        job.error.append(result + QLatin1Char('\n'));
+        if (job.error.size() > MaxErrorLength) {
+            job.error.remove(0, job.error.size() - MaxErrorLength);
+        }
+        return;
+    }
+    const int progress = result.section(QLatin1Char(' '), -1).toInt();
+    if (progress <= job.progress || progress > 100) {
+        return;
+    }
+    job.progress = progress;
+    job.frame = result.section(QLatin1Char(','), 0, 0).section(QLatin1Char(' '), -1).toInt();
+    broadcast({{QStringLiteral("event"), QStringLiteral("progress")},
+               {QStringLiteral("id"), id},
+               {QStringLiteral("progress"), job.progress},
+               {QStringLiteral("frame"), job.frame}});
+}
+
+void RenderQueue::jobFinished(int id)
+{
+    Job &job = m_jobs.at(id);
+    if (!job.process) {
+        return;
+    }
+    QProcess *process = job.process;
+    job.process = nullptr;
+    m_runningJobs--;
+    if (job.status == JobStatus::Aborted) {
+        QFile::remove(job.target);
+    } else if (process->error() == QProcess::FailedToStart) {
+        job.status = JobStatus::Failed;
+        job.error = QStringLiteral("Cannot start %1").arg(m_melt);
+    } else if (process->exitStatus() == QProcess::CrashExit || process->exitCode() != 0) {
+        job.status = JobStatus::Failed;
+    } else {
+        job.status = JobStatus::Finished;
+        job.progress = 100;
+        job.error.clear();
+    }
+    process->deleteLater();
+    save();
+    broadcast({{QStringLiteral("event"), QStringLiteral("finished")}, {QStringLiteral("job"), jobObject(id, job)}});
+    startJobs();
+}
+
+void RenderQueue::broadcast(const QJsonObject &event)
+{
+    const QByteArray data = QJsonDocument(event).toJson(QJsonDocument::Compact) + '\n';
+    for (QLocalSocket *client : qAsConst(m_subscribers)) {
+        client->write(data);
+        client->flush();
+    }
+}
+
+void RenderQueue::load()
+{
+    QFile file(m_queueFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QJsonObject queue = QJsonDocument::fromJson(file.readAll()).object();
+    m_nextId = qMax(1, queue.value(QStringLiteral("nextId")).toInt());
+    const QJsonArray jobs = queue.value(QStringLiteral("jobs")).toArray();
+    for (const QJsonValue &value : jobs) {
+        const QJsonObject object = value.toObject();
+        const int id = object.value(QStringLiteral("id")).toInt();
+        if (id <= 0) {
+            continue;
+        }
+        Job job;
+        job.playlist = object.value(QStringLiteral("playlist")).toString();
+        job.target = object.value(QStringLiteral("target")).toString();
+        job.status = statusFromName(object.value(QStringLiteral("status")).toString());
+        job.progress = object.value(QStringLiteral("progress")).toInt();
+        job.frame = object.value(QStringLiteral("frame")).toInt();
+        job.error = object.value(QStringLiteral("error")).toString();
+        job.submitted = QDateTime::fromString(object.value(QStringLiteral("submitted")).toString(), Qt::ISODate);
+        if (job.status == JobStatus::Running) {
+            // Interrupted by a shutdown, render it again
+            job.status = JobStatus::Waiting;
+            job.progress = 0;
+            job.frame = 0;
+        }
+        m_jobs.emplace(id, job);
+        m_nextId = qMax(m_nextId, id + 1);
+    }
+}
+
+void RenderQueue::save() const
+{
+    QJsonArray jobs;
+    for (const auto &it : m_jobs) {
+        jobs.append(jobObject(it.first, it.second));
+    }
+    QDir().mkpath(QFileInfo(m_queueFile).absolutePath());
+    QSaveFile file(m_queueFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot save render queue to" << m_queueFile;
+        return;
+    }
+    file.write(QJsonDocument(QJsonObject{{QStringLiteral("nextId"), m_nextId}, {QStringLiteral("jobs"), jobs}}).toJson());
+    file.commit();
+}
+
+// static
+QString RenderQueue::statusName(JobStatus status)
+{
+    switch (status) {
+    case JobStatus::Running:
+        return QStringLiteral("running");
+    case JobStatus::Finished:
+        return QStringLiteral("finished");
+    case JobStatus::Failed:
+        return QStringLiteral("failed");
+    case JobStatus::Aborted:
+        return QStringLiteral("aborted");
+    default:
+        return QStringLiteral("waiting");
+    }
+}
+
+// static
+RenderQueue::JobStatus RenderQueue::statusFromName(const QString &name)
+{
+    for (JobStatus status : {JobStatus::Running, JobStatus::Finished, JobStatus::Failed, JobStatus::Aborted}) {
+        if (name == statusName(status)) {
+            return status;
+        }
+    }
+    return JobStatus::Waiting;
+}
+
+// static
+qint64 RenderQueue::availableMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile meminfo(QStringLiteral("/proc/meminfo"));
+    if (meminfo.open(QIODevice::ReadOnly)) {
+        while (!meminfo.atEnd()) {
+            const QByteArray line = meminfo.readLine().simplified();
+            if (line.startsWith("MemAvailable:")) {
+                // Value in kB
+                return line.split(' ').value(1).toLongLong() * 1024;
+            }
+        }
+    }
+#endif
+    return -1;
+}
+
+// static
+double RenderQueue::loadAverage()
+{
+#ifdef Q_OS_LINUX
+    QFile loadavg(QStringLiteral("/proc/loadavg"));
+    if (loadavg.open(QIODevice::ReadOnly)) {
+        bool ok;
+        const double load = loadavg.readLine().split(' ').value(0).toDouble(&ok);
+        if (ok) {
+            return load;
+        }
+    }
+#endif
+    return -1;
+}
+
+// static
+QString RenderQueue::playlistTarget(const QString &playlist)
+{
+    QFile file(playlist);
+    QDomDocument doc;
+    if (!file.open(QIODevice::ReadOnly) || !doc.setContent(&file, false)) {
+        return QString();
+    }
+    return doc.documentElement().firstChildElement(QStringLiteral("consumer")).attribute(QStringLiteral("target"));
+}
@@ -0,0 +1,95 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QDateTime>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+#include <map>
+
+/** @class RenderQueue
+    @brief Persistent render queue served over a local socket by kdenlive_renderqueue.
+
+    Jobs are MLT playlists with an embedded consumer, as written by the render widget or its scripts.
+    They are rendered by melt, several at a time when the machine has enough free memory and idle cores,
+    and the queue is saved after each change so that waiting and interrupted jobs are resumed on restart.
+    The protocol is described in dev-docs/renderqueue.md.
+ */
+class RenderQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class JobStatus { Waiting, Running, Finished, Failed, Aborted };
+
+    /** @param melt path to the melt executable
+        @param maxJobs maximum number of jobs rendering at the same time
+        @param minFreeMemory memory in bytes that must be available to start a job while another one is running
+        @param queueFile file the jobs are saved to, renderqueue.json in the application data folder if empty */
+    RenderQueue(const QString &melt, int maxJobs, qint64 minFreeMemory, const QString &queueFile = QString(), QObject *parent = nullptr);
+    ~RenderQueue() override;
+
+    /** @brief Start accepting clients on socket @p name, returns false if it is in use */
+    bool listen(const QString &name);
+    /** @brief Name of the socket used when none is given */
+    static QString defaultServerName();
+
+private slots:
+    void clientConnected();
+    void clientData();
+    /** @brief Start a waiting job if the limits allow it, further ones on the next admission checks */
+    void startJobs();
+
+private:
+    struct Job
+    {
+        QString playlist;
+        QString target;
+        JobStatus status = JobStatus::Waiting;
+        int progress = 0;
+        int frame = 0;
+        QString error;
+        QDateTime submitted;
+        QProcess *process = nullptr;
+    };
+    QString m_melt;
+    int m_maxJobs;
+    qint64 m_minFreeMemory;
+    QLocalServer m_server;
+    /** @brief Jobs by id, ids are increasing so this is the submission order */
+    std::map<int, Job> m_jobs;
+    int m_nextId{1};
+    int m_runningJobs{0};
+    /** @brief Clients that asked to receive the progress events */
+    QList<QLocalSocket *> m_subscribers;
+    QString m_queueFile;
+    /** @brief Retry admission while jobs are waiting on resources */
+    QTimer m_admissionTimer;
+
+    QJsonObject handleRequest(const QJsonObject &request, QLocalSocket *client);
+    QJsonObject jobObject(int id, const Job &job) const;
+    bool canStartJob() const;
+    void startJob(int id, Job &job);
+    void jobOutput(int id);
+    void jobFinished(int id);
+    /** @brief Send @p event to the subscribed clients */
+    void broadcast(const QJsonObject &event);
+    void load();
+    void save() const;
+    static QString statusName(JobStatus status);
+    static JobStatus statusFromName(const QString &name);
+    /** @brief Available memory in bytes, -1 if unknown */
+    static qint64 availableMemory();
+    /** @brief One minute load average, -1 if unknown */
+    static double loadAverage();
+    /** @brief Read the target of the consumer embedded in @p playlist */
+    static QString playlistTarget(const QString &playlist);
+};
@@ -0,0 +1,83 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "rendersegments.h"
+
+#include <QtGlobal>
+
+// static
+bool RenderSegments::hasAudio(const QDomElement &consumer)
+{
+    return consumer.attribute(QStringLiteral("an")) != QLatin1String("1") && consumer.attribute(QStringLiteral("audio_off")) != QLatin1String("1");
+}
+
+// static
+std::vector<RenderSegments::Part> RenderSegments::split(int in, int out, const QList<int> &starts, bool audio)
+{
+    std::vector<Part> parts;
+    QList<int> cuts = {in};
+    for (int start : starts) {
+        if (start > cuts.last() && start <= out) {
+            cuts << start;
+        }
+    }
+    if (cuts.count() < 2) {
+        return parts;
+    }
+    for (int i = 0; i < cuts.count(); ++i) {
+        parts.push_back({cuts.at(i), i + 1 < cuts.count() ? cuts.at(i + 1) - 1 : out, false});
+    }
+    if (audio) {
+        parts.push_back({in, out, true});
+    }
+    return parts;
+}
+
+// static
+QDomDocument RenderSegments::partPlaylist(const QDomDocument &doc, const Part &part, const QString &target, int threads)
+{
+    QDomDocument result = doc.cloneNode(true).toDocument();
+    QDomElement consumer = result.documentElement().firstChildElement(QStringLiteral("consumer"));
+    consumer.setAttribute(QStringLiteral("in"), part.in);
+    consumer.setAttribute(QStringLiteral("out"), part.out);
+    consumer.setAttribute(QStringLiteral("target"), target);
+    consumer.setAttribute(QStringLiteral("real_time"), -qMax(1, threads));
+    if (part.audio) {
+        // Lossless, it is encoded with the requested codec when joining the parts
+        consumer.setAttribute(QStringLiteral("vn"), 1);
+        consumer.setAttribute(QStringLiteral("f"), QStringLiteral("matroska"));
+        consumer.setAttribute(QStringLiteral("acodec"), QStringLiteral("flac"));
+        consumer.removeAttribute(QStringLiteral("ab"));
+        consumer.removeAttribute(QStringLiteral("aq"));
+    } else {
+        consumer.setAttribute(QStringLiteral("an"), 1);
+    }
+    return result;
+}
+
+// static
+QStringList RenderSegments::concatArguments(const QDomElement &consumer, const QString &list, const QString &audio, const QString &dest)
+{
+    QStringList args = {QStringLiteral("-y"), QStringLiteral("-v"), QStringLiteral("error"), QStringLiteral("-f"), QStringLiteral("concat"),
+                        QStringLiteral("-safe"), QStringLiteral("0"), QStringLiteral("-i"), list};
+    if (audio.isEmpty()) {
+        args << QStringLiteral("-map") << QStringLiteral("0") << QStringLiteral("-c") << QStringLiteral("copy") << dest;
+        return args;
+    }
+    args << QStringLiteral("-i") << audio << QStringLiteral("-map") << QStringLiteral("0:v") << QStringLiteral("-map") << QStringLiteral("1:a")
+         << QStringLiteral("-c:v") << QStringLiteral("copy");
+    const QString codec = consumer.attribute(QStringLiteral("acodec"));
+    if (!codec.isEmpty()) {
+        args << QStringLiteral("-c:a") << codec;
+    }
+    if (consumer.hasAttribute(QStringLiteral("ab"))) {
+        args << QStringLiteral("-b:a") << consumer.attribute(QStringLiteral("ab"));
+    } else if (consumer.hasAttribute(QStringLiteral("aq"))) {
+        args << QStringLiteral("-q:a") << consumer.attribute(QStringLiteral("aq"));
+    }
+    args << dest;
+    return args;
+}
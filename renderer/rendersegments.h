@@ -0,0 +1,45 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QDomDocument>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+/** @struct RenderSegments
+    @brief Splits a render in parts rendered by parallel melt processes and joined with ffmpeg.
+
+    The video is rendered in consecutive parts without audio. Audio frames do not line up with
+    the video frames at the cuts, so joining encoded audio parts would leave small gaps: the audio
+    of the whole range is rendered once, lossless, by its own process and encoded while joining.
+ */
+struct RenderSegments
+{
+    struct Part
+    {
+        int in;
+        int out;
+        /** @brief True for the part rendering the audio of the whole range */
+        bool audio;
+    };
+
+    /** @brief Returns false if the consumer of the playlist disables the audio */
+    static bool hasAudio(const QDomElement &consumer);
+    /** @brief Split [in, out] at the given frames, followed by an audio part if @p audio is true
+        Returns an empty list if the range cannot be split in at least two video parts.
+     */
+    static std::vector<Part> split(int in, int out, const QList<int> &starts, bool audio);
+    /** @brief Returns a copy of the playlist @p doc rendering @p part to @p target with @p threads processing threads */
+    static QDomDocument partPlaylist(const QDomDocument &doc, const Part &part, const QString &target, int threads);
+    /** @brief Arguments of the ffmpeg process joining the video parts listed in @p list and the @p audio file into @p dest
+        The audio is encoded with the codec of @p consumer, the consumer of the original playlist.
+        If @p audio is empty, the parts are joined as they are.
+     */
+    static QStringList concatArguments(const QDomElement &consumer, const QString &list, const QString &audio, const QString &dest);
+};
@@ -0,0 +1,259 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "rendertelemetry.h"
+
+#include <QDomDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Number of sections the rendered range is split in
+const int MaxSections = 100;
+// Number of sections detailed in the report
+const int SlowestCount = 5;
+// A process that does not reach a new frame for this long is stalled
+const qint64 StallMs = 10000;
+
+QString property(const QDomElement &element, const QString &name)
+{
+    QDomElement child = element.firstChildElement(QStringLiteral("property"));
+    while (!child.isNull()) {
+        if (child.attribute(QStringLiteral("name")) == name) {
+            return child.text();
+        }
+        child = child.nextSiblingElement(QStringLiteral("property"));
+    }
+    return QString();
+}
+
+// Convert a time property to frames, it is stored as a clock value in Kdenlive's playlists
+int toFrames(const QString &value, double fps)
+{
+    if (!value.contains(QLatin1Char(':'))) {
+        return value.toInt();
+    }
+    const QStringList parts = value.split(QLatin1Char(':'));
+    double seconds = 0;
+    for (const QString &part : parts) {
+        seconds = seconds * 60 + part.toDouble();
+    }
+    return int(std::lround(seconds * fps));
+}
+
+QString effectName(const QDomElement &element)
+{
+    const QString id = property(element, QStringLiteral("kdenlive_id"));
+    return id.isEmpty() ? property(element, QStringLiteral("mlt_service")) : id;
+}
+} // namespace
+
+void RenderTelemetry::start()
+{
+    m_started = QDateTime::currentDateTime();
+    m_timer.start();
+}
+
+void RenderTelemetry::addSample(int stream, int frame)
+{
+    std::vector<Sample> &samples = m_samples[stream];
+    // Only keep the time at which each frame was first reached
+    if (samples.empty() || frame > samples.back().frame) {
+        samples.push_back({m_timer.elapsed(), frame});
+    }
+}
+
+// static
+double RenderTelemetry::timeAt(const std::vector<Sample> &samples, int frame)
+{
+    if (frame <= samples.front().frame) {
+        return samples.front().ms;
+    }
+    if (frame >= samples.back().frame) {
+        return samples.back().ms;
+    }
+    auto next = std::lower_bound(samples.cbegin(), samples.cend(), frame, [](const Sample &sample, int f) { return sample.frame < f; });
+    auto previous = next - 1;
+    return previous->ms + double(next->ms - previous->ms) * (frame - previous->frame) / (next->frame - previous->frame);
+}
+
+std::vector<RenderTelemetry::Section> RenderTelemetry::sections() const
+{
+    std::vector<Section> result;
+    int total = 0;
+    for (const auto &it : m_samples) {
+        total += it.second.back().frame - it.second.front().frame;
+    }
+    if (total <= 0) {
+        return result;
+    }
+    const int size = qMax(1, (total + MaxSections - 1) / MaxSections);
+    for (const auto &it : m_samples) {
+        const std::vector<Sample> &samples = it.second;
+        const int last = samples.back().frame;
+        for (int start = samples.front().frame; start < last; start += size) {
+            const int end = qMin(start + size, last);
+            result.push_back({start, end - 1, (timeAt(samples, end) - timeAt(samples, start)) / 1000.});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const Section &a, const Section &b) { return a.start < b.start; });
+    return result;
+}
+
+// static
+QJsonArray RenderTelemetry::clipsInRange(const QDomDocument &doc, int start, int end)
+{
+    QJsonArray clips;
+    const QDomElement root = doc.documentElement();
+    const QDomElement profile = root.firstChildElement(QStringLiteral("profile"));
+    double fps = 25;
+    if (profile.attribute(QStringLiteral("frame_rate_den")).toInt() > 0) {
+        fps = profile.attribute(QStringLiteral("frame_rate_num")).toDouble() / profile.attribute(QStringLiteral("frame_rate_den")).toDouble();
+    }
+    // Names of the producers and tracks
+    QHash<QString, QString> names;
+    for (const QString &tag : {QStringLiteral("producer"), QStringLiteral("chain")}) {
+        const QDomNodeList producers = doc.elementsByTagName(tag);
+        for (int i = 0; i < producers.count(); ++i) {
+            const QDomElement producer = producers.at(i).toElement();
+            QString name = property(producer, QStringLiteral("kdenlive:clipname"));
+            if (name.isEmpty()) {
+                name = QFileInfo(property(producer, QStringLiteral("resource"))).fileName();
+            }
+            names.insert(producer.attribute(QStringLiteral("id")), name);
+        }
+    }
+    QHash<QString, QString> trackNames;
+    const QDomNodeList tractors = doc.elementsByTagName(QStringLiteral("tractor"));
+    for (int i = 0; i < tractors.count(); ++i) {
+        const QDomElement tractor = tractors.at(i).toElement();
+        const QString trackName = property(tractor, QStringLiteral("kdenlive:track_name"));
+        QDomElement track = tractor.firstChildElement(QStringLiteral("track"));
+        while (!track.isNull()) {
+            trackNames.insert(track.attribute(QStringLiteral("producer")), trackName);
+            track = track.nextSiblingElement(QStringLiteral("track"));
+        }
+        // Compositions active in the range, ignoring the track compositing added by Kdenlive
+        QDomElement transition = tractor.firstChildElement(QStringLiteral("transition"));
+        while (!transition.isNull()) {
+            const int in = toFrames(transition.attribute(QStringLiteral("in")), fps);
+            const int out = toFrames(transition.attribute(QStringLiteral("out")), fps);
+            if (property(transition, QStringLiteral("internal_added")).isEmpty() && in <= end && out >= start) {
+                clips.append(QJsonObject{{QStringLiteral("composition"), effectName(transition)},
+                                         {QStringLiteral("track"), trackName},
+                                         {QStringLiteral("start"), in},
+                                         {QStringLiteral("end"), out}});
+            }
+            transition = transition.nextSiblingElement(QStringLiteral("transition"));
+        }
+    }
+    const QDomNodeList playlists = doc.elementsByTagName(QStringLiteral("playlist"));
+    for (int i = 0; i < playlists.count(); ++i) {
+        const QDomElement playlist = playlists.at(i).toElement();
+        const QString playlistId = playlist.attribute(QStringLiteral("id"));
+        if (playlistId == QLatin1String("main_bin")) {
+            continue;
+        }
+        int position = 0;
+        QDomElement item = playlist.firstChildElement();
+        while (!item.isNull() && position <= end) {
+            if (item.tagName() == QLatin1String("blank")) {
+                position += toFrames(item.attribute(QStringLiteral("length")), fps);
+            } else if (item.tagName() == QLatin1String("entry")) {
+                const int length = toFrames(item.attribute(QStringLiteral("out")), fps) - toFrames(item.attribute(QStringLiteral("in")), fps) + 1;
+                if (position + length > start) {
+                    QJsonArray effects;
+                    QDomElement filter = item.firstChildElement(QStringLiteral("filter"));
+                    while (!filter.isNull()) {
+                        effects.append(effectName(filter));
+                        filter = filter.nextSiblingElement(QStringLiteral("filter"));
+                    }
+                    clips.append(QJsonObject{{QStringLiteral("clip"), names.value(item.attribute(QStringLiteral("producer")))},
+                                             {QStringLiteral("track"), trackNames.value(playlistId)},
+                                             {QStringLiteral("start"), position},
+                                             {QStringLiteral("end"), position + length - 1},
+                                             {QStringLiteral("effects"), effects}});
+                }
+                position += length;
+            }
+            item = item.nextSiblingElement();
+        }
+    }
+    return clips;
+}
+
+QJsonObject RenderTelemetry::report(const QString &playlist) const
+{
+    QJsonObject report;
+    report.insert(QStringLiteral("started"), m_started.toString(Qt::ISODate));
+    const double duration = m_timer.isValid() ? m_timer.elapsed() / 1000. : 0.;
+    report.insert(QStringLiteral("duration"), duration);
+    int frames = 0;
+    qint64 startup = -1;
+    QJsonArray stalls;
+    for (const auto &it : m_samples) {
+        const std::vector<Sample> &samples = it.second;
+        frames += samples.back().frame - samples.front().frame + 1;
+        startup = startup < 0 ? samples.front().ms : qMin(startup, samples.front().ms);
+        for (size_t i = 1; i < samples.size(); ++i) {
+            if (samples[i].ms - samples[i - 1].ms > StallMs) {
+                stalls.append(QJsonObject{{QStringLiteral("frame"), samples[i - 1].frame + 1},
+                                          {QStringLiteral("seconds"), (samples[i].ms - samples[i - 1].ms) / 1000.}});
+            }
+        }
+    }
+    report.insert(QStringLiteral("frames"), frames);
+    report.insert(QStringLiteral("fps"), duration > 0 ? frames / duration : 0.);
+    report.insert(QStringLiteral("startup"), qMax(qint64(0), startup) / 1000.);
+    report.insert(QStringLiteral("stalls"), stalls);
+
+    std::vector<Section> sections = this->sections();
+    QJsonArray throughput;
+    for (const Section &section : sections) {
+        throughput.append(QJsonObject{{QStringLiteral("start"), section.start},
+                                      {QStringLiteral("end"), section.end},
+                                      {QStringLiteral("fps"), section.seconds > 0 ? (section.end - section.start + 1) / section.seconds : 0.}});
+    }
+    report.insert(QStringLiteral("throughput"), throughput);
+
+    QJsonArray slowest;
+    if (sections.size() > 1) {
+        std::sort(sections.begin(), sections.end(),
+                  [](const Section &a, const Section &b) { return a.seconds / (a.end - a.start + 1) > b.seconds / (b.end - b.start + 1); });
+        sections.resize(qMin(sections.size(), size_t(SlowestCount)));
+        QDomDocument doc;
+        QFile file(playlist);
+        if (file.open(QIODevice::ReadOnly)) {
+            doc.setContent(&file, false);
+        }
+        for (const Section &section : sections) {
+            slowest.append(QJsonObject{{QStringLiteral("start"), section.start},
+                                       {QStringLiteral("end"), section.end},
+                                       {QStringLiteral("fps"), section.seconds > 0 ? (section.end - section.start + 1) / section.seconds : 0.},
+                                       {QStringLiteral("clips"), doc.isNull() ? QJsonArray() : clipsInRange(doc, section.start, section.end)}});
+        }
+    }
+    report.insert(QStringLiteral("slowest"), slowest);
+    return report;
+}
+
+bool RenderTelemetry::save(const QString &fileName, const QString &playlist) const
+{
+    if (m_samples.empty()) {
+        return false;
+    }
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(report(playlist)).toJson());
+    return file.commit();
+}
@@ -0,0 +1,58 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <map>
+#include <vector>
+
+class QDomDocument;
+
+/** @class RenderTelemetry
+    @brief Records when each frame was reached during a render and builds a throughput report.
+
+    Samples come from the progress lines of the melt processes, one stream per process.
+    The rendered range is split in sections whose speed is interpolated from the samples,
+    and the slowest ones are mapped to the clips and effects of the playlist at that position.
+ */
+class RenderTelemetry
+{
+public:
+    /** @brief Start the clock, the time until the first sample of a stream is its startup time */
+    void start();
+    /** @brief Record that the process rendering @p stream reached @p frame */
+    void addSample(int stream, int frame);
+    /** @brief Build the report, @p playlist is the rendered MLT playlist used to find the clips of the slowest sections */
+    QJsonObject report(const QString &playlist) const;
+    /** @brief Write the report to @p fileName, returns false on error */
+    bool save(const QString &fileName, const QString &playlist) const;
+
+private:
+    struct Sample
+    {
+        qint64 ms;
+        int frame;
+    };
+    struct Section
+    {
+        int start;
+        int end;
+        double seconds;
+    };
+    QElapsedTimer m_timer;
+    QDateTime m_started;
+    std::map<int, std::vector<Sample>> m_samples;
+
+    /** @brief Time at which @p frame was reached, interpolated between the samples of a stream */
+    static double timeAt(const std::vector<Sample> &samples, int frame);
+    std::vector<Section> sections() const;
+    /** @brief Describe the clips of @p doc overlapping frames [start, end] */
+    static QJsonArray clipsInRange(const QDomDocument &doc, int start, int end);
+};
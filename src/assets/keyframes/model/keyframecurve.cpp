@@ -0,0 +1,212 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "keyframecurve.hpp"
+
+#include <QtGlobal>
+#include <algorithm>
+
+KeyframeCurve::KeyframeCurve(std::vector<int> frames, std::vector<mlt_keyframe_type> types, std::vector<double> values, int components)
+    : m_components(qMax(1, components))
+    , m_frames(std::move(frames))
+    , m_values(std::move(values))
+{
+    Q_ASSERT(m_frames.size() == types.size());
+    Q_ASSERT(m_values.size() == m_frames.size() * size_t(m_components));
+    if (m_frames.empty()) {
+        // Behave like an empty animation
+        m_frames.push_back(0);
+        m_values.assign(size_t(m_components), 0.);
+        types.push_back(mlt_keyframe_linear);
+    }
+    const size_t keys = m_frames.size();
+    const size_t comps = size_t(m_components);
+    m_segments.reserve(keys - 1);
+    m_coefficients.resize((keys - 1) * comps * 4);
+    for (size_t i = 0; i + 1 < keys; ++i) {
+        m_segments.push_back({types[i], double(m_frames[i + 1] - m_frames[i])});
+        // Like MLT, smooth segments use the previous and next keys, repeating the bounds
+        const size_t i0 = i > 0 ? i - 1 : i;
+        const size_t i3 = i + 2 < keys ? i + 2 : i + 1;
+        for (size_t c = 0; c < comps; ++c) {
+            const double y0 = m_values[i0 * comps + c];
+            const double y1 = m_values[i * comps + c];
+            const double y2 = m_values[(i + 1) * comps + c];
+            const double y3 = m_values[i3 * comps + c];
+            double *a = &m_coefficients[(i * comps + c) * 4];
+            switch (types[i]) {
+            case mlt_keyframe_smooth:
+                // Catmull-Rom spline
+                a[0] = -0.5 * y0 + 1.5 * y1 - 1.5 * y2 + 0.5 * y3;
+                a[1] = y0 - 2.5 * y1 + 2 * y2 - 0.5 * y3;
+                a[2] = -0.5 * y0 + 0.5 * y2;
+                a[3] = y1;
+                break;
+            case mlt_keyframe_linear:
+                a[0] = 0.;
+                a[1] = 0.;
+                a[2] = y2 - y1;
+                a[3] = y1;
+                break;
+            default:
+                a[0] = 0.;
+                a[1] = 0.;
+                a[2] = 0.;
+                a[3] = y1;
+                break;
+            }
+        }
+    }
+}
+
+std::shared_ptr<const KeyframeCurve> KeyframeCurve::compile(Mlt::Properties &properties, const char *name, bool rect)
+{
+    const int components = rect ? 5 : 1;
+    std::vector<int> frames;
+    std::vector<mlt_keyframe_type> types;
+    std::vector<double> values;
+    auto appendValue = [&](int frame) {
+        if (rect) {
+            mlt_rect r = properties.anim_get_rect(name, frame);
+            values.insert(values.end(), {r.x, r.y, r.w, r.h, r.o});
+        } else {
+            values.push_back(properties.anim_get_double(name, frame));
+        }
+    };
+    Mlt::Animation anim = properties.get_animation(name);
+    if (anim.is_valid()) {
+        const int count = anim.key_count();
+        frames.reserve(size_t(count));
+        types.reserve(size_t(count));
+        values.reserve(size_t(count * components));
+        for (int i = 0; i < count; ++i) {
+            int frame;
+            mlt_keyframe_type type;
+            if (anim.key_get(i, frame, type) != 0 || (!frames.empty() && frame <= frames.back())) {
+                continue;
+            }
+            frames.push_back(frame);
+            types.push_back(type);
+            appendValue(frame);
+        }
+    }
+    if (frames.empty()) {
+        // Not animated, the value is constant
+        frames.push_back(0);
+        types.push_back(mlt_keyframe_linear);
+        appendValue(0);
+    }
+    return std::make_shared<const KeyframeCurve>(std::move(frames), std::move(types), std::move(values), components);
+}
+
+int KeyframeCurve::components() const
+{
+    return m_components;
+}
+
+int KeyframeCurve::keyCount() const
+{
+    return int(m_frames.size());
+}
+
+int KeyframeCurve::keyAt(int frame) const
+{
+    auto it = std::upper_bound(m_frames.cbegin(), m_frames.cend(), frame);
+    return int(std::distance(m_frames.cbegin(), it)) - 1;
+}
+
+double KeyframeCurve::evaluate(int segment, int component, double progress) const
+{
+    const double *a = &m_coefficients[(size_t(segment) * size_t(m_components) + size_t(component)) * 4];
+    switch (m_segments[size_t(segment)].type) {
+    case mlt_keyframe_smooth: {
+        // Same evaluation order as MLT's catmull_rom_interpolate
+        const double t2 = progress * progress;
+        return a[0] * progress * t2 + a[1] * t2 + a[2] * progress + a[3];
+    }
+    case mlt_keyframe_linear:
+        return a[3] + a[2] * progress;
+    default:
+        return a[3];
+    }
+}
+
+void KeyframeCurve::value(int frame, double *out) const
+{
+    const int key = keyAt(frame);
+    const size_t comps = size_t(m_components);
+    if (key < 0 || key + 1 >= int(m_frames.size()) || frame == m_frames[size_t(key)]) {
+        // Before the first key, after the last one or on a key: no interpolation
+        const double *keyValues = &m_values[size_t(qMax(0, key)) * comps];
+        std::copy(keyValues, keyValues + comps, out);
+        return;
+    }
+    double progress = frame - m_frames[size_t(key)];
+    progress /= m_segments[size_t(key)].length;
+    for (int c = 0; c < m_components; ++c) {
+        out[c] = evaluate(key, c, progress);
+    }
+}
+
+double KeyframeCurve::value(int frame, int component) const
+{
+    Q_ASSERT(component >= 0 && component < m_components);
+    const int key = keyAt(frame);
+    if (key < 0 || key + 1 >= int(m_frames.size()) || frame == m_frames[size_t(key)]) {
+        return m_values[size_t(qMax(0, key)) * size_t(m_components) + size_t(component)];
+    }
+    double progress = frame - m_frames[size_t(key)];
+    progress /= m_segments[size_t(key)].length;
+    return evaluate(key, component, progress);
+}
+
+void KeyframeCurve::values(int from, int count, int component, double *out) const
+{
+    Q_ASSERT(component >= 0 && component < m_components);
+    const size_t comps = size_t(m_components);
+    const int keys = int(m_frames.size());
+    int key = keyAt(from);
+    int i = 0;
+    while (i < count) {
+        const int frame = from + i;
+        if (key < 0 || key + 1 >= keys) {
+            // Constant before the first key and after the last one
+            const double value = m_values[size_t(qMax(0, key)) * comps + size_t(component)];
+            const int end = key < 0 ? qMin(count, m_frames.front() - from) : count;
+            std::fill(out + i, out + end, value);
+            i = end;
+            key++;
+            continue;
+        }
+        const int start = m_frames[size_t(key)];
+        const int end = qMin(count, m_frames[size_t(key) + 1] - from);
+        const double length = m_segments[size_t(key)].length;
+        if (frame == start) {
+            out[i++] = m_values[size_t(key) * comps + size_t(component)];
+        }
+        // One branch free loop per segment type, so that the compiler can vectorize it
+        const double *a = &m_coefficients[(size_t(key) * comps + size_t(component)) * 4];
+        const double offset = from - start;
+        switch (m_segments[size_t(key)].type) {
+        case mlt_keyframe_smooth:
+            for (; i < end; ++i) {
+                const double progress = (offset + i) / length;
+                const double t2 = progress * progress;
+                out[i] = a[0] * progress * t2 + a[1] * t2 + a[2] * progress + a[3];
+            }
+            break;
+        case mlt_keyframe_linear:
+            for (; i < end; ++i) {
+                out[i] = a[3] + a[2] * ((offset + i) / length);
+            }
+            break;
+        default:
+            std::fill(out + i, out + end, a[3]);
+            i = end;
+            break;
+        }
+        key++;
+    }
+}
@@ -0,0 +1,63 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <memory>
+#include <mlt++/Mlt.h>
+#include <vector>
+
+/** @class KeyframeCurve
+    @brief Compiled form of an MLT animation, used to interpolate keyframed parameters without parsing their string.
+
+   The animation is parsed once by MLT, then its keys are stored in sorted arrays along with
+   the polynomial coefficients of each segment. Lookups are a binary search followed by the
+   evaluation of the segment, using the same formulas as MLT so that the values are identical.
+   Rect animations have 5 components (x, y, w, h, opacity), scalar ones only one.
+ */
+class KeyframeCurve
+{
+public:
+    /** @brief Build the curve from the keys of an animation
+       @param frames the sorted key positions
+       @param types the interpolation type of the segment starting at each key
+       @param values the key values, @p components consecutive values per key
+     */
+    KeyframeCurve(std::vector<int> frames, std::vector<mlt_keyframe_type> types, std::vector<double> values, int components = 1);
+
+    /** @brief Parse the animation stored in property @p name, which must have been parsed with its duration.
+       Returns a curve with a single key if the property is not animated. */
+    static std::shared_ptr<const KeyframeCurve> compile(Mlt::Properties &properties, const char *name, bool rect);
+
+    int components() const;
+    int keyCount() const;
+
+    /** @brief Write the interpolated components at @p frame in @p out, which must hold components() values */
+    void value(int frame, double *out) const;
+    /** @brief Return one interpolated component at @p frame */
+    double value(int frame, int component = 0) const;
+    /** @brief Interpolate one component for @p count consecutive frames starting at @p from.
+       The segments are walked once, so this is much cheaper than calling value() for each frame */
+    void values(int from, int count, int component, double *out) const;
+
+private:
+    struct Segment
+    {
+        mlt_keyframe_type type;
+        /** @brief Length of the segment in frames */
+        double length;
+    };
+    int m_components;
+    std::vector<int> m_frames;
+    std::vector<double> m_values;
+    std::vector<Segment> m_segments;
+    /** @brief 4 coefficients per segment and component, a0 * t³ + a1 * t² + a2 * t + a3 for smooth segments,
+        a3 + a2 * t for linear ones */
+    std::vector<double> m_coefficients;
+
+    /** @brief Index of the last key at or before @p frame, -1 if @p frame is before the first key */
+    int keyAt(int frame) const;
+    double evaluate(int segment, int component, double progress) const;
+};
@@ -5,6 +5,7 @@
 
 #include "keyframemodel.hpp"
 #include "../../bpoint.h"
+#include "keyframecurve.hpp"
 #include "core.h"
 #include "doc/docundostack.hpp"
 #include "macros.hpp"
@@ -477,7 +478,15 @@ bool KeyframeModel::updateKeyframe(GenTime pos, QVariant value)
     Fun redo = []() { return true; };
     bool res = updateKeyframe(pos, value, undo, redo);
     if (res) {
-        PUSH_UNDO(undo, redo, i18n("Update keyframe"));
+        if (auto ptr = m_undoStack.lock()) {
+            // Successive updates of the same keyframe, for example while dragging it, make a single undo step
+            auto *command = new FunctionalUndoCommand(undo, redo, i18n("Update keyframe"));
+            command->setMergeKey(QStringLiteral("keyframe-%1-%2").arg(quintptr(this)).arg(pos.frames(pCore->getCurrentFps())));
+            ptr->push(command);
+        } else {
+            qDebug() << "ERROR : unable to access undo stack";
+            Q_ASSERT(false);
+        }
     }
     return res;
 }
@@ -1092,31 +1101,27 @@ QVariant KeyframeModel::getInterpolatedValue(const GenTime &pos) const
     if (m_keyframeList.size() == 0) {
         return QVariant();
     }
-    Mlt::Properties mlt_prop;
-    QString animData;
-    int out = 0;
-    bool useOpacity = false;
-    if (auto ptr = m_model.lock()) {
-        ptr->passProperties(mlt_prop);
-        out = ptr->data(m_index, AssetParameterModel::ParentDurationRole).toInt();
-        useOpacity = ptr->data(m_index, AssetParameterModel::OpacityRole).toBool();
-        animData = ptr->data(m_index, AssetParameterModel::ValueRole).toString();
-    }
-
-    if (!animData.isEmpty() && (m_paramType == ParamType::KeyframeParam || m_paramType == ParamType::ColorWheel)) {
-        mlt_prop.set("key", animData.toUtf8().constData());
-        // This is a fake query to force the animation to be parsed
-        (void)mlt_prop.anim_get_double("key", 0, out);
-        return QVariant(mlt_prop.anim_get_double("key", pos.frames(pCore->getCurrentFps())));
+    if (m_paramType == ParamType::KeyframeParam || m_paramType == ParamType::ColorWheel) {
+        std::shared_ptr<const KeyframeCurve> curve = compiledCurve();
+        if (curve) {
+            return QVariant(curve->value(pos.frames(pCore->getCurrentFps())));
+        }
+        return QVariant();
     }
-    if (!animData.isEmpty() && m_paramType == ParamType::AnimatedRect) {
-        mlt_prop.set("key", animData.toUtf8().constData());
-        // This is a fake query to force the animation to be parsed
-        (void)mlt_prop.anim_get_double("key", 0, out);
-        mlt_rect rect = mlt_prop.anim_get_rect("key", pos.frames(pCore->getCurrentFps()));
-        QString res = QStringLiteral("%1 %2 %3 %4").arg(int(rect.x)).arg(int(rect.y)).arg(int(rect.w)).arg(int(rect.h));
+    if (m_paramType == ParamType::AnimatedRect) {
+        std::shared_ptr<const KeyframeCurve> curve = compiledCurve();
+        if (!curve) {
+            return QVariant();
+        }
+        bool useOpacity = false;
+        if (auto ptr = m_model.lock()) {
+            useOpacity = ptr->data(m_index, AssetParameterModel::OpacityRole).toBool();
+        }
+        double rect[5];
+        curve->value(pos.frames(pCore->getCurrentFps()), rect);
+        QString res = QStringLiteral("%1 %2 %3 %4").arg(int(rect[0])).arg(int(rect[1])).arg(int(rect[2])).arg(int(rect[3]));
         if (useOpacity) {
-            res.append(QStringLiteral(" %1").arg(QString::number(rect.o, 'f')));
+            res.append(QStringLiteral(" %1").arg(QString::number(rect[4], 'f')));
         }
         return QVariant(res);
     }
@@ -1164,6 +1169,48 @@ QVariant KeyframeModel::getInterpolatedValue(const GenTime &pos) const
     return QVariant();
 }
 
+QVector<double> KeyframeModel::getInterpolatedValues(int from, int count, int component) const
+{
+    QVector<double> values;
+    if (count <= 0 || !(m_paramType == ParamType::KeyframeParam || m_paramType == ParamType::ColorWheel || m_paramType == ParamType::AnimatedRect)) {
+        return values;
+    }
+    std::shared_ptr<const KeyframeCurve> curve = compiledCurve();
+    if (curve && component >= 0 && component < curve->components()) {
+        values.resize(count);
+        curve->values(from, count, component, values.data());
+    }
+    return values;
+}
+
+std::shared_ptr<const KeyframeCurve> KeyframeModel::compiledCurve() const
+{
+    auto ptr = m_model.lock();
+    if (!ptr) {
+        return nullptr;
+    }
+    int out = ptr->data(m_index, AssetParameterModel::ParentDurationRole).toInt();
+    quint64 revision = ptr->valueRevision();
+    QMutexLocker lock(&m_curveMutex);
+    if (m_curve && out == m_curveDuration && revision == m_curveRevision) {
+        return m_curve;
+    }
+    // The animation changed, parse it once and keep its compiled form for the next queries
+    QString animData = ptr->data(m_index, AssetParameterModel::ValueRole).toString();
+    if (animData.isEmpty()) {
+        return nullptr;
+    }
+    Mlt::Properties mlt_prop;
+    ptr->passProperties(mlt_prop);
+    mlt_prop.set("key", animData.toUtf8().constData());
+    // This is a fake query to force the animation to be parsed
+    (void)mlt_prop.anim_get_double("key", 0, out);
+    m_curve = KeyframeCurve::compile(mlt_prop, "key", m_paramType == ParamType::AnimatedRect);
+    m_curveRevision = revision;
+    m_curveDuration = out;
+    return m_curve;
+}
+
 void KeyframeModel::sendModification()
 {
     if (auto ptr = m_model.lock()) {
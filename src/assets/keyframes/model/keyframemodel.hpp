@@ -11,6 +11,7 @@
 #include "utils/gentime.h"
 
 #include <QAbstractListModel>
+#include <QMutex>
 #include <QReadWriteLock>
 
 #include <map>
@@ -19,6 +20,7 @@
 class AssetParameterModel;
 class DocUndoStack;
 class EffectItemModel;
+class KeyframeCurve;
 
 enum class KeyframeType { Linear = mlt_keyframe_linear, Discrete = mlt_keyframe_discrete, Curve = mlt_keyframe_smooth };
 Q_DECLARE_METATYPE(KeyframeType)
@@ -142,6 +144,9 @@ public:
     /** @brief Return the interpolated value at given pos */
     QVariant getInterpolatedValue(int pos) const;
     QVariant getInterpolatedValue(const GenTime &pos) const;
+    /** @brief Return the interpolated values of a component for @p count frames starting at @p from.
+       The component is 0 for scalar parameters, or the index of x, y, w, h, opacity for rects */
+    QVector<double> getInterpolatedValues(int from, int count, int component = 0) const;
     QVariant updateInterpolated(const QVariant &interpValue, double val);
     /** @brief Return the real value from a normalized one */
     QVariant getNormalizedValue(double newVal) const;
@@ -203,6 +208,14 @@ private:
     mutable QReadWriteLock m_lock;
 
     std::map<GenTime, std::pair<KeyframeType, QVariant>> m_keyframeList;
+    /** @brief Compiled animation of the parameter, rebuilt when the asset values or the duration change */
+    mutable std::shared_ptr<const KeyframeCurve> m_curve;
+    /** @brief Value revision of the asset model when m_curve was compiled */
+    mutable quint64 m_curveRevision{0};
+    mutable int m_curveDuration{0};
+    mutable QMutex m_curveMutex;
+    /** @brief Returns the compiled animation of the parameter, nullptr if it has no value or is not a MLT animation */
+    std::shared_ptr<const KeyframeCurve> compiledCurve() const;
     bool moveOneKeyframe(GenTime oldPos, GenTime pos, QVariant newVal, Fun &undo, Fun &redo, bool updateView = true);
 
 signals:
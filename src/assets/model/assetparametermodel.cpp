@@ -30,6 +30,7 @@ AssetParameterModel::AssetParameterModel(std::unique_ptr<Mlt::Properties> asset,
     , m_keyframes(nullptr)
     , m_activeKeyframe(-1)
     , m_filterProgress(0)
+    , m_valueRevision(0)
 {
     Q_ASSERT(m_asset->is_valid());
     QDomNodeList parameterNodes = assetXml.elementsByTagName(QStringLiteral("parameter"));
@@ -253,6 +254,26 @@ QStringList AssetParameterModel::getKeyframableParameters() const
     return paramNames;
 }
 
+quint64 AssetParameterModel::valueRevision() const
+{
+    return m_valueRevision.load();
+}
+
+void AssetParameterModel::invalidateValues()
+{
+    m_valueRevision++;
+}
+
+qint64 AssetParameterModel::memoryEstimate() const
+{
+    // The value also lives in the MLT properties
+    qint64 memory = 0;
+    for (const auto &param : m_params) {
+        memory += UndoMemory::AssetParameter + 2 * (param.first.size() + param.second.value.toString().size()) * qint64(sizeof(QChar));
+    }
+    return memory;
+}
+
 const QString AssetParameterModel::getParam(const QString &paramName)
 {
     Q_ASSERT(m_asset->is_valid());
@@ -263,6 +284,8 @@ void AssetParameterModel::setParameter(const QString &name, int value, bool upda
 {
     Q_ASSERT(m_asset->is_valid());
     m_asset->set(name.toLatin1().constData(), value);
+    // Bumped after the write, so that a concurrent reader never caches the old value with the new revision
+    m_valueRevision++;
     if (m_fixedParams.count(name) == 0) {
         m_params[name].value = value;
     } else {
@@ -379,6 +402,7 @@ void AssetParameterModel::internalSetParameter(const QString &name, const QStrin
             }
         }
     }
+    m_valueRevision++;
     qDebug() << " = = SET EFFECT PARAM: " << name << " = " << m_asset->get(name.toLatin1().constData());
 }
 
@@ -1342,6 +1366,7 @@ std::shared_ptr<KeyframeModelList> AssetParameterModel::getKeyframeModel()
 void AssetParameterModel::resetAsset(std::unique_ptr<Mlt::Properties> asset)
 {
     m_asset = std::move(asset);
+    m_valueRevision++;
 }
 
 bool AssetParameterModel::hasMoreThanOneKeyframe() const
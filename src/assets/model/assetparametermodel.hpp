@@ -10,6 +10,7 @@
 #include <QAbstractListModel>
 #include <QDomElement>
 #include <QJsonDocument>
+#include <atomic>
 #include <unordered_map>
 
 #include <memory>
@@ -144,6 +145,12 @@ public:
      */
     Q_INVOKABLE void setParameter(const QString &name, const QString &paramValue, bool update = true, const QModelIndex &paramIndex = QModelIndex());
     void setParameter(const QString &name, int value, bool update = true);
+    /** @brief Returns a counter incremented each time a parameter value changes, used to invalidate data computed from the values */
+    quint64 valueRevision() const;
+    /** @brief Increment the value revision, to call after setting properties directly on the asset returned by getAsset() */
+    void invalidateValues();
+    /** @brief Rough size in bytes of the parameters held by this asset, used to estimate the memory kept by the undo history */
+    qint64 memoryEstimate() const;
 
     /** @brief Return all the parameters as pairs (parameter name, parameter value) */
     QVector<QPair<QString, QVariant>> getAllParameters() const;
@@ -249,6 +256,8 @@ protected:
     bool m_isAudio;
     /** @brief Store a filter's job progress */
     int m_filterProgress;
+    /** @brief Incremented on each write to the asset properties, read from the threads querying the keyframes */
+    std::atomic<quint64> m_valueRevision;
 
     /** @brief Set the parameter with given name to the given value. This should be called when first
      *  building an effect in the constructor, so that we don't call shared_from_this
@@ -1325,6 +1325,7 @@ void KeyframeImport::updateView()
     std::shared_ptr<Mlt::Animation> anim2(new Mlt::Animation(animData->get_animation("key2")));
     anim2->interpolate();
     m_model->getAsset()->set(paramName.toUtf8().constData(), anim2->serialize_cut());
+    m_model->invalidateValues();
     if (m_model->getOwnerId().first == ObjectType::BinClip) {
         pCore->getMonitor(Kdenlive::ClipMonitor)->refreshMonitor();
     } else {
@@ -1347,6 +1348,7 @@ void KeyframeImport::reject()
             m_model->getAsset()->set(paramName.toUtf8().constData(), m_originalParams.value(ix).toUtf8().constData());
         }
     }
+    m_model->invalidateValues();
     if (m_model->getOwnerId().first == ObjectType::BinClip) {
         pCore->getMonitor(Kdenlive::ClipMonitor)->refreshMonitor();
     } else {
@@ -1489,13 +1489,13 @@ Bin::Bin(std::shared_ptr<ProjectItemModel> model, QWidget *parent, bool isMainBi
         connect(m_discardCurrentClipJobs, &QAction::triggered, this, [&]() {
             const QString currentId = m_monitor->activeClipId();
             if (!currentId.isEmpty()) {
-                pCore->taskManager.discardJobs({ObjectType::BinClip, currentId.toInt()}, AbstractTask::NOJOBTYPE, true);
+                pCore->taskManager.cancelJobs({ObjectType::BinClip, currentId.toInt()}, AbstractTask::NOJOBTYPE, true);
             }
         });
-        connect(m_cancelJobs, &QAction::triggered, [&]() { pCore->taskManager.slotCancelJobs(); });
+        connect(m_cancelJobs, &QAction::triggered, [&]() { pCore->taskManager.cancelAllJobs(); });
         connect(m_discardPendingJobs, &QAction::triggered, [&]() {
             // TODO: implement pending only deletion
-            pCore->taskManager.slotCancelJobs();
+            pCore->taskManager.cancelAllJobs();
         });
     }
     // Hack, create toolbar spacer
@@ -1798,10 +1798,12 @@ void Bin::slotDeleteClip()
     // Ensure we don't delete a parent before a child
     // std::sort(items.begin(), items.end(), [](std::shared_ptr<AbstractProjectItem> a, std::shared_ptr<AbstractProjectItem>b) { return a->depth() > b->depth();
     // });
+    qint64 memory = 0;
     for (const auto &item : items) {
+        memory += m_itemModel->undoMemoryEstimate(item);
         m_itemModel->requestBinClipDeletion(item, undo, redo);
     }
-    pCore->pushUndo(undo, redo, i18n("Delete bin Clips"));
+    pCore->pushUndo(undo, redo, i18n("Delete bin Clips"), memory);
 }
 
 void Bin::slotReloadClip()
@@ -2334,6 +2336,12 @@ void Bin::selectProxyModel(const QModelIndex &id)
     if (isLoading) {
         // return;
     }
+    // Start the pending tasks of the selected clips before the other bin clips
+    QSet<int> selectedIds;
+    for (const QString &binId : selectedClipsIds()) {
+        selectedIds.insert(binId.toInt());
+    }
+    pCore->taskManager.setSelectionFocus(selectedIds);
     if (id.isValid()) {
         if (id.column() != 0) {
             return;
@@ -4639,9 +4647,11 @@ void Bin::reloadAllProducers(bool reloadThumbs)
                 ThumbnailCache::get()->invalidateThumbsForClip(clip->clipId());
             }
             clip->setClipStatus(FileStatus::StatusWaiting);
-            pCore->taskManager.discardJobs({ObjectType::BinClip, clip->clipId().toInt()}, AbstractTask::NOJOBTYPE, true,
-                                           {AbstractTask::TRANSCODEJOB, AbstractTask::PROXYJOB, AbstractTask::AUDIOTHUMBJOB});
-            ClipLoadTask::start({ObjectType::BinClip, clip->clipId().toInt()}, xml, false, -1, -1, this);
+            const ObjectId owner(ObjectType::BinClip, clip->clipId().toInt());
+            QFuture<void> stopped = pCore->taskManager.cancelJobs(owner, AbstractTask::NOJOBTYPE, true,
+                                                                  {AbstractTask::TRANSCODEJOB, AbstractTask::PROXYJOB, AbstractTask::AUDIOTHUMBJOB});
+            // Start the new load once the previous tasks stopped, so that they do not overlap
+            pCore->taskManager.whenStopped({stopped}, clip.get(), [this, owner, xml]() { ClipLoadTask::start(owner, xml, false, -1, -1, this); });
         }
     }
 }
@@ -557,11 +557,14 @@ void MarkerListModel::registerSnapModel(const std::weak_ptr<SnapInterface> &snap
         m_registeredSnaps.push_back(snapModel);
 
         // we now add the already existing markers to the snap
+        std::vector<int> positions;
+        positions.reserve(size_t(m_markerPositions.size()));
         QMap<int, int>::const_iterator i = m_markerPositions.constBegin();
         while (i != m_markerPositions.constEnd()) {
-            ptr->addPoint(i.key());
+            positions.push_back(i.key());
             ++i;
         }
+        ptr->addPoints(positions);
     } else {
         qDebug() << "Error: added snapmodel is null";
         Q_ASSERT(false);
@@ -665,9 +665,12 @@ void SubtitleModel::registerSnap(const std::weak_ptr<SnapInterface> &snapModel)
         // ptr is valid, we store it
         m_regSnaps.push_back(snapModel);
         // we now add the already existing subtitles to the snap
+        std::vector<int> positions;
+        positions.reserve(m_subtitleList.size());
         for (const auto &subtitle : m_subtitleList) {
-            ptr->addPoint(subtitle.first.frames(pCore->getCurrentFps()));
+            positions.push_back(subtitle.first.frames(pCore->getCurrentFps()));
         }
+        ptr->addPoints(positions);
     } else {
         qDebug() << "Error: added snapmodel for subtitle is null";
         Q_ASSERT(false);
@@ -19,6 +19,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "jobs/cliploadtask.h"
 #include "jobs/proxytask.h"
 #include "kdenlivesettings.h"
+#include "lib/audio/audioPeaks.h"
 #include "lib/audio/audioStreamInfo.h"
 #include "macros.hpp"
 #include "mltcontroller/clippropertiescontroller.h"
@@ -30,6 +31,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "projectitemmodel.h"
 #include "projectsubclip.h"
 #include "timeline2/model/snapmodel.hpp"
+#include "utils/mediaprobecache.hpp"
 #include "utils/timecode.h"
 #include "utils/thumbnailcache.hpp"
 #include "xml/xml.hpp"
@@ -235,22 +237,16 @@ void ProjectClip::updateAudioThumbnail(bool cachedThumb)
                 QMapIterator<int, QString> st(streams);
                 while (st.hasNext()) {
                     st.next();
-                    int channels = channelsList.value(st.key());
-                    double channelHeight = double(streamHeight) / channels;
-                    const QVector<uint8_t> audioLevels = audioFrameCache(st.key());
-                    qreal indicesPrPixel = qreal(audioLevels.length()) / img.width();
-                    int idx;
+                    std::shared_ptr<const AudioPeaks> peaks = audioPeaks(st.key());
+                    int channels = peaks ? qMin(channelsList.value(st.key()), peaks->channels()) : 0;
+                    double channelHeight = double(streamHeight) / qMax(1, channels);
+                    qreal pointsPrPixel = peaks ? qreal(peaks->size()) / img.width() : 0;
                     for (int channel = 0; channel < channels; channel++) {
                         double y = (streamHeight * streamCount) + (channel * channelHeight) + channelHeight / 2;
                         for (int i = 0; i <= img.width(); i++) {
-                            idx = int(ceil(i * indicesPrPixel));
-                            idx += idx % channels;
-                            idx += channel;
-                            if (idx >= audioLevels.length() || idx < 0) {
-                                break;
-                            }
-                            double level = audioLevels.at(idx) * channelHeight / 510.; // divide height by 510 (2*255) to get height
-                            painter.drawLine(i, int(y - level), i, int(y + level));
+                            const AudioPeaks::Peak peak = peaks->peak(channel, i * pointsPrPixel, (i + 1) * pointsPrPixel);
+                            // divide height by 254 (2*127) to get height
+                            painter.drawLine(i, int(y - peak.max * channelHeight / 254.), i, int(y - peak.min * channelHeight / 254.));
                         }
                     }
                     streamCount++;
@@ -377,23 +373,34 @@ size_t ProjectClip::frameDuration() const
 void ProjectClip::reloadProducer(bool refreshOnly, bool isProxy, bool forceAudioReload)
 {
     // we find if there are some loading job on that clip
-    QMutexLocker lock(&m_thumbMutex);
+    const ObjectId owner(ObjectType::BinClip, m_binId.toInt());
     if (refreshOnly) {
-        // In that case, we only want a new thumbnail.
-        // We thus set up a thumb job. We must make sure that there is no pending LOADJOB
         // Clear cache first
         ThumbnailCache::get()->invalidateThumbsForClip(m_binId);
-        pCore->taskManager.discardJobs({ObjectType::BinClip, m_binId.toInt()}, AbstractTask::LOADJOB, true);
-        pCore->taskManager.discardJobs({ObjectType::BinClip, m_binId.toInt()}, AbstractTask::CACHEJOB);
+    }
+    // Cancel them without waiting, the reload continues once they stopped so that two loads never overlap
+    QList<QFuture<void>> stopped = {pCore->taskManager.cancelJobs(owner, AbstractTask::LOADJOB, true),
+                                    pCore->taskManager.cancelJobs(owner, AbstractTask::CACHEJOB)};
+    int request = ++m_reloadRequest;
+    pCore->taskManager.whenStopped(stopped, this, [this, request, refreshOnly, isProxy, forceAudioReload]() {
+        if (request == m_reloadRequest) {
+            finishReload(refreshOnly, isProxy, forceAudioReload);
+        }
+    });
+}
+
+void ProjectClip::finishReload(bool refreshOnly, bool isProxy, bool forceAudioReload)
+{
+    QMutexLocker lock(&m_thumbMutex);
+    if (refreshOnly) {
+        // In that case, we only want a new thumbnail.
+        // We thus set up a thumb job, the pending LOADJOB was canceled
         m_thumbsProducer.reset();
         // Reset uuid to enforce reloading thumbnails from qml cache
         m_uuid = QUuid::createUuid();
         updateTimelineClips({TimelineModel::ClipThumbRole});
         ClipLoadTask::start({ObjectType::BinClip, m_binId.toInt()}, QDomElement(), true, -1, -1, this);
     } else {
-        // If another load job is running?
-        pCore->taskManager.discardJobs({ObjectType::BinClip, m_binId.toInt()}, AbstractTask::LOADJOB, true);
-        pCore->taskManager.discardJobs({ObjectType::BinClip, m_binId.toInt()}, AbstractTask::CACHEJOB);
         if (QFile::exists(m_path) && (!isProxy && !hasProxy()) && m_properties) {
             clearBackupProperties();
         }
@@ -545,6 +552,8 @@ bool ProjectClip::setProducer(std::shared_ptr<Mlt::Producer> producer, bool gene
     updateProducer(producer);
     isReloading = false;
     getFileHash();
+    // The thumbnail keys depend on the clip hash
+    ThumbnailCache::get()->invalidateKeyPrefix(m_binId);
     emit producerChanged(m_binId, producer);
     m_thumbsProducer.reset();
     connectEffectStack();
@@ -1374,9 +1383,13 @@ const QString ProjectClip::getFileHash()
 
 const QPair<QByteArray, qint64> ProjectClip::calculateHash(const QString &path)
 {
-    QFile file(path);
     QByteArray fileHash;
     qint64 fSize = 0;
+    if (MediaProbeCache::get()->fileHash(path, fileHash, fSize)) {
+        // Unchanged since we last hashed it
+        return {fileHash, fSize};
+    }
+    QFile file(path);
     if (file.open(QIODevice::ReadOnly)) { // write size and hash only if resource points to a file
         /*
          * 1 MB = 1 second per 450 files (or faster)
@@ -1394,6 +1407,7 @@ const QPair<QByteArray, qint64> ProjectClip::calculateHash(const QString &path)
         }
         file.close();
         fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
+        MediaProbeCache::get()->storeFileHash(path, fileHash, fSize);
     }
     return {fileHash, fSize};
 }
@@ -1730,19 +1744,18 @@ void ProjectClip::discardAudioThumb()
     pCore->taskManager.discardJobs({ObjectType::BinClip, m_binId.toInt()}, AbstractTask::AUDIOTHUMBJOB);
     QString audioThumbPath;
     QList<int> streams = m_audioInfo->streams().keys();
-    // Delete audio thumbnail data
     for (int &st : streams) {
+        // Release the pyramid first, a memory mapped cache file cannot be removed on Windows
+        const QString key = QString("_kdenlive:audiopeaks%1").arg(st);
+        m_masterProducer->lock();
+        m_masterProducer->set(key.toUtf8().constData(), static_cast<void *>(nullptr), 0);
+        m_masterProducer->unlock();
+        // Delete audio thumbnail data
         audioThumbPath = getAudioThumbPath(st);
         if (!audioThumbPath.isEmpty()) {
             QFile::remove(audioThumbPath);
         }
-        // Clear audio cache
-        QString key = QString("%1:%2").arg(m_binId).arg(st);
-        pCore->audioThumbCache.insert(key, QByteArray("-"));
-    }
-    // Delete thumbnail
-    for (int &st : streams) {
-        audioThumbPath = getAudioThumbPath(st);
+        audioThumbPath = getAudioThumbPath(st, true);
         if (!audioThumbPath.isEmpty()) {
             QFile::remove(audioThumbPath);
         }
@@ -1765,7 +1778,7 @@ int ProjectClip::getAudioStreamFfmpegIndex(int mltStream)
     return -1;
 }
 
-const QString ProjectClip::getAudioThumbPath(int stream)
+const QString ProjectClip::getAudioThumbPath(int stream, bool legacyImage)
 {
     if (audioInfo() == nullptr) {
         return QString();
@@ -1782,7 +1795,8 @@ const QString ProjectClip::getAudioThumbPath(int stream)
     QString audioPath = thumbFolder.absoluteFilePath(clipHash);
     audioPath.append(QLatin1Char('_') + QString::number(stream));
     int roundedFps = int(pCore->getCurrentFps());
-    audioPath.append(QStringLiteral("_%1_audio.png").arg(roundedFps));
+    audioPath.append(QStringLiteral("_%1_audio").arg(roundedFps));
+    audioPath.append(legacyImage ? QStringLiteral(".png") : QStringLiteral(".peaks"));
     return audioPath;
 }
 
@@ -2090,75 +2104,43 @@ void ProjectClip::setRating(uint rating)
     pCore->currentDoc()->setModified(true);
 }
 
-int ProjectClip::getAudioMax(int stream)
+std::shared_ptr<const AudioPeaks> ProjectClip::audioPeaks(int stream)
 {
-    const QString key = QString("kdenlive:audio_max%1").arg(stream);
-    if (m_masterProducer->property_exists(key.toUtf8().constData())) {
-        return m_masterProducer->get_int(key.toUtf8().constData());
-    }
-    // Process audio max for the stream
-    const QString key2 = QString("_kdenlive:audio%1").arg(stream);
-    if (!m_masterProducer->property_exists(key2.toUtf8().constData())) {
-        return 0;
-    }
-    const QVector<uint8_t> audioData = *static_cast<QVector<uint8_t> *>(m_masterProducer->get_data(key2.toUtf8().constData()));
-    if (audioData.isEmpty()) {
-        return 0;
-    }
-    uint max = *std::max_element(audioData.constBegin(), audioData.constEnd());
-    m_masterProducer->set(key.toUtf8().constData(), int(max));
-    return int(max);
-}
-
-const QVector<uint8_t> ProjectClip::audioFrameCache(int stream)
-{
-    QVector<uint8_t> audioLevels;
     if (stream == -1) {
         if (m_audioInfo) {
             stream = m_audioInfo->ffmpeg_audio_index();
         } else {
-            return audioLevels;
+            return nullptr;
         }
     }
-    const QString key = QString("_kdenlive:audio%1").arg(stream);
-    if (m_masterProducer->get_data(key.toUtf8().constData())) {
-        const QVector<uint8_t> audioData = *static_cast<QVector<uint8_t> *>(m_masterProducer->get_data(key.toUtf8().constData()));
-        return audioData;
-    } else {
-        qDebug() << "=== AUDIO NOT FOUND ";
+    const QString key = QString("_kdenlive:audiopeaks%1").arg(stream);
+    std::shared_ptr<const AudioPeaks> peaks;
+    m_masterProducer->lock();
+    auto *data = static_cast<std::shared_ptr<const AudioPeaks> *>(m_masterProducer->get_data(key.toUtf8().constData()));
+    if (data) {
+        peaks = *data;
     }
-    return QVector<uint8_t>();
+    m_masterProducer->unlock();
+    return peaks;
+}
 
-    // TODO
-    /*QString key = QString("%1:%2").arg(m_binId).arg(stream);
-    QByteArray audioData;
-    if (pCore->audioThumbCache.find(key, &audioData)) {
-        if (audioData != QByteArray("-")) {
-            QDataStream in(audioData);
-            in >> audioLevels;
-            return audioLevels;
-        }
-    }
-    // convert cached image
-    const QString cachePath = getAudioThumbPath(stream);
-    // checking for cached thumbs
-    QImage image(cachePath);
-    if (!image.isNull()) {
-        int channels = m_audioInfo->channelsForStream(stream);
-        int n = image.width() * image.height();
-        for (int i = 0; i < n; i++) {
-            QRgb p = image.pixel(i / channels, i % channels);
-            audioLevels << uint8_t(qRed(p));
-            audioLevels << uint8_t(qGreen(p));
-            audioLevels << uint8_t(qBlue(p));
-            audioLevels << uint8_t(qAlpha(p));
-        }
-        // populate vector
-        QDataStream st(&audioData, QIODevice::WriteOnly);
-        st << audioLevels;
-        pCore->audioThumbCache.insert(key, audioData);
-    }
-    return audioLevels;*/
+qint64 ProjectClip::memoryEstimate()
+{
+    qint64 memory = UndoMemory::Producer;
+    if (m_audioInfo) {
+        QList<int> streams = audioStreams().keys();
+        for (int stream : qAsConst(streams)) {
+            std::shared_ptr<const AudioPeaks> peaks = audioPeaks(stream);
+            if (peaks) {
+                // The decimated levels add a third to level 0
+                memory += peaks->size() * peaks->channels() * qint64(sizeof(AudioPeaks::Peak)) * 4 / 3;
+            }
+        }
+    }
+    if (m_effectStack) {
+        memory += m_effectStack->memoryEstimate();
+    }
+    return memory;
 }
 
 void ProjectClip::setClipStatus(FileStatus::ClipStatus status)
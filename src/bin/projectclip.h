@@ -19,6 +19,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QUuid>
 #include <memory>
 
+class AudioPeaks;
 class ClipPropertiesController;
 class ProjectFolder;
 class ProjectSubClip;
@@ -180,8 +181,9 @@ public:
     QStringList subClipIds() const;
     /** @brief Delete cached audio thumb - needs to be recreated */
     void discardAudioThumb();
-    /** @brief Get path for this clip's audio thumbnail */
-    const QString getAudioThumbPath(int stream);
+    /** @brief Get path for this clip's audio thumbnail cache
+     *  @param legacyImage if true, returns the path of the image cache used by older versions */
+    const QString getAudioThumbPath(int stream, bool legacyImage = false);
     /** @brief Returns true if this producer has audio and can be splitted on timeline*/
     bool isSplittable() const;
 
@@ -218,9 +220,12 @@ public:
     /** @brief Display Bin thumbnail given a percent
      */
     void getThumbFromPercent(int percent, bool storeFrame = false);
-    /** @brief Return audio cache for a stream
+    /** @brief Return the audio peak pyramid used to draw waveforms for a stream, nullptr if not computed yet
      */
-    const QVector <uint8_t> audioFrameCache(int stream = -1);
+    std::shared_ptr<const AudioPeaks> audioPeaks(int stream = -1);
+    /** @brief Rough size in bytes of the producer, waveforms and effects of this clip, used to estimate the memory kept by the undo history
+     */
+    qint64 memoryEstimate();
     /** @brief Return FFmpeg's audio stream index for an MLT audio stream index
      */
     int getAudioStreamFfmpegIndex(int mltStream);
@@ -244,8 +249,6 @@ public:
     /** @brief Check if the clip is included in timeline and reset its occurrences on producer reload. */
     void updateTimelineOnReload();
     int getRecordTime();
-    /** @brief Return maximum audio level for a stream. */
-    int getAudioMax(int stream);
     /** @brief Refresh zones of insertion in timeline. */
     void refreshBounds();
     /** @brief Retuns a list of important enforces parameters in MLT format, for example to disable autorotate. */
@@ -316,6 +319,10 @@ private:
     const QString getFileHash();
     QMutex m_producerMutex;
     QMutex m_thumbMutex;
+    /** @brief Incremented on each reload request, a reload waiting for the canceled tasks is dropped if a newer one was requested */
+    int m_reloadRequest{0};
+    /** @brief Second part of reloadProducer, once the previous loading tasks stopped */
+    void finishReload(bool refreshOnly, bool isProxy, bool forceAudioReload);
     const QString geometryWithOffset(const QString &data, int offset);
     QMap <QString, QByteArray> m_audioLevels;
     /** @brief If true, all timeline occurrences of this clip will be replaced from a fresh producer on reload. */
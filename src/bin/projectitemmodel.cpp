@@ -44,6 +44,8 @@ ProjectItemModel::ProjectItemModel(QObject *parent)
     , m_lock(QReadWriteLock::Recursive)
     , m_binPlaylist(nullptr)
     , m_fileWatcher(new FileWatcher())
+    , m_clipLookups(0)
+    , m_clipLookupMisses(0)
     , m_nextId(1)
     , m_blankThumb()
     , m_dragType(PlaylistState::Disabled)
@@ -457,40 +459,30 @@ std::shared_ptr<ProjectClip> ProjectItemModel::getClipByBinID(const QString &bin
     if (binId.contains(QLatin1Char('_'))) {
         return getClipByBinID(binId.section(QLatin1Char('_'), 0, 0));
     }
-    for (const auto &clip : m_allItems) {
-        auto c = std::static_pointer_cast<AbstractProjectItem>(clip.second.lock());
-        if (c->itemType() == AbstractProjectItem::ClipItem && c->clipId() == binId) {
-            return std::static_pointer_cast<ProjectClip>(c);
+    m_clipLookups.fetch_add(1, std::memory_order_relaxed);
+    auto it = m_clipsByBinId.find(binId);
+    if (it != m_clipsByBinId.end()) {
+        if (auto clip = it->second.lock()) {
+            return clip;
         }
     }
+    m_clipLookupMisses.fetch_add(1, std::memory_order_relaxed);
     return nullptr;
 }
 
-const QVector<uint8_t> ProjectItemModel::getAudioLevelsByBinID(const QString &binId, int stream)
+std::shared_ptr<const AudioPeaks> ProjectItemModel::getAudioPeaksByBinID(const QString &binId, int stream)
 {
     READ_LOCK();
-    for (const auto &clip : m_allItems) {
-        auto c = std::static_pointer_cast<AbstractProjectItem>(clip.second.lock());
-        if (c->itemType() == AbstractProjectItem::ClipItem && c->clipId() == binId) {
-            return std::static_pointer_cast<ProjectClip>(c)->audioFrameCache(stream);
-        }
+    std::shared_ptr<ProjectClip> clip = getClipByBinID(binId);
+    if (clip) {
+        return clip->audioPeaks(stream);
     }
-    return QVector<uint8_t>();
+    return nullptr;
 }
 
-double ProjectItemModel::getAudioMaxLevel(const QString &binId, int stream)
+std::pair<quint64, quint64> ProjectItemModel::clipLookupStats() const
 {
-    READ_LOCK();
-    for (const auto &item : m_allItems) {
-        auto i = std::static_pointer_cast<AbstractProjectItem>(item.second.lock());
-        if (i->itemType() == AbstractProjectItem::ClipItem && i->clipId() == binId) {
-            auto clip = std::static_pointer_cast<ProjectClip>(i);
-            if (clip) {
-                return clip->getAudioMax(stream);
-            }
-        }
-    }
-    return 0;
+    return {m_clipLookups.load(std::memory_order_relaxed), m_clipLookupMisses.load(std::memory_order_relaxed)};
 }
 
 bool ProjectItemModel::hasClip(const QString &binId)
@@ -662,6 +654,21 @@ std::shared_ptr<AbstractProjectItem> ProjectItemModel::getBinItemByIndex(const Q
     return std::static_pointer_cast<AbstractProjectItem>(getItemById(int(index.internalId())));
 }
 
+qint64 ProjectItemModel::undoMemoryEstimate(const std::shared_ptr<AbstractProjectItem> &item) const
+{
+    READ_LOCK();
+    qint64 memory = 0;
+    if (item->itemType() == AbstractProjectItem::ClipItem) {
+        memory = std::static_pointer_cast<ProjectClip>(item)->memoryEstimate();
+    } else if (item->itemType() == AbstractProjectItem::FolderItem) {
+        const QList<std::shared_ptr<ProjectClip>> clips = std::static_pointer_cast<ProjectFolder>(item)->childClips();
+        for (const std::shared_ptr<ProjectClip> &clip : clips) {
+            memory += clip->memoryEstimate();
+        }
+    }
+    return memory;
+}
+
 bool ProjectItemModel::requestBinClipDeletion(const std::shared_ptr<AbstractProjectItem> &clip, Fun &undo, Fun &redo)
 {
     QWriteLocker locker(&m_lock);
@@ -709,6 +716,7 @@ void ProjectItemModel::registerItem(const std::shared_ptr<TreeItem> &item)
     AbstractTreeModel::registerItem(item);
     if (clip->itemType() == AbstractProjectItem::ClipItem) {
         auto clipItem = std::static_pointer_cast<ProjectClip>(clip);
+        m_clipsByBinId[clipItem->clipId()] = clipItem;
         updateWatcher(clipItem);
     }
 }
@@ -721,6 +729,10 @@ void ProjectItemModel::deregisterItem(int id, TreeItem *item)
     AbstractTreeModel::deregisterItem(id, item);
     if (clip->itemType() == AbstractProjectItem::ClipItem) {
         auto clipItem = static_cast<ProjectClip *>(clip);
+        auto indexed = m_clipsByBinId.find(clipItem->clipId());
+        if (indexed != m_clipsByBinId.end() && (indexed->second.expired() || indexed->second.lock().get() == clipItem)) {
+            m_clipsByBinId.erase(indexed);
+        }
         m_fileWatcher->removeFile(clipItem->clipId());
     }
 }
@@ -934,7 +946,9 @@ bool ProjectItemModel::requestCleanupUnused()
     }
     // it is important to execute deletion in a separate loop, because otherwise
     // the iterators of m_allItems get messed up
+    qint64 memory = 0;
     for (const auto &c : to_delete) {
+        memory += undoMemoryEstimate(c);
         bool res = requestBinClipDeletion(c, undo, redo);
         if (!res) {
             bool undone = undo();
@@ -942,7 +956,7 @@ bool ProjectItemModel::requestCleanupUnused()
             return false;
         }
     }
-    pCore->pushUndo(undo, redo, i18n("Clean Project"));
+    pCore->pushUndo(undo, redo, i18n("Clean Project"), memory);
     return true;
 }
 
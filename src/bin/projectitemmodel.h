@@ -19,7 +19,10 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QReadWriteLock>
 #include <QSize>
 #include <QUuid>
+#include <atomic>
+#include <unordered_map>
 
+class AudioPeaks;
 class BinPlaylist;
 class FileWatcher;
 class MarkerListModel;
@@ -55,9 +58,8 @@ public:
 
     /** @brief Returns a clip from the hierarchy, given its id */
     std::shared_ptr<ProjectClip> getClipByBinID(const QString &binId);
-    /** @brief Returns audio levels for a clip from its id */
-    const QVector <uint8_t>getAudioLevelsByBinID(const QString &binId, int stream);
-    double getAudioMaxLevel(const QString &binId, int stream);
+    /** @brief Returns the audio peak pyramid of a clip stream from its id, nullptr if not available */
+    std::shared_ptr<const AudioPeaks> getAudioPeaksByBinID(const QString &binId, int stream);
 
     /** @brief Returns a list of clips using the given url */
     QStringList getClipByUrl(const QFileInfo &url) const;
@@ -134,6 +136,8 @@ public:
        @param undo,redo: lambdas that are updated to accumulate operation.
      */
     bool requestBinClipDeletion(const std::shared_ptr<AbstractProjectItem> &clip, Fun &undo, Fun &redo);
+    /** @brief Returns an estimate of the memory kept by the undo history when deleting @p item, with the content of folders */
+    qint64 undoMemoryEstimate(const std::shared_ptr<AbstractProjectItem> &item) const;
 
     /** @brief Request creation of a bin folder
        @param id Id of the requested bin. If this is empty or invalid (already used, for example), it will be used as a return parameter to give the automatic
@@ -209,6 +213,9 @@ public:
     int clipsCount() const;
     /** @brief Check if  a file is already in Bin */
     bool urlExists(const QString &path) const;
+    /** @brief Returns the number of clip lookups by bin id since the model was created, and how many of them found no clip.
+        Used to profile the thumbnail and waveform code paths */
+    std::pair<quint64, quint64> clipLookupStats() const;
     /** @brief Returns the unique uuid for this project item model */
     QUuid uuid() const { return m_uuid; };
 
@@ -251,6 +258,11 @@ private:
 
     std::unique_ptr<FileWatcher> m_fileWatcher;
 
+    /** @brief Bin clips indexed by their bin id, kept in sync by registerItem / deregisterItem */
+    std::unordered_map<QString, std::weak_ptr<ProjectClip>> m_clipsByBinId;
+    mutable std::atomic<quint64> m_clipLookups;
+    mutable std::atomic<quint64> m_clipLookupMisses;
+
     int m_nextId;
     QIcon m_blankThumb;
     PlaylistState::ClipState m_dragType;
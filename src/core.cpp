@@ -41,8 +41,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 std::unique_ptr<Core> Core::m_self;
 Core::Core(const QString &packageType)
-    : audioThumbCache(QStringLiteral("audioCache"), 2000000)
-    , taskManager(this)
+    : taskManager(this)
     , m_packageType(packageType)
     , m_thumbProfile(nullptr)
     , m_capture(new MediaCapture(this))
@@ -787,9 +786,11 @@ void Core::profileChanged()
     GenTime::setFps(getCurrentFps());
 }
 
-void Core::pushUndo(const Fun &undo, const Fun &redo, const QString &text)
+void Core::pushUndo(const Fun &undo, const Fun &redo, const QString &text, qint64 memoryHint)
 {
-    undoStack()->push(new FunctionalUndoCommand(undo, redo, text));
+    auto *command = new FunctionalUndoCommand(undo, redo, text);
+    command->addMemoryHint(memoryHint);
+    undoStack()->push(command);
 }
 
 void Core::pushUndo(QUndoCommand *command)
@@ -1238,10 +1239,10 @@ int Core::getMixCutPos(int cid) const
     return m_mainWindow->getCurrentTimeline()->controller()->getMixCutPos(cid);
 }
 
-void Core::cleanup()
+QFuture<void> Core::cleanup()
 {
-    audioThumbCache.clear();
-    taskManager.slotCancelJobs();
+    // Do not wait for the running tasks, they stop on their own
+    QFuture<void> stopped = taskManager.cancelAllJobs();
     if (timeRemapWidget()) {
         timeRemapWidget()->selectedClip(-1);
     }
@@ -1250,6 +1251,7 @@ void Core::cleanup()
                    &ProjectManager::adjustProjectDuration);
         m_mainWindow->getMainTimeline()->controller()->clipActions.clear();
     }
+    return stopped;
 }
 
 int Core::getNewStuff(const QString &config)
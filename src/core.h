@@ -17,7 +17,6 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QPoint>
 #include <QThreadPool>
 #include <QTextEdit>
-#include <KSharedDataCache>
 #include <unordered_set>
 #include "utils/timecode.h"
 
@@ -168,8 +167,9 @@ public:
     void profileChanged();
 
     /** @brief Create and push and undo object based on the corresponding functions
-        Note that if you class permits and requires it, you should use the macro PUSH_UNDO instead*/
-    void pushUndo(const Fun &undo, const Fun &redo, const QString &text);
+        Note that if you class permits and requires it, you should use the macro PUSH_UNDO instead
+        @param memoryHint size in bytes of the data captured by the functions, if known, used to bound the undo history memory */
+    void pushUndo(const Fun &undo, const Fun &redo, const QString &text, qint64 memoryHint = 0);
     void pushUndo(QUndoCommand *command);
     /** @brief display a user info/warning message in statusbar */
     void displayMessage(const QString &message, MessageType type, int timeout = -1);
@@ -258,7 +258,6 @@ public:
     void transcodeFile(const QString &url);
     /** @brief Display key binding info in statusbar. */
     void setWidgetKeyBinding(const QString &mess = QString());
-    KSharedDataCache audioThumbCache;
     /* @brief The thread job pool for clip jobs, allowing to set a max number of concurrent jobs */
     TaskManager taskManager;
     /** @brief The number of clip load jobs changed */
@@ -269,8 +268,10 @@ public:
     int getMixCutPos(int cid) const;
     /** @brief Get alignment info for a mix item */
     MixAlignment getMixAlign(int cid) const;
-    /** @brief Closing current document, do some cleanup */
-    void cleanup();
+    /** @brief Closing current document, do some cleanup
+     *  @returns a future that finishes once the canceled tasks stopped
+     */
+    QFuture<void> cleanup();
     /** @brief Instantiates a "Get Hot New Stuff" dialog.
      * @param configFile configuration file for KNewStuff
      * @return number of installed items */
@@ -16,6 +16,7 @@
 #include "profiles/profilemodel.hpp"
 #include "profiles/profilerepository.hpp"
 #include "project/projectmanager.h"
+#include "timeline2/model/timelineitemmodel.hpp"
 #include "utils/timecode.h"
 #include "xml/xml.hpp"
 
@@ -46,8 +47,10 @@
 #include <QHeaderView>
 #include <QInputDialog>
 #include <QJsonArray>
+#include <QJsonDocument>
 #include <QJsonObject>
 #include <QKeyEvent>
+#include <QLocalSocket>
 #include <QMenu>
 #include <QMimeDatabase>
 #include <QProcess>
@@ -57,6 +60,7 @@
 #include <QString>
 #include <QTemporaryFile>
 #include <QThread>
+#include <QTimer>
 #include <QTreeWidgetItem>
 #include <QtGlobal>
 
@@ -228,6 +232,9 @@ RenderWidget::RenderWidget(bool enableProxy, QWidget *parent)
     m_view.processing_threads->setValue(KdenliveSettings::processingthreads());
     connect(m_view.processing_threads, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &KdenliveSettings::setProcessingthreads);
     connect(m_view.processing_threads, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &RenderWidget::refreshParams);
+    m_view.render_segments->setMaximum(QThread::idealThreadCount());
+    m_view.render_segments->setValue(KdenliveSettings::rendersegments());
+    connect(m_view.render_segments, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &KdenliveSettings::setRendersegments);
     m_view.processing_box->setChecked(KdenliveSettings::parallelrender());
     connect(m_view.processing_box, &QGroupBox::toggled, [&](int state) {
         KdenliveSettings::setParallelrender(state == Qt::Checked);
@@ -255,6 +262,7 @@ RenderWidget::RenderWidget(bool enableProxy, QWidget *parent)
     connect(m_view.running_jobs, &QTreeWidget::customContextMenuRequested, this, &RenderWidget::prepareJobContextMenu);
     m_view.scripts_list->setUniformRowHeights(false);
     connect(m_view.start_script, &QAbstractButton::clicked, this, &RenderWidget::slotStartScript);
+    connect(m_view.queue_script, &QAbstractButton::clicked, this, &RenderWidget::slotQueueScript);
     connect(m_view.delete_script, &QAbstractButton::clicked, this, &RenderWidget::slotDeleteScript);
     connect(m_view.scripts_list, &QTreeWidget::itemSelectionChanged, this, &RenderWidget::slotCheckScript);
     connect(m_view.running_jobs, &QTreeWidget::itemSelectionChanged, this, &RenderWidget::slotCheckJob);
@@ -986,10 +994,14 @@ void RenderWidget::generateRenderFiles(QDomDocument doc, int in, int out, QStrin
         parseScriptFiles();
         return;
     }
+    QStringList segments;
+    if (passes == 1 && !renderArgs.contains(QLatin1String("=stills/"))) {
+        segments = segmentStarts(in, out);
+    }
     QList<RenderJobItem *> jobList;
     QMap<QString, QString>::const_iterator i = renderFiles.constBegin();
     while (i != renderFiles.constEnd()) {
-        RenderJobItem *renderItem = createRenderJob(i.key(), i.value(), in, out, subtitleFile);
+        RenderJobItem *renderItem = createRenderJob(i.key(), i.value(), in, out, subtitleFile, i.value() == outputFile ? segments : QStringList());
         if (renderItem != nullptr) {
             jobList << renderItem;
         }
@@ -1003,7 +1015,8 @@ void RenderWidget::generateRenderFiles(QDomDocument doc, int in, int out, QStrin
     checkRenderStatus();
 }
 
-RenderJobItem *RenderWidget::createRenderJob(const QString &playlist, const QString &outputFile, int in, int out, const QString &subtitleFile)
+RenderJobItem *RenderWidget::createRenderJob(const QString &playlist, const QString &outputFile, int in, int out, const QString &subtitleFile,
+                                             const QStringList &segments)
 {
     QList<QTreeWidgetItem *> existing = m_view.running_jobs->findItems(outputFile, Qt::MatchExactly, 1);
     RenderJobItem *renderItem = nullptr;
@@ -1034,6 +1047,9 @@ RenderJobItem *RenderWidget::createRenderJob(const QString &playlist, const QStr
                            QStringLiteral("-pid:%1").arg(QCoreApplication::applicationPid()),
                            QStringLiteral("-out"),
                            QString::number(out)};
+    if (!segments.isEmpty()) {
+        argsJob << QStringLiteral("-segments") << segments.join(QLatin1Char(','));
+    }
     if (!subtitleFile.isEmpty()) {
         argsJob << QStringLiteral("-subtitle") << subtitleFile;
     }
@@ -1051,6 +1067,36 @@ RenderJobItem *RenderWidget::createRenderJob(const QString &playlist, const QStr
     return renderItem;
 }
 
+QStringList RenderWidget::segmentStarts(int in, int out) const
+{
+    QStringList starts;
+    if (!m_view.processing_box->isChecked() || !m_view.processing_box->isEnabled()) {
+        return starts;
+    }
+    // Below this length, starting the processes and joining the parts costs more than it saves
+    const int minLength = int(30 * pCore->getCurrentFps());
+    const int length = out - in + 1;
+    const int count = qMin(KdenliveSettings::rendersegments(), length / qMax(1, minLength));
+    auto timeline = pCore->projectManager()->getTimeline();
+    if (count < 2 || !timeline) {
+        return starts;
+    }
+    int previous = in;
+    for (int i = 1; i < count; ++i) {
+        int start = in + int(qint64(length) * i / count);
+        // Splitting on a cut hides the encoder restart
+        int cut = timeline->getClosestCut(start, length / count / 4);
+        if (cut > previous && cut <= out) {
+            start = cut;
+        }
+        if (start > previous) {
+            starts << QString::number(start);
+            previous = start;
+        }
+    }
+    return starts;
+}
+
 void RenderWidget::checkRenderStatus()
 {
     // check if we have a job waiting to render
@@ -1537,6 +1583,7 @@ void RenderWidget::setRenderStatus(const QString &dest, int status, const QStrin
         est.append(when.toString(QStringLiteral("hh:mm:ss")));
         QString t = i18n("Rendering finished in %1", est);
         item->setData(1, Qt::UserRole, t);
+        item->setToolTip(1, renderReportSummary(dest));
 
 #ifdef KF5_USE_PURPOSE
         m_shareMenu->model()->setInputData(QJsonObject{{QStringLiteral("mimeType"), QMimeDatabase().mimeTypeForFile(item->text(1)).name()},
@@ -1570,6 +1617,10 @@ void RenderWidget::setRenderStatus(const QString &dest, int status, const QStrin
         item->setStatus(FAILEDJOB);
         m_view.error_log->append(i18n("<strong>Rendering of %1 crashed</strong><br />", dest));
         m_view.error_log->append(error);
+        const QString summary = renderReportSummary(dest);
+        if (!summary.isEmpty()) {
+            m_view.error_log->append(summary.toHtmlEscaped().replace(QLatin1Char('\n'), QStringLiteral("<br />")));
+        }
         m_view.error_log->append(QStringLiteral("<hr />"));
         m_view.error_box->setVisible(true);
     } else if (status == -3) {
@@ -1582,6 +1633,56 @@ void RenderWidget::setRenderStatus(const QString &dest, int status, const QStrin
     checkRenderStatus();
 }
 
+QString RenderWidget::renderReportSummary(const QString &dest) const
+{
+    QFile file(dest + QStringLiteral(".report.json"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    const QJsonObject report = QJsonDocument::fromJson(file.readAll()).object();
+    if (report.isEmpty()) {
+        return QString();
+    }
+    const Timecode tc = pCore->timecode();
+    QStringList lines;
+    lines << i18n("Average speed: %1 fps", QString::number(report.value(QStringLiteral("fps")).toDouble(), 'f', 1));
+    const QJsonArray slowest = report.value(QStringLiteral("slowest")).toArray();
+    if (!slowest.isEmpty()) {
+        lines << i18n("Slowest sections:");
+    }
+    for (const QJsonValue &value : slowest) {
+        const QJsonObject section = value.toObject();
+        QStringList clips;
+        const QJsonArray items = section.value(QStringLiteral("clips")).toArray();
+        for (const QJsonValue &itemValue : items) {
+            const QJsonObject clip = itemValue.toObject();
+            if (clip.contains(QStringLiteral("composition"))) {
+                clips << clip.value(QStringLiteral("composition")).toString();
+                continue;
+            }
+            QStringList effects;
+            const QJsonArray effectList = clip.value(QStringLiteral("effects")).toArray();
+            for (const QJsonValue &effect : effectList) {
+                effects << effect.toString();
+            }
+            const QString name = clip.value(QStringLiteral("clip")).toString();
+            clips << (effects.isEmpty() ? name : QStringLiteral("%1 (%2)").arg(name, effects.join(QStringLiteral(", "))));
+        }
+        clips.removeDuplicates();
+        lines << i18nc("timeline range, render speed, clips in the range", "%1 - %2: %3 fps %4",
+                       tc.getTimecodeFromFrames(section.value(QStringLiteral("start")).toInt()),
+                       tc.getTimecodeFromFrames(section.value(QStringLiteral("end")).toInt()),
+                       QString::number(section.value(QStringLiteral("fps")).toDouble(), 'f', 1), clips.join(QStringLiteral(", ")));
+    }
+    const QJsonArray stalls = report.value(QStringLiteral("stalls")).toArray();
+    for (const QJsonValue &value : stalls) {
+        const QJsonObject stall = value.toObject();
+        lines << i18n("Stalled %1 seconds at %2", qRound(stall.value(QStringLiteral("seconds")).toDouble()),
+                      tc.getTimecodeFromFrames(stall.value(QStringLiteral("frame")).toInt()));
+    }
+    return lines.join(QLatin1Char('\n'));
+}
+
 void RenderWidget::slotAbortCurrentJob()
 {
     auto *current = static_cast<RenderJobItem *>(m_view.running_jobs->currentItem());
@@ -1639,6 +1740,8 @@ void RenderWidget::slotCleanUpJobs()
     auto *current = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(ix));
     while (current != nullptr) {
         if (current->status() == FINISHEDJOB || current->status() == ABORTEDJOB) {
+            // The render report expires with the job
+            QFile::remove(current->text(1) + QStringLiteral(".report.json"));
             delete current;
         } else {
             ix++;
@@ -1706,6 +1809,7 @@ void RenderWidget::slotCheckScript()
         return;
     }
     m_view.start_script->setEnabled(current->data(0, Qt::UserRole).toString().isEmpty());
+    m_view.queue_script->setEnabled(true);
     m_view.delete_script->setEnabled(true);
     for (int i = 0; i < m_view.scripts_list->topLevelItemCount(); ++i) {
         current = m_view.scripts_list->topLevelItem(i);
@@ -1765,6 +1869,96 @@ void RenderWidget::slotStartScript()
     }
 }
 
+void RenderWidget::slotQueueScript()
+{
+    QTreeWidgetItem *item = m_view.scripts_list->currentItem();
+    if (!item) {
+        return;
+    }
+    const QString path = item->data(1, Qt::UserRole + 1).toString();
+    const QString scriptName = item->text(1);
+    // Default socket of kdenlive_renderqueue, see dev-docs/renderqueue.md
+    const QString server = QStringLiteral("org.kde.kdenlive-renderqueue");
+    auto *socket = new QLocalSocket(this);
+    // Retries the connection while the queue starts, then waits for its reply
+    auto *timer = new QTimer(socket);
+    timer->setSingleShot(true);
+    struct QueueRequest
+    {
+        bool queueStarted{false};
+        bool sent{false};
+        int attempts{0};
+    };
+    auto request = std::make_shared<QueueRequest>();
+    auto fail = [this, socket, timer](const QString &message) {
+        timer->stop();
+        socket->disconnect();
+        socket->abort();
+        socket->deleteLater();
+        KMessageBox::error(this, message);
+    };
+    connect(timer, &QTimer::timeout, socket, [socket, timer, request, server, fail]() {
+        if (request->sent) {
+            fail(i18n("The render queue did not reply"));
+            return;
+        }
+        socket->connectToServer(server);
+    });
+    connect(socket, &QLocalSocket::connected, socket, [socket, timer, request, path]() {
+        const QJsonObject submit{{QStringLiteral("command"), QStringLiteral("submit")}, {QStringLiteral("playlist"), path}};
+        socket->write(QJsonDocument(submit).toJson(QJsonDocument::Compact) + '\n');
+        request->sent = true;
+        timer->start(3000);
+    });
+    connect(socket, &QLocalSocket::readyRead, socket, [this, socket, timer, scriptName]() {
+        if (!socket->canReadLine()) {
+            return;
+        }
+        timer->stop();
+        const QJsonObject reply = QJsonDocument::fromJson(socket->readLine()).object();
+        socket->disconnect();
+        socket->disconnectFromServer();
+        socket->deleteLater();
+        if (!reply.value(QStringLiteral("ok")).toBool()) {
+            KMessageBox::error(this, i18n("The render queue did not accept the script: %1", reply.value(QStringLiteral("error")).toString()));
+            return;
+        }
+        KMessageBox::information(this, i18n("Script %1 was added to the render queue as job %2.", scriptName, reply.value(QStringLiteral("id")).toInt()),
+                                 i18n("Render Queue"));
+    });
+    connect(socket, &QLocalSocket::errorOccurred, socket, [socket, timer, request, fail]() {
+        if (request->sent) {
+            if (socket->canReadLine()) {
+                // The queue closed the connection after its reply, readyRead reports it
+                return;
+            }
+            fail(i18n("The render queue did not accept the script: %1", socket->errorString()));
+            return;
+        }
+        if (!request->queueStarted) {
+            // Start the queue, it keeps rendering after Kdenlive is closed
+            request->queueStarted = true;
+            QString queue = QStandardPaths::findExecutable(QStringLiteral("kdenlive_renderqueue"), {QCoreApplication::applicationDirPath()});
+            if (queue.isEmpty()) {
+                queue = QStandardPaths::findExecutable(QStringLiteral("kdenlive_renderqueue"));
+            }
+            QStringList args;
+            if (!KdenliveSettings::rendererpath().isEmpty()) {
+                args << QStringLiteral("--melt") << KdenliveSettings::rendererpath();
+            }
+            if (queue.isEmpty() || !QProcess::startDetached(queue, args)) {
+                fail(i18n("Could not start the kdenlive_renderqueue application"));
+                return;
+            }
+        } else if (++request->attempts >= 50) {
+            fail(i18n("Could not connect to the render queue: %1", socket->errorString()));
+            return;
+        }
+        timer->start(100);
+    });
+    socket->connectToServer(server);
+}
+
 void RenderWidget::slotDeleteScript()
 {
     QTreeWidgetItem *item = m_view.scripts_list->currentItem();
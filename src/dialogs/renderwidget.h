@@ -180,6 +180,8 @@ private slots:
     void adjustSpeed(int videoQuality);
 
     void slotStartScript();
+    /** @brief Submit the selected script to kdenlive_renderqueue, starting it if needed. */
+    void slotQueueScript();
     void slotDeleteScript();
     void parseScriptFiles();
     void slotCheckScript();
@@ -227,7 +229,13 @@ private:
     /** @brief Create a new empty playlist (*.mlt) file and @returns the filename of the created file */
     QString generatePlaylistFile(bool delayedRendering);
     void generateRenderFiles(QDomDocument doc, int in, int out, QString outputFile, bool delayedRendering, const QString &subtitleFile = QString());
-    RenderJobItem *createRenderJob(const QString &playlist, const QString &outputFile, int in, int out, const QString &subtitleFile = QString());
+    RenderJobItem *createRenderJob(const QString &playlist, const QString &outputFile, int in, int out, const QString &subtitleFile = QString(),
+                                   const QStringList &segments = QStringList());
+    /** @brief Returns the first frame of each segment after the first one when rendering the range in parallel segments,
+        preferably on clip boundaries, or an empty list to render it in one process */
+    QStringList segmentStarts(int in, int out) const;
+    /** @brief Summary of the report written by kdenlive_render next to @p dest: speed, slowest timeline sections and stalls */
+    QString renderReportSummary(const QString &dest) const;
 
 signals:
     void abortProcess(const QString &url);
@@ -0,0 +1,122 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "documentscanner.h"
+
+#include <QXmlStreamReader>
+
+DocumentScanner::DocumentScanner(const QByteArray &data)
+{
+    QXmlStreamReader reader(data);
+    while (!reader.atEnd()) {
+        switch (reader.readNext()) {
+        case QXmlStreamReader::StartElement: {
+            const QStringRef name = reader.name();
+            if (name == QLatin1String("producer") || name == QLatin1String("chain")) {
+                m_producers++;
+            } else if (name == QLatin1String("playlist")) {
+                m_playlists++;
+            } else if (name == QLatin1String("track")) {
+                m_tracks++;
+            } else if (name == QLatin1String("entry")) {
+                m_entries++;
+            } else if (name == QLatin1String("filter")) {
+                m_filters++;
+            } else if (name == QLatin1String("transition")) {
+                m_transitions++;
+            }
+            const QXmlStreamAttributes attributes = reader.attributes();
+            for (const QXmlStreamAttribute &attribute : attributes) {
+                checkText(attribute.value());
+            }
+            break;
+        }
+        case QXmlStreamReader::Characters:
+            checkText(reader.text());
+            break;
+        default:
+            break;
+        }
+    }
+    if (reader.hasError()) {
+        m_errorString = reader.errorString();
+        m_errorLine = int(reader.lineNumber());
+        m_errorColumn = int(reader.columnNumber());
+        return;
+    }
+    m_valid = true;
+}
+
+void DocumentScanner::checkText(const QStringRef &text)
+{
+    // Same checks as a substring search in the serialized document
+    if (!m_usesMovit && text.contains(QLatin1String("movit."))) {
+        m_usesMovit = true;
+    }
+    if (!m_hasFontSize && text.contains(QLatin1String("font-size"))) {
+        m_hasFontSize = true;
+    }
+}
+
+bool DocumentScanner::isValid() const
+{
+    return m_valid;
+}
+
+QString DocumentScanner::errorString() const
+{
+    return m_errorString;
+}
+
+int DocumentScanner::errorLine() const
+{
+    return m_errorLine;
+}
+
+int DocumentScanner::errorColumn() const
+{
+    return m_errorColumn;
+}
+
+bool DocumentScanner::usesMovit() const
+{
+    return m_usesMovit;
+}
+
+bool DocumentScanner::hasFontSize() const
+{
+    return m_hasFontSize;
+}
+
+int DocumentScanner::producerCount() const
+{
+    return m_producers;
+}
+
+int DocumentScanner::playlistCount() const
+{
+    return m_playlists;
+}
+
+int DocumentScanner::trackCount() const
+{
+    return m_tracks;
+}
+
+int DocumentScanner::entryCount() const
+{
+    return m_entries;
+}
+
+int DocumentScanner::filterCount() const
+{
+    return m_filters;
+}
+
+int DocumentScanner::transitionCount() const
+{
+    return m_transitions;
+}
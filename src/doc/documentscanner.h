@@ -0,0 +1,56 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+/** @class DocumentScanner
+    @brief Reads a project file in a single streaming pass, before it is loaded in a QDomDocument.
+
+    It collects the information that the loading steps used to search in a serialized copy
+    of the whole document (use of Movit effects, old title font sizes), along with the number
+    of producers, tracks and effects.
+ */
+class DocumentScanner
+{
+
+public:
+    explicit DocumentScanner(const QByteArray &data);
+    /** @brief Returns true if the data is well formed xml */
+    bool isValid() const;
+    QString errorString() const;
+    int errorLine() const;
+    int errorColumn() const;
+
+    /** @brief Returns true if the project references Movit (GLSL) services */
+    bool usesMovit() const;
+    /** @brief Returns true if the project contains titles with a point font size (Kdenlive <= 0.8.3) */
+    bool hasFontSize() const;
+
+    int producerCount() const;
+    int playlistCount() const;
+    int trackCount() const;
+    int entryCount() const;
+    int filterCount() const;
+    int transitionCount() const;
+
+private:
+    QString m_errorString;
+    int m_errorLine{0};
+    int m_errorColumn{0};
+    bool m_valid{false};
+    bool m_usesMovit{false};
+    bool m_hasFontSize{false};
+    int m_producers{0};
+    int m_playlists{0};
+    int m_tracks{0};
+    int m_entries{0};
+    int m_filters{0};
+    int m_transitions{0};
+    void checkText(const QStringRef &text);
+};
@@ -5,6 +5,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 */
 
 #include "documentvalidator.h"
+#include "documentscanner.h"
 
 #include "bin/binplaylist.hpp"
 #include "core.h"
@@ -34,13 +35,47 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <lib/localeHandling.h>
 #include <utility>
 
-DocumentValidator::DocumentValidator(const QDomDocument &doc, QUrl documentUrl)
+DocumentValidator::DocumentValidator(const QDomDocument &doc, QUrl documentUrl, const DocumentScanner *scanner)
     : m_doc(doc)
     , m_url(std::move(documentUrl))
     , m_modified(false)
+    , m_scanner(scanner != nullptr && scanner->isValid() ? scanner : nullptr)
 {
 }
 
+bool DocumentValidator::documentContains(const QString &text) const
+{
+    if (m_scanner) {
+        if (text == QLatin1String("movit.")) {
+            return m_scanner->usesMovit();
+        }
+        if (text == QLatin1String("font-size")) {
+            return m_scanner->hasFontSize();
+        }
+    }
+    return nodeContains(m_doc.documentElement(), text);
+}
+
+bool DocumentValidator::nodeContains(const QDomNode &node, const QString &text)
+{
+    // Walk the document instead of serializing it, attribute values and text are what a search in the file would match
+    if (node.isCharacterData()) {
+        return node.nodeValue().contains(text);
+    }
+    const QDomNamedNodeMap attributes = node.attributes();
+    for (int i = 0; i < attributes.count(); ++i) {
+        if (attributes.item(i).nodeValue().contains(text)) {
+            return true;
+        }
+    }
+    for (QDomNode child = node.firstChild(); !child.isNull(); child = child.nextSibling()) {
+        if (nodeContains(child, text)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 QPair<bool, QString> DocumentValidator::validate(const double currentVersion)
 {
     QDomElement mlt = m_doc.firstChildElement(QStringLiteral("mlt"));
@@ -55,10 +90,13 @@ QPair<bool, QString> DocumentValidator::validate(const double currentVersion)
         QString playlist = m_doc.toString();
         playlist.replace(QLatin1String("$CURRENTPATH"), m_url.adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).toLocalFile());
         m_doc.setContent(playlist);
+        // The scan of the file does not describe the rewritten paths
+        m_scanner = nullptr;
         mlt = m_doc.firstChildElement(QStringLiteral("mlt"));
         kdenliveDoc = mlt.firstChildElement(QStringLiteral("kdenlivedoc"));
     } else if (rootDir.isEmpty()) {
         mlt.setAttribute(QStringLiteral("root"), m_url.adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).toLocalFile());
+        m_scanner = nullptr;
     }
 
     QLocale documentLocale = QLocale::c(); // Document locale for conversion. Previous MLT / Kdenlive versions used C locale by default
@@ -145,6 +183,9 @@ bool DocumentValidator::upgrade(double version, const double currentVersion)
         return true;
     }
 
+    // From now on the scan of the file may not match the upgraded document, search the DOM instead
+    m_scanner = nullptr;
+
     // The document is too new
     if (version > currentVersion) {
         // qCDebug(KDENLIVE_LOG) << "Unable to open document with version " << version;
@@ -666,7 +707,7 @@ bool DocumentValidator::upgrade(double version, const double currentVersion)
 
     if (version <= 0.83) {
         // Replace point size with pixel size in text titles
-        if (m_doc.toString().contains(QStringLiteral("font-size"))) {
+        if (documentContains(QStringLiteral("font-size"))) {
             KMessageBox::ButtonCode convert = KMessageBox::Continue;
             QDomNodeList kproducerNodes = m_doc.elementsByTagName(QStringLiteral("kdenlive_producer"));
             for (int i = 0; i < kproducerNodes.count() && convert != KMessageBox::No; ++i) {
@@ -2194,8 +2235,7 @@ bool DocumentValidator::isModified() const
 
 bool DocumentValidator::checkMovit()
 {
-    QString playlist = m_doc.toString();
-    if (!playlist.contains(QStringLiteral("movit."))) {
+    if (!documentContains(QStringLiteral("movit."))) {
         // Project does not use Movit GLSL effects, we can load it
         return true;
     }
@@ -13,11 +13,14 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QUrl>
 #include <QtCore/QLocale>
 
+class DocumentScanner;
+
 class DocumentValidator
 {
 
 public:
-    DocumentValidator(const QDomDocument &doc, QUrl documentUrl);
+    /** @param scanner the result of a scan of the document file, if available. It replaces searches in the serialized document */
+    DocumentValidator(const QDomDocument &doc, QUrl documentUrl, const DocumentScanner *scanner = nullptr);
     bool isProject() const;
     /** @brief Check if the document is a valid Kdenlive project
      * @param currentVersion The version of the document, with the current
@@ -35,6 +38,12 @@ private:
     QDomDocument m_doc;
     QUrl m_url;
     bool m_modified;
+    const DocumentScanner *m_scanner;
+    /** @brief Returns true if the text of the document contains @p text.
+     * The scan of the file answers as long as the document was not changed, the current DOM is searched otherwise */
+    bool documentContains(const QString &text) const;
+    /** @brief Returns true if an attribute value or a text below @p node contains @p text */
+    static bool nodeContains(const QDomNode &node, const QString &text);
     /** @brief Upgrade from a previous Kdenlive document version. */
     bool upgrade(double version, const double currentVersion);
 
@@ -4,19 +4,142 @@
 */
 
 #include "docundostack.hpp"
+#include "kdenlivesettings.h"
+#include "undohelper.hpp"
 #include <QUndoCommand>
 #include <QUndoGroup>
+#include <typeinfo>
+
+namespace {
+// Estimate for commands that are not functional, they usually only store a few parameters
+const qint64 DefaultCommandMemory = 512;
+} // namespace
 
 DocUndoStack::DocUndoStack(QUndoGroup *parent)
     : QUndoStack(parent)
+    , m_memoryLimit(qint64(KdenliveSettings::undomemory()) * 1024 * 1024)
+    , m_memoryUsage(0)
+    , m_countedCommands(0)
 {
 }
 
 // TODO: custom undostack everywhere do that
 void DocUndoStack::push(QUndoCommand *cmd)
 {
+    qint64 usage = memoryUsage();
     if (index() < count()) {
         emit invalidate(index());
+        // The undone commands are deleted by the push
+        for (int i = index(); i < count(); ++i) {
+            usage -= commandMemory(command(i));
+        }
     }
+    const int previous = index();
+    const qint64 previousMemory = previous > 0 ? commandMemory(command(previous - 1)) : 0;
+    const qint64 memory = commandMemory(cmd);
     QUndoStack::push(cmd);
+    if (count() == previous + 1) {
+        usage += memory;
+    } else if (count() == previous && previous > 0) {
+        // Merged in the previous command, which now holds the memory of both
+        usage += commandMemory(command(previous - 1)) - previousMemory;
+    } else {
+        // The merged command became obsolete and was removed
+        usage = computeMemoryUsage();
+    }
+    m_memoryUsage = usage;
+    m_countedCommands = count();
+    trimHistory();
+}
+
+qint64 DocUndoStack::memoryUsage() const
+{
+    if (m_countedCommands != count()) {
+        m_memoryUsage = computeMemoryUsage();
+        m_countedCommands = count();
+    }
+    return m_memoryUsage;
+}
+
+qint64 DocUndoStack::computeMemoryUsage() const
+{
+    qint64 total = 0;
+    for (int i = 0; i < count(); ++i) {
+        total += commandMemory(command(i));
+    }
+    return total;
+}
+
+void DocUndoStack::setMemoryLimit(qint64 bytes)
+{
+    m_memoryLimit = bytes;
+    trimHistory();
+}
+
+void DocUndoStack::trimHistory()
+{
+    if (m_memoryLimit <= 0) {
+        return;
+    }
+    qint64 total = memoryUsage();
+    // QUndoStack can not remove its oldest commands, so they are released and marked obsolete instead:
+    // undoing them later only removes them from the stack. Only a contiguous range of functional commands
+    // starting at the bottom is released, so that the remaining ones are always undone in a consistent state.
+    // The last applied command is always kept.
+    for (int i = 0; i < index() - 1 && total > m_memoryLimit; ++i) {
+        auto *cmd = const_cast<QUndoCommand *>(command(i));
+        if (cmd->isObsolete()) {
+            continue;
+        }
+        if (!isReleasable(cmd)) {
+            break;
+        }
+        total -= commandMemory(cmd);
+        releaseCommand(cmd);
+        total += commandMemory(cmd);
+    }
+    m_memoryUsage = total;
+}
+
+qint64 DocUndoStack::commandMemory(const QUndoCommand *command)
+{
+    qint64 memory = DefaultCommandMemory;
+    if (auto *functional = dynamic_cast<const FunctionalUndoCommand *>(command)) {
+        memory = functional->memoryEstimate();
+    } else if (command->isObsolete()) {
+        memory = 0;
+    }
+    for (int i = 0; i < command->childCount(); ++i) {
+        memory += commandMemory(command->child(i));
+    }
+    return memory;
+}
+
+bool DocUndoStack::isReleasable(const QUndoCommand *command)
+{
+    if (command->childCount() == 0) {
+        return dynamic_cast<const FunctionalUndoCommand *>(command) != nullptr;
+    }
+    // Macros are plain commands that only undo their children
+    if (typeid(*command) != typeid(QUndoCommand) && dynamic_cast<const FunctionalUndoCommand *>(command) == nullptr) {
+        return false;
+    }
+    for (int i = 0; i < command->childCount(); ++i) {
+        if (!isReleasable(command->child(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DocUndoStack::releaseCommand(QUndoCommand *command)
+{
+    for (int i = 0; i < command->childCount(); ++i) {
+        releaseCommand(const_cast<QUndoCommand *>(command->child(i)));
+    }
+    if (auto *functional = dynamic_cast<FunctionalUndoCommand *>(command)) {
+        functional->release();
+    } else {
+        command->setObsolete(true);
+    }
 }
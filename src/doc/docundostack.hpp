@@ -10,12 +10,37 @@
 class QUndoGroup;
 class QUndoCommand;
 
+/** @class DocUndoStack
+    @brief The undo stack of a project. It keeps track of the memory held by its commands and releases the oldest ones
+    when it goes over its memory limit.
+ */
 class DocUndoStack : public QUndoStack
 {
     Q_OBJECT
 public:
     explicit DocUndoStack(QUndoGroup *parent = Q_NULLPTR);
     void push(QUndoCommand *cmd);
+    /** @brief Estimated memory held by the commands of the stack, in bytes */
+    qint64 memoryUsage() const;
+    /** @brief Set the memory budget of the stack in bytes, 0 for no limit */
+    void setMemoryLimit(qint64 bytes);
+
+private:
+    qint64 m_memoryLimit;
+    /** @brief Running total of the memory held by the commands, kept up to date by push and trimHistory */
+    mutable qint64 m_memoryUsage;
+    /** @brief Number of commands counted in m_memoryUsage. QUndoStack can remove commands without going through push
+        (clear, obsolete commands dropped on undo), the total is then computed again */
+    mutable int m_countedCommands;
+    /** @brief Sum the memory of all the commands of the stack */
+    qint64 computeMemoryUsage() const;
+    /** @brief Release the oldest commands until the stack fits in its memory budget */
+    void trimHistory();
+    /** @brief Returns true if undoing @p command only runs functional commands, which can be released */
+    static bool isReleasable(const QUndoCommand *command);
+    static qint64 commandMemory(const QUndoCommand *command);
+    static void releaseCommand(QUndoCommand *command);
+
 signals:
     void invalidate(int ix);
 };
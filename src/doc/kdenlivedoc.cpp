@@ -16,6 +16,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "core.h"
 #include "dialogs/profilesdialog.h"
 #include "documentchecker.h"
+#include "documentscanner.h"
 #include "documentvalidator.h"
 #include "docundostack.hpp"
 #include "effects/effectsrepository.hpp"
@@ -47,6 +48,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QStandardPaths>
 #include <QUndoGroup>
 #include <QUndoStack>
+#include <QtConcurrent>
 
 #include <mlt++/Mlt.h>
 
@@ -77,6 +79,7 @@ KdenliveDoc::KdenliveDoc(QString projectFolder, QUndoGroup *undoGroup, const QSt
     }
     connect(m_commandStack.get(), &QUndoStack::indexChanged, this, &KdenliveDoc::slotModified);
     connect(m_commandStack.get(), &DocUndoStack::invalidate, this, &KdenliveDoc::checkPreviewStack, Qt::DirectConnection);
+    connect(&m_autoSaveWatcher, &QFutureWatcher<AutoSaveResult>::finished, this, &KdenliveDoc::autoSaveFinished);
     // connect(m_commandStack, SIGNAL(cleanChanged(bool)), this, SLOT(setModified(bool)));
 
     initializeProperties();
@@ -131,6 +134,7 @@ KdenliveDoc::KdenliveDoc(const QUrl &url, QDomDocument& newDom, QString projectF
     }
     connect(m_commandStack.get(), &QUndoStack::indexChanged, this, &KdenliveDoc::slotModified);
     connect(m_commandStack.get(), &DocUndoStack::invalidate, this, &KdenliveDoc::checkPreviewStack, Qt::DirectConnection);
+    connect(&m_autoSaveWatcher, &QFutureWatcher<AutoSaveResult>::finished, this, &KdenliveDoc::autoSaveFinished);
 
     initializeProperties();
 
@@ -167,6 +171,11 @@ DocOpenResult KdenliveDoc::Open(const QUrl &url, const QString &projectFolder, Q
         return result;
     }
 
+    QByteArray data = file.readAll();
+    file.close();
+    // Collect in a single streaming pass what the validation steps need, so that they don't have to serialize the document
+    const DocumentScanner scanner(data);
+
     QDomDocument domDoc {};
     int line;
     int col;
@@ -179,13 +188,13 @@ DocOpenResult KdenliveDoc::Open(const QUrl &url, const QString &projectFolder, Q
         QDomImplementation::setInvalidDataPolicy(QDomImplementation::DropInvalidChars);
         result.setModified(true);
     }
-    bool success = domDoc.setContent(&file, false, &domErrorMessage, &line, &col);
+    bool success = domDoc.setContent(data, false, &domErrorMessage, &line, &col);
 
     if (!success) {
         if (recoverCorruption) {
             // Try to recover broken file produced by Kdenlive 0.9.4
             int correction = 0;
-            QString playlist = QString::fromUtf8(file.readAll());
+            QString playlist = QString::fromUtf8(data);
             while (!success && correction < 2) {
                 int errorPos = 0;
                 line--;
@@ -217,11 +226,11 @@ DocOpenResult KdenliveDoc::Open(const QUrl &url, const QString &projectFolder, Q
             return result;
         }
     }
-    file.close();
-
+    // The DOM holds the document now
+    data.clear();
 
     qCDebug(KDENLIVE_LOG) << "// validating project file";
-    DocumentValidator validator(domDoc, url);
+    DocumentValidator validator(domDoc, url, &scanner);
     success = validator.isProject();
     if (!success) {
         // It is not a project file
@@ -320,6 +329,7 @@ KdenliveDoc::~KdenliveDoc()
     // Clean up guide model
     m_guideModel.reset();
     // qCDebug(KDENLIVE_LOG) << "// DEL CLP MAN done";
+    m_autoSaveWatcher.waitForFinished();
     if (m_autosave) {
         if (!m_autosave->fileName().isEmpty()) {
             m_autosave->remove();
@@ -366,7 +376,8 @@ int KdenliveDoc::clipsCount() const
 
 const QByteArray KdenliveDoc::getAndClearProjectXml()
 {
-    const QByteArray result = m_document.toString().toUtf8();
+    // Serialize directly to UTF-8, without an intermediate QString of twice the size
+    const QByteArray result = m_document.toByteArray();
     // We don't need the xml data anymore, throw away
     m_document.clear();
     return result;
@@ -495,7 +506,28 @@ bool KdenliveDoc::autoGenerateImageProxy(int width) const
            width > m_documentProperties.value(QStringLiteral("proxyimageminsize")).toInt();
 }
 
-void KdenliveDoc::slotAutoSave(const QString &scene)
+bool KdenliveDoc::needsAutoSave() const
+{
+    return m_revision != m_autoSaveRevision;
+}
+
+void KdenliveDoc::slotAutoSave(const std::function<QString()> &serializer, const QMap<QString, QString> &replacements)
+{
+    writeAutoSave(serializer, replacements, m_revision);
+}
+
+void KdenliveDoc::waitForAutoSave()
+{
+    m_autoSaveWatcher.waitForFinished();
+}
+
+void KdenliveDoc::stopAutoSave()
+{
+    m_pendingAutoSave = nullptr;
+    m_autoSaveWatcher.waitForFinished();
+}
+
+void KdenliveDoc::writeAutoSave(const std::function<QString()> &serializer, const QMap<QString, QString> &replacements, qint64 revision)
 {
     if (m_autosave != nullptr) {
         if (!m_autosave->isOpen() && !m_autosave->open(QIODevice::ReadWrite)) {
@@ -504,16 +536,91 @@ void KdenliveDoc::slotAutoSave(const QString &scene)
             pCore->displayMessage(i18n("Cannot create autosave file %1", m_autosave->fileName()), ErrorMessage);
             return;
         }
-        if (scene.isEmpty()) {
-            // Make sure we don't save if scenelist is corrupted
-            KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", m_autosave->fileName()));
+        m_autoSaveRevision = revision;
+        if (m_autoSaveWatcher.isRunning()) {
+            // Only the latest scene matters, it will be built when the current backup is done
+            m_pendingAutoSave = serializer;
+            m_pendingReplacements = replacements;
+            m_pendingRevision = revision;
             return;
         }
+        KAutoSaveFile *file = m_autosave;
+        const QByteArray previousHash = m_autoSaveHash;
+        const int generation = m_autoSaveGeneration;
+        m_autoSaveWatcher.setFuture(QtConcurrent::run([file, serializer, replacements, previousHash, generation]() {
+            AutoSaveResult result;
+            result.generation = generation;
+            QString data = serializer();
+            if (data.isEmpty()) {
+                result.emptyScene = true;
+                return result;
+            }
+            QMapIterator<QString, QString> i(replacements);
+            while (i.hasNext()) {
+                i.next();
+                data.replace(i.key(), i.value());
+            }
+            if (!data.contains(QLatin1String("<track "))) {
+                // In some unexplained cases, the MLT playlist is corrupted and all tracks are deleted. Don't save in that case.
+                result.corrupted = true;
+                return result;
+            }
+            const QByteArray bytes = data.toUtf8();
+            QCryptographicHash hash(QCryptographicHash::Sha1);
+            hash.addData(file->fileName().toUtf8());
+            hash.addData(bytes);
+            result.hash = hash.result();
+            if (result.hash == previousHash) {
+                // Nothing changed since the last backup
+                return result;
+            }
+            file->resize(0);
+            result.failed = file->write(bytes) < 0;
+            file->flush();
+            return result;
+        }));
+    }
+}
+
+void KdenliveDoc::autoSaveFinished()
+{
+    const AutoSaveResult result = m_autoSaveWatcher.result();
+    if (result.generation != m_autoSaveGeneration) {
+        // The autosave file was emptied since this backup was started
+        return;
+    }
+    if (result.emptyScene) {
+        // Make sure we don't save if scenelist is corrupted
+        m_autoSaveRevision = -1;
+        KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", m_autosave ? m_autosave->fileName() : QString()));
+    } else if (result.corrupted) {
+        m_autoSaveRevision = -1;
+        pCore->displayMessage(i18n("Project was corrupted, cannot backup. Please close and reopen your project file to recover last backup"), ErrorMessage);
+    } else if (result.failed) {
+        m_autoSaveHash.clear();
+        m_autoSaveRevision = -1;
+        pCore->displayMessage(i18n("Cannot create autosave file %1", m_autosave ? m_autosave->fileName() : QString()), ErrorMessage);
+    } else {
+        m_autoSaveHash = result.hash;
+    }
+    if (m_pendingAutoSave) {
+        const std::function<QString()> serializer = m_pendingAutoSave;
+        m_pendingAutoSave = nullptr;
+        writeAutoSave(serializer, m_pendingReplacements, m_pendingRevision);
+    }
+}
+
+void KdenliveDoc::clearAutoSave()
+{
+    m_autoSaveWatcher.waitForFinished();
+    // The finished signal of the backup may still be queued, its result must not be used anymore
+    m_autoSaveGeneration++;
+    m_pendingAutoSave = nullptr;
+    m_autoSaveHash.clear();
+    // The saved project matches the current state
+    m_autoSaveRevision = m_revision;
+    if (m_autosave) {
         m_autosave->resize(0);
-        if (m_autosave->write(scene.toUtf8()) < 0) {
-            pCore->displayMessage(i18n("Cannot create autosave file %1", m_autosave->fileName()), ErrorMessage);
-        };
-        m_autosave->flush();
     }
 }
 
@@ -852,6 +959,7 @@ void KdenliveDoc::setModified(bool mod)
 {
     // fix mantis#3160: The document may have an empty URL if not saved yet, but should have a m_autosave in any case
     if ((m_autosave != nullptr) && mod && KdenliveSettings::crashrecovery()) {
+        m_revision++;
         emit startAutoSave();
     }
     if (mod == m_modified) {
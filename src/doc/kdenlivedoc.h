@@ -14,10 +14,12 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include <QAction>
 #include <QDir>
+#include <QFutureWatcher>
 #include <QList>
 #include <QMap>
 #include <QObject>
 #include <QUuid>
+#include <functional>
 #include <memory>
 #include <qdom.h>
 
@@ -230,8 +232,38 @@ public:
     bool hasSubtitles() const;
     /** @brief Generate a temporary subtitle file for a zone. */
     void generateRenderSubtitleFile(int in, int out, const QString &subtitleFile);
+    /** @brief Wait for the backup being written, if any, and empty the autosave file. Used once the project is saved */
+    void clearAutoSave();
+    /** @brief Returns true if the project was modified since the last backup, so that unchanged projects are not serialized again */
+    bool needsAutoSave() const;
 
 private:
+    struct AutoSaveResult
+    {
+        /** @brief Hash of the file name and written data */
+        QByteArray hash;
+        bool corrupted{false};
+        bool emptyScene{false};
+        bool failed{false};
+        /** @brief Value of m_autoSaveGeneration when the backup was started */
+        int generation{0};
+    };
+    /** @brief Writes the autosave file in a background thread */
+    QFutureWatcher<AutoSaveResult> m_autoSaveWatcher;
+    QByteArray m_autoSaveHash;
+    /** @brief Scene serializer and replacements received while a backup was being written */
+    std::function<QString()> m_pendingAutoSave;
+    QMap<QString, QString> m_pendingReplacements;
+    qint64 m_pendingRevision{0};
+    /** @brief Incremented each time a modification requests a backup */
+    qint64 m_revision{0};
+    /** @brief Value of m_revision for the last backup, -1 if it failed */
+    qint64 m_autoSaveRevision{0};
+    /** @brief Incremented when the autosave file is emptied, backups started before are ignored once finished */
+    int m_autoSaveGeneration{0};
+    void autoSaveFinished();
+    void writeAutoSave(const std::function<QString()> &serializer, const QMap<QString, QString> &replacements, qint64 revision);
+
     /** @brief Create a new KdenliveDoc using the provided QDomDocument (an
      * existing project file), used by the Open() named constructor. */
     KdenliveDoc(const QUrl &url, QDomDocument& newDom, QString projectFolder, QUndoGroup *undoGroup,
@@ -302,8 +334,14 @@ public slots:
                               QUndoCommand *masterCommand = nullptr);
     /** @brief Saves the current project at the autosave location.
      *
+     * The scene is built by @p serializer in a background thread, then the @p replacements are applied and it is written. A scene identical to the
+     * last backup is not written again. If a backup is still being written, only the latest serializer is kept and run after it.
      * The autosave files are in ~/.kde/data/stalefiles/kdenlive/ */
-    void slotAutoSave(const QString &scene);
+    void slotAutoSave(const std::function<QString()> &serializer, const QMap<QString, QString> &replacements = QMap<QString, QString>());
+    /** @brief Waits until the running backup stopped reading the timeline */
+    void waitForAutoSave();
+    /** @brief Waits for the running backup and drops the pending one, so that the timeline can be released */
+    void stopAutoSave();
     /** @brief Groups were changed, save to MLT. */
     void groupsChanged(const QString &groups);
     void switchProfile(ProfileParam* pf, const QString &clipName);
@@ -244,6 +244,7 @@ void EffectItemModel::setInOut(const QString &effectName, QPair<int, int> bounds
         m_asset->set("kdenlive:force_in_out", currentState);
         m_asset->set("in", currentInOut.first);
         m_asset->set("out", currentInOut.second);
+        invalidateValues();
         emit AssetParameterModel::updateChildren({QStringLiteral("in"), QStringLiteral("out")});
         if (!isAudio()) {
             pCore->refreshProjectItem(m_ownerId);
@@ -256,6 +257,7 @@ void EffectItemModel::setInOut(const QString &effectName, QPair<int, int> bounds
         m_asset->set("kdenlive:force_in_out", enabled ? 1 : 0);
         m_asset->set("in", bounds.first);
         m_asset->set("out", bounds.second);
+        invalidateValues();
         emit AssetParameterModel::updateChildren({QStringLiteral("in"), QStringLiteral("out")});
         if (!isAudio()) {
             pCore->refreshProjectItem(m_ownerId);
@@ -218,7 +218,7 @@ void EffectStackModel::removeEffect(const std::shared_ptr<EffectItemModel> &effe
         update();
         PUSH_LAMBDA(update, redo);
         PUSH_LAMBDA(update2, undo);
-        PUSH_UNDO(undo, redo, i18n("Delete effect %1", effectName));
+        PUSH_UNDO_MEMORY(undo, redo, i18n("Delete effect %1", effectName), effect->memoryEstimate());
     } else {
         qDebug() << "..........FAILED EFFECT DELETION";
     }
@@ -1139,6 +1139,17 @@ int EffectStackModel::getActiveEffect() const
     return 0;
 }
 
+qint64 EffectStackModel::memoryEstimate() const
+{
+    QWriteLocker locker(&m_lock);
+    qint64 memory = 0;
+    for (int i = 0; i < rootItem->childCount(); ++i) {
+        auto effect = std::static_pointer_cast<EffectItemModel>(rootItem->child(i));
+        memory += effect->memoryEstimate();
+    }
+    return memory;
+}
+
 void EffectStackModel::slotCreateGroup(const std::shared_ptr<EffectItemModel> &childEffect)
 {
     QWriteLocker locker(&m_lock);
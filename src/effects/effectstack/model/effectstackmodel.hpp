@@ -69,6 +69,8 @@ public:
     void setActiveEffect(int ix);
     /** @brief Get currently active effect row */
     int getActiveEffect() const;
+    /** @brief Rough size in bytes of the effects of the stack, used to estimate the memory kept by the undo history */
+    qint64 memoryEstimate() const;
     /** @brief Adjust an effect duration (useful for fades) */
     bool adjustFadeLength(int duration, bool fromStart, bool audioFade, bool videoFade, bool logUndo);
     bool adjustStackLength(bool adjustFromEnd, int oldIn, int oldDuration, int newIn, int duration, int offset, Fun &undo, Fun &redo, bool logUndo);
@@ -43,6 +43,7 @@ AbstractTask::AbstractTask(const ObjectId &owner, JOBTYPE type, QObject *object)
     , m_softDelete(false)
     , m_isForce(false)
     , m_running(false)
+    , m_resource(CpuBound)
     , m_type(type)
 {
     setAutoDelete(false);
@@ -94,6 +95,11 @@ void AbstractTask::run()
     qDebug() << "============0\n\nABSTRACT TASKSTARTRING\n\n==================";
 }
 
+void AbstractTask::discard()
+{
+    pCore->taskManager.taskDone(m_owner.second, this);
+}
+
 // Background tasks should not slow down the main UI too much. Unless the user
 // has opted out, lower the priority of proxy and transcode tasks.
 void AbstractTask::setPreferredPriority(qint64 pid)
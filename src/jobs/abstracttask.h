@@ -33,6 +33,8 @@ public:
         SPEEDJOB = 10,
         CACHEJOB = 11
     };
+    /** @brief What a task mostly waits on, used to select the thread pool running it */
+    enum TaskResource { CpuBound, IoBound };
     AbstractTask(const ObjectId &owner, JOBTYPE type, QObject* object);
     ~AbstractTask() override;
     static void closeAll();
@@ -50,7 +52,11 @@ protected:
     QMutex m_runMutex;
     bool m_isForce;
     bool m_running;
+    /** @brief Set by the task constructor, CPU bound by default */
+    TaskResource m_resource;
     void run() override;
+    /** @brief Called instead of run() when the task is canceled before it was started, releases it without doing any work */
+    virtual void discard();
     void cleanup();
 
 private:
@@ -6,6 +6,7 @@
 */
 
 #include "audiolevelstask.h"
+#include "audio/audioPeaks.h"
 #include "audio/audioStreamInfo.h"
 #include "bin/projectclip.h"
 #include "bin/projectitemmodel.h"
@@ -14,22 +15,117 @@
 #include <KMessageWidget>
 #include <QElapsedTimer>
 #include <QFile>
+#include <QFutureSynchronizer>
 #include <QImage>
 #include <QList>
 #include <QMutex>
 #include <QRgb>
 #include <QString>
+#include <QThread>
 #include <QThreadPool>
 #include <QTime>
 #include <QVariantList>
+#include <QtConcurrent>
 #include <klocalizedstring.h>
+#include <functional>
 
 static QList<AudioLevelsTask *> tasksList;
 static QMutex tasksListMutex;
 
-static void deleteQVariantList(QVector<uint8_t> *list)
+static void deleteAudioPeaks(std::shared_ptr<const AudioPeaks> *peaks)
 {
-    delete list;
+    delete peaks;
+}
+
+/** @brief Attach the peak pyramid of a stream to the producer, where it is shared by the bin and timeline */
+static void storeAudioPeaks(const std::shared_ptr<Mlt::Producer> &producer, int stream, const std::shared_ptr<const AudioPeaks> &peaks)
+{
+    auto *peaksCopy = new std::shared_ptr<const AudioPeaks>(peaks);
+    producer->lock();
+    QString key = QString("_kdenlive:audiopeaks%1").arg(stream);
+    producer->set(key.toUtf8().constData(), peaksCopy, 0, (mlt_destructor)deleteAudioPeaks);
+    producer->unlock();
+}
+
+/** @brief Convert an audio thumbnail cached as image by older versions to the binary cache format */
+static std::shared_ptr<const AudioPeaks> importImageCache(const QString &imagePath, int channels, const QString &cachePath)
+{
+    if (!QFile::exists(imagePath)) {
+        return nullptr;
+    }
+    QImage image(imagePath);
+    if (image.isNull()) {
+        return nullptr;
+    }
+    QVector<uint8_t> levels;
+    int n = image.width() * image.height();
+    levels.reserve(4 * n);
+    for (int i = 0; n > 1 && i < n; i++) {
+        QRgb p = image.pixel(i / channels, i % channels);
+        levels << qRed(p);
+        levels << qGreen(p);
+        levels << qBlue(p);
+        levels << qAlpha(p);
+    }
+    if (levels.isEmpty()) {
+        return nullptr;
+    }
+    auto peaks = std::make_shared<const AudioPeaks>(AudioPeaks::fromFrameLevels(levels, channels));
+    if (peaks->save(cachePath)) {
+        QFile::remove(imagePath);
+    }
+    return peaks;
+}
+
+/** @brief Decode frames [in, out[ of an audio stream and append their peaks.
+ *  The producer is only seeked once, at the segment start.
+ *  @param frameDone called after each decoded frame with its position
+ *  @returns false if the file could not be opened
+ */
+static bool decodeAudioSegment(Mlt::Profile &profile, const QString &service, const char *resource, int stream, int frequency, int in, int out,
+                               AudioPeaks &peaks, const QAtomicInt &canceled, const std::function<void(int)> &frameDone)
+{
+    if (canceled) {
+        // Opening the file can take a while, don't start if the task was canceled meanwhile
+        return true;
+    }
+    Mlt::Producer audioProducer(profile, service.toUtf8().constData(), resource);
+    if (!audioProducer.is_valid()) {
+        return false;
+    }
+    audioProducer.set("video_index", "-1");
+    audioProducer.set("audio_index", stream);
+    Mlt::Filter chans(profile, "audiochannels");
+    Mlt::Filter converter(profile, "audioconvert");
+    audioProducer.attach(chans);
+    audioProducer.attach(converter);
+    if (in > 0) {
+        audioProducer.seek(in);
+    }
+    int channels = peaks.channels();
+    double framesPerSecond = audioProducer.get_fps();
+    for (int z = in; z < out && !canceled; ++z) {
+        QScopedPointer<Mlt::Frame> mltFrame(audioProducer.get_frame());
+        void *buffer = nullptr;
+        mlt_audio_format audioFormat = mlt_audio_s16;
+        int samples = mlt_audio_calculate_frame_samples(float(framesPerSecond), frequency, z);
+        int frameChannels = channels;
+        if ((mltFrame != nullptr) && mltFrame->is_valid() && (mltFrame->get_int("test_audio") == 0)) {
+            int frameFrequency = frequency;
+            buffer = mltFrame->get_audio(audioFormat, frameFrequency, frameChannels, samples);
+        }
+        if (buffer == nullptr || frameChannels != channels) {
+            peaks.repeatLastFrame();
+        } else if (audioFormat == mlt_audio_f32le) {
+            peaks.appendFrame(static_cast<const float *>(buffer), samples);
+        } else if (audioFormat == mlt_audio_s16) {
+            peaks.appendFrame(static_cast<const int16_t *>(buffer), samples);
+        } else {
+            peaks.repeatLastFrame();
+        }
+        frameDone(z);
+    }
+    return true;
 }
 
 AudioLevelsTask::AudioLevelsTask(const ObjectId &owner, QObject *object)
@@ -105,28 +201,15 @@ void AudioLevelsTask::run()
         }
         // Generate one thumb per stream
         QString cachePath = binClip->getAudioThumbPath(stream);
-        QVector<uint8_t> mltLevels;
-        if (!m_isForce && QFile::exists(cachePath)) {
-            // Audio thumb already exists
-            QImage image(cachePath);
-            if (!m_isCanceled && !image.isNull()) {
-                // convert cached image
-                int n = image.width() * image.height();
-                for (int i = 0; n > 1 && i < n; i++) {
-                    QRgb p = image.pixel(i / channels, i % channels);
-                    mltLevels << qRed(p);
-                    mltLevels << qGreen(p);
-                    mltLevels << qBlue(p);
-                    mltLevels << qAlpha(p);
-                }
-                if (mltLevels.size() > 0) {
-                    QVector<uint8_t> *levelsCopy = new QVector<uint8_t>(mltLevels);
-                    producer->lock();
-                    QString key = QString("_kdenlive:audio%1").arg(stream);
-                    producer->set(key.toUtf8().constData(), levelsCopy, 0, (mlt_destructor)deleteQVariantList);
-                    producer->unlock();
-                    continue;
-                }
+        if (!m_isForce) {
+            std::shared_ptr<const AudioPeaks> cached = AudioPeaks::load(cachePath);
+            if (cached == nullptr && !m_isCanceled) {
+                cached = importImageCache(binClip->getAudioThumbPath(stream, true), channels, cachePath);
+            }
+            if (cached && cached->channels() == channels) {
+                // Audio thumb already exists
+                storeAudioPeaks(producer, stream, cached);
+                continue;
             }
         }
         QString service = producer->get("mlt_service");
@@ -135,106 +218,97 @@ void AudioLevelsTask::run()
         } else if (service.startsWith(QLatin1String("xml"))) {
             service = QStringLiteral("xml-nogl");
         }
-        QScopedPointer<Mlt::Producer> audioProducer(new Mlt::Producer(*producer->profile(), service.toUtf8().constData(), producer->get("resource")));
-        if (!audioProducer->is_valid()) {
-            QMetaObject::invokeMethod(pCore.get(), "displayBinMessage", Qt::QueuedConnection,
-                                      Q_ARG(QString, i18n("Audio thumbs: cannot open file %1", producer->get("resource"))),
-                                      Q_ARG(int, int(KMessageWidget::Warning)));
-            pCore->taskManager.taskDone(m_owner.second, this);
-            return;
+        Mlt::Profile *profile = producer->profile();
+        const char *resource = producer->get("resource");
+        // Peaks are computed from the decoded samples with sub-frame resolution
+        AudioPeaks peaks(channels);
+        bool valid = true;
+        // Long files are split in segments of at least 2 minutes, decoded in parallel
+        QThreadPool *segmentPool = pCore->taskManager.segmentPool();
+        int segments = 1;
+        if (service == QLatin1String("avformat")) {
+            int minSegment = qMax(1, int(pCore->getCurrentFps() * 120));
+            segments = qBound(1, lengthInFrames / minSegment, segmentPool->maxThreadCount());
         }
-        audioProducer->set("video_index", "-1");
-        audioProducer->set("audio_index", stream);
-        Mlt::Filter chans(*producer->profile(), "audiochannels");
-        Mlt::Filter converter(*producer->profile(), "audioconvert");
-        Mlt::Filter levels(*producer->profile(), "audiolevel");
-        audioProducer->attach(chans);
-        audioProducer->attach(converter);
-        audioProducer->attach(levels);
-
-        double framesPerSecond = audioProducer->get_fps();
-        mlt_audio_format audioFormat = mlt_audio_s16;
-        QStringList keys;
-        keys.reserve(channels);
-        for (int i = 0; i < channels; i++) {
-            keys << "meta.media.audio_level." + QString::number(i);
-        }
-        uint maxLevel = 1;
-        QElapsedTimer updateTime;
-        updateTime.start();
-        for (int z = 0; z < lengthInFrames && !m_isCanceled; ++z) {
-            int val = int(100.0 * z / lengthInFrames);
-            if (m_progress != val) {
-                m_progress = val;
-                QMetaObject::invokeMethod(m_object, "updateJobProgress");
+        if (segments > 1) {
+            std::vector<AudioPeaks> parts(size_t(segments), AudioPeaks(channels));
+            QAtomicInt framesDone;
+            QAtomicInt failures;
+            QFutureSynchronizer<void> synchronizer;
+            for (int i = 0; i < segments; ++i) {
+                int in = int(qint64(lengthInFrames) * i / segments);
+                int out = int(qint64(lengthInFrames) * (i + 1) / segments);
+                AudioPeaks &part = parts[size_t(i)];
+                synchronizer.addFuture(QtConcurrent::run(segmentPool, [&, in, out]() {
+                    // Segments only count their frames, the progress is published from the task thread
+                    if (!decodeAudioSegment(*profile, service, resource, stream, frequency, in, out, part, m_isCanceled,
+                                            [&](int) { framesDone.fetchAndAddRelaxed(1); })) {
+                        failures.fetchAndAddRelaxed(1);
+                    }
+                }));
             }
-            QScopedPointer<Mlt::Frame> mltFrame(audioProducer->get_frame());
-            if ((mltFrame != nullptr) && mltFrame->is_valid() && (mltFrame->get_int("test_audio") == 0)) {
-                int samples = mlt_audio_calculate_frame_samples(float(framesPerSecond), frequency, z);
-                mltFrame->get_audio(audioFormat, frequency, channels, samples);
-                for (int channel = 0; channel < channels; ++channel) {
-                    uint lev = 256 * qMin(mltFrame->get_double(keys.at(channel).toUtf8().constData()) * 0.9, 1.0);
-                    mltLevels << lev;
-                    // double lev = mltFrame->get_double(keys.at(channel).toUtf8().constData());
-                    // mltLevels << lev;
-                    maxLevel = qMax(lev, maxLevel);
+            // Segments are appended in order, so the waveform grows each time the next one is complete
+            const QList<QFuture<void>> futures = synchronizer.futures();
+            for (int i = 0; i < futures.size(); ++i) {
+                QFuture<void> future = futures.at(i);
+                while (!future.isFinished()) {
+                    int val = int(100.0 * framesDone.loadRelaxed() / lengthInFrames);
+                    if (val > m_progress) {
+                        m_progress = val;
+                        QMetaObject::invokeMethod(m_object, "updateJobProgress");
+                    }
+                    QThread::msleep(100);
                 }
-            } else if (!mltLevels.isEmpty()) {
-                for (int channel = 0; channel < channels; channel++) {
-                    mltLevels << mltLevels.last();
+                if (m_isCanceled || failures.loadRelaxed() > 0) {
+                    continue;
+                }
+                peaks.append(parts.at(size_t(i)));
+                if (i < futures.size() - 1) {
+                    auto partialPeaks = std::make_shared<AudioPeaks>(peaks);
+                    partialPeaks->build();
+                    storeAudioPeaks(producer, stream, partialPeaks);
+                    QMetaObject::invokeMethod(m_object, "updateAudioThumbnail", Q_ARG(bool, false));
                 }
             }
-            // Incrementally update the audio levels every 3 seconds.
-            if (updateTime.elapsed() > 3000 && !m_isCanceled) {
-                updateTime.restart();
-                QVector<uint8_t> *levelsCopy = new QVector<uint8_t>(mltLevels);
-                producer->lock();
-                QString key = QString("_kdenlive:audio%1").arg(stream);
-                producer->set(key.toUtf8().constData(), levelsCopy, 0, (mlt_destructor)deleteQVariantList);
-                producer->unlock();
-                QMetaObject::invokeMethod(m_object, "updateAudioThumbnail", Q_ARG(bool, false));
-            }
+            synchronizer.waitForFinished();
+            valid = failures.loadRelaxed() == 0;
+        } else {
+            QElapsedTimer updateTime;
+            updateTime.start();
+            valid = decodeAudioSegment(*profile, service, resource, stream, frequency, 0, lengthInFrames, peaks, m_isCanceled, [&](int z) {
+                int val = int(100.0 * z / lengthInFrames);
+                if (m_progress != val) {
+                    m_progress = val;
+                    QMetaObject::invokeMethod(m_object, "updateJobProgress");
+                }
+                // Incrementally update the audio levels every 3 seconds.
+                if (updateTime.elapsed() > 3000 && !m_isCanceled) {
+                    updateTime.restart();
+                    auto partialPeaks = std::make_shared<AudioPeaks>(peaks);
+                    partialPeaks->build();
+                    storeAudioPeaks(producer, stream, partialPeaks);
+                    QMetaObject::invokeMethod(m_object, "updateAudioThumbnail", Q_ARG(bool, false));
+                }
+            });
+        }
+        if (!valid) {
+            QMetaObject::invokeMethod(pCore.get(), "displayBinMessage", Qt::QueuedConnection,
+                                      Q_ARG(QString, i18n("Audio thumbs: cannot open file %1", resource)),
+                                      Q_ARG(int, int(KMessageWidget::Warning)));
+            pCore->taskManager.taskDone(m_owner.second, this);
+            return;
         }
 
-        /*// Normalize
-        for (double &v : mltLevels) {
-            m_audioLevels << uchar(255 * v / maxLevel);
-        }*/
         if (m_isCanceled) {
-            mltLevels.clear();
             m_progress = 100;
             QMetaObject::invokeMethod(m_object, "updateJobProgress");
-        }
-        if (mltLevels.size() > 0) {
-            QVector<uint8_t> *levelsCopy = new QVector<uint8_t>(mltLevels);
-            producer->lock();
-            QString key = QString("_kdenlive:audio%1").arg(stream);
-            QString key2 = QString("kdenlive:audio_max%1").arg(stream);
-            producer->set(key2.toUtf8().constData(), int(maxLevel));
-            producer->set(key.toUtf8().constData(), levelsCopy, 0, (mlt_destructor)deleteQVariantList);
-            producer->unlock();
-            // qDebug()<<"=== FINISHED PRODUCING AUDIO FOR: "<<key<<", SIZE: "<<levelsCopy->size();
+        } else if (!peaks.isEmpty()) {
+            peaks.build();
+            // Once written, use the memory mapped cache so that the pages are shared and not kept on the heap
+            std::shared_ptr<const AudioPeaks> mapped = peaks.save(cachePath) ? AudioPeaks::load(cachePath) : nullptr;
+            storeAudioPeaks(producer, stream, mapped ? mapped : std::make_shared<const AudioPeaks>(std::move(peaks)));
             m_progress = 100;
             QMetaObject::invokeMethod(m_object, "updateJobProgress");
-            // Put into an image for caching.
-            int count = mltLevels.size();
-            QImage image((count + 3) / 4 / channels, channels, QImage::Format_ARGB32);
-            int n = image.width() * image.height();
-            for (int i = 0; i < n; i++) {
-                QRgb p;
-                if ((4 * i + 3) < count) {
-                    p = qRgba(mltLevels.at(4 * i), mltLevels.at(4 * i + 1), mltLevels.at(4 * i + 2), mltLevels.at(4 * i + 3));
-                } else {
-                    int last = mltLevels.last();
-                    int r = (4 * i + 0) < count ? mltLevels.at(4 * i + 0) : last;
-                    int g = (4 * i + 1) < count ? mltLevels.at(4 * i + 1) : last;
-                    int b = (4 * i + 2) < count ? mltLevels.at(4 * i + 2) : last;
-                    int a = last;
-                    p = qRgba(r, g, b, a);
-                }
-                image.setPixel(i / channels, i % channels, p);
-            }
-            image.save(cachePath);
             audioCreated = true;
             QMetaObject::invokeMethod(m_object, "updateAudioThumbnail", Q_ARG(bool, false));
         }
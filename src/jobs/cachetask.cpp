@@ -79,8 +79,14 @@ void CacheTask::generateThumbnail(std::shared_ptr<ProjectClip> binClip)
                 // Thumb producer not available
                 break;
             }
+            if (m_isCanceled) {
+                break;
+            }
             thumbProd->seek(i);
             QScopedPointer<Mlt::Frame> frame(thumbProd->get_frame());
+            if (m_isCanceled) {
+                break;
+            }
             if (frame != nullptr && frame->is_valid()) {
                 frame->set("consumer.deinterlacer", "onefield");
                 frame->set("consumer.top_field_first", -1);
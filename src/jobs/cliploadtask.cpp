@@ -14,6 +14,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "doc/kthumb.h"
 #include "kdenlivesettings.h"
 #include "project/dialogs/slideshowclip.h"
+#include "utils/mediaprobecache.hpp"
 #include "utils/thumbnailcache.hpp"
 
 #include "xml/xml.hpp"
@@ -38,6 +39,8 @@ ClipLoadTask::ClipLoadTask(const ObjectId &owner, const QDomElement &xml, bool t
     , m_out(out)
     , m_thumbOnly(thumbOnly)
 {
+    // Probing a file and fetching a thumbnail mostly waits on the disk
+    m_resource = IoBound;
 }
 
 ClipLoadTask::~ClipLoadTask() {}
@@ -274,7 +277,13 @@ void ClipLoadTask::generateThumbnail(std::shared_ptr<ProjectClip> binClip, std::
                 if (frameNumber > 0) {
                     thumbProd->seek(frameNumber);
                 }
+                if (m_isCanceled.loadAcquire() || pCore->taskManager.isBlocked()) {
+                    return;
+                }
                 QScopedPointer<Mlt::Frame> frame(thumbProd->get_frame());
+                if (m_isCanceled.loadAcquire() || pCore->taskManager.isBlocked()) {
+                    return;
+                }
                 if ((frame != nullptr) && frame->is_valid()) {
                     frame->set("consumer.deinterlacer", "onefield");
                     frame->set("consumer.top_field_first", -1);
@@ -610,17 +619,33 @@ void ClipLoadTask::run()
             producer->set("out", fixedLength - 1);
         }
     } else if (mltService == QLatin1String("avformat")) {
-        // Get a frame to init properties
-        mlt_image_format format = mlt_image_none;
-        QSize frameSize = pCore->getCurrentFrameSize();
-        int w = frameSize.width();
-        int h = frameSize.height();
-        std::unique_ptr<Mlt::Frame> frame(producer->get_frame());
-        frame->get_image(format, w, h);
-        // Check audio / video
-        bool hasAudio = frame->get_int("test_audio") == 0;
-        bool hasVideo = frame->get_int("test_image") == 0;
-        frame.reset();
+        // Check audio / video, decoding a frame unless the file is unchanged since we last did it with the same streams
+        QString selection;
+        for (const QString &name : {QStringLiteral("video_index"), QStringLiteral("audio_index"), QStringLiteral("set.test_image"), QStringLiteral("set.test_audio")}) {
+            if (Xml::hasXmlProperty(m_xml, name)) {
+                selection.append(QStringLiteral("%1=%2;").arg(name, Xml::getXmlProperty(m_xml, name)));
+            }
+        }
+        MediaProbeCache::StreamInfo probe;
+        bool cached = MediaProbeCache::get()->streams(resource, selection, probe);
+        if (cached && qAbs(probe.duration * pCore->getCurrentFps() - producer->get_length()) > 1) {
+            // Same file identity but not the same content
+            cached = false;
+        }
+        if (!cached) {
+            mlt_image_format format = mlt_image_none;
+            QSize frameSize = pCore->getCurrentFrameSize();
+            int w = frameSize.width();
+            int h = frameSize.height();
+            std::unique_ptr<Mlt::Frame> frame(producer->get_frame());
+            frame->get_image(format, w, h);
+            probe.hasAudio = frame->get_int("test_audio") == 0;
+            probe.hasVideo = frame->get_int("test_image") == 0;
+            probe.duration = producer->get_length() / pCore->getCurrentFps();
+            frame.reset();
+        }
+        bool hasAudio = probe.hasAudio;
+        bool hasVideo = probe.hasVideo;
         if (hasAudio) {
             if (hasVideo) {
                 producer->set("kdenlive:clip_type", 0);
@@ -671,12 +696,15 @@ void ClipLoadTask::run()
         }
 
         if (vindex > -1 && !m_isCanceled.loadAcquire()) {
-            char property[200];
-            snprintf(property, sizeof(property), "meta.media.%d.stream.frame_rate", vindex);
-            fps = producer->get_double(property);
-            QString codecName = QStringLiteral("meta.media.%1.codec.name").arg(vindex);
-            QString codec = producer->get(codecName.toUtf8().constData());
-            if (codec == QLatin1String("mjpeg")) {
+            if (!cached) {
+                char property[200];
+                snprintf(property, sizeof(property), "meta.media.%d.stream.frame_rate", vindex);
+                probe.fps = producer->get_double(property);
+                QString codecName = QStringLiteral("meta.media.%1.codec.name").arg(vindex);
+                probe.codec = producer->get(codecName.toUtf8().constData());
+            }
+            fps = probe.fps;
+            if (probe.codec == QLatin1String("mjpeg")) {
                 int frame_rate = producer->get_int("meta.media.frame_rate_num");
                 if (frame_rate == 90000) {
                     // This is an audio file with cover art, ignore video stream
@@ -724,6 +752,9 @@ void ClipLoadTask::run()
                 fps = producer->get_double("source_fps");
             }
         }
+        if (!cached && !m_isCanceled.loadAcquire()) {
+            MediaProbeCache::get()->storeStreams(resource, selection, probe);
+        }
     }
     if (fps <= 0 && type == ClipType::Unknown) {
         // something wrong, maybe audio file with embedded image
@@ -750,6 +781,11 @@ void ClipLoadTask::run()
     pCore->taskManager.taskDone(m_owner.second, this);
 }
 
+void ClipLoadTask::discard()
+{
+    abort();
+}
+
 void ClipLoadTask::abort()
 {
     m_progress = 100;
@@ -34,6 +34,7 @@ public:
 
 protected:
     void run() override;
+    void discard() override;
 
 private:
     //QString cacheKey();
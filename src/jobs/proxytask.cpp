@@ -62,6 +62,12 @@ void ProxyTask::run()
         QMetaObject::invokeMethod(binClip.get(), "updateProxyProducer", Qt::QueuedConnection, Q_ARG(QString, dest));
         return;
     }
+    // The document of a closed project is only deleted once its tasks returned
+    KdenliveDoc *document = pCore->currentDoc();
+    if (m_isCanceled || document == nullptr) {
+        pCore->taskManager.taskDone(m_owner.second, this);
+        return;
+    }
 
     ClipType::ProducerType type = binClip->clipType();
     m_progress = 0;
@@ -97,10 +103,10 @@ void ProxyTask::run()
         mltParameters << source;
         // set destination
         mltParameters << QStringLiteral("-consumer") << QStringLiteral("avformat:") + dest;
-        QString parameter = pCore->currentDoc()->getDocumentProperty(QStringLiteral("proxyparams")).simplified();
+        QString parameter = document->getDocumentProperty(QStringLiteral("proxyparams")).simplified();
         if (parameter.isEmpty()) {
             // Automatic setting, decide based on hw support
-            parameter = pCore->currentDoc()->getAutoProxyProfile();
+            parameter = document->getAutoProxyProfile();
             bool nvenc = parameter.contains(QStringLiteral("%nvcodec"));
             if (nvenc) {
                 parameter = parameter.section(QStringLiteral("-i"), 1);
@@ -109,7 +115,7 @@ void ProxyTask::run()
                 parameter.prepend(QStringLiteral("-pix_fmt yuv420p"));
             }
         }
-        int proxyResize = pCore->currentDoc()->getDocumentProperty(QStringLiteral("proxyresize")).toInt();
+        int proxyResize = document->getDocumentProperty(QStringLiteral("proxyresize")).toInt();
         parameter.replace(QStringLiteral("%width"), QString::number(proxyResize));
 
         QStringList params = parameter.split(QLatin1Char('-'), Qt::SkipEmptyParts);
@@ -261,12 +267,12 @@ void ProxyTask::run()
         QStringList parameters = {QStringLiteral("-hide_banner"), QStringLiteral("-y"),    QStringLiteral("-stats"),
                                   QStringLiteral("-v"),           QStringLiteral("error"), QStringLiteral("-noautorotate")};
         m_jobDuration = int(binClip->duration().seconds());
-        QString proxyParams = pCore->currentDoc()->getDocumentProperty(QStringLiteral("proxyparams")).simplified();
+        QString proxyParams = document->getDocumentProperty(QStringLiteral("proxyparams")).simplified();
         if (proxyParams.isEmpty()) {
             // Automatic setting, decide based on hw support
-            proxyParams = pCore->currentDoc()->getAutoProxyProfile();
+            proxyParams = document->getAutoProxyProfile();
         }
-        int proxyResize = pCore->currentDoc()->getDocumentProperty(QStringLiteral("proxyresize")).toInt();
+        int proxyResize = document->getDocumentProperty(QStringLiteral("proxyresize")).toInt();
         bool nvenc = proxyParams.contains(QStringLiteral("%nvcodec"));
         if (nvenc) {
             QString pix_fmt = binClip->videoCodecProperty(QStringLiteral("pix_fmt"));
@@ -21,10 +21,14 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 TaskManager::TaskManager(QObject *parent)
     : QObject(parent)
     , m_tasksListLock(QReadWriteLock::Recursive)
+    , m_started{0, 0, 0}
+    , m_runCounter(0)
     , m_blockUpdates(false)
 {
-    int maxThreads = qMin(4, QThread::idealThreadCount() - 1);
-    m_taskPool.setMaxThreadCount(qMax(maxThreads, 1));
+    // Keep one core for the interface and playback
+    m_taskPool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() - 1, 8));
+    m_segmentPool.setMaxThreadCount(m_taskPool.maxThreadCount());
+    m_ioPool.setMaxThreadCount(IoThreads);
     m_transcodePool.setMaxThreadCount(KdenliveSettings::proxythreads());
 }
 
@@ -38,39 +42,227 @@ bool TaskManager::isBlocked() const
     return m_blockUpdates;
 }
 
+QThreadPool *TaskManager::segmentPool()
+{
+    return &m_segmentPool;
+}
+
 void TaskManager::updateConcurrency()
 {
     m_transcodePool.setMaxThreadCount(KdenliveSettings::proxythreads());
+    dispatchTasks();
+}
+
+void TaskManager::setTimelineFocus(const QSet<int> &binIds)
+{
+    QMutexLocker lk(&m_queueMutex);
+    m_timelineFocus = binIds;
+}
+
+void TaskManager::setSelectionFocus(const QSet<int> &binIds)
+{
+    QMutexLocker lk(&m_queueMutex);
+    m_selectionFocus = binIds;
+}
+
+bool TaskManager::hasQueuedTasks() const
+{
+    QMutexLocker lk(&m_queueMutex);
+    return !m_queue.empty();
+}
+
+QThreadPool &TaskManager::pool(PoolType type)
+{
+    switch (type) {
+    case IoPool:
+        return m_ioPool;
+    case TranscodePool:
+        return m_transcodePool;
+    default:
+        return m_taskPool;
+    }
+}
+
+TaskManager::PoolType TaskManager::poolType(const AbstractTask *task) const
+{
+    if (task->m_type == AbstractTask::TRANSCODEJOB || task->m_type == AbstractTask::PROXYJOB) {
+        // We only want a limited concurrent jobs for those as for example GPU usually only accept 2 concurrent encoding jobs
+        return TranscodePool;
+    }
+    return task->m_resource == AbstractTask::IoBound ? IoPool : CpuPool;
+}
+
+int TaskManager::urgency(const AbstractTask *task) const
+{
+    if (task->m_isCanceled.loadAcquire()) {
+        // A canceled task returns immediately, release it first
+        return 0;
+    }
+    int focus = 3;
+    if (task->m_owner.first == ObjectType::BinClip) {
+        if (m_timelineFocus.contains(task->m_owner.second)) {
+            focus = 1;
+        } else if (m_selectionFocus.contains(task->m_owner.second)) {
+            focus = 2;
+        }
+    }
+    // Type priorities are below 100
+    return focus * 100 - task->m_priority;
+}
+
+void TaskManager::dispatchTasks()
+{
+    QMutexLocker lk(&m_queueMutex);
+    while (!m_blockUpdates) {
+        auto next = m_queue.end();
+        int nextUrgency = 0;
+        for (auto it = m_queue.begin(); it != m_queue.end(); ++it) {
+            PoolType type = poolType(*it);
+            if (m_started[type] >= pool(type).maxThreadCount()) {
+                continue;
+            }
+            int value = urgency(*it);
+            // On equal urgency, the oldest task wins
+            if (next == m_queue.end() || value < nextUrgency) {
+                next = it;
+                nextUrgency = value;
+            }
+        }
+        if (next == m_queue.end()) {
+            break;
+        }
+        AbstractTask *task = *next;
+        m_queue.erase(next);
+        PoolType type = poolType(task);
+        m_started[type]++;
+        quint64 runId = ++m_runCounter;
+        m_runningTasks[task] = runId;
+        pool(type).start([this, task, type, runId]() {
+            // The task may be deleted once run returns
+            task->run();
+            taskReturned(type, task, runId);
+        });
+    }
+}
+
+void TaskManager::taskReturned(PoolType type, AbstractTask *task, quint64 runId)
+{
+    m_queueMutex.lock();
+    m_started[type]--;
+    auto running = m_runningTasks.find(task);
+    if (running != m_runningTasks.end() && running->second == runId) {
+        m_runningTasks.erase(running);
+    }
+    auto requests = m_stopRequests.find(runId);
+    if (requests != m_stopRequests.end()) {
+        for (const auto &request : requests->second) {
+            if (--request->pending == 0) {
+                request->promise.reportFinished();
+            }
+        }
+        m_stopRequests.erase(requests);
+    }
+    m_queueMutex.unlock();
+    dispatchTasks();
+}
+
+QFuture<void> TaskManager::stopTasks(const std::vector<AbstractTask *> &tasks, bool softDelete)
+{
+    auto request = std::make_shared<StopRequest>();
+    request->promise.reportStarted();
+    QFuture<void> future = request->promise.future();
+    for (AbstractTask *t : tasks) {
+        t->cancelJob(softDelete);
+    }
+    std::vector<AbstractTask *> queued;
+    m_queueMutex.lock();
+    for (AbstractTask *t : tasks) {
+        auto it = std::find(m_queue.begin(), m_queue.end(), t);
+        if (it != m_queue.end()) {
+            m_queue.erase(it);
+            queued.push_back(t);
+            continue;
+        }
+        auto running = m_runningTasks.find(t);
+        if (running != m_runningTasks.end()) {
+            m_stopRequests[running->second].push_back(request);
+            request->pending++;
+        }
+    }
+    bool stopped = request->pending == 0;
+    m_queueMutex.unlock();
+    // Tasks that did not start are released without waiting for a free thread
+    for (AbstractTask *t : queued) {
+        t->discard();
+    }
+    if (stopped) {
+        request->promise.reportFinished();
+    }
+    return future;
 }
 
 void TaskManager::discardJobs(const ObjectId &owner, AbstractTask::JOBTYPE type, bool softDelete, const QVector<AbstractTask::JOBTYPE> exceptions)
+{
+    // Block until the tasks are finished
+    cancelJobs(owner, type, softDelete, exceptions).waitForFinished();
+}
+
+QFuture<void> TaskManager::cancelJobs(const ObjectId &owner, AbstractTask::JOBTYPE type, bool softDelete, const QVector<AbstractTask::JOBTYPE> exceptions)
 {
     qDebug() << "========== READY FOR TASK DISCARD ON: " << owner.second;
     if (m_blockUpdates) {
         // We are already deleting all tasks
-        return;
+        return stopTasks({}, softDelete);
     }
+    std::vector<AbstractTask *> tasks;
     m_tasksListLock.lockForRead();
     // See if there is already a task for this MLT service and resource.
-    if (m_taskList.find(owner.second) == m_taskList.end()) {
-        m_tasksListLock.unlock();
-        return;
+    if (m_taskList.find(owner.second) != m_taskList.end()) {
+        for (AbstractTask *t : m_taskList.at(owner.second)) {
+            if ((type == AbstractTask::NOJOBTYPE || type == t->m_type) && t->m_progress < 100 && !exceptions.contains(t->m_type)) {
+                tasks.push_back(t);
+            }
+        }
     }
-    std::vector<AbstractTask *> taskList = m_taskList.at(owner.second);
     m_tasksListLock.unlock();
-    for (AbstractTask *t : taskList) {
-        if ((type == AbstractTask::NOJOBTYPE || type == t->m_type) && t->m_progress < 100) {
-            // If so, then just add ourselves to be notified upon completion.
-            if (exceptions.contains(t->m_type)) {
-                // Don't abort
-                continue;
+    return stopTasks(tasks, softDelete);
+}
+
+QFuture<void> TaskManager::cancelAllJobs(const QVector<AbstractTask::JOBTYPE> exceptions)
+{
+    if (m_blockUpdates) {
+        return stopTasks({}, false);
+    }
+    std::vector<AbstractTask *> tasks;
+    m_tasksListLock.lockForRead();
+    for (const auto &task : m_taskList) {
+        for (AbstractTask *t : task.second) {
+            if (!exceptions.contains(t->m_type)) {
+                tasks.push_back(t);
             }
-            t->cancelJob(softDelete);
-            qDebug() << "========== DELETING JOB!!!!";
-            // Block until the task is finished
-            t->m_runMutex.lock();
         }
     }
+    m_tasksListLock.unlock();
+    return stopTasks(tasks, false);
+}
+
+void TaskManager::whenStopped(QList<QFuture<void>> futures, QObject *context, std::function<void()> callback)
+{
+    while (!futures.isEmpty() && futures.first().isFinished()) {
+        futures.removeFirst();
+    }
+    if (futures.isEmpty()) {
+        callback();
+        return;
+    }
+    // Follow the first running future, then check the others again
+    QFuture<void> next = futures.takeFirst();
+    auto *watcher = new QFutureWatcher<void>(context);
+    connect(watcher, &QFutureWatcher<void>::finished, context, [this, watcher, futures, context, callback]() {
+        watcher->deleteLater();
+        whenStopped(futures, context, callback);
+    });
+    watcher->setFuture(next);
 }
 
 bool TaskManager::hasPendingJob(const ObjectId &owner, AbstractTask::JOBTYPE type) const
@@ -140,28 +332,42 @@ void TaskManager::taskDone(int cid, AbstractTask *task)
 void TaskManager::slotCancelJobs(const QVector<AbstractTask::JOBTYPE> exceptions)
 {
     m_blockUpdates = true;
-    m_tasksListLock.lockForWrite();
+    std::vector<AbstractTask *> tasks;
+    m_tasksListLock.lockForRead();
     for (const auto &task : m_taskList) {
         for (AbstractTask *t : task.second) {
-            if (m_taskList.find(task.first) != m_taskList.end()) {
-                if (!exceptions.contains(t->m_type)) {
-                    // If so, then just add ourselves to be notified upon completion.
-                    t->cancelJob();
-                    t->m_runMutex.lock();
-                    t->m_runMutex.unlock();
-                    delete t;
+            if (!exceptions.contains(t->m_type)) {
+                tasks.push_back(t);
+            }
+        }
+    }
+    m_tasksListLock.unlock();
+    // Cancel everything before waiting, so that the running tasks stop in parallel
+    stopTasks(tasks, false).waitForFinished();
+    m_tasksListLock.lockForWrite();
+    for (AbstractTask *t : tasks) {
+        // Updates are blocked, so the stopped tasks are still listed and have to be deleted here
+        for (auto it = m_taskList.begin(); it != m_taskList.end(); ++it) {
+            auto pos = std::find(it->second.begin(), it->second.end(), t);
+            if (pos != it->second.end()) {
+                it->second.erase(pos);
+                if (it->second.empty()) {
+                    m_taskList.erase(it);
                 }
+                delete t;
+                break;
             }
         }
     }
     m_tasksListLock.unlock();
     if (exceptions.isEmpty()) {
         m_taskPool.waitForDone();
+        m_ioPool.waitForDone();
         m_transcodePool.waitForDone();
-        m_taskList.clear();
-        m_taskPool.clear();
+        m_segmentPool.waitForDone();
     }
     m_blockUpdates = false;
+    dispatchTasks();
     updateJobCount();
 }
 
@@ -179,13 +385,11 @@ void TaskManager::startTask(int ownerId, AbstractTask *task)
     } else {
         m_taskList[ownerId].emplace_back(task);
     }
-    if (task->m_type == AbstractTask::TRANSCODEJOB || task->m_type == AbstractTask::PROXYJOB) {
-        // We only want a limited concurrent jobs for those as for example GPU usually only accept 2 concurrent encoding jobs
-        m_transcodePool.start(task, task->m_priority);
-    } else {
-        m_taskPool.start(task, task->m_priority);
-    }
+    m_queueMutex.lock();
+    m_queue.push_back(task);
+    m_queueMutex.unlock();
     m_tasksListLock.unlock();
+    dispatchTasks();
     updateJobCount();
 }
 
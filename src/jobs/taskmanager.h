@@ -12,10 +12,14 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "definitions.h"
 
 #include <QAbstractListModel>
+#include <QFutureInterface>
 #include <QFutureWatcher>
+#include <QMutex>
 #include <QObject>
 #include <QReadWriteLock>
+#include <QSet>
 #include <QThreadPool>
+#include <functional>
 #include <map>
 #include <memory>
 #include <unordered_map>
@@ -28,6 +32,13 @@ Q_DECLARE_METATYPE(TaskManagerStatus)
 
 /** @class TaskManager
     @brief This class is responsible for clip jobs management.
+
+    Tasks are not pushed to the thread pools directly: they wait in a queue and
+    each time a thread becomes free, the most urgent queued task is started.
+    Tasks on bin clips used around the playhead or in the visible part of the
+    timeline come first, then tasks on the clips selected in the bin, then the
+    others, by their type priority. CPU bound and I/O bound tasks use separate
+    pools, sized from the number of cores and a fixed number of threads.
  */
 class TaskManager : public QObject
 {
@@ -37,7 +48,7 @@ public:
     explicit TaskManager(QObject *parent);
     ~TaskManager() override;
 
-    /** @brief Discard specific job type for a clip.
+    /** @brief Discard specific job type for a clip and wait until the running tasks stopped.
      *  @param owner the owner item for this task
      *  @param type The type of job that you want to abort, leave to NOJOBTYPE to abort all jobs
      */
@@ -48,6 +59,22 @@ public:
      *  @param type The type of job that you want to query
      */
     bool hasPendingJob(const ObjectId &owner, AbstractTask::JOBTYPE type = AbstractTask::NOJOBTYPE) const;
+
+    /** @brief Request the cancellation of jobs for a clip without waiting, same parameters as discardJobs.
+     *  Tasks that did not start yet are released immediately.
+     *  @returns a future that finishes once all the matching tasks actually stopped
+     */
+    QFuture<void> cancelJobs(const ObjectId &owner, AbstractTask::JOBTYPE type = AbstractTask::NOJOBTYPE, bool softDelete = false,
+                             const QVector<AbstractTask::JOBTYPE> exceptions = {});
+    /** @brief Request the cancellation of all jobs without waiting.
+     *  @returns a future that finishes once all the canceled tasks actually stopped
+     */
+    QFuture<void> cancelAllJobs(const QVector<AbstractTask::JOBTYPE> exceptions = {});
+    /** @brief Call @p callback once all the @p futures returned by cancelJobs / cancelAllJobs finished.
+     *  The callback is called right away if they are already finished, otherwise from the event loop of @p context.
+     *  It is not called if @p context is deleted before.
+     */
+    void whenStopped(QList<QFuture<void>> futures, QObject *context, std::function<void()> callback);
     
     TaskManagerStatus jobStatus(const ObjectId &owner) const;
 
@@ -63,14 +90,26 @@ public:
     /** @brief Update the number of concurrent jobs allowed */
     void updateConcurrency();
 
+    /** @brief Set the bin clips used around the playhead or in the visible part of the timeline, their tasks are started first */
+    void setTimelineFocus(const QSet<int> &binIds);
+    /** @brief Set the bin clips selected in the project bin, their tasks are started before the remaining ones */
+    void setSelectionFocus(const QSet<int> &binIds);
+    /** @brief Returns true if some tasks are waiting for a free thread */
+    bool hasQueuedTasks() const;
+
     /** @brief We are aborting all tasks and don't want them to send any updates */
     bool isBlocked() const;
 
+    /** @brief Pool for the parts of a task that are processed in parallel, like audio thumbnail segments.
+     *  It is sized like the CPU pool, a task waiting on its parts leaves its own thread idle.
+     */
+    QThreadPool *segmentPool();
+
     /** @brief return the message of a given job on a given clip (message, detailed log)*/
     //QPair<QString, QString> getJobMessageForClip(int jobId, const QString &binId) const;
 
 public slots:
-    /** @brief Discard all running jobs. */
+    /** @brief Discard all running jobs and wait until they stopped. All tasks are canceled before waiting, so they stop in parallel. */
     void slotCancelJobs(const QVector<AbstractTask::JOBTYPE> exceptions = {});
 
 private slots:
@@ -78,12 +117,48 @@ private slots:
     void updateJobCount();
 
 private:
+    enum PoolType { CpuPool = 0, IoPool = 1, TranscodePool = 2, PoolCount = 3 };
+    /** @brief Number of threads for the I/O bound tasks, they mostly wait on the disk so it does not depend on the cores */
+    static const int IoThreads = 4;
+
     QThreadPool m_taskPool;
+    QThreadPool m_ioPool;
     QThreadPool m_transcodePool;
+    QThreadPool m_segmentPool;
+    /** @brief Tasks waiting for a free thread, in submission order */
+    std::vector<AbstractTask *> m_queue;
+    /** @brief Number of tasks handed to each pool and not finished */
+    int m_started[PoolCount];
+    QSet<int> m_timelineFocus;
+    QSet<int> m_selectionFocus;
+    /** @brief Tasks handed to a pool and not returned, with the id of their run */
+    std::unordered_map<AbstractTask *, quint64> m_runningTasks;
+    quint64 m_runCounter;
+    /** @brief A cancellation request, finished once all its running tasks returned */
+    struct StopRequest
+    {
+        QFutureInterface<void> promise;
+        int pending = 0;
+    };
+    /** @brief Cancellation requests waiting for a run to return, by run id */
+    std::unordered_map<quint64, std::vector<std::shared_ptr<StopRequest>>> m_stopRequests;
+    /** @brief Protects the queue, the started counts, the running tasks, the stop requests and the focus sets */
+    mutable QMutex m_queueMutex;
     std::unordered_map<int, std::vector<AbstractTask*> > m_taskList;
     mutable QReadWriteLock m_tasksListLock;
     bool m_blockUpdates;
 
+    QThreadPool &pool(PoolType type);
+    PoolType poolType(const AbstractTask *task) const;
+    /** @brief Lower is more urgent */
+    int urgency(const AbstractTask *task) const;
+    /** @brief Start the most urgent queued tasks while their pool has a free thread */
+    void dispatchTasks();
+    /** @brief Called from the pool thread once a task returned, @p task may already be deleted */
+    void taskReturned(PoolType type, AbstractTask *task, quint64 runId);
+    /** @brief Cancel tasks, release the queued ones and return a future following the running ones */
+    QFuture<void> stopTasks(const std::vector<AbstractTask *> &tasks, bool softDelete);
+
 signals:
     void jobCount(int);
 };
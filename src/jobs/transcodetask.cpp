@@ -63,6 +63,12 @@ void TranscodeTask::run()
     QMutexLocker lock(&m_runMutex);
     m_running = true;
     auto binClip = pCore->projectItemModel()->getClipByBinID(QString::number(m_owner.second));
+    // The document of a closed project is only deleted once its tasks returned
+    KdenliveDoc *document = pCore->currentDoc();
+    if (binClip == nullptr || document == nullptr) {
+        pCore->taskManager.taskDone(m_owner.second, this);
+        return;
+    }
     ClipType::ProducerType type = binClip->clipType();
     QString source;
     QTemporaryFile src;
@@ -98,7 +104,7 @@ void TranscodeTask::run()
     QDir dir;
     if (type == ClipType::Text) {
         fileName = binClip->name();
-        dir = QDir(pCore->currentDoc()->url().isValid() ? pCore->currentDoc()->url().adjusted(QUrl::RemoveFilename).toLocalFile()
+        dir = QDir(document->url().isValid() ? document->url().adjusted(QUrl::RemoveFilename).toLocalFile()
                                                         : KdenliveSettings::defaultprojectfolder());
     } else {
         fileName = finfo.fileName().section(QLatin1Char('.'), 0, -2);
@@ -9,6 +9,8 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "kdenlive_debug.h"
 #include "klocalizedstring.h"
 #include <QElapsedTimer>
+#include <QtConcurrent>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
@@ -22,6 +24,14 @@ AudioCorrelation::AudioCorrelation(std::unique_ptr<AudioEnvelope> mainTrackEnvel
 
 AudioCorrelation::~AudioCorrelation()
 {
+    for (auto it = m_running.constBegin(); it != m_running.constEnd(); ++it) {
+        it.key()->waitForFinished();
+        delete it.key()->result().info;
+        delete it.value();
+    }
+    for (AudioEnvelope *envelope : qAsConst(m_pending)) {
+        delete envelope;
+    }
     for (AudioEnvelope *envelope : qAsConst(m_children)) {
         delete envelope;
     }
@@ -35,6 +45,14 @@ AudioCorrelation::~AudioCorrelation()
 void AudioCorrelation::slotAnnounceEnvelope()
 {
     emit displayMessage(i18n("Audio analysis finished"), OperationCompletedMessage, 300);
+    // Normalize the reference once, its transform is then cached for all children
+    const std::vector<qint64> &envMain = m_mainTrackEnvelope->envelope();
+    m_reference = std::make_shared<const FFTCorrelation::Reference>(envMain.data(), envMain.size());
+    // Process the children that were ready before the reference
+    const QList<AudioEnvelope *> ready = m_ready;
+    for (AudioEnvelope *envelope : ready) {
+        startCorrelation(envelope);
+    }
 }
 
 void AudioCorrelation::addChild(AudioEnvelope *envelope)
@@ -43,51 +61,98 @@ void AudioCorrelation::addChild(AudioEnvelope *envelope)
     // there is no race condition where the signal 'envelopeReady' is
     // lost.
     Q_ASSERT(!envelope->hasComputationStarted());
+    m_pending.append(envelope);
     connect(envelope, &AudioEnvelope::envelopeReady, this, &AudioCorrelation::slotProcessChild);
     envelope->startComputeEnvelope();
 }
 
+void AudioCorrelation::addChildren(const QList<AudioEnvelope *> &envelopes)
+{
+    m_batchSize += envelopes.size();
+    for (AudioEnvelope *envelope : envelopes) {
+        addChild(envelope);
+    }
+}
+
 void AudioCorrelation::slotProcessChild(AudioEnvelope *envelope)
 {
-    // Note that at this point the computation of the envelope of the
-    // main track might not be finished. envelope() will block until
-    // the computation is done.
-    const size_t sizeMain = m_mainTrackEnvelope->envelope().size();
-    const size_t sizeSub = envelope->envelope().size();
+    // The correlation needs the envelope of the main track, wait for it without blocking
+    if (m_reference) {
+        startCorrelation(envelope);
+    } else {
+        m_ready.append(envelope);
+    }
+}
 
-    auto *info = new AudioCorrelationInfo(sizeMain, sizeSub);
-    qint64 *correlation = info->correlationVector();
+void AudioCorrelation::startCorrelation(AudioEnvelope *envelope)
+{
+    m_pending.removeAll(envelope);
+    m_ready.removeAll(envelope);
+    auto *watcher = new QFutureWatcher<ChildResult>(this);
+    m_running.insert(watcher, envelope);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() { childCorrelated(watcher); });
+    watcher->setFuture(QtConcurrent::run([this, envelope]() { return correlateChild(envelope); }));
+}
 
+AudioCorrelation::ChildResult AudioCorrelation::correlateChild(AudioEnvelope *envelope) const
+{
+    // Both envelopes are computed at this point, so these do not block
     const std::vector<qint64> &envMain = m_mainTrackEnvelope->envelope();
     const std::vector<qint64> &envSub = envelope->envelope();
+    const size_t sizeMain = envMain.size();
+    const size_t sizeSub = envSub.size();
+
+    auto *info = new AudioCorrelationInfo(sizeMain, sizeSub);
+    qint64 *correlation = info->correlationVector();
     qint64 max = 0;
 
     if (sizeSub > 200) {
-        FFTCorrelation::correlate(&envMain[0], sizeMain, &envSub[0], sizeSub, correlation);
+        FFTCorrelation::correlate(*m_reference, &envSub[0], sizeSub, correlation);
     } else {
         correlate(&envMain[0], sizeMain, &envSub[0], sizeSub, correlation, &max);
         info->setMax(max);
     }
 
+    // Coarse pass at frame resolution, then refine the lag with the fine envelopes
+    const qint64 lag = qint64(info->maxIndex()) - qint64(sizeSub);
+    return {info, refineLag(m_mainTrackEnvelope->fineEnvelope(), envelope->fineEnvelope(), AudioEnvelope::SubFrames, lag)};
+}
+
+void AudioCorrelation::childCorrelated(QFutureWatcher<ChildResult> *watcher)
+{
+    AudioEnvelope *envelope = m_running.take(watcher);
+    const ChildResult result = watcher->result();
+    watcher->deleteLater();
+
     m_children.append(envelope);
-    m_correlations.append(info);
+    m_correlations.append(result.info);
+    m_lags.append(result.lag);
 
     Q_ASSERT(m_correlations.size() == m_children.size());
-    int index = m_children.indexOf(envelope);
+    int index = m_children.size() - 1;
     int shift = getShift(index);
     emit gotAudioAlignData(envelope->clipId(), shift);
+    m_batchDone++;
+    if (m_batchSize > 1) {
+        emit displayMessage(i18n("Aligned %1 of %2 clips", m_batchDone, m_batchSize), ProcessingJobMessage, 100 * m_batchDone / m_batchSize);
+    }
+    if (m_batchDone >= m_batchSize) {
+        m_batchSize = 0;
+        m_batchDone = 0;
+    }
 }
 
 int AudioCorrelation::getShift(int childIndex) const
+{
+    return int(std::lround(getSubFrameShift(childIndex)));
+}
+
+double AudioCorrelation::getSubFrameShift(int childIndex) const
 {
     Q_ASSERT(childIndex >= 0);
     Q_ASSERT(childIndex < m_correlations.size());
 
-    size_t indexOffset = m_correlations.at(childIndex)->maxIndex();
-    indexOffset -= m_children.at(childIndex)->envelope().size();
-    indexOffset += m_children.at(childIndex)->offset();
-
-    return int(indexOffset);
+    return m_lags.at(childIndex) + double(m_children.at(childIndex)->offset());
 }
 
 AudioCorrelationInfo const *AudioCorrelation::info(int childIndex) const
@@ -98,6 +163,43 @@ AudioCorrelationInfo const *AudioCorrelation::info(int childIndex) const
     return m_correlations.at(childIndex);
 }
 
+double AudioCorrelation::refineLag(const std::vector<qint64> &fineMain, const std::vector<qint64> &fineSub, int subFrames, qint64 lag)
+{
+    if (fineMain.empty() || fineSub.empty() || subFrames < 1) {
+        return double(lag);
+    }
+    // Correlation of the fine envelopes for a lag in sub-frames, on their overlapping part.
+    // Summed as double since the products of sums of samples overflow 64 bit integers.
+    auto correlation = [&fineMain, &fineSub](qint64 fineLag) {
+        const qint64 first = std::max(qint64(0), -fineLag);
+        const qint64 last = std::min(qint64(fineSub.size()), qint64(fineMain.size()) - fineLag);
+        double sum = 0;
+        for (qint64 i = first; i < last; ++i) {
+            sum += double(fineSub[size_t(i)]) * double(fineMain[size_t(i + fineLag)]);
+        }
+        return sum;
+    };
+    const qint64 center = lag * subFrames;
+    qint64 best = center;
+    double bestValue = correlation(center);
+    for (qint64 fineLag = center - subFrames; fineLag <= center + subFrames; ++fineLag) {
+        const double value = correlation(fineLag);
+        if (value > bestValue) {
+            best = fineLag;
+            bestValue = value;
+        }
+    }
+    // Fit a parabola through the best lag and its neighbours, its vertex is the sub-frame estimate
+    const double before = correlation(best - 1);
+    const double after = correlation(best + 1);
+    const double curvature = before - 2 * bestValue + after;
+    double delta = 0;
+    if (curvature < 0) {
+        delta = qBound(-0.5, 0.5 * (before - after) / curvature, 0.5);
+    }
+    return (double(best) + delta) / subFrames;
+}
+
 void AudioCorrelation::correlate(const qint64 *envMain, size_t sizeMain, const qint64 *envSub, size_t sizeSub, qint64 *correlation, qint64 *out_max)
 {
     Q_ASSERT(correlation != nullptr);
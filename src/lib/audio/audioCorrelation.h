@@ -10,14 +10,21 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "audioCorrelationInfo.h"
 #include "audioEnvelope.h"
 #include "definitions.h"
+#include "fftCorrelation.h"
+#include <QFutureWatcher>
+#include <QHash>
 #include <QList>
+#include <memory>
 
 /**
   This class does the correlation between two tracks
   in order to synchronize (align) them.
 
   It uses one main track (used in the initializer); further tracks will be
-  aligned relative to this main track.
+  aligned relative to this main track. The transform of the main track is
+  computed once and shared by the correlations of all the children, which
+  run in worker threads. The frame accurate shift is then refined below one
+  frame using the fine envelopes.
   */
 class AudioCorrelation : public QObject
 {
@@ -48,9 +55,20 @@ public:
       This object will take ownership of the passed envelope.
       */
     void addChild(AudioEnvelope *envelope);
+    /**
+      Adds several child envelopes, their computations all run in parallel.
+      gotAudioAlignData is emitted for each child once aligned, and
+      displayMessage reports how many children were aligned.
+
+      This object will take ownership of the passed envelopes.
+      */
+    void addChildren(const QList<AudioEnvelope *> &envelopes);
 
     const AudioCorrelationInfo *info(int childIndex) const;
+    /** Returns the shift of a child in frames, rounded from getSubFrameShift() */
     int getShift(int childIndex) const;
+    /** Returns the shift of a child in frames, with sub-frame accuracy */
+    double getSubFrameShift(int childIndex) const;
 
     /**
       Correlates the two vectors envMain and envSub.
@@ -58,11 +76,39 @@ public:
       */
     static void correlate(const qint64 *envMain, size_t sizeMain, const qint64 *envSub, size_t sizeSub, qint64 *correlation, qint64 *out_max = nullptr);
 
+    /**
+      Refines the frame lag \c lag of envSub relative to envMain (i.e. envSub[i] matches envMain[i + lag])
+      using their fine envelopes with \c subFrames entries per frame. The best lag within one frame
+      is searched, then interpolated with its neighbours. Returns the lag in frames.
+      */
+    static double refineLag(const std::vector<qint64> &fineMain, const std::vector<qint64> &fineSub, int subFrames, qint64 lag);
+
 private:
+    struct ChildResult
+    {
+        AudioCorrelationInfo *info;
+        double lag;
+    };
+
     std::unique_ptr<AudioEnvelope> m_mainTrackEnvelope;
+    std::shared_ptr<const FFTCorrelation::Reference> m_reference;
 
     QList<AudioEnvelope *> m_children;
     QList<AudioCorrelationInfo *> m_correlations;
+    QList<double> m_lags;
+    /** Children whose correlation was not started yet */
+    QList<AudioEnvelope *> m_pending;
+    /** Pending children whose envelope is computed, waiting for the main envelope */
+    QList<AudioEnvelope *> m_ready;
+    /** Children whose correlation is running */
+    QHash<QFutureWatcher<ChildResult> *, AudioEnvelope *> m_running;
+    int m_batchSize{0};
+    int m_batchDone{0};
+
+    /** Runs in a worker thread */
+    ChildResult correlateChild(AudioEnvelope *envelope) const;
+    void startCorrelation(AudioEnvelope *envelope);
+    void childCorrelated(QFutureWatcher<ChildResult> *watcher);
 
 private slots:
     /**
@@ -6,6 +6,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 */
 
 #include "audioEnvelope.h"
+#include "audioPeaks.h"
 #include "audioStreamInfo.h"
 #include "bin/bin.h"
 #include "bin/projectclip.h"
@@ -18,12 +19,33 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <algorithm>
 #include <cmath>
 
+constexpr int AudioEnvelope::SubFrames;
+
 AudioEnvelope::AudioEnvelope(const QString &binId, int clipId, size_t offset, size_t length, size_t startPos)
     : m_offset(offset)
     , m_clipId(clipId)
     , m_startpos(startPos)
 {
     std::shared_ptr<ProjectClip> clip = pCore->bin()->getBinClip(binId);
+    connect(&m_watcher, &QFutureWatcherBase::finished, this, [this] { emit envelopeReady(this); });
+    // Reuse the audio thumbnail if it was already computed, so that the clip is not decoded again
+    std::shared_ptr<const AudioPeaks> peaks = clip->audioPeaks();
+    if (peaks && !peaks->isEmpty()) {
+        size_t in = 0;
+        size_t size = clip->frameDuration();
+        if (length > 2000) {
+            // Analyse on timeline clip zone only
+            m_offset = 0;
+            in = offset;
+            size = length + 1;
+        }
+        if (in + size <= size_t(peaks->frameCount())) {
+            m_peaks = peaks;
+            m_peaksIn = in;
+            m_envelopeSize = size;
+            return;
+        }
+    }
     m_producer = clip->cloneProducer();
     if (length > 2000) {
         // Analyse on timeline clip zone only
@@ -33,7 +55,6 @@ AudioEnvelope::AudioEnvelope(const QString &binId, int clipId, size_t offset, si
     m_envelopeSize = size_t(m_producer->get_playtime());
 
     m_producer->set("set.test_image", 1);
-    connect(&m_watcher, &QFutureWatcherBase::finished, this, [this] { emit envelopeReady(this); });
     if (!m_producer || !m_producer->is_valid()) {
         qCDebug(KDENLIVE_LOG) << "// Cannot create envelope for producer: " << binId;
     } else {
@@ -95,13 +116,76 @@ const std::vector<qint64> &AudioEnvelope::envelope()
     return audioSummary().audioAmplitudes;
 }
 
+const std::vector<qint64> &AudioEnvelope::fineEnvelope()
+{
+    return audioSummary().fineAmplitudes;
+}
+
 AudioEnvelope::AudioSummary AudioEnvelope::loadAndNormalizeEnvelope() const
 {
     qCDebug(KDENLIVE_LOG) << "Loading envelope …";
     AudioSummary summary(m_envelopeSize);
-    if (!m_info || m_info->size() < 1) {
+    if (m_peaks) {
+        loadFromPeaks(summary);
+    } else if (!decodeEnvelope(summary)) {
+        return summary;
+    }
+    size_t max = summary.audioAmplitudes.size();
+    if (max == 0) {
         return summary;
     }
+    qCDebug(KDENLIVE_LOG) << "Normalizing envelope …";
+    const qint64 meanBeforeNormalization =
+        std::accumulate(summary.audioAmplitudes.begin(), summary.audioAmplitudes.end(), 0LL) / qint64(summary.audioAmplitudes.size());
+
+    // Normalize the envelope.
+    summary.amplitudeMax = 0;
+    for (size_t i = 0; i < max; ++i) {
+        summary.audioAmplitudes[i] -= meanBeforeNormalization;
+        summary.amplitudeMax = std::max(summary.amplitudeMax, qAbs(summary.audioAmplitudes[i]));
+    }
+    const qint64 fineMean = meanBeforeNormalization / SubFrames;
+    for (qint64 &amplitude : summary.fineAmplitudes) {
+        amplitude -= fineMean;
+    }
+    pCore->displayMessage(i18n("Audio analysis finished"), OperationCompletedMessage, 300);
+    return summary;
+}
+
+void AudioEnvelope::loadFromPeaks(AudioSummary &summary) const
+{
+    // The peaks store the rms level of each channel per bucket, IEC scaled. Their linear amplitude
+    // replaces the mean absolute sample value, which only changes the scale of the correlation.
+    const AudioPeaks::Peak *data = m_peaks->levelData(0);
+    const int channels = m_peaks->channels();
+    const int buckets = m_peaks->subFrames();
+    double amplitudes[256];
+    for (int level = 0; level < 256; ++level) {
+        amplitudes[level] = 32768. * AudioPeaks::levelAmplitude(uint8_t(level));
+    }
+    for (size_t i = 0; i < m_envelopeSize; ++i) {
+        const AudioPeaks::Peak *frame = data + (m_peaksIn + i) * size_t(buckets * channels);
+        qint64 *fine = &summary.fineAmplitudes[i * SubFrames];
+        summary.audioAmplitudes[i] = 0;
+        for (int k = 0; k < SubFrames; ++k) {
+            // Legacy caches only have one bucket per frame, which is then spread over the sub-frames
+            const AudioPeaks::Peak *bucket = frame + (k * buckets / SubFrames) * channels;
+            double sum = 0;
+            for (int c = 0; c < channels; ++c) {
+                sum += amplitudes[bucket[c].rms];
+            }
+            fine[k] = qint64(sum / channels);
+            summary.audioAmplitudes[i] += fine[k];
+        }
+    }
+    qCDebug(KDENLIVE_LOG) << "Envelope (" << m_envelopeSize << " frames) built from the audio thumbnail.";
+}
+
+bool AudioEnvelope::decodeEnvelope(AudioSummary &summary) const
+{
+    if (!m_info || m_info->size() < 1) {
+        return false;
+    }
     int samplingRate = m_info->info(0)->samplingRate();
     mlt_audio_format format_s16 = mlt_audio_s16;
     int channels = 1;
@@ -110,6 +194,7 @@ AudioEnvelope::AudioSummary AudioEnvelope::loadAndNormalizeEnvelope() const
     t.start();
     m_producer->seek(0);
     size_t max = summary.audioAmplitudes.size();
+    int progress = -1;
     for (size_t i = 0; i < max; ++i) {
         std::unique_ptr<Mlt::Frame> frame(m_producer->get_frame(int(i)));
         qint64 position = mlt_frame_get_position(frame->get_frame());
@@ -117,24 +202,19 @@ AudioEnvelope::AudioSummary AudioEnvelope::loadAndNormalizeEnvelope() const
         auto *data = static_cast<qint16 *>(frame->get_audio(format_s16, samplingRate, channels, samples));
 
         summary.audioAmplitudes[i] = 0;
+        qint64 *fine = &summary.fineAmplitudes[i * SubFrames];
         for (int k = 0; k < samples; ++k) {
             summary.audioAmplitudes[i] += abs(data[k]);
+            fine[k * SubFrames / samples] += abs(data[k]);
+        }
+        // Only report progress when the displayed value changes, this is called for every frame
+        if (int(100 * i / max) != progress) {
+            progress = int(100 * i / max);
+            pCore->displayMessage(i18n("Processing data analysis"), ProcessingJobMessage, progress);
         }
-        pCore->displayMessage(i18n("Processing data analysis"), ProcessingJobMessage, int(100 * i / max));
     }
     qCDebug(KDENLIVE_LOG) << "Calculating the envelope (" << m_envelopeSize << " frames) took " << t.elapsed() << " ms.";
-    qCDebug(KDENLIVE_LOG) << "Normalizing envelope …";
-    const qint64 meanBeforeNormalization =
-        std::accumulate(summary.audioAmplitudes.begin(), summary.audioAmplitudes.end(), 0LL) / qint64(summary.audioAmplitudes.size());
-
-    // Normalize the envelope.
-    summary.amplitudeMax = 0;
-    for (size_t i = 0; i < max; ++i) {
-        summary.audioAmplitudes[i] -= meanBeforeNormalization;
-        summary.amplitudeMax = std::max(summary.amplitudeMax, qAbs(summary.audioAmplitudes[i]));
-    }
-    pCore->displayMessage(i18n("Audio analysis finished"), OperationCompletedMessage, 300);
-    return summary;
+    return true;
 }
 
 int AudioEnvelope::clipId() const
@@ -14,12 +14,19 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <mlt++/Mlt.h>
 #include <vector>
 
+class AudioPeaks;
 class QImage;
 
 /**
   The audio envelope is a simplified version of an audio track
   with frame resolution. One entry is calculated by the sum
   of the absolute values of all samples in the current frame.
+  A finer envelope with SubFrames entries per frame is computed
+  during the same decoding pass, to refine alignments below one frame.
+
+  When the audio thumbnail of the clip was already computed, both
+  envelopes are built from its cached peaks instead of decoding the
+  clip again.
 
   See also: http://web.archive.org/web/20180626235917/http://bemasc.net/wordpress/2011/07/26/an-auto-aligner-for-pitivi/
   */
@@ -28,6 +35,9 @@ class AudioEnvelope : public QObject
     Q_OBJECT
 
 public:
+    /** @brief Number of entries per frame in the fine envelope */
+    static constexpr int SubFrames = 4;
+
     explicit AudioEnvelope(const QString &binId, int clipId, size_t offset = 0, size_t length = 0, size_t startPos = 0);
     ~AudioEnvelope() override;
     /**
@@ -48,6 +58,12 @@ public:
        REQUIRES: startComputeEnvelope() has been called.
     */
     const std::vector<qint64> &envelope();
+    /**
+       Returns the envelope with SubFrames entries per frame. Blocks until
+       the computation of the envelope is done.
+       REQUIRES: startComputeEnvelope() has been called.
+    */
+    const std::vector<qint64> &fineEnvelope();
 
     QImage drawEnvelope();
 
@@ -63,6 +79,7 @@ private:
     {
         explicit AudioSummary(size_t size)
             : audioAmplitudes(size)
+            , fineAmplitudes(size * SubFrames)
         {
         }
         AudioSummary() = default;
@@ -70,6 +87,8 @@ private:
         // frame, which contains the sum of the absolute amplitudes of
         // the audio signal for that frame.
         std::vector<qint64> audioAmplitudes;
+        // Same as audioAmplitudes, with SubFrames elements per frame.
+        std::vector<qint64> fineAmplitudes;
         // Maximum absolute value of the elements in 'audioAmplitudes'.
         qint64 amplitudeMax = 0;
     };
@@ -84,9 +103,21 @@ private:
      Actually computes the envelope data, synchronously.
     */
     AudioSummary loadAndNormalizeEnvelope() const;
+    /**
+     Fills the envelope data from the cached audio thumbnail.
+    */
+    void loadFromPeaks(AudioSummary &summary) const;
+    /**
+     Fills the envelope data by decoding the clip, returns false if it has no audio.
+    */
+    bool decodeEnvelope(AudioSummary &summary) const;
 
     std::shared_ptr<Mlt::Producer> m_producer;
     std::unique_ptr<AudioInfo> m_info;
+    /** @brief Cached peaks of the clip, nullptr if they do not cover the analysed zone */
+    std::shared_ptr<const AudioPeaks> m_peaks;
+    /** @brief First clip frame of the envelope when built from m_peaks */
+    size_t m_peaksIn{0};
     QFutureWatcher<AudioSummary> m_watcher;
     QFuture<AudioSummary> m_audioSummary;
 
@@ -0,0 +1,447 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "audioPeaks.h"
+#include "audiomixer/iecscale.h"
+
+#include <QFile>
+#include <QtGlobal>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AUDIOPEAKS_SSE2
+#endif
+
+namespace {
+// Binary cache layout: header, one entry count per level, then the packed Peak entries of each level
+const char peaksMagic[4] = {'K', 'P', 'K', 'S'};
+const quint32 peaksVersion = 1;
+const quint32 peaksByteOrder = 0x01020304;
+
+struct PeaksHeader
+{
+    char magic[4];
+    quint32 byteOrder;
+    quint32 version;
+    quint32 channels;
+    quint32 subFrames;
+    qint32 maximum;
+    quint32 levelCount;
+    quint32 reserved;
+};
+
+/** @brief Accumulate the per channel extremes and sum of squares of interleaved float samples */
+void sampleStats(const float *samples, int values, int channels, double *minimum, double *maximum, double *squares)
+{
+    for (int i = 0; i < values; i += channels) {
+        for (int c = 0; c < channels; ++c) {
+            double value = double(samples[i + c]);
+            minimum[c] = qMin(minimum[c], value);
+            maximum[c] = qMax(maximum[c], value);
+            squares[c] += value * value;
+        }
+    }
+}
+
+/** @brief Accumulate the per channel extremes and sum of squares of interleaved s16 samples */
+void sampleStats(const int16_t *samples, int values, int channels, double *minimum, double *maximum, double *squares)
+{
+    int i = 0;
+#ifdef AUDIOPEAKS_SSE2
+    if (8 % channels == 0 && values >= 8) {
+        // Channels repeat every 8 samples, so each 16 bit lane always holds the same channel
+        const __m128i zero = _mm_setzero_si128();
+        __m128i low = zero;
+        __m128i high = zero;
+        __m128i sums[4] = {zero, zero, zero, zero};
+        for (; i + 8 <= values; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+            low = _mm_min_epi16(low, v);
+            high = _mm_max_epi16(high, v);
+            // Squares fit in 32 bits, widen them to 64 bits before accumulating
+            __m128i lo = _mm_unpacklo_epi16(v, zero);
+            __m128i hi = _mm_unpackhi_epi16(v, zero);
+            __m128i squaresLo = _mm_madd_epi16(lo, lo);
+            __m128i squaresHi = _mm_madd_epi16(hi, hi);
+            sums[0] = _mm_add_epi64(sums[0], _mm_unpacklo_epi32(squaresLo, zero));
+            sums[1] = _mm_add_epi64(sums[1], _mm_unpackhi_epi32(squaresLo, zero));
+            sums[2] = _mm_add_epi64(sums[2], _mm_unpacklo_epi32(squaresHi, zero));
+            sums[3] = _mm_add_epi64(sums[3], _mm_unpackhi_epi32(squaresHi, zero));
+        }
+        alignas(16) int16_t lowLanes[8];
+        alignas(16) int16_t highLanes[8];
+        alignas(16) qint64 sumLanes[8];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lowLanes), low);
+        _mm_store_si128(reinterpret_cast<__m128i *>(highLanes), high);
+        for (int k = 0; k < 4; ++k) {
+            _mm_store_si128(reinterpret_cast<__m128i *>(sumLanes + 2 * k), sums[k]);
+        }
+        for (int lane = 0; lane < 8; ++lane) {
+            int c = lane % channels;
+            minimum[c] = qMin(minimum[c], double(lowLanes[lane]));
+            maximum[c] = qMax(maximum[c], double(highLanes[lane]));
+            squares[c] += double(sumLanes[lane]);
+        }
+    }
+#endif
+    for (; i < values; i += channels) {
+        for (int c = 0; c < channels; ++c) {
+            double value = double(samples[i + c]);
+            minimum[c] = qMin(minimum[c], value);
+            maximum[c] = qMax(maximum[c], value);
+            squares[c] += value * value;
+        }
+    }
+}
+} // namespace
+
+static_assert(sizeof(AudioPeaks::Peak) == 3, "AudioPeaks::Peak must be packed for the binary cache");
+
+constexpr int AudioPeaks::SubFrames;
+constexpr int AudioPeaks::Decimation;
+
+AudioPeaks::AudioPeaks(int channels, int subFrames)
+    : m_channels(qMax(1, channels))
+    , m_subFrames(qMax(1, subFrames))
+    , m_maximum(0)
+{
+    m_levels.resize(1);
+}
+
+AudioPeaks AudioPeaks::fromFrameLevels(const QVector<uint8_t> &levels, int channels)
+{
+    AudioPeaks peaks(channels, 1);
+    std::vector<Peak> &base = peaks.m_levels.front();
+    int count = levels.size() - levels.size() % peaks.m_channels;
+    base.reserve(size_t(count));
+    for (int i = 0; i < count; ++i) {
+        uint8_t lev = levels.at(i);
+        Peak p;
+        p.max = int8_t(lev / 2);
+        p.min = int8_t(-p.max);
+        p.rms = lev;
+        peaks.m_maximum = qMax(peaks.m_maximum, int(p.max));
+        base.push_back(p);
+    }
+    peaks.build();
+    return peaks;
+}
+
+uint8_t AudioPeaks::scaleLevel(double amplitude)
+{
+    if (amplitude <= 0.) {
+        return 0;
+    }
+    // Same scaling as the MLT audiolevel filter with iec_scale, with a small headroom
+    double level = IEC_Scale(20. * std::log10(amplitude)) * 0.9;
+    return uint8_t(qBound(0., 256. * level, 255.));
+}
+
+double AudioPeaks::levelAmplitude(uint8_t level)
+{
+    if (level == 0) {
+        return 0.;
+    }
+    // Invert the linear segments of IEC_Scale
+    double scale = level / 256. / 0.9;
+    double dB;
+    if (scale < 0.025) {
+        dB = scale / 0.0025 - 70.;
+    } else if (scale < 0.075) {
+        dB = (scale - 0.025) / 0.005 - 60.;
+    } else if (scale < 0.15) {
+        dB = (scale - 0.075) / 0.0075 - 50.;
+    } else if (scale < 0.3) {
+        dB = (scale - 0.15) / 0.015 - 40.;
+    } else if (scale < 0.5) {
+        dB = (scale - 0.3) / 0.02 - 30.;
+    } else {
+        dB = (scale - 0.5) / 0.025 - 20.;
+    }
+    return std::pow(10., dB / 20.);
+}
+
+template <typename T> void AudioPeaks::appendSamples(const T *samples, int sampleCount, double range)
+{
+    std::vector<Peak> &base = m_levels.front();
+    size_t channels = size_t(m_channels);
+    std::vector<double> minimum(channels);
+    std::vector<double> maximum(channels);
+    std::vector<double> squares(channels);
+    for (int slice = 0; slice < m_subFrames; ++slice) {
+        int start = sampleCount * slice / m_subFrames;
+        int end = sampleCount * (slice + 1) / m_subFrames;
+        std::fill(minimum.begin(), minimum.end(), 0.);
+        std::fill(maximum.begin(), maximum.end(), 0.);
+        std::fill(squares.begin(), squares.end(), 0.);
+        sampleStats(samples + start * m_channels, (end - start) * m_channels, m_channels, minimum.data(), maximum.data(), squares.data());
+        int length = qMax(1, end - start);
+        for (int c = 0; c < m_channels; ++c) {
+            Peak p;
+            p.max = int8_t(scaleLevel(maximum[size_t(c)] / range) / 2);
+            p.min = int8_t(-(scaleLevel(-minimum[size_t(c)] / range) / 2));
+            p.rms = scaleLevel(std::sqrt(squares[size_t(c)] / length) / range);
+            m_maximum = qMax(m_maximum, qMax(int(p.max), -int(p.min)));
+            base.push_back(p);
+        }
+    }
+}
+
+void AudioPeaks::append(const Peak *peaks)
+{
+    std::vector<Peak> &base = m_levels.front();
+    for (int c = 0; c < m_channels; ++c) {
+        m_maximum = qMax(m_maximum, qMax(int(peaks[c].max), -int(peaks[c].min)));
+        base.push_back(peaks[c]);
+    }
+}
+
+void AudioPeaks::append(const AudioPeaks &other)
+{
+    Q_ASSERT(other.m_channels == m_channels && other.m_subFrames == m_subFrames);
+    std::vector<Peak> &base = m_levels.front();
+    const Peak *data = other.levelData(0);
+    base.insert(base.end(), data, data + size_t(other.size()) * size_t(m_channels));
+    m_maximum = qMax(m_maximum, other.m_maximum);
+}
+
+void AudioPeaks::appendFrame(const int16_t *samples, int sampleCount)
+{
+    appendSamples(samples, sampleCount, 32768.);
+}
+
+void AudioPeaks::appendFrame(const float *samples, int sampleCount)
+{
+    appendSamples(samples, sampleCount, 1.);
+}
+
+void AudioPeaks::repeatLastFrame()
+{
+    std::vector<Peak> &base = m_levels.front();
+    size_t frameSize = size_t(m_channels * m_subFrames);
+    if (base.size() < frameSize) {
+        base.resize(base.size() + frameSize);
+        return;
+    }
+    size_t start = base.size() - frameSize;
+    for (size_t i = 0; i < frameSize; ++i) {
+        base.push_back(base[start + i]);
+    }
+}
+
+void AudioPeaks::build()
+{
+    m_levels.resize(1);
+    size_t channels = size_t(m_channels);
+    while (m_levels.back().size() / channels > size_t(Decimation)) {
+        const std::vector<Peak> &source = m_levels.back();
+        size_t sourceBuckets = source.size() / channels;
+        size_t buckets = (sourceBuckets + Decimation - 1) / Decimation;
+        std::vector<Peak> next(buckets * channels);
+        for (size_t b = 0; b < buckets; ++b) {
+            size_t first = b * Decimation;
+            size_t last = qMin(first + Decimation, sourceBuckets);
+            for (size_t c = 0; c < channels; ++c) {
+                Peak merged;
+                double squares = 0.;
+                for (size_t i = first; i < last; ++i) {
+                    const Peak &p = source[i * channels + c];
+                    merged.min = qMin(merged.min, p.min);
+                    merged.max = qMax(merged.max, p.max);
+                    squares += double(p.rms) * p.rms;
+                }
+                merged.rms = uint8_t(std::sqrt(squares / double(last - first)));
+                next[b * channels + c] = merged;
+            }
+        }
+        m_levels.push_back(std::move(next));
+    }
+}
+
+int AudioPeaks::channels() const
+{
+    return m_channels;
+}
+
+int AudioPeaks::subFrames() const
+{
+    return m_subFrames;
+}
+
+int AudioPeaks::frameCount() const
+{
+    return size() / m_subFrames;
+}
+
+int AudioPeaks::size() const
+{
+    return levelSize(0);
+}
+
+int AudioPeaks::levelCount() const
+{
+    return int(m_file ? m_mapped.size() : m_levels.size());
+}
+
+bool AudioPeaks::isEmpty() const
+{
+    return size() == 0;
+}
+
+int AudioPeaks::maximum() const
+{
+    return m_maximum;
+}
+
+const AudioPeaks::Peak *AudioPeaks::levelData(int ix) const
+{
+    if (m_file) {
+        return m_mapped.at(size_t(ix)).first;
+    }
+    return m_levels.at(size_t(ix)).data();
+}
+
+int AudioPeaks::levelSize(int ix) const
+{
+    size_t entries = m_file ? m_mapped.at(size_t(ix)).second : m_levels.at(size_t(ix)).size();
+    return int(entries / size_t(m_channels));
+}
+
+AudioPeaks::Peak AudioPeaks::peak(int channel, double from, double to) const
+{
+    Peak result;
+    int count = size();
+    if (count == 0) {
+        return result;
+    }
+    qint64 first = qBound(qint64(0), qint64(std::floor(qMin(from, to))), qint64(count - 1));
+    qint64 last = qBound(first + 1, qint64(std::ceil(qMax(from, to))), qint64(count));
+    // Pick the coarsest level with less than Decimation buckets per range
+    int ix = 0;
+    qint64 bucketSize = 1;
+    while (ix + 1 < levelCount() && bucketSize * Decimation <= last - first) {
+        bucketSize *= Decimation;
+        ix++;
+    }
+    const Peak *data = levelData(ix);
+    qint64 firstBucket = first / bucketSize;
+    qint64 lastBucket = (last + bucketSize - 1) / bucketSize;
+    int firstChannel = channel < 0 ? 0 : qMin(channel, m_channels - 1);
+    int lastChannel = channel < 0 ? m_channels : firstChannel + 1;
+    double squares = 0.;
+    int values = 0;
+    for (qint64 b = firstBucket; b < lastBucket; ++b) {
+        for (int c = firstChannel; c < lastChannel; ++c) {
+            const Peak &p = data[size_t(b * m_channels + c)];
+            result.min = qMin(result.min, p.min);
+            result.max = qMax(result.max, p.max);
+            squares += double(p.rms) * p.rms;
+            values++;
+        }
+    }
+    result.rms = uint8_t(std::sqrt(squares / qMax(1, values)));
+    return result;
+}
+
+QVector<uint8_t> AudioPeaks::frameLevels() const
+{
+    QVector<uint8_t> levels;
+    int frames = frameCount();
+    levels.reserve(frames * m_channels);
+    for (int f = 0; f < frames; ++f) {
+        for (int c = 0; c < m_channels; ++c) {
+            levels << peak(c, f * m_subFrames, (f + 1) * m_subFrames).rms;
+        }
+    }
+    return levels;
+}
+
+bool AudioPeaks::save(const QString &path) const
+{
+    if (isEmpty()) {
+        return false;
+    }
+    PeaksHeader header;
+    memcpy(header.magic, peaksMagic, sizeof(header.magic));
+    header.byteOrder = peaksByteOrder;
+    header.version = peaksVersion;
+    header.channels = quint32(m_channels);
+    header.subFrames = quint32(m_subFrames);
+    header.maximum = m_maximum;
+    header.levelCount = quint32(levelCount());
+    header.reserved = 0;
+    // Write next to the cache and rename, a view may still map the previous version
+    QFile file(path + QStringLiteral(".part"));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (int ix = 0; ix < levelCount(); ++ix) {
+        quint64 entries = quint64(levelSize(ix)) * quint64(m_channels);
+        file.write(reinterpret_cast<const char *>(&entries), sizeof(entries));
+    }
+    for (int ix = 0; ix < levelCount(); ++ix) {
+        qint64 bytes = qint64(levelSize(ix)) * m_channels * qint64(sizeof(Peak));
+        if (file.write(reinterpret_cast<const char *>(levelData(ix)), bytes) != bytes) {
+            file.remove();
+            return false;
+        }
+    }
+    file.close();
+    if (file.error() != QFileDevice::NoError) {
+        file.remove();
+        return false;
+    }
+    // Fails if the previous version is still mapped on Windows, the caller then keeps the pyramid in memory
+    if ((QFile::exists(path) && !QFile::remove(path)) || !file.rename(path)) {
+        file.remove();
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const AudioPeaks> AudioPeaks::load(const QString &path)
+{
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly) || file->size() < qint64(sizeof(PeaksHeader))) {
+        return nullptr;
+    }
+    const qint64 fileSize = file->size();
+    const uchar *data = file->map(0, fileSize);
+    if (data == nullptr) {
+        return nullptr;
+    }
+    PeaksHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, peaksMagic, sizeof(header.magic)) != 0 || header.byteOrder != peaksByteOrder || header.version != peaksVersion ||
+        header.channels == 0 || header.subFrames == 0 || header.levelCount == 0 || header.levelCount > 64) {
+        return nullptr;
+    }
+    qint64 offset = qint64(sizeof(header) + header.levelCount * sizeof(quint64));
+    if (offset > fileSize) {
+        return nullptr;
+    }
+    auto peaks = std::make_shared<AudioPeaks>(int(header.channels), int(header.subFrames));
+    peaks->m_maximum = header.maximum;
+    for (quint32 ix = 0; ix < header.levelCount; ++ix) {
+        quint64 entries;
+        memcpy(&entries, data + sizeof(header) + ix * sizeof(quint64), sizeof(entries));
+        if (entries % header.channels != 0 || entries > quint64(fileSize - offset) / sizeof(Peak)) {
+            return nullptr;
+        }
+        peaks->m_mapped.emplace_back(reinterpret_cast<const Peak *>(data + offset), size_t(entries));
+        offset += qint64(entries * sizeof(Peak));
+    }
+    if (offset != fileSize) {
+        return nullptr;
+    }
+    peaks->m_levels.clear();
+    peaks->m_file = file;
+    return peaks;
+}
@@ -0,0 +1,109 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QVector>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class QFile;
+class QString;
+
+/** @class AudioPeaks
+    @brief Multi-resolution peak pyramid used to draw audio waveforms.
+
+    Level 0 stores one min/max/rms triplet per channel for each sub-frame slice
+    of audio (SubFrames slices per video frame). Each following level merges
+    Decimation consecutive buckets of the previous one, so that a painter can
+    read the level matching its zoom factor instead of walking every sample.
+    Values are IEC scaled: max is in [0, 127], min in [-127, 0].
+
+    The pyramid can be saved to a versioned binary file (header, channel layout,
+    then each level as packed Peak entries) that is later memory mapped by load(),
+    so that cached waveforms are shared between views without decoding or copying.
+  */
+class AudioPeaks
+{
+public:
+    struct Peak
+    {
+        int8_t min = 0;
+        int8_t max = 0;
+        uint8_t rms = 0;
+    };
+
+    /** @brief Number of level 0 buckets computed for each video frame */
+    static constexpr int SubFrames = 4;
+    /** @brief Number of buckets merged into one bucket of the next level */
+    static constexpr int Decimation = 4;
+
+    /** @param subFrames the number of level 0 buckets per frame, usually SubFrames */
+    explicit AudioPeaks(int channels, int subFrames = SubFrames);
+
+    /** @brief Build a pyramid from legacy per frame levels (interleaved, 0-255), as stored in the old image cache */
+    static AudioPeaks fromFrameLevels(const QVector<uint8_t> &levels, int channels);
+
+    /** @brief Convert a linear amplitude in [0, 1] to an IEC scaled byte in [0, 255] */
+    static uint8_t scaleLevel(double amplitude);
+    /** @brief Inverse of scaleLevel, returns the linear amplitude of an IEC scaled byte */
+    static double levelAmplitude(uint8_t level);
+
+    /** @brief Append one level 0 bucket, @p peaks contains one Peak per channel */
+    void append(const Peak *peaks);
+    /** @brief Append the level 0 buckets of another pyramid with the same layout, used to merge segments */
+    void append(const AudioPeaks &other);
+    /** @brief Append the level 0 buckets computed from an interleaved s16 audio buffer for one frame.
+        Common channel layouts are processed with SSE2 when available */
+    void appendFrame(const int16_t *samples, int sampleCount);
+    /** @brief Append the level 0 buckets computed from an interleaved f32 audio buffer for one frame */
+    void appendFrame(const float *samples, int sampleCount);
+    /** @brief Repeat the last frame, used when a frame could not be decoded */
+    void repeatLastFrame();
+    /** @brief Compute the decimated levels, must be called once all buckets were appended */
+    void build();
+
+    int channels() const;
+    int subFrames() const;
+    /** @brief Number of video frames covered by the data */
+    int frameCount() const;
+    /** @brief Number of buckets in level 0 */
+    int size() const;
+    int levelCount() const;
+    bool isEmpty() const;
+    /** @brief Highest absolute peak value, used to normalize the display */
+    int maximum() const;
+
+    /** @brief Returns the merged peak of a channel for a range of level 0 buckets [from, to[.
+        The coarsest level whose bucket fits in the range is used, so the cost does not depend on the range length.
+        If @p channel is -1, all channels are merged */
+    Peak peak(int channel, double from, double to) const;
+
+    /** @brief Per frame rms levels (interleaved, 0-255) */
+    QVector<uint8_t> frameLevels() const;
+
+    /** @brief Direct access to the interleaved buckets of a level */
+    const Peak *levelData(int ix) const;
+    /** @brief Number of buckets in a level */
+    int levelSize(int ix) const;
+
+    /** @brief Write the pyramid to a binary cache file, build() must have been called */
+    bool save(const QString &path) const;
+    /** @brief Memory map a binary cache file, returns nullptr if it is missing, outdated or corrupted */
+    static std::shared_ptr<const AudioPeaks> load(const QString &path);
+
+private:
+    int m_channels;
+    int m_subFrames;
+    int m_maximum;
+    /** @brief Level data when computed in memory */
+    std::vector<std::vector<Peak>> m_levels;
+    /** @brief Level data pointing into m_file when loaded from the cache */
+    std::vector<std::pair<const Peak *, size_t>> m_mapped;
+    std::shared_ptr<QFile> m_file;
+    template <typename T> void appendSamples(const T *samples, int sampleCount, double range);
+};
@@ -5,7 +5,13 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #pragma once
 
+#include "../external/kiss_fft/tools/kiss_fftr.h"
+
+#include <QMutex>
 #include <QtGlobal>
+#include <map>
+#include <vector>
+
 /** @class FFTCorrelation
     @brief This class provides methods to calculate convolution
     and correlation of two vectors by means of FFT, which
@@ -15,6 +21,27 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 class FFTCorrelation
 {
 public:
+    /** @class Reference
+        @brief A normalized vector to which several other vectors are correlated.
+        Its Fourier transform is computed once per FFT size and shared between
+        threads, so that only the other vectors need to be transformed.
+      */
+    class Reference
+    {
+    public:
+        Reference(const qint64 *left, const size_t leftSize);
+        size_t size() const;
+
+    private:
+        friend class FFTCorrelation;
+        /** @brief Returns the transform for an FFT of @p fftSize samples, computed on first use */
+        const std::vector<kiss_fft_cpx> &transform(size_t fftSize) const;
+
+        std::vector<float> m_data;
+        mutable QMutex m_mutex;
+        mutable std::map<size_t, std::vector<kiss_fft_cpx>> m_transforms;
+    };
+
     /**
       Computes the convolution between \c left and \c right.
       \c out_correlated must be a pre-allocated vector of size
@@ -30,4 +57,16 @@ public:
     static void correlate(const qint64 *left, const size_t leftSize, const qint64 *right, const size_t rightSize, float *out_correlated);
 
     static void correlate(const qint64 *left, const size_t leftSize, const qint64 *right, const size_t rightSize, qint64 *out_correlated);
+
+    /**
+      Same as correlate() with a cached reference as \c left. This is thread safe.
+      \c out_correlated must be a pre-allocated vector of size
+      \c reference.size() + \c rightSize + 1.
+      */
+    static void correlate(const Reference &reference, const qint64 *right, const size_t rightSize, qint64 *out_correlated);
+
+private:
+    /** @brief Size of the padded FFT used to convolve vectors of at most @p largestSize entries */
+    static size_t fftSize(size_t largestSize);
+    static void correlate(const Reference &reference, const qint64 *right, const size_t rightSize, float *out_correlated);
 };
@@ -9,8 +9,10 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include <cmath>
 #include <iostream>
+#include <vector>
 
-#include <QString>
+#include <QHash>
+#include <QMutex>
 
 // Uncomment for debugging, like writing a GNU Octave .m file to /tmp
 //#define DEBUG_FFTTOOLS
@@ -21,26 +23,74 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <fstream>
 #endif
 
-FFTTools::FFTTools()
-    : m_fftCfgs()
-    , m_windowFunctions()
+namespace {
+/** @brief Process wide cache of FFT configurations and window functions */
+class FFTCache
 {
-}
-FFTTools::~FFTTools()
-{
-    QHash<QString, kiss_fftr_cfg>::iterator i;
-    for (i = m_fftCfgs.begin(); i != m_fftCfgs.end(); ++i) {
-        free(*i);
+public:
+    ~FFTCache()
+    {
+        for (const QVector<kiss_fftr_cfg> &cfgs : qAsConst(m_cfgs)) {
+            for (kiss_fftr_cfg cfg : cfgs) {
+                free(cfg);
+            }
+        }
+    }
+
+    /** @brief Take a configuration for an FFT of @p size, it is reserved to the caller until released */
+    kiss_fftr_cfg acquireCfg(int size)
+    {
+        QMutexLocker lock(&m_mutex);
+        QVector<kiss_fftr_cfg> &cfgs = m_cfgs[size];
+        if (!cfgs.isEmpty()) {
+            return cfgs.takeLast();
+        }
+        lock.unlock();
+#ifdef DEBUG_FFTTOOLS
+        qCDebug(KDENLIVE_LOG) << "Creating FFT configuration with size " << size;
+#endif
+        return kiss_fftr_alloc(size, 0, nullptr, nullptr);
     }
-}
 
-const QString FFTTools::windowSignature(const WindowType windowType, const int size, const float param)
+    void releaseCfg(int size, kiss_fftr_cfg cfg)
+    {
+        QMutexLocker lock(&m_mutex);
+        m_cfgs[size].append(cfg);
+    }
+
+    QVector<float> window(const FFTTools::WindowType windowType, const int size, const float param)
+    {
+        const quint64 key = FFTTools::windowKey(windowType, size, param);
+        QMutexLocker lock(&m_mutex);
+        auto it = m_windows.constFind(key);
+        if (it != m_windows.constEnd()) {
+            return it.value();
+        }
+        lock.unlock();
+        QVector<float> window = FFTTools::window(windowType, size, param);
+        lock.relock();
+        m_windows.insert(key, window);
+        return window;
+    }
+
+private:
+    QMutex m_mutex;
+    QHash<int, QVector<kiss_fftr_cfg>> m_cfgs;
+    QHash<quint64, QVector<float>> m_windows;
+};
+
+FFTCache &fftCache()
 {
-    return QStringLiteral("s%1_t%2_p%3").arg(size).arg(windowType).arg(param, 0, 'f', 3);
+    static FFTCache cache;
+    return cache;
 }
-const QString FFTTools::cfgSignature(const int size)
+} // namespace
+
+quint64 FFTTools::windowKey(const WindowType windowType, const int size, const float param)
 {
-    return QStringLiteral("s%1").arg(size);
+    // Same precision as the parameter had in the former string signature
+    const auto quantizedParam = quint16(qint16(qRound(param * 1000)));
+    return quint64(quint32(size)) | (quint64(quint8(windowType)) << 32) | (quint64(quantizedParam) << 40);
 }
 
 // https://cplusplus.syntaxerrors.info/index.php?title=Cannot_declare_member_function_%E2%80%98static_int_Foo::bar%28%29%E2%80%99_to_have_static_linkage
@@ -107,122 +157,73 @@ const QVector<float> FFTTools::window(const WindowType windowType, const int siz
 
 void FFTTools::fftNormalized(const audioShortVector &audioFrame, const uint channel, const uint numChannels, float *freqSpectrum, const WindowType windowType,
                              const uint windowSize, const float param)
+{
+    fftNormalizedBatch(audioFrame, channel, numChannels, freqSpectrum, 1, 0, windowType, windowSize, param);
+}
+
+void FFTTools::fftNormalizedBatch(const audioShortVector &audioFrame, const uint channel, const uint numChannels, float *freqSpectra, const uint count,
+                                  const uint hop, const WindowType windowType, const uint windowSize, const float param)
 {
 #ifdef DEBUG_FFTTOOLS
     QTime start = QTime::currentTime();
 #endif
 
-    const uint numSamples = uint(audioFrame.size()) / numChannels;
-
-    if (((windowSize & 1) != 0u) || windowSize < 2) {
+    if (((windowSize & 1) != 0u) || windowSize < 2 || numChannels == 0 || count == 0) {
         return;
     }
-
-    const QString cfgSig = cfgSignature(int(windowSize));
-    const QString winSig = windowSignature(windowType, int(windowSize), param);
-
-    // Get the kiss_fft configuration from the config cache
-    // or build a new configuration if the requested one is not available.
-    kiss_fftr_cfg myCfg;
-    if (m_fftCfgs.contains(cfgSig)) {
-#ifdef DEBUG_FFTTOOLS
-        qCDebug(KDENLIVE_LOG) << "Re-using FFT configuration with size " << windowSize;
-#endif
-        myCfg = m_fftCfgs.value(cfgSig);
-    } else {
-#ifdef DEBUG_FFTTOOLS
-        qCDebug(KDENLIVE_LOG) << "Creating FFT configuration with size " << windowSize;
-#endif
-        myCfg = kiss_fftr_alloc(int(windowSize), 0, nullptr, nullptr);
-        m_fftCfgs.insert(cfgSig, myCfg);
-    }
+    const uint numSamples = uint(audioFrame.size()) / numChannels;
 
     // Get the window function from the cache
     // (except for a rectangular window; nothing to do there).
     QVector<float> window;
     float windowScaleFactor = 1;
     if (windowType != FFTTools::Window_Rect) {
-
-        if (m_windowFunctions.contains(winSig)) {
-#ifdef DEBUG_FFTTOOLS
-            qCDebug(KDENLIVE_LOG) << "Re-using window function with signature " << winSig;
-#endif
-            window = m_windowFunctions.value(winSig);
-        } else {
-#ifdef DEBUG_FFTTOOLS
-            qCDebug(KDENLIVE_LOG) << "Building new window function with signature " << winSig;
-#endif
-            window = FFTTools::window(windowType, int(windowSize), 0);
-            m_windowFunctions.insert(winSig, window);
-        }
+        window = fftCache().window(windowType, int(windowSize), param);
         windowScaleFactor = 1.0f / window[int(windowSize)];
     }
 
-    // Prepare frequency space vector. The resulting FFT vector is only half as long.
-    auto *freqData = new kiss_fft_cpx[size_t(windowSize) / 2];
-    auto *data = new float[size_t(windowSize)];
-
-    // Copy the first channel's audio into a vector for the FFT display;
-    // Fill the data vector indices that cannot be covered with sample data with 0
-    if (numSamples < windowSize) {
-        std::fill(&data[numSamples], &data[windowSize - 1], 0);
-    }
-    // Normalize signals to [0,1] to get correct dB values later on
-    for (uint i = 0; i < numSamples && i < windowSize; ++i) {
-        // Performance note: Benchmarking has shown that using the if/else inside the loop
-        // does not do noticeable worse than keeping it outside (perhaps the branch predictor
-        // is good enough), so it remains in there for better readability.
+    // Prepare frequency space vector. The resulting FFT vector is only half as long,
+    // kiss_fftr also writes the Nyquist frequency after it.
+    std::vector<kiss_fft_cpx> freqData(size_t(windowSize) / 2 + 1);
+    std::vector<float> data(windowSize);
+    kiss_fftr_cfg cfg = fftCache().acquireCfg(int(windowSize));
+
+    for (uint k = 0; k < count; ++k) {
+        const uint offset = k * hop;
+        // Copy the channel's audio into a vector for the FFT display;
+        // Fill the data vector indices that cannot be covered with sample data with 0
+        const uint available = offset < numSamples ? qMin(numSamples - offset, windowSize) : 0;
+        std::fill(data.begin() + available, data.end(), 0.f);
+        // Normalize signals to [0,1] to get correct dB values later on
+        const qint16 *samples = audioFrame.constData() + size_t(qMin(offset, numSamples)) * numChannels + channel;
         if (windowType != FFTTools::Window_Rect) {
-            data[i] = float(audioFrame.data()[i * numChannels + channel]) / 32767.0f * window[int(i)];
+            for (uint i = 0; i < available; ++i) {
+                data[i] = float(samples[i * numChannels]) / 32767.0f * window[int(i)];
+            }
         } else {
-            data[i] = float(audioFrame.data()[i * numChannels + channel]) / 32767.0f;
+            for (uint i = 0; i < available; ++i) {
+                data[i] = float(samples[i * numChannels]) / 32767.0f;
+            }
         }
-    }
 
-    // Calculate the Fast Fourier Transform for the input data
-    kiss_fftr(myCfg, data, freqData);
+        // Calculate the Fast Fourier Transform for the input data
+        kiss_fftr(cfg, data.data(), freqData.data());
 
-    // Logarithmic scale: 20 * log ( 2 * magnitude / N ) with magnitude = sqrt(r² + i²)
-    // with N = FFT size (after FFT, 1/2 window size)
-    for (uint i = 0; i < windowSize / 2; ++i) {
         // Logarithmic scale: 20 * log ( 2 * magnitude / N ) with magnitude = sqrt(r² + i²)
         // with N = FFT size (after FFT, 1/2 window size)
-        freqSpectrum[i] =
-            20 *
-            logf(powf(powf(fabs(freqData[i].r * windowScaleFactor), 2) + powf(fabs(freqData[i].i * windowScaleFactor), 2), .5) / (float(windowSize) / 2.0f)) /
-            logf(10);
-        ;
-    }
-
-#ifdef DEBUG_FFTTOOLS
-    std::ofstream mFile;
-    mFile.open("/tmp/freq.m");
-    if (!mFile) {
-        qCDebug(KDENLIVE_LOG) << "Opening file failed.";
-    } else {
-        mFile << "val = [ ";
-
-        for (int sample = 0; sample < 256; ++sample) {
-            mFile << data[sample] << ' ';
-        }
-        mFile << " ];\n";
-
-        mFile << "freq = [ ";
-        for (int sample = 0; sample < 256; ++sample) {
-            mFile << freqData[sample].r << '+' << freqData[sample].i << "*i ";
+        float *freqSpectrum = freqSpectra + size_t(k) * (windowSize / 2);
+        for (uint i = 0; i < windowSize / 2; ++i) {
+            freqSpectrum[i] = 20 *
+                              logf(powf(powf(fabs(freqData[i].r * windowScaleFactor), 2) + powf(fabs(freqData[i].i * windowScaleFactor), 2), .5) /
+                                   (float(windowSize) / 2.0f)) /
+                              logf(10);
         }
-        mFile << " ];\n";
-
-        mFile.close();
-        qCDebug(KDENLIVE_LOG) << "File written.";
     }
-#endif
+    fftCache().releaseCfg(int(windowSize), cfg);
 
 #ifdef DEBUG_FFTTOOLS
-    qCDebug(KDENLIVE_LOG) << "Calculated FFT in " << start.elapsed() << " ms.";
+    qCDebug(KDENLIVE_LOG) << "Calculated " << count << " FFTs in " << start.elapsed() << " ms.";
 #endif
-    delete[] freqData;
-    delete[] data;
 }
 
 const QVector<float> FFTTools::interpolatePeakPreserving(const QVector<float> &in, const uint targetSize, uint left, uint right, float fill)
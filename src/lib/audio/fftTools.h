@@ -9,15 +9,19 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "../../definitions.h"
 #include "../external/kiss_fft/tools/kiss_fftr.h"
-#include <QHash>
 #include <QVector>
 
+/** @class FFTTools
+    @brief Fourier transformation helpers for the audio scopes.
+
+    FFT configurations and window functions are kept in a process wide cache shared
+    by all instances and threads, keyed by integers instead of formatted strings.
+    As a kiss_fft configuration also holds scratch memory, a configuration is only
+    used by one thread at a time; the cache keeps the released ones for reuse.
+  */
 class FFTTools
 {
 public:
-    FFTTools();
-    ~FFTTools();
-
     enum WindowType { Window_Rect, Window_Triangle, Window_Hamming };
 
     /** Creates a vector containing the factors for the selected window functions.
@@ -35,11 +39,8 @@ public:
     */
     static const QVector<float> window(const WindowType windowType, const int size, const float param = 0);
 
-    static const QString windowSignature(const WindowType windowType, const int size, const float param = 0);
-
-    /** Returns a signature for a kiss_fft configuration
-        used as a hash in the cache */
-    static const QString cfgSignature(const int size);
+    /** Returns the key of a window function in the cache */
+    static quint64 windowKey(const WindowType windowType, const int size, const float param = 0);
 
     /** Calculates the Fourier Transformation of the input audio frame.
         The resulting values will be given in relative decibel: The maximum power is 0 dB, lower powers have
@@ -53,6 +54,14 @@ public:
     void fftNormalized(const audioShortVector &audioFrame, const uint channel, const uint numChannels, float *freqSpectrum, const WindowType windowType,
                        const uint windowSize, const float param = 0);
 
+    /** Same as fftNormalized() for @p count overlapping windows, the window k starting at sample k * @p hop.
+        Samples after the end of the audio frame are considered silent.
+        * freqSpectra has to be of size count * windowSize/2, the spectrum of window k starting at k * windowSize/2
+        The FFT configuration and buffers are only set up once for the whole batch.
+    */
+    void fftNormalizedBatch(const audioShortVector &audioFrame, const uint channel, const uint numChannels, float *freqSpectra, const uint count,
+                            const uint hop, const WindowType windowType, const uint windowSize, const float param = 0);
+
     /** This is linear interpolation with the special property that it preserves peaks, which is required
         for e.g. showing correct Decibel values (where the peak values are of interest because of clipping which
         may occur for too strong frequencies; The lower values are smeared by the window function anyway).
@@ -68,8 +77,4 @@ public:
                             will be used for filling the missing information.
         */
     static const QVector<float> interpolatePeakPreserving(const QVector<float> &in, const uint targetSize, uint left = 0, uint right = 0, float fill = 0.0);
-
-private:
-    QHash<QString, kiss_fftr_cfg> m_fftCfgs;          // FFT cfg cache
-    QHash<QString, QVector<float>> m_windowFunctions; // Window function cache
 };
@@ -47,9 +47,16 @@ reading a Read-protected property. In that case, we try to write lock it first (
  * The lambdas are transformed to make sure they lock access to the class they operate on.
  * Then they are added on the undoStack
  */
-#define PUSH_UNDO(undo, redo, text)                                                                                                                            \
+#define PUSH_UNDO(undo, redo, text) PUSH_UNDO_MEMORY(undo, redo, text, 0)
+
+/** @brief Same as PUSH_UNDO, for an operation whose lambdas keep about @p memory bytes alive (deleted items...)
+ * The estimate is used by the undo stack to bound the memory of the history
+ */
+#define PUSH_UNDO_MEMORY(undo, redo, text, memory)                                                                                                             \
     if (auto ptr = m_undoStack.lock()) {                                                                                                                       \
-        ptr->push(new FunctionalUndoCommand(undo, redo, text));                                                                                                \
+        auto *undoCommand = new FunctionalUndoCommand(undo, redo, text);                                                                                       \
+        undoCommand->addMemoryHint(memory);                                                                                                                    \
+        ptr->push(undoCommand);                                                                                                                                \
     } else {                                                                                                                                                   \
         qDebug() << "ERROR : unable to access undo stack";                                                                                                     \
         Q_ASSERT(false);                                                                                                                                       \
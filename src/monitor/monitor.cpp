@@ -2092,6 +2092,11 @@ void Monitor::sendFrameForAnalysis(bool analyse)
     m_glMonitor->sendFrameForAnalysis = analyse;
 }
 
+void Monitor::sendFrameToScopes(bool send)
+{
+    m_sendFrameToScopes = send;
+}
+
 void Monitor::updateAudioForAnalysis()
 {
     m_glMonitor->updateAudioForAnalysis();
@@ -2100,6 +2105,10 @@ void Monitor::updateAudioForAnalysis()
 void Monitor::onFrameDisplayed(const SharedFrame &frame)
 {
     emit m_monitorManager->frameDisplayed(frame);
+    if (m_sendFrameToScopes) {
+        // Scopes read the decoded frame, no need for a framebuffer readback
+        emit frameDisplayedForScopes(frame);
+    }
     if (m_id == Kdenlive::ProjectMonitor) {
         emit pCore->updateMixerLevels(frame.get_position());
     }
@@ -97,6 +97,8 @@ public:
     QVariantList effectRoto() const;
     void setEffectKeyframe(bool enable);
     void sendFrameForAnalysis(bool analyse);
+    /** @brief Enable / disable sending the displayed frames to the color scopes */
+    void sendFrameToScopes(bool send);
     void updateAudioForAnalysis();
     void switchMonitorInfo(int code);
     void restart();
@@ -224,6 +226,8 @@ private:
     int m_speedIndex;
     QMetaObject::Connection m_switchConnection;
     QMetaObject::Connection m_captureConnection;
+    /** @brief True if the displayed frames are sent to the color scopes */
+    bool m_sendFrameToScopes{false};
 
     void adjustScrollBars(float horizontal, float vertical);
     void loadQmlScene(MonitorSceneType type, const QVariant &sceneData = QVariant());
@@ -358,6 +362,8 @@ signals:
     /** @brief  Editing transitions / effects over the monitor requires the renderer to send frames as QImage.
      *      This causes a major slowdown, so we only enable it if required */
     void requestFrameForAnalysis(bool);
+    /** @brief A frame was displayed while color scopes are active, see sendFrameToScopes() */
+    void frameDisplayedForScopes(const SharedFrame &frame);
     void effectChanged(const QRect &);
     void effectPointsChanged(const QVariantList &);
     void addRemoveKeyframe();
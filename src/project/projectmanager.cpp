@@ -16,6 +16,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "project/dialogs/backupwidget.h"
 #include "project/dialogs/noteswidget.h"
 #include "project/dialogs/projectsettings.h"
+#include "utils/mediaprobecache.hpp"
 #include "utils/thumbnailcache.hpp"
 #include "xml/xml.hpp"
 #include <audiomixer/mixermanager.hpp>
@@ -320,12 +321,15 @@ bool ProjectManager::closeCurrentDocument(bool saveChanges, bool quit)
             break;
         }
     }
+    QFuture<void> stopped;
     if (m_project) {
         ::mlt_pool_purge();
-        pCore->cleanup();
+        stopped = pCore->cleanup();
         if (!quit && !qApp->isSavingSession()) {
             pCore->bin()->abortOperations();
         }
+        // The backup may still be reading the timeline
+        m_project->stopAutoSave();
         pCore->window()->getMainTimeline()->unsetModel();
         pCore->window()->resetSubtitles();
         if (m_mainTimelineModel) {
@@ -333,11 +337,14 @@ bool ProjectManager::closeCurrentDocument(bool saveChanges, bool quit)
         }
     }
     pCore->bin()->cleanDocument();
+    MediaProbeCache::get()->save();
     if (!quit && !qApp->isSavingSession() && m_project) {
         emit pCore->window()->clearAssetPanel();
         pCore->monitorManager()->clipMonitor()->slotOpenClip(nullptr);
-        delete m_project;
+        // Canceled tasks may still read the document until they return
+        KdenliveDoc *project = m_project;
         m_project = nullptr;
+        pCore->taskManager.whenStopped({stopped}, this, [project]() { delete project; });
     }
     pCore->mixer()->unsetModel();
     // Release model shared pointers
@@ -382,6 +389,7 @@ bool ProjectManager::saveFileAs(const QString &outputFileName, bool saveACopy)
         p.second.erase(last, p.second.end());
     }
     ThumbnailCache::get()->saveCachedThumbs(thumbKeys);
+    MediaProbeCache::get()->save();
     if (!saveACopy) {
         m_project->setUrl(url);
         // setting up autosave file in ~/.kde/data/stalefiles/kdenlive/
@@ -390,6 +398,8 @@ bool ProjectManager::saveFileAs(const QString &outputFileName, bool saveACopy)
         // This timer is set by KdenliveDoc::setModified()
         const QString projectId = QCryptographicHash::hash(url.fileName().toUtf8(), QCryptographicHash::Md5).toHex();
         QUrl autosaveUrl = QUrl::fromLocalFile(QFileInfo(outputFileName).absoluteDir().absoluteFilePath(projectId + QStringLiteral(".kdenlive")));
+        // The project is saved, the pending backup is not needed anymore
+        m_project->clearAutoSave();
         if (m_project->m_autosave == nullptr) {
             // The temporary file is not opened or created until actually needed.
             // The file filename does not have to exist for KAutoSaveFile to be constructed (if it exists, it will not be touched).
@@ -486,7 +496,7 @@ bool ProjectManager::saveFile()
         return saveFileAs();
     }
     bool result = saveFileAs(m_project->url().toLocalFile());
-    m_project->m_autosave->resize(0);
+    m_project->clearAutoSave();
     return result;
 }
 
@@ -801,27 +811,37 @@ void ProjectManager::slotStartAutoSave()
 
 void ProjectManager::slotAutoSave()
 {
+    if (!m_project->needsAutoSave()) {
+        // Nothing changed since the last backup, don't serialize the project again
+        m_lastSave.start();
+        return;
+    }
     prepareSave();
     QString saveFolder = m_project->url().adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).toLocalFile();
-    QString scene = projectSceneList(saveFolder);
-    if (!m_replacementPattern.isEmpty()) {
-        QMapIterator<QString, QString> i(m_replacementPattern);
-        while (i.hasNext()) {
-            i.next();
-            scene.replace(i.key(), i.value());
-        }
-    }
-    if (!scene.contains(QLatin1String("<track "))) {
-        // In some unexplained cases, the MLT playlist is corrupted and all tracks are deleted. Don't save in that case.
-        pCore->displayMessage(i18n("Project was corrupted, cannot backup. Please close and reopen your project file to recover last backup"), ErrorMessage);
-        return;
+    std::function<QString()> serializer;
+    if (pCore->monitorManager()->isMultiTrack() || pCore->window()->getMainTimeline()->controller()->hasPreviewTrack() ||
+        pCore->monitorManager()->isTrimming()) {
+        // These modes change the timeline tractor, it has to be restored from the GUI thread before serializing
+        const QString scene = projectSceneList(saveFolder);
+        serializer = [scene]() { return scene; };
+    } else {
+        // Build the MLT playlist with the backup in the background, timeline operations wait for it
+        std::weak_ptr<TimelineItemModel> timeline = m_mainTimelineModel;
+        serializer = [timeline, saveFolder]() {
+            if (auto ptr = timeline.lock()) {
+                return ptr->lockedSceneList(saveFolder);
+            }
+            return QString();
+        };
     }
-    m_project->slotAutoSave(scene);
+    m_project->slotAutoSave(serializer, m_replacementPattern);
     m_lastSave.start();
 }
 
 QString ProjectManager::projectSceneList(const QString &outputFolder, const QString &overlayData)
 {
+    // The tractor is changed below, a backup must not be serializing it at the same time
+    m_project->waitForAutoSave();
     // Disable multitrack view and overlay
     bool isMultiTrack = pCore->monitorManager()->isMultiTrack();
     bool hasPreview = pCore->window()->getMainTimeline()->controller()->hasPreviewTrack();
@@ -1046,7 +1066,7 @@ void ProjectManager::requestBackup(const QString &errorMessage)
 
 bool ProjectManager::updateTimeline(int pos, const QString &chunks, const QString &dirty, const QDateTime &documentDate, int enablePreview)
 {
-    pCore->taskManager.slotCancelJobs();
+    pCore->taskManager.cancelAllJobs();
 
     QScopedPointer<Mlt::Producer> xmlProd(new Mlt::Producer(*pCore->getProjectProfile(), "xml-string", m_project->getAndClearProjectXml().constData()));
 
@@ -15,6 +15,8 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <KConfigGroup>
 #include <KSharedConfig>
 
+#include <algorithm>
+
 // Defines the number of FFT samples to store.
 // Around 4 kB for a window size of 2000. Should be at least as large as the
 // highest vertical screen resolution available for complete reconstruction.
@@ -312,10 +314,10 @@ QImage Spectrogram::renderAudioScope(uint, const audioShortVector &audioFrame, c
         QElapsedTimer timer;
         timer.start();
 
+        // Keep the selected window size even if the frame has less samples, they are padded with silence.
+        // The frames do not all have the same number of samples (e.g. at 29.97 fps),
+        // adapting the window to them would reset the history at each change.
         int fftWindow = m_ui->windowSize->itemData(m_ui->windowSize->currentIndex()).toInt();
-        if (fftWindow > num_samples) {
-            fftWindow = num_samples;
-        }
         if ((fftWindow & 1) == 1) {
             fftWindow--;
         }
@@ -323,21 +325,33 @@ QImage Spectrogram::renderAudioScope(uint, const audioShortVector &audioFrame, c
         // Show the window size used, for information
         m_ui->labelFFTSizeNumber->setText(QVariant(fftWindow).toString());
 
-        if (newDataAvailable) {
-
-            auto *freqSpectrum = new float[uint(fftWindow / 2)];
+        int newLines = 0;
+        if (newDataAvailable && fftWindow >= 2) {
+            // Compute the spectra of half overlapping windows covering the new samples
+            const int bins = fftWindow / 2;
+            const int hop = qMax(1, bins);
+            const int windows = num_samples > fftWindow ? (num_samples - fftWindow) / hop + 1 : 1;
+            if (bins != m_historyBins) {
+                // The window size changed, previous spectra cannot be displayed anymore
+                m_historyBins = bins;
+                m_fftHistory = QVector<float>(SPECTROGRAM_HISTORY_SIZE * bins);
+                m_historyHead = 0;
+                m_historyCount = 0;
+                m_parameterChanged = true;
+            }
+            QVector<float> spectra(windows * bins);
 
             // Get the spectral power distribution of the input samples,
             // using the given window size and function
             FFTTools::WindowType windowType = FFTTools::WindowType(m_ui->windowFunction->itemData(m_ui->windowFunction->currentIndex()).toInt());
-            m_fftTools.fftNormalized(audioFrame, 0, uint(num_channels), freqSpectrum, windowType, uint(fftWindow), 0);
+            m_fftTools.fftNormalizedBatch(audioFrame, 0, uint(num_channels), spectra.data(), uint(windows), uint(hop), windowType, uint(fftWindow), 0);
 
             // This method might be called also when a simple refresh is required.
             // In this case there is no data to append to the history. Only append new data.
-            QVector<float> spectrumVector(fftWindow / 2);
-            memcpy(spectrumVector.data(), &freqSpectrum[0], uint(fftWindow) / 2 * sizeof(float));
-            m_fftHistory.prepend(spectrumVector);
-            delete[] freqSpectrum;
+            for (int k = 0; k < windows; ++k) {
+                appendHistory(spectra.constData() + k * bins);
+            }
+            newLines = windows;
         }
 #ifdef DEBUG_SPECTROGRAM
         else {
@@ -345,12 +359,29 @@ QImage Spectrogram::renderAudioScope(uint, const audioShortVector &audioFrame, c
         }
 #endif
 
-        // Limit the maximum history size to avoid wasting space
-        while (m_fftHistory.size() > SPECTROGRAM_HISTORY_SIZE) {
-            m_fftHistory.removeLast();
+        const int h = m_innerScopeRect.height();
+        const int leftDist = m_innerScopeRect.left() - m_scopeRect.left();
+        const int topDist = m_innerScopeRect.top() - m_scopeRect.top();
+        const bool completeRedraw = m_fftHistoryImg.size() != m_innerScopeRect.size() || m_parameterChanged || newLines >= h;
+
+        if (completeRedraw) {
+            // The size of the widget or the parameters (like min/max dB) have changed, repaint all lines from the history
+            m_parameterChanged = false;
+            m_fftHistoryImg = QImage(m_innerScopeRect.size(), QImage::Format_ARGB32);
+            m_fftHistoryImg.fill(qRgba(0, 0, 0, 0));
+            m_imgHead = h - 1;
+            for (int age = 0; age < qMin(m_historyCount, h); ++age) {
+                paintHistoryRow(h - 1 - age, age);
+            }
+        } else {
+            // Only paint the new lines, the oldest ones being overwritten
+            for (int age = newLines - 1; age >= 0; --age) {
+                m_imgHead = (m_imgHead + 1) % h;
+                paintHistoryRow(m_imgHead, age);
+            }
         }
 
-        // Draw the spectrum
+        // Draw the spectrum, the most recent line at the bottom
         QImage spectrum(m_scopeRect.size(), QImage::Format_ARGB32);
         spectrum.fill(qRgba(0, 0, 0, 0));
 
@@ -360,88 +391,69 @@ QImage Spectrogram::renderAudioScope(uint, const audioShortVector &audioFrame, c
             qDebug() << "Warning: Could not initialise QPainter for rendering spectrogram.";
             return spectrum;
         }
-
-        const int h = m_innerScopeRect.height();
-        const int leftDist = m_innerScopeRect.left() - m_scopeRect.left();
-        const int topDist = m_innerScopeRect.top() - m_scopeRect.top();
-        int y;
-        bool completeRedraw = true;
-
-        if (m_fftHistoryImg.size() == m_scopeRect.size() && !m_parameterChanged) {
-            // The size of the widget and the parameters (like min/max dB) have not changed since last time,
-            // so we can re-use it, shift it by one pixel, and render the single remaining line. Usually about
-            // 10 times faster for a widget height of around 400 px.
-            if (newDataAvailable) {
-                davinci.drawImage(0, -1, m_fftHistoryImg);
-            } else {
-                // spectrum = m_fftHistoryImg does NOT work, leads to segfaults (anyone knows why, please tell me)
-                davinci.drawImage(0, 0, m_fftHistoryImg);
-            }
-            completeRedraw = false;
-        }
-
-        y = 0;
-        if ((newData != 0) || m_parameterChanged) {
-            m_parameterChanged = false;
-
-            QVector<float> dbMap;
-            uint right;
-            ////////////////FIXME
-            for (auto &it : m_fftHistory) {
-
-                int windowSize = it.size();
-
-                // Interpolate the frequency data to match the pixel coordinates
-                right = uint(m_freqMax / (m_freq / 2.f) * (windowSize - 1));
-                dbMap = FFTTools::interpolatePeakPreserving(it, uint(m_innerScopeRect.width()), 0, right, -180);
-
-                for (int i = 0; i < dbMap.size(); ++i) {
-                    float val;
-                    val = dbMap[i];
-                    bool peak = val > m_dBmax;
-
-                    // Normalize dB value to [0 1], 1 corresponding to dbMax dB and 0 to dbMin dB
-                    val = (val - m_dBmax) / (m_dBmax - m_dBmin) + 1.f;
-                    if (val < 0) {
-                        val = 0;
-                    } else if (val > 1) {
-                        val = 1;
-                    }
-                    if (!peak || !m_aHighlightPeaks->isChecked()) {
-                        spectrum.setPixel(leftDist + i, topDist + h - 1 - y, m_colorMap[int(val * 255)]);
-                    } else {
-                        spectrum.setPixel(leftDist + i, topDist + h - 1 - y, AbstractScopeWidget::colHighlightDark.rgba());
-                    }
-                }
-
-                y++;
-                if (y >= topDist + m_innerScopeRect.height()) {
-                    break;
-                }
-                if (!completeRedraw) {
-                    break;
-                }
-            }
+        davinci.setCompositionMode(QPainter::CompositionMode_Source);
+        const int oldest = (m_imgHead + 1) % h;
+        const int width = m_innerScopeRect.width();
+        davinci.drawImage(QPoint(leftDist, topDist), m_fftHistoryImg, QRect(0, oldest, width, h - oldest));
+        if (oldest > 0) {
+            davinci.drawImage(QPoint(leftDist, topDist + h - oldest), m_fftHistoryImg, QRect(0, 0, width, oldest));
         }
+        davinci.end();
 
 #ifdef DEBUG_SPECTROGRAM
-        qCDebug(KDENLIVE_LOG) << "Rendered " << y - topDist << "lines from " << m_fftHistory.size() << " available samples in " << start.elapsed() << " ms"
-                              << (completeRedraw ? "" : " (re-used old image)");
-        uint storedBytes = 0;
-        for (QList<QVector<float>>::iterator it = m_fftHistory.begin(); it != m_fftHistory.end(); ++it) {
-            storedBytes += (*it).size() * sizeof((*it)[0]);
-        }
-        qCDebug(KDENLIVE_LOG) << QString("Total storage used: %1 kB").arg((double)storedBytes / 1000, 0, 'f', 2);
+        qCDebug(KDENLIVE_LOG) << "Rendered " << (completeRedraw ? qMin(m_historyCount, h) : newLines) << "lines from " << m_historyCount
+                              << " available samples in " << timer.elapsed() << " ms" << (completeRedraw ? "" : " (re-used old image)");
+        qCDebug(KDENLIVE_LOG) << QString("Total storage used: %1 kB").arg(double(m_fftHistory.size() * sizeof(float)) / 1000, 0, 'f', 2);
 #endif
 
-        m_fftHistoryImg = spectrum;
-
         emit signalScopeRenderingFinished(uint(timer.elapsed()), 1);
         return spectrum;
     }
     emit signalScopeRenderingFinished(0, 1);
     return QImage();
 }
+void Spectrogram::appendHistory(const float *spectrum)
+{
+    m_historyHead = (m_historyHead + 1) % SPECTROGRAM_HISTORY_SIZE;
+    memcpy(m_fftHistory.data() + m_historyHead * m_historyBins, spectrum, size_t(m_historyBins) * sizeof(float));
+    m_historyCount = qMin(m_historyCount + 1, SPECTROGRAM_HISTORY_SIZE);
+}
+
+void Spectrogram::paintHistoryRow(int row, int age)
+{
+    auto *line = reinterpret_cast<QRgb *>(m_fftHistoryImg.scanLine(row));
+    if (age >= m_historyCount) {
+        std::fill(line, line + m_fftHistoryImg.width(), qRgba(0, 0, 0, 0));
+        return;
+    }
+    const int index = (m_historyHead - age + SPECTROGRAM_HISTORY_SIZE) % SPECTROGRAM_HISTORY_SIZE;
+    const float *first = m_fftHistory.constData() + index * m_historyBins;
+    QVector<float> spectrum(m_historyBins);
+    std::copy(first, first + m_historyBins, spectrum.begin());
+
+    // Interpolate the frequency data to match the pixel coordinates
+    const uint right = uint(m_freqMax / (m_freq / 2.f) * (m_historyBins - 1));
+    const QVector<float> dbMap = FFTTools::interpolatePeakPreserving(spectrum, uint(m_fftHistoryImg.width()), 0, right, -180);
+    const bool highlightPeaks = m_aHighlightPeaks->isChecked();
+    for (int i = 0; i < dbMap.size(); ++i) {
+        float val = dbMap[i];
+        bool peak = val > m_dBmax;
+
+        // Normalize dB value to [0 1], 1 corresponding to dbMax dB and 0 to dbMin dB
+        val = (val - m_dBmax) / (m_dBmax - m_dBmin) + 1.f;
+        if (val < 0) {
+            val = 0;
+        } else if (val > 1) {
+            val = 1;
+        }
+        if (!peak || !highlightPeaks) {
+            line[i] = m_colorMap[int(val * 255)];
+        } else {
+            line[i] = AbstractScopeWidget::colHighlightDark.rgba();
+        }
+    }
+}
+
 QImage Spectrogram::renderBackground(uint)
 {
     return QImage();
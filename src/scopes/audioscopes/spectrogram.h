@@ -18,10 +18,11 @@ class Spectrogram_UI;
     over time. See https://en.wikipedia.org/wiki/Spectrogram.
 
     The Spectrogram makes use of two caches:
-    * A cached image where only the most recent line needs to be appended instead of
-      having to recalculate the whole image. A typical speedup factor is 10x.
+    * A cached image where only the most recent lines need to be painted instead of
+      having to recalculate the whole image. Its rows are used as a ring buffer, so
+      scrolling does not move any pixel. A typical speedup factor is 10x.
     * A FFT cache storing a history of previous spectral power distributions (i.e.
-      the Fourier-transformed audio signals). This is used if the user adjusts parameters
+      the Fourier-transformed audio signals) in a ring buffer. This is used if the user adjusts parameters
       like the maximum frequency to display or minimum/maximum signal strength in dB.
       All required information is preserved in the FFT history, which would not be the
       case for an image (consider re-sizing the widget to 100x100 px and then back to
@@ -60,8 +61,16 @@ private:
     QAction *m_aTrackMouse;
     QAction *m_aHighlightPeaks;
 
-    QList<QVector<float>> m_fftHistory;
+    /** @brief Ring buffer of the last spectra, m_historyBins values per spectrum */
+    QVector<float> m_fftHistory;
+    int m_historyBins{0};
+    /** @brief Index of the most recent spectrum in m_fftHistory */
+    int m_historyHead{0};
+    int m_historyCount{0};
+    /** @brief Spectra of the inner scope rect, one row per spectrum used as a ring buffer */
     QImage m_fftHistoryImg;
+    /** @brief Row of m_fftHistoryImg holding the most recent spectrum */
+    int m_imgHead{0};
 
     int m_dBmin{-70};
     int m_dBmax{0};
@@ -74,6 +83,11 @@ private:
     QRect m_innerScopeRect;
     QRgb m_colorMap[256];
 
+    /** @brief Append a spectrum of m_historyBins values to the history */
+    void appendHistory(const float *spectrum);
+    /** @brief Paint the spectrum @p age (0 being the most recent one) in the row @p row of m_fftHistoryImg */
+    void paintHistoryRow(int row, int age);
+
 private slots:
     void slotResetMaxFreq();
 };
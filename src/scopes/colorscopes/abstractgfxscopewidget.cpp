@@ -7,6 +7,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "abstractgfxscopewidget.h"
 #include "monitor/monitormanager.h"
+#include "scopeframe.h"
 
 #include <QMouseEvent>
 
@@ -25,8 +26,11 @@ AbstractGfxScopeWidget::~AbstractGfxScopeWidget() = default;
 
 QImage AbstractGfxScopeWidget::renderScope(uint accelerationFactor)
 {
-    QMutexLocker lock(&m_mutex);
-    return renderGfxScope(accelerationFactor, m_scopeImage);
+    m_mutex.lock();
+    std::shared_ptr<const ScopeFrame> frame = m_scopeFrame;
+    m_mutex.unlock();
+    // The frame is read-only, no need to keep the lock while rendering
+    return renderGfxScope(accelerationFactor, frame ? frame->image() : QImage());
 }
 
 void AbstractGfxScopeWidget::mouseReleaseEvent(QMouseEvent *event)
@@ -37,10 +41,11 @@ void AbstractGfxScopeWidget::mouseReleaseEvent(QMouseEvent *event)
 
 ///// Slots /////
 
-void AbstractGfxScopeWidget::slotRenderZoneUpdated(const QImage &frame)
+void AbstractGfxScopeWidget::slotRenderZoneUpdated(const std::shared_ptr<const ScopeFrame> &frame)
 {
-    QMutexLocker lock(&m_mutex);
-    m_scopeImage = frame;
+    m_mutex.lock();
+    m_scopeFrame = frame;
+    m_mutex.unlock();
     AbstractScopeWidget::slotRenderZoneUpdated();
 }
 
@@ -12,6 +12,10 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "../abstractscopewidget.h"
 
+#include <memory>
+
+class ScopeFrame;
+
 /**
 * @brief Abstract class for scopes analyzing image frames.
 */
@@ -36,14 +40,15 @@ protected:
     void mouseReleaseEvent(QMouseEvent *) override;
 
 private:
-    QImage m_scopeImage;
+    std::shared_ptr<const ScopeFrame> m_scopeFrame;
     QMutex m_mutex;
 
 public slots:
     /** @brief Must be called when the active monitor has shown a new frame.
+     * The frame is shared with the other scopes and only converted when rendering.
      * This slot must be connected in the implementing class, it is *not*
      * done in this abstract class. */
-    void slotRenderZoneUpdated(const QImage &);
+    void slotRenderZoneUpdated(const std::shared_ptr<const ScopeFrame> &frame);
 
 protected slots:
     virtual void slotAutoRefreshToggled(bool autoRefresh);
@@ -6,6 +6,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 */
 
 #include "histogramgenerator.h"
+#include "scopekernels.h"
 
 #include "klocalizedstring.h"
 #include <QDebug>
@@ -13,6 +14,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QPainter>
 #include <algorithm>
 #include <cmath>
+#include <vector>
 
 HistogramGenerator::HistogramGenerator() = default;
 
@@ -29,43 +31,79 @@ QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const QIm
     bool drawB = (components & HistogramGenerator::ComponentB) != 0;
     bool drawSum = (components & HistogramGenerator::ComponentSum) != 0;
 
-    int r[256], g[256], b[256], y[256], s[766];
-    // Initialize the values to zero
-    std::fill(r, r + 256, 0);
-    std::fill(g, g + 256, 0);
-    std::fill(b, b + 256, 0);
-    std::fill(y, y + 256, 0);
-    std::fill(s, s + 766, 0);
-
-    const int ww = paradeSize.width();
-    const int wh = paradeSize.height();
-
-    // Read the stats from the input image
-    for (int Y = 0; Y < image.height(); ++Y) {
-        for (int X = 0; X < image.width(); X += accelFactor) {
-
-            QRgb col = image.pixel(X, Y);
-            r[qRed(col)]++;
-            g[qGreen(col)]++;
-            b[qBlue(col)]++;
-
+    struct Counts
+    {
+        int r[256], g[256], b[256], y[256], s[766];
+    };
+    const QImage source = ScopeKernels::directImage(image);
+    const int samplesPerRow = (image.width() + int(accelFactor) - 1) / int(accelFactor);
+    const int chunks = ScopeKernels::chunkCount(qint64(samplesPerRow) * image.height(), image.height());
+    std::vector<Counts> chunkCounts(size_t(chunks));
+
+    // Read the stats from the input image, the rows are processed in parallel chunks
+    ScopeKernels::forRowChunks(image.height(), chunks, [&](int chunk, int firstRow, int endRow) {
+        Counts &counts = chunkCounts[size_t(chunk)];
+        // Initialize the values to zero
+        std::fill(counts.r, counts.r + 256, 0);
+        std::fill(counts.g, counts.g + 256, 0);
+        std::fill(counts.b, counts.b + 256, 0);
+        std::fill(counts.y, counts.y + 256, 0);
+        std::fill(counts.s, counts.s + 766, 0);
+        std::vector<QRgb> samples(size_t(samplesPerRow));
+        std::vector<float> luma(size_t(samplesPerRow));
+        for (int Y = firstRow; Y < endRow; ++Y) {
+            const auto *line = reinterpret_cast<const QRgb *>(source.constScanLine(Y));
+            const QRgb *pixels = line;
+            if (accelFactor > 1) {
+                for (int k = 0; k < samplesPerRow; ++k) {
+                    samples[size_t(k)] = line[k * int(accelFactor)];
+                }
+                pixels = samples.data();
+            }
+            for (int k = 0; k < samplesPerRow; ++k) {
+                const QRgb col = pixels[k];
+                counts.r[qRed(col)]++;
+                counts.g[qGreen(col)]++;
+                counts.b[qBlue(col)]++;
+            }
             if (drawY) {
-                // Use if branch to avoid expensive multiplication if Y disabled
-                if (rec == ITURec::Rec_601) {
-                    y[int(REC_601_R * qRed(col) + REC_601_G * qGreen(col) + REC_601_B * qBlue(col))]++;
-                } else {
-                    y[int(REC_709_R * qRed(col) + REC_709_G * qGreen(col) + REC_709_B * qBlue(col))]++;
+                // Only compute the luma if Y is enabled
+                ScopeKernels::lumaValues(pixels, samplesPerRow, rec, luma.data());
+                for (int k = 0; k < samplesPerRow; ++k) {
+                    counts.y[int(luma[size_t(k)])]++;
                 }
             }
-
             if (drawSum) {
-                // Use an if branch here because the sum takes more operations than rgb
-                s[qRed(col)]++;
-                s[qGreen(col)]++;
-                s[qBlue(col)]++;
+                for (int k = 0; k < samplesPerRow; ++k) {
+                    const QRgb col = pixels[k];
+                    counts.s[qRed(col)]++;
+                    counts.s[qGreen(col)]++;
+                    counts.s[qBlue(col)]++;
+                }
             }
         }
+    });
+    Counts &total = chunkCounts.front();
+    for (size_t c = 1; c < chunkCounts.size(); ++c) {
+        const Counts &counts = chunkCounts[c];
+        for (int i = 0; i < 256; ++i) {
+            total.r[i] += counts.r[i];
+            total.g[i] += counts.g[i];
+            total.b[i] += counts.b[i];
+            total.y[i] += counts.y[i];
+        }
+        for (int i = 0; i < 766; ++i) {
+            total.s[i] += counts.s[i];
+        }
     }
+    const int *r = total.r;
+    const int *g = total.g;
+    const int *b = total.b;
+    const int *y = total.y;
+    const int *s = total.s;
+
+    const int ww = paradeSize.width();
+    const int wh = paradeSize.height();
 
     const int nParts = (drawY ? 1 : 0) + (drawR ? 1 : 0) + (drawG ? 1 : 0) + (drawB ? 1 : 0) + (drawSum ? 1 : 0);
     if (nParts == 0) {
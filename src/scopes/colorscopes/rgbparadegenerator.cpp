@@ -7,6 +7,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "rgbparadegenerator.h"
 #include "klocalizedstring.h"
+#include "scopekernels.h"
 #include <QColor>
 #include <QDebug>
 #include <QPainter>
@@ -71,63 +72,72 @@ QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QIm
 
     const float wPrediv = float(partW - 1) / (iw - 1);
 
-    std::vector<std::vector<StructRGB>> paradeVals(partW, std::vector<StructRGB>(256, {0, 0, 0}));
-
+    // Rows are processed in parallel chunks, each counting in its own flat buffer indexed by [column * 256 + value]
+    struct Chunk
+    {
+        std::vector<StructRGB> values;
+        uchar minR = 255, minG = 255, minB = 255, maxR = 0, maxG = 0, maxB = 0;
+    };
+    const QImage source = ScopeKernels::directImage(image);
+    const size_t bufferSize = size_t(partW) * 256;
     const auto totalPixels = image.width() * image.height();
-    for (int i = 0; i < totalPixels; i += accelFactor) {
-        const auto x = i % image.width();
-        const QRgb pixel = image.pixel(x, i / image.width());
-        auto r = uchar(qRed(pixel));
-        auto g = uchar(qGreen(pixel));
-        auto b = uchar(qBlue(pixel));
-
-        double dx = x * double(wPrediv);
-
-        paradeVals[size_t(dx)][r].r++;
-        paradeVals[size_t(dx)][g].g++;
-        paradeVals[size_t(dx)][b].b++;
-
-        if (r < minR) {
-            minR = r;
-        }
-        if (g < minG) {
-            minG = g;
-        }
-        if (b < minB) {
-            minB = b;
-        }
-        if (r > maxR) {
-            maxR = r;
-        }
-        if (g > maxG) {
-            maxG = g;
+    const int chunks = ScopeKernels::chunkCount(totalPixels / accelFactor, image.height());
+    std::vector<Chunk> chunkValues(size_t(chunks));
+    ScopeKernels::forRowChunks(image.height(), chunks, [&](int chunk, int firstRow, int endRow) {
+        Chunk &data = chunkValues[size_t(chunk)];
+        data.values.assign(bufferSize, {0, 0, 0});
+        for (int y = firstRow; y < endRow; ++y) {
+            const auto *line = reinterpret_cast<const QRgb *>(source.constScanLine(y));
+            for (int x = ScopeKernels::firstSample(y, image.width(), accelFactor); x < image.width(); x += int(accelFactor)) {
+                const QRgb pixel = line[x];
+                auto r = uchar(qRed(pixel));
+                auto g = uchar(qGreen(pixel));
+                auto b = uchar(qBlue(pixel));
+
+                double dx = x * double(wPrediv);
+                StructRGB *column = data.values.data() + size_t(dx) * 256;
+                column[r].r++;
+                column[g].g++;
+                column[b].b++;
+
+                data.minR = qMin(data.minR, r);
+                data.minG = qMin(data.minG, g);
+                data.minB = qMin(data.minB, b);
+                data.maxR = qMax(data.maxR, r);
+                data.maxG = qMax(data.maxG, g);
+                data.maxB = qMax(data.maxB, b);
+            }
         }
-        if (b > maxB) {
-            maxB = b;
+    });
+    std::vector<StructRGB> &paradeVals = chunkValues.front().values;
+    for (const Chunk &data : chunkValues) {
+        if (&data != &chunkValues.front()) {
+            for (size_t i = 0; i < bufferSize; ++i) {
+                paradeVals[i].r += data.values[i].r;
+                paradeVals[i].g += data.values[i].g;
+                paradeVals[i].b += data.values[i].b;
+            }
         }
+        minR = qMin(minR, data.minR);
+        minG = qMin(minG, data.minG);
+        minB = qMin(minB, data.minB);
+        maxR = qMax(maxR, data.maxR);
+        maxG = qMax(maxG, data.maxG);
+        maxB = qMax(maxB, data.maxB);
     }
 
     const int offset1 = int(partW + offset);
     const int offset2 = int(2 * partW + 2 * offset);
-    switch (paintMode) {
-    case PaintMode_RGB:
+    // The other channels of each part, tinted or white
+    const int tint = paintMode == PaintMode_RGB ? 10 : 255;
+    for (int j = 0; j < 256; ++j) {
+        auto *line = reinterpret_cast<QRgb *>(unscaled.scanLine(j));
         for (int i = 0; i < int(partW); ++i) {
-            for (int j = 0; j < 256; ++j) {
-                unscaled.setPixel(i, j, qRgba(255, 10, 10, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].r))));
-                unscaled.setPixel(i + offset1, j, qRgba(10, 255, 10, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].g))));
-                unscaled.setPixel(i + offset2, j, qRgba(10, 10, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].b))));
-            }
-        }
-        break;
-    default:
-        for (int i = 0; i < int(partW); ++i) {
-            for (int j = 0; j < 256; ++j) {
-                unscaled.setPixel(i, j, qRgba(255, 255, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].r))));
-                unscaled.setPixel(i + offset1, j, qRgba(255, 255, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].g))));
-                unscaled.setPixel(i + offset2, j, qRgba(255, 255, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].b))));
-            }
+            const StructRGB &value = paradeVals[size_t(i) * 256 + size_t(j)];
+            line[i] = qRgba(255, tint, tint, CHOP255(gain * float(value.r)));
+            line[i + offset1] = qRgba(tint, 255, tint, CHOP255(gain * float(value.g)));
+            line[i + offset2] = qRgba(tint, tint, 255, CHOP255(gain * float(value.b)));
         }
-        break;
     }
 
     // Scale the image to the target height. Scaling is not accomplished before because
@@ -0,0 +1,35 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "scopeframe.h"
+
+ScopeFrame::ScopeFrame(const SharedFrame &frame)
+    : m_frame(frame)
+{
+}
+
+QImage ScopeFrame::image() const
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_converted) {
+        return m_image;
+    }
+    m_converted = true;
+    if (!m_frame.is_valid()) {
+        return m_image;
+    }
+    // The converted rgba image is cached in the frame, wrap it without copying
+    const uint8_t *data = m_frame.get_image(mlt_image_rgba);
+    const int width = m_frame.get_image_width();
+    const int height = m_frame.get_image_height();
+    if (data == nullptr || width <= 0 || height <= 0) {
+        return m_image;
+    }
+    const QImage rgba(data, width, height, QImage::Format_RGBA8888);
+    // Scope generators read ARGB32 scanlines directly, convert once for all of them
+    m_image = rgba.convertToFormat(QImage::Format_ARGB32);
+    return m_image;
+}
@@ -0,0 +1,34 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include "monitor/scopes/sharedframe.h"
+
+#include <QImage>
+#include <QMutex>
+
+/** @class ScopeFrame
+    @brief A displayed monitor frame, shared read-only by all the color scopes.
+
+    The frame is received from the monitor as a SharedFrame, so that no framebuffer
+    readback is needed. The RGB image used by the scope generators is only computed
+    the first time a scope asks for it, and then reused by the other scopes.
+  */
+class ScopeFrame
+{
+public:
+    explicit ScopeFrame(const SharedFrame &frame);
+
+    /** @brief The frame as an ARGB32 image, converted once and shared by all scopes. Returns a null image for an invalid frame */
+    QImage image() const;
+
+private:
+    SharedFrame m_frame;
+    mutable QMutex m_mutex;
+    mutable QImage m_image;
+    mutable bool m_converted{false};
+};
@@ -0,0 +1,130 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "scopekernels.h"
+
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCOPEKERNELS_SSE2
+#endif
+
+namespace {
+// Below this number of sampled pixels, starting threads costs more than it saves
+const qint64 MinParallelSamples = 1 << 18;
+// Keep enough rows per chunk so that merging the buffers stays cheap
+const int MinRowsPerChunk = 16;
+const int MaxChunks = 16;
+} // namespace
+
+QImage ScopeKernels::directImage(const QImage &image)
+{
+    switch (image.format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        return image;
+    default:
+        break;
+    }
+    // QImage::pixel() returns premultiplied values for premultiplied formats, and straight ones otherwise
+    if (image.pixelFormat().premultiplied() == QPixelFormat::Premultiplied) {
+        return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    return image.convertToFormat(QImage::Format_ARGB32);
+}
+
+int ScopeKernels::chunkCount(qint64 samples, int rows)
+{
+    if (samples < MinParallelSamples) {
+        return 1;
+    }
+    return qBound(1, qMin(QThread::idealThreadCount(), rows / MinRowsPerChunk), MaxChunks);
+}
+
+void ScopeKernels::forRowChunks(int rows, int chunks, const std::function<void(int, int, int)> &function)
+{
+    if (chunks <= 1) {
+        function(0, 0, rows);
+        return;
+    }
+    QVector<int> ids(chunks);
+    std::iota(ids.begin(), ids.end(), 0);
+    QtConcurrent::blockingMap(ids, [rows, chunks, &function](int chunk) {
+        function(chunk, int(qint64(rows) * chunk / chunks), int(qint64(rows) * (chunk + 1) / chunks));
+    });
+}
+
+int ScopeKernels::firstSample(int y, int width, uint accelFactor)
+{
+    const qint64 offset = (qint64(y) * width) % accelFactor;
+    return int((accelFactor - offset) % accelFactor);
+}
+
+void ScopeKernels::lumaValues(const QRgb *pixels, int count, ITURec rec, float *luma)
+{
+    const float kr = rec == ITURec::Rec_601 ? REC_601_R : REC_709_R;
+    const float kg = rec == ITURec::Rec_601 ? REC_601_G : REC_709_G;
+    const float kb = rec == ITURec::Rec_601 ? REC_601_B : REC_709_B;
+    int i = 0;
+#ifdef SCOPEKERNELS_SSE2
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128 vr = _mm_set1_ps(kr);
+    const __m128 vg = _mm_set1_ps(kg);
+    const __m128 vb = _mm_set1_ps(kb);
+    for (; i + 4 <= count; i += 4) {
+        const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i));
+        const __m128 r = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 16), mask));
+        const __m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, 8), mask));
+        const __m128 b = _mm_cvtepi32_ps(_mm_and_si128(p, mask));
+        // Same evaluation order as the scalar formula, so that results are bit identical
+        _mm_storeu_ps(luma + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(vr, r), _mm_mul_ps(vg, g)), _mm_mul_ps(vb, b)));
+    }
+#endif
+    for (; i < count; ++i) {
+        luma[i] = kr * qRed(pixels[i]) + kg * qGreen(pixels[i]) + kb * qBlue(pixels[i]);
+    }
+}
+
+void ScopeKernels::chromaValues(const QRgb *pixels, int count, bool yPbPr, double *u, double *v)
+{
+    // u = ur * r - ug * g + ub * b, v = vr * r - vg * g - vb * b
+    const double ur = yPbPr ? -0.0006671 : -0.0005781;
+    const double ug = yPbPr ? 0.001299 : 0.001135;
+    const double ub = yPbPr ? 0.0019608 : 0.001713;
+    const double vr = yPbPr ? 0.001961 : 0.002411;
+    const double vg = yPbPr ? 0.001642 : 0.002019;
+    const double vb = yPbPr ? 0.0003189 : 0.0003921;
+    int i = 0;
+#ifdef SCOPEKERNELS_SSE2
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128d cur = _mm_set1_pd(ur);
+    const __m128d cug = _mm_set1_pd(ug);
+    const __m128d cub = _mm_set1_pd(ub);
+    const __m128d cvr = _mm_set1_pd(vr);
+    const __m128d cvg = _mm_set1_pd(vg);
+    const __m128d cvb = _mm_set1_pd(vb);
+    for (; i + 2 <= count; i += 2) {
+        const __m128i p = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(pixels + i));
+        const __m128d r = _mm_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(p, 16), mask));
+        const __m128d g = _mm_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(p, 8), mask));
+        const __m128d b = _mm_cvtepi32_pd(_mm_and_si128(p, mask));
+        _mm_storeu_pd(u + i, _mm_add_pd(_mm_sub_pd(_mm_mul_pd(cur, r), _mm_mul_pd(cug, g)), _mm_mul_pd(cub, b)));
+        _mm_storeu_pd(v + i, _mm_sub_pd(_mm_sub_pd(_mm_mul_pd(cvr, r), _mm_mul_pd(cvg, g)), _mm_mul_pd(cvb, b)));
+    }
+#endif
+    for (; i < count; ++i) {
+        const int r = qRed(pixels[i]);
+        const int g = qGreen(pixels[i]);
+        const int b = qBlue(pixels[i]);
+        u[i] = ur * r - ug * g + ub * b;
+        v[i] = vr * r - vg * g - vb * b;
+    }
+}
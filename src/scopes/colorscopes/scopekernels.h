@@ -0,0 +1,42 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include "colorconstants.h"
+
+#include <QImage>
+#include <functional>
+
+/** @brief Helpers shared by the color scope generators.
+
+    The generators read the scanlines of the input image directly and split
+    its rows in chunks processed in parallel, each chunk accumulating in its
+    own flat buffer. The per pixel math is vectorized with SSE2 when available,
+    using the same operations in the same order as the scalar formulas so that
+    the scopes are identical with and without it.
+ */
+namespace ScopeKernels {
+
+/** @brief Returns @p image or a converted copy whose scanlines contain the values QImage::pixel() returns for it */
+QImage directImage(const QImage &image);
+
+/** @brief Number of row chunks to use for @p samples sampled pixels spread over @p rows rows, 1 for small images */
+int chunkCount(qint64 samples, int rows);
+
+/** @brief Call @p function (chunk, first row, end row) for @p chunks consecutive row ranges in parallel and wait for them */
+void forRowChunks(int rows, int chunks, const std::function<void(int, int, int)> &function);
+
+/** @brief First x of row @p y sampled when walking all the pixels of an image of width @p width with a step of @p accelFactor */
+int firstSample(int y, int width, uint accelFactor);
+
+/** @brief Luma of @p count pixels, computed in float as REC_R * r + REC_G * g + REC_B * b */
+void lumaValues(const QRgb *pixels, int count, ITURec rec, float *luma);
+
+/** @brief Chroma of @p count pixels for the vectorscope, in double precision, with YPbPr coefficients if @p yPbPr is true */
+void chromaValues(const QRgb *pixels, int count, bool yPbPr, double *u, double *v);
+
+} // namespace ScopeKernels
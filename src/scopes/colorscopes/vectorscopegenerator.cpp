@@ -61,7 +61,10 @@ mRgb2YPbPr =                        r =
  */
 
 #include "vectorscopegenerator.h"
+#include "scopekernels.h"
+
 #include <cmath>
+#include <vector>
 
 // The maximum distance from the center for any RGB color is 0.63, so
 // no need to make the circle bigger than required.
@@ -119,11 +122,6 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
     QImage scope = QImage(cw, cw, QImage::Format_ARGB32);
     scope.fill(qRgba(0, 0, 0, 0));
 
-    double dy, dr, dg, db, dmax;
-    double /*y,*/ u, v;
-    QPoint pt;
-    QRgb px;
-
     // Just an average for the number of image pixels per scope pixel.
     // NOTE: byteCount() has to be replaced by (img.bytesPerLine()*img.height()) for Qt 4.5 to compile, see:
     // https://doc.qt.io/qt-5/qimage.html#bytesPerLine
@@ -132,130 +130,187 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
     // benchmarking code
     // const auto start = std::chrono::high_resolution_clock::now();
 
-    const auto totalPixels = image.width() * image.height();
-    for (int i = 0; i < totalPixels; i += accelFactor) {
-        const QRgb pixel = image.pixel(i % image.width(), i / image.width());
-        const int r = qRed(pixel);
-        const int g = qGreen(pixel);
-        const int b = qBlue(pixel);
-
-        switch (colorSpace) {
-        case VectorscopeGenerator::ColorSpace_YUV:
-            //             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = -0.0005781 * r - 0.001135 * g + 0.001713 * b;
-            v = 0.002411 * r - 0.002019 * g - 0.0003921 * b;
-            break;
-        case VectorscopeGenerator::ColorSpace_YPbPr:
-        default:
-            //             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = -0.0006671 * r - 0.001299 * g + 0.0019608 * b;
-            v = 0.001961 * r - 0.001642 * g - 0.0003189 * b;
-            break;
-        }
-
-        pt = mapToCircle(vectorscopeSize, QPointF(SCALING * double(gain) * u, SCALING * double(gain) * v));
-
-        if (pt.x() >= scope.width() || pt.x() < 0 || pt.y() >= scope.height() || pt.y() < 0) {
-            // Point lies outside (because of scaling), don't plot it
-
-        } else {
+    // In the YUV, Chroma and Original modes, a scope pixel gets the color of the last image pixel mapped to it.
+    // In the other modes, its color only depends on how many image pixels were mapped to it.
+    const bool lastPixelWins = paintMode == PaintMode_YUV || paintMode == PaintMode_Chroma || paintMode == PaintMode_Original;
+    const bool yPbPr = colorSpace != VectorscopeGenerator::ColorSpace_YUV;
+    const double factor = SCALING * double(gain);
+    const QImage source = ScopeKernels::directImage(image);
+    const size_t scopePixels = size_t(scope.width()) * size_t(scope.height());
 
-            // Draw the pixel using the chosen draw mode.
-            switch (paintMode) {
-            case PaintMode_YUV:
-                // see yuvColorWheel
-                dy = 128; // Default Y value. Lower = darker.
-
-                // Calculate the RGB values from YUV/YPbPr
-                switch (colorSpace) {
-                case VectorscopeGenerator::ColorSpace_YUV:
-                    dr = dy + 290.8 * v;
-                    dg = dy - 100.6 * u - 148 * v;
-                    db = dy + 517.2 * u;
-                    break;
-                case VectorscopeGenerator::ColorSpace_YPbPr:
-                default:
-                    dr = dy + 357.5 * v;
-                    dg = dy - 87.75 * u - 182 * v;
-                    db = dy + 451.9 * u;
-                    break;
-                }
-
-                if (dr < 0) {
-                    dr = 0;
-                }
-                if (dg < 0) {
-                    dg = 0;
+    // Rows are processed in parallel chunks, each chunk storing the last image pixel index or the hit count of each scope pixel
+    const auto totalPixels = image.width() * image.height();
+    const int chunks = ScopeKernels::chunkCount(totalPixels / accelFactor, image.height());
+    std::vector<std::vector<int>> chunkValues(size_t(chunks));
+    ScopeKernels::forRowChunks(image.height(), chunks, [&](int chunk, int firstRow, int endRow) {
+        std::vector<int> &values = chunkValues[size_t(chunk)];
+        values.assign(scopePixels, lastPixelWins ? -1 : 0);
+        std::vector<QRgb> samples(size_t(image.width()));
+        std::vector<double> u(size_t(image.width()));
+        std::vector<double> v(size_t(image.width()));
+        for (int y = firstRow; y < endRow; ++y) {
+            const auto *line = reinterpret_cast<const QRgb *>(source.constScanLine(y));
+            const int first = ScopeKernels::firstSample(y, image.width(), accelFactor);
+            int count = 0;
+            for (int x = first; x < image.width(); x += int(accelFactor)) {
+                samples[size_t(count++)] = line[x];
+            }
+            ScopeKernels::chromaValues(samples.data(), count, yPbPr, u.data(), v.data());
+            for (int k = 0; k < count; ++k) {
+                const QPoint pt = mapToCircle(vectorscopeSize, QPointF(factor * u[size_t(k)], factor * v[size_t(k)]));
+                if (pt.x() >= scope.width() || pt.x() < 0 || pt.y() >= scope.height() || pt.y() < 0) {
+                    // Point lies outside (because of scaling), don't plot it
+                    continue;
                 }
-                if (db < 0) {
-                    db = 0;
+                int &value = values[size_t(pt.y()) * size_t(scope.width()) + size_t(pt.x())];
+                if (lastPixelWins) {
+                    value = y * image.width() + first + k * int(accelFactor);
+                } else {
+                    value++;
                 }
-                if (dr > 255) {
-                    dr = 255;
+            }
+        }
+    });
+    std::vector<int> &values = chunkValues.front();
+    for (size_t c = 1; c < chunkValues.size(); ++c) {
+        const std::vector<int> &chunkValue = chunkValues[c];
+        for (size_t i = 0; i < scopePixels; ++i) {
+            if (lastPixelWins) {
+                // Later chunks contain later pixels
+                if (chunkValue[i] >= 0) {
+                    values[i] = chunkValue[i];
                 }
-                if (dg > 255) {
-                    dg = 255;
+            } else {
+                values[i] += chunkValue[i];
+            }
+        }
+    }
+
+    double dy, dr, dg, db, dmax;
+    double /*y,*/ u, v;
+    QRgb px;
+    for (int j = 0; j < scope.height(); ++j) {
+        auto *scopeLine = reinterpret_cast<QRgb *>(scope.scanLine(j));
+        const int *lineValues = values.data() + size_t(j) * size_t(scope.width());
+        for (int i = 0; i < scope.width(); ++i) {
+            const int value = lineValues[i];
+            if (lastPixelWins) {
+                if (value < 0) {
+                    continue;
                 }
-                if (db > 255) {
-                    db = 255;
+                QRgb pixel = reinterpret_cast<const QRgb *>(source.constScanLine(value / image.width()))[value % image.width()];
+                if (source.format() == QImage::Format_RGB32) {
+                    // Like QImage::pixel()
+                    pixel |= 0xff000000;
                 }
+                ScopeKernels::chromaValues(&pixel, 1, yPbPr, &u, &v);
+                // Draw the pixel using the chosen draw mode.
+                switch (paintMode) {
+                case PaintMode_YUV:
+                    // see yuvColorWheel
+                    dy = 128; // Default Y value. Lower = darker.
+
+                    // Calculate the RGB values from YUV/YPbPr
+                    switch (colorSpace) {
+                    case VectorscopeGenerator::ColorSpace_YUV:
+                        dr = dy + 290.8 * v;
+                        dg = dy - 100.6 * u - 148 * v;
+                        db = dy + 517.2 * u;
+                        break;
+                    case VectorscopeGenerator::ColorSpace_YPbPr:
+                    default:
+                        dr = dy + 357.5 * v;
+                        dg = dy - 87.75 * u - 182 * v;
+                        db = dy + 451.9 * u;
+                        break;
+                    }
+
+                    if (dr < 0) {
+                        dr = 0;
+                    }
+                    if (dg < 0) {
+                        dg = 0;
+                    }
+                    if (db < 0) {
+                        db = 0;
+                    }
+                    if (dr > 255) {
+                        dr = 255;
+                    }
+                    if (dg > 255) {
+                        dg = 255;
+                    }
+                    if (db > 255) {
+                        db = 255;
+                    }
+
+                    scopeLine[i] = qRgba(int(dr), int(dg), int(db), 255);
+                    break;
 
-                scope.setPixel(pt, qRgba(int(dr), int(dg), int(db), 255));
-                break;
-
-            case PaintMode_Chroma:
-                dy = 200; // Default Y value. Lower = darker.
-
-                // Calculate the RGB values from YUV/YPbPr
-                switch (colorSpace) {
-                case VectorscopeGenerator::ColorSpace_YUV:
-                    dr = dy + 290.8 * v;
-                    dg = dy - 100.6 * u - 148 * v;
-                    db = dy + 517.2 * u;
+                case PaintMode_Chroma:
+                    dy = 200; // Default Y value. Lower = darker.
+
+                    // Calculate the RGB values from YUV/YPbPr
+                    switch (colorSpace) {
+                    case VectorscopeGenerator::ColorSpace_YUV:
+                        dr = dy + 290.8 * v;
+                        dg = dy - 100.6 * u - 148 * v;
+                        db = dy + 517.2 * u;
+                        break;
+                    case VectorscopeGenerator::ColorSpace_YPbPr:
+                    default:
+                        dr = dy + 357.5 * v;
+                        dg = dy - 87.75 * u - 182 * v;
+                        db = dy + 451.9 * u;
+                        break;
+                    }
+
+                    // Scale the RGB values back to max 255
+                    dmax = dr;
+                    if (dg > dmax) {
+                        dmax = dg;
+                    }
+                    if (db > dmax) {
+                        dmax = db;
+                    }
+                    dmax = 255 / dmax;
+
+                    dr *= dmax;
+                    dg *= dmax;
+                    db *= dmax;
+
+                    scopeLine[i] = qRgba(int(dr), int(dg), int(db), 255);
                     break;
-                case VectorscopeGenerator::ColorSpace_YPbPr:
                 default:
-                    dr = dy + 357.5 * v;
-                    dg = dy - 87.75 * u - 182 * v;
-                    db = dy + 451.9 * u;
+                    scopeLine[i] = pixel;
                     break;
                 }
-
-                // Scale the RGB values back to max 255
-                dmax = dr;
-                if (dg > dmax) {
-                    dmax = dg;
+                continue;
+            }
+            // Apply the blending of each hit, stopping early once the color does not change anymore
+            px = scopeLine[i];
+            for (int hit = 0; hit < value; ++hit) {
+                QRgb next;
+                switch (paintMode) {
+                case PaintMode_Green:
+                    next = qRgba(qRed(px) + int((255 - qRed(px)) / (3 * avgPxPerPx)), qGreen(px) + int(20 * (255 - qGreen(px)) / (avgPxPerPx)),
+                                 qBlue(px) + int((255 - qBlue(px)) / (avgPxPerPx)), qAlpha(px) + int((255 - qAlpha(px)) / (avgPxPerPx)));
+                    break;
+                case PaintMode_Green2:
+                    next = qRgba(qRed(px) + int(ceil((255 - qRed(px)) / (4 * avgPxPerPx))), 255, qBlue(px) + int(ceil((255 - qBlue(px)) / (avgPxPerPx))),
+                                 qAlpha(px) + int(ceil((255 - qAlpha(px)) / (avgPxPerPx))));
+                    break;
+                case PaintMode_Black:
+                default:
+                    next = qRgba(0, 0, 0, qAlpha(px) + (255 - qAlpha(px)) / 20);
+                    break;
                 }
-                if (db > dmax) {
-                    dmax = db;
+                if (next == px) {
+                    break;
                 }
-                dmax = 255 / dmax;
-
-                dr *= dmax;
-                dg *= dmax;
-                db *= dmax;
-
-                scope.setPixel(pt, qRgba(int(dr), int(dg), int(db), 255));
-                break;
-            case PaintMode_Original:
-                scope.setPixel(pt, pixel);
-                break;
-            case PaintMode_Green:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(qRed(px) + int((255 - qRed(px)) / (3 * avgPxPerPx)), qGreen(px) + int(20 * (255 - qGreen(px)) / (avgPxPerPx)),
-                                         qBlue(px) + int((255 - qBlue(px)) / (avgPxPerPx)), qAlpha(px) + int((255 - qAlpha(px)) / (avgPxPerPx))));
-                break;
-            case PaintMode_Green2:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(qRed(px) + int(ceil((255 - qRed(px)) / (4 * avgPxPerPx))), 255,
-                                         qBlue(px) + int(ceil((255 - qBlue(px)) / (avgPxPerPx))), qAlpha(px) + int(ceil((255 - qAlpha(px)) / (avgPxPerPx)))));
-                break;
-            case PaintMode_Black:
-            default:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(0, 0, 0, qAlpha(px) + (255 - qAlpha(px)) / 20));
-                break;
+                px = next;
             }
+            scopeLine[i] = px;
         }
     }
     // const auto elapsed = std::chrono::high_resolution_clock::now() - start;
@@ -6,6 +6,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 */
 
 #include "waveformgenerator.h"
+#include "scopekernels.h"
 
 #include <cmath>
 
@@ -14,6 +15,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QImage>
 #include <QPainter>
 #include <QSize>
+#include <functional>
 #include <vector>
 
 #define CHOP255(a) int((255) < (a) ? (255) : (a))
@@ -44,8 +46,6 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QIm
     const uint iw = uint(image.width());
     const auto totalPixels = image.width() * image.height();
 
-    std::vector<std::vector<uint>> waveValues(size_t(waveformSize.width()), std::vector<uint>(size_t(waveformSize.height()), 0));
-
     // Number of input pixels that will fall on one scope pixel.
     // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
     const float pixelDepth = float(totalPixels / accelFactor) / (ww * wh);
@@ -57,54 +57,75 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QIm
     const float hPrediv = (wh - 1) / 255.f;
     const float wPrediv = (ww - 1) / float(iw - 1);
 
-    for (int i = 0; i < totalPixels; i += accelFactor) {
-        const int x = i % image.width();
-        const QRgb pixel = image.pixel(x, i / image.width());
-
-        float dY, dx, dy;
-
-        if (rec == ITURec::Rec_601) {
-            // CIE 601 Luminance
-            dY = REC_601_R * qRed(pixel) + REC_601_G * qGreen(pixel) + REC_601_B * qBlue(pixel);
-        } else {
-            // CIE 709 Luminance
-            dY = REC_709_R * qRed(pixel) + REC_709_G * qGreen(pixel) + REC_709_B * qBlue(pixel);
+    // Rows are processed in parallel chunks, each counting in its own flat buffer indexed by [level * width + column]
+    const QImage source = ScopeKernels::directImage(image);
+    const size_t bufferSize = size_t(ww) * wh;
+    const int chunks = ScopeKernels::chunkCount(totalPixels / accelFactor, image.height());
+    std::vector<std::vector<uint>> chunkValues(size_t(chunks));
+    ScopeKernels::forRowChunks(image.height(), chunks, [&](int chunk, int firstRow, int endRow) {
+        std::vector<uint> &values = chunkValues[size_t(chunk)];
+        values.assign(bufferSize, 0);
+        std::vector<QRgb> samples(size_t(image.width()));
+        std::vector<float> luma(size_t(image.width()));
+        for (int y = firstRow; y < endRow; ++y) {
+            const auto *line = reinterpret_cast<const QRgb *>(source.constScanLine(y));
+            const int first = ScopeKernels::firstSample(y, image.width(), accelFactor);
+            const QRgb *pixels = line + first;
+            int count = 0;
+            if (accelFactor == 1) {
+                count = image.width() - first;
+            } else {
+                for (int x = first; x < image.width(); x += int(accelFactor)) {
+                    samples[size_t(count++)] = line[x];
+                }
+                pixels = samples.data();
+            }
+            // dY is on [0,255]
+            ScopeKernels::lumaValues(pixels, count, rec, luma.data());
+            for (int k = 0; k < count; ++k) {
+                const int x = first + k * int(accelFactor);
+                const float dy = luma[size_t(k)] * hPrediv;
+                const float dx = x * wPrediv;
+                values[size_t(dy) * ww + size_t(dx)]++;
+            }
+        }
+    });
+    std::vector<uint> &waveValues = chunkValues.front();
+    for (size_t c = 1; c < chunkValues.size(); ++c) {
+        const std::vector<uint> &values = chunkValues[c];
+        for (size_t i = 0; i < bufferSize; ++i) {
+            waveValues[i] += values[i];
         }
-        // dY is on [0,255] now.
-
-        dy = dY * hPrediv;
-        dx = x * wPrediv;
-        waveValues[size_t(dx)][size_t(dy)]++;
     }
 
+    // Most scope pixels receive few input pixels, cache the colors of small counts
+    std::function<QRgb(uint)> color;
     switch (paintMode) {
     case PaintMode_Green:
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
-                // Logarithmic scale. Needs fine tuning by hand, but looks great.
-                wave.setPixel(i, waveformSize.height() - j - 1,
-                              qRgba(CHOP255(52 * logf(0.1f * gain * float(waveValues[size_t(i)][size_t(j)]))),
-                                    CHOP255(52 * logf(gain * float(waveValues[size_t(i)][size_t(j)]))),
-                                    CHOP255(52 * logf(.25f * gain * float(waveValues[size_t(i)][size_t(j)]))),
-                                    CHOP255(64 * logf(gain * float(waveValues[size_t(i)][size_t(j)])))));
-            }
-        }
+        color = [gain](uint value) {
+            // Logarithmic scale. Needs fine tuning by hand, but looks great.
+            return qRgba(CHOP255(52 * logf(0.1f * gain * float(value))), CHOP255(52 * logf(gain * float(value))), CHOP255(52 * logf(.25f * gain * float(value))),
+                         CHOP255(64 * logf(gain * float(value))));
+        };
         break;
     case PaintMode_Yellow:
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
-                wave.setPixel(i, waveformSize.height() - j - 1, qRgba(255, 242, 0, CHOP255(gain * float(waveValues[size_t(i)][size_t(j)]))));
-            }
-        }
+        color = [gain](uint value) { return qRgba(255, 242, 0, CHOP255(gain * float(value))); };
         break;
     default:
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
-                wave.setPixel(i, waveformSize.height() - j - 1, qRgba(255, 255, 255, CHOP255(2.f * gain * float(waveValues[size_t(i)][size_t(j)]))));
-            }
-        }
+        color = [gain](uint value) { return qRgba(255, 255, 255, CHOP255(2.f * gain * float(value))); };
         break;
     }
+    QRgb colors[256];
+    for (uint i = 0; i < 256; ++i) {
+        colors[i] = color(i);
+    }
+    for (uint j = 0; j < wh; ++j) {
+        auto *line = reinterpret_cast<QRgb *>(wave.scanLine(int(wh - j - 1)));
+        const uint *values = waveValues.data() + size_t(j) * ww;
+        for (uint i = 0; i < ww; ++i) {
+            line[i] = values[i] < 256 ? colors[values[i]] : color(values[i]);
+        }
+    }
 
     if (drawAxis) {
         QPainter davinci;
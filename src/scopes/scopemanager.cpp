@@ -11,6 +11,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "audioscopes/spectrogram.h"
 #include "colorscopes/histogram.h"
 #include "colorscopes/rgbparade.h"
+#include "colorscopes/scopeframe.h"
 #include "colorscopes/vectorscope.h"
 #include "colorscopes/waveform.h"
 #include "core.h"
@@ -121,15 +122,16 @@ void ScopeManager::slotDistributeAudio(const audioShortVector &sampleData, int f
         }
     }
 }
-void ScopeManager::slotDistributeFrame(const QImage &image)
+void ScopeManager::slotDistributeFrame(const SharedFrame &frame)
 {
 #ifdef DEBUG_SM
     qCDebug(KDENLIVE_LOG) << "ScopeManager: Starting to distribute frame.";
 #endif
+    const auto scopeFrame = std::make_shared<const ScopeFrame>(frame);
     for (auto &m_colorScope : m_colorScopes) {
         if (!m_colorScope.scope->visibleRegion().isEmpty()) {
             if (m_colorScope.scope->autoRefreshEnabled()) {
-                m_colorScope.scope->slotRenderZoneUpdated(image);
+                m_colorScope.scope->slotRenderZoneUpdated(scopeFrame);
 #ifdef DEBUG_SM
                 qCDebug(KDENLIVE_LOG) << "ScopeManager: Distributed frame to " << m_colorScopes[i].scope->widgetName();
 #endif
@@ -137,7 +139,7 @@ void ScopeManager::slotDistributeFrame(const QImage &image)
                 // Special case: Auto refresh is disabled, but user requested an update (e.g. by clicking).
                 // Force the scope to update.
                 m_colorScope.singleFrameRequested = false;
-                m_colorScope.scope->slotRenderZoneUpdated(image);
+                m_colorScope.scope->slotRenderZoneUpdated(scopeFrame);
                 m_colorScope.scope->forceUpdateScope();
 #ifdef DEBUG_SM
                 qCDebug(KDENLIVE_LOG) << "ScopeManager: Distributed forced frame to " << m_colorScopes[i].scope->widgetName();
@@ -201,7 +203,8 @@ void ScopeManager::slotUpdateActiveRenderer()
 
     // Connect new renderer
     if (m_lastConnectedRenderer != nullptr) {
-        connect(m_lastConnectedRenderer, &Monitor::frameUpdated, this, &ScopeManager::slotDistributeFrame, Qt::UniqueConnection);
+        connect(static_cast<Monitor *>(m_lastConnectedRenderer), &Monitor::frameDisplayedForScopes, this, &ScopeManager::slotDistributeFrame,
+                Qt::UniqueConnection);
         connect(m_lastConnectedRenderer, &Monitor::audioSamplesSignal, this, &ScopeManager::slotDistributeAudio, Qt::UniqueConnection);
 
 #ifdef DEBUG_SM
@@ -279,12 +282,12 @@ void ScopeManager::checkActiveColourScopes()
     Monitor *monitor;
     monitor = static_cast<Monitor *>(pCore->monitorManager()->monitor(Kdenlive::ProjectMonitor));
     if (monitor != nullptr) {
-        monitor->sendFrameForAnalysis(imageStillRequested);
+        monitor->sendFrameToScopes(imageStillRequested);
     }
 
     monitor = static_cast<Monitor *>(pCore->monitorManager()->monitor(Kdenlive::ClipMonitor));
     if (monitor != nullptr) {
-        monitor->sendFrameForAnalysis(imageStillRequested);
+        monitor->sendFrameToScopes(imageStillRequested);
     }
 }
 
@@ -9,6 +9,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "audioscopes/abstractaudioscopewidget.h"
 #include "colorscopes/abstractgfxscopewidget.h"
+#include "monitor/scopes/sharedframe.h"
 
 #include <QList>
 
@@ -124,7 +125,8 @@ private slots:
       */
     void checkActiveColourScopes();
 
-    void slotDistributeFrame(const QImage &image);
+    /** @brief Hand the displayed frame to the visible scopes, all of them sharing the same converted image. */
+    void slotDistributeFrame(const SharedFrame &frame);
     void slotDistributeAudio(const audioShortVector &sampleData, int freq, int num_channels, int num_samples);
     /**
       Allows a scope to explicitly request a new frame, even if the scope's autoRefresh is disabled.
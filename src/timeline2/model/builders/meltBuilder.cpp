@@ -20,6 +20,8 @@
 #include <QDebug>
 #include <QProgressDialog>
 #include <QSet>
+#include <algorithm>
+#include <climits>
 #include <mlt++/MltField.h>
 #include <mlt++/MltFilter.h>
 #include <mlt++/MltPlaylist.h>
@@ -31,13 +33,50 @@
 static QStringList m_errorMessage;
 static QStringList m_notesLog;
 
+namespace {
+/** @brief Frame ranges of the same track mixes, sorted by start with the furthest end reached so far,
+    so that the mixes covering a frame are found with a binary search instead of a walk over all compositions */
+class MixRanges
+{
+public:
+    MixRanges() = default;
+    explicit MixRanges(const QList<Mlt::Transition *> &compositions)
+    {
+        m_ranges.reserve(size_t(compositions.size()));
+        for (auto *compo : compositions) {
+            m_ranges.emplace_back(compo->get_in(), compo->get_out());
+        }
+        std::sort(m_ranges.begin(), m_ranges.end());
+        int maxOut = INT_MIN;
+        for (auto &range : m_ranges) {
+            maxOut = qMax(maxOut, range.second);
+            range.second = maxOut;
+        }
+    }
+    /** @brief Returns true if a mix starts at or before @p frame and ends after it */
+    bool coversStart(int frame) const
+    {
+        auto it = std::upper_bound(m_ranges.cbegin(), m_ranges.cend(), std::make_pair(frame, INT_MAX));
+        return it != m_ranges.cbegin() && std::prev(it)->second > frame;
+    }
+    /** @brief Returns true if a mix starts before @p frame and ends at or after it */
+    bool coversEnd(int frame) const
+    {
+        auto it = std::lower_bound(m_ranges.cbegin(), m_ranges.cend(), std::make_pair(frame, INT_MIN));
+        return it != m_ranges.cbegin() && std::prev(it)->second >= frame;
+    }
+
+private:
+    std::vector<std::pair<int, int>> m_ranges;
+};
+} // namespace
+
 bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline, int tid, const QString trackTag, Mlt::Tractor &track,
                             const std::unordered_map<QString, QString> &binIdCorresp, Fun &undo, Fun &redo, bool audioTrack,
                             const QString &originalDecimalPoint, QProgressDialog *progressDialog = nullptr);
 bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline, int tid, const QString trackTag, Mlt::Playlist &track,
                             const std::unordered_map<QString, QString> &binIdCorresp, Fun &undo, Fun &redo, bool audioTrack,
-                            const QString &originalDecimalPoint, int playlist, const QList<Mlt::Transition *> &compositions,
-                            QProgressDialog *progressDialog = nullptr);
+                            const QString &originalDecimalPoint, int playlist, const MixRanges &mixes, QProgressDialog *progressDialog = nullptr);
 
 bool constructTimelineFromMelt(const std::shared_ptr<TimelineItemModel> &timeline, Mlt::Tractor tractor, QProgressDialog *progressDialog,
                                const QString &originalDecimalPoint, const QString &chunks, const QString &dirty, int enablePreview, bool *projectErrors)
@@ -46,6 +85,8 @@ bool constructTimelineFromMelt(const std::shared_ptr<TimelineItemModel> &timelin
     Fun redo = []() { return true; };
     // First, we destruct the previous tracks
     timeline->requestReset(undo, redo);
+    // Insert all items inside a single reset of the view
+    timeline->setBulkLoading(true);
     m_errorMessage.clear();
     m_notesLog.clear();
     std::unordered_map<QString, QString> binIdCorresp;
@@ -161,7 +202,7 @@ bool constructTimelineFromMelt(const std::shared_ptr<TimelineItemModel> &timelin
             }
             const QString trackTag = audioTrack ? QStringLiteral("A%1").arg(aTracksCount - aTracks) : QStringLiteral("V%1").arg(vTracks);
             ok = ok && constructTrackFromMelt(timeline, tid, trackTag, local_playlist, binIdCorresp, undo, redo, audioTrack, originalDecimalPoint, 0,
-                                              QList<Mlt::Transition *>(), progressDialog);
+                                              MixRanges(), progressDialog);
             if (local_playlist.get_int("kdenlive:locked_track") > 0) {
                 lockedTracksIndexes << tid;
             }
@@ -174,7 +215,6 @@ bool constructTimelineFromMelt(const std::shared_ptr<TimelineItemModel> &timelin
             qWarning() << "Unexpected track type" << track->type();
         }
     }
-    timeline->_resetView();
 
     // Loading compositions
     QScopedPointer<Mlt::Service> service(tractor.producer());
@@ -255,6 +295,7 @@ bool constructTimelineFromMelt(const std::shared_ptr<TimelineItemModel> &timelin
 
     // build internal track compositing
     timeline->buildTrackCompositing();
+    timeline->setBulkLoading(false);
 
     // load locked state as last step
     for (int tid : qAsConst(lockedTracksIndexes)) {
@@ -308,6 +349,7 @@ bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline,
         }
         service.reset(service->producer());
     }
+    const MixRanges mixes(compositions);
     for (int i = 0; i < track.count(); i++) {
         std::unique_ptr<Mlt::Producer> sub_track(track.track(i));
         if (sub_track->type() != mlt_service_playlist_type) {
@@ -315,7 +357,7 @@ bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline,
             return false;
         }
         Mlt::Playlist playlist(*sub_track);
-        constructTrackFromMelt(timeline, tid, trackTag, playlist, binIdCorresp, undo, redo, audioTrack, originalDecimalPoint, i, compositions, progressDialog);
+        constructTrackFromMelt(timeline, tid, trackTag, playlist, binIdCorresp, undo, redo, audioTrack, originalDecimalPoint, i, mixes, progressDialog);
         if (i == 0) {
             // Pass track properties
             int height = track.get_int("kdenlive:trackheight");
@@ -410,8 +452,9 @@ PlaylistState::ClipState inferState(const std::shared_ptr<Mlt::Producer> &prod,
 
 bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline, int tid, const QString trackTag, Mlt::Playlist &track,
                             const std::unordered_map<QString, QString> &binIdCorresp, Fun &undo, Fun &redo, bool audioTrack,
-                            const QString &originalDecimalPoint, int playlist, const QList<Mlt::Transition *> &compositions, QProgressDialog *progressDialog)
+                            const QString &originalDecimalPoint, int playlist, const MixRanges &mixes, QProgressDialog *progressDialog)
 {
+    // The view is reset once the timeline is loaded, no need to refresh it for each clip
     int max = track.count();
     for (int i = 0; i < max; i++) {
         if (track.is_blank(i)) {
@@ -477,22 +520,9 @@ bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline,
                     bool hasStartMix = !timeline->trackIsBlankAt(tid, position, 0);
                     int duration = clip->get_playtime() - 1;
                     bool hasEndMix = !timeline->trackIsBlankAt(tid, position + duration, 0);
-                    bool startMixToFind = hasStartMix;
-                    bool endMixToFind = hasEndMix;
-                    if (startMixToFind || endMixToFind) {
-                        for (auto &compo : compositions) {
-                            int in = compo->get_in();
-                            int out = compo->get_out();
-                            if (startMixToFind && out > position && in <= position) {
-                                startMixToFind = false;
-                            }
-                            if (endMixToFind && in < position + duration && out >= position + duration) {
-                                endMixToFind = false;
-                            }
-                            if (!startMixToFind && !endMixToFind) {
-                                break;
-                            }
-                        }
+                    bool startMixToFind = hasStartMix && !mixes.coversStart(position);
+                    bool endMixToFind = hasEndMix && !mixes.coversEnd(position + duration);
+                    if (hasStartMix || hasEndMix) {
                         if (startMixToFind || endMixToFind) {
                             // A mix for this clip is missing
                             QString tcInfo = QString("<a href=\"%1?%2\">%3 %4</a>")
@@ -511,7 +541,7 @@ bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline,
                                     if (!startMixToFind) {
                                         // Move to top playlist
                                         cid = ClipModel::construct(timeline, binId, clip, st, tid, originalDecimalPoint, hasStartMix ? playlist : 0);
-                                        timeline->requestClipMove(cid, tid, position, true, true, false, true, undo, redo);
+                                        timeline->requestClipMove(cid, tid, position, true, false, false, true, undo, redo);
                                         m_notesLog << i18n("%1 Clip (%2) with missing mix found and resized", tcInfo, clip->parent().get("id"));
                                         m_errorMessage << i18n("Clip without mix %1 found and resized on track %2 at %3.", clip->parent().get("id"), trackTag,
                                                                pCore->timecode().getTimecodeFromFrames(position));
@@ -535,7 +565,7 @@ bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline,
                                     clip->set_in_and_out(currentIn, currentOut);
                                     // Move to top playlist
                                     cid = ClipModel::construct(timeline, binId, clip, st, tid, originalDecimalPoint, hasEndMix ? playlist : 0);
-                                    ok = timeline->requestClipMove(cid, tid, position, true, true, false, true, undo, redo);
+                                    ok = timeline->requestClipMove(cid, tid, position, true, false, false, true, undo, redo);
                                     if (!ok && cid > -1) {
                                         timeline->requestItemDeletion(cid, false);
                                         m_errorMessage << i18n("Invalid clip %1 found on track %2 at %3.", clip->parent().get("id"), track.get("id"),
@@ -576,7 +606,7 @@ bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline,
                     }
                 }
                 cid = ClipModel::construct(timeline, binId, clip, st, tid, originalDecimalPoint, enforceTopPlaylist ? 0 : playlist);
-                ok = timeline->requestClipMove(cid, tid, position, true, true, false, true, undo, redo);
+                ok = timeline->requestLoadedClipInsertion(cid, tid, position, undo, redo);
             } else {
                 qWarning() << "can't find bin clip" << binId << clip->get("id");
             }
@@ -114,6 +114,7 @@ bool CompositionModel::requestResize(int size, bool right, Fun &undo, Fun &redo,
                 result.append(QStringLiteral(";-1="));
                 result.append(animation.section(QLatin1Char('='), -1));
                 m_asset->set("rect", result.toUtf8().constData());
+                invalidateValues();
             }
             return true;
         };
@@ -129,6 +130,7 @@ bool CompositionModel::requestResize(int size, bool right, Fun &undo, Fun &redo,
                 } else {
                     m_asset->set("geometry", "0=0% 0% 100% 100% 100%;-1=0% 0% 100% 100% 0%");
                 }
+                invalidateValues();
             }
             return true;
         };
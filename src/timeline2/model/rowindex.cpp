@@ -0,0 +1,110 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "rowindex.hpp"
+#include <algorithm>
+
+size_t RowIndex::blockFor(int id) const
+{
+    // First block whose last id is not below id, or the last block
+    auto it = std::lower_bound(m_blocks.begin(), m_blocks.end(), id, [](const std::vector<int> &block, int value) { return block.back() < value; });
+    if (it == m_blocks.end()) {
+        return m_blocks.size() - 1;
+    }
+    return size_t(std::distance(m_blocks.begin(), it));
+}
+
+void RowIndex::shiftOffsets(size_t index, int delta)
+{
+    for (size_t i = index + 1; i < m_offsets.size(); ++i) {
+        m_offsets[i] += delta;
+    }
+}
+
+void RowIndex::insert(int id)
+{
+    if (m_blocks.empty()) {
+        m_blocks.push_back({id});
+        m_offsets.push_back(0);
+        m_size = 1;
+        return;
+    }
+    size_t index = blockFor(id);
+    std::vector<int> &block = m_blocks[index];
+    auto it = std::lower_bound(block.begin(), block.end(), id);
+    if (it != block.end() && *it == id) {
+        return;
+    }
+    block.insert(it, id);
+    m_size++;
+    shiftOffsets(index, 1);
+    if (int(block.size()) >= 2 * BlockSize) {
+        std::vector<int> upper(block.begin() + BlockSize, block.end());
+        block.resize(BlockSize);
+        m_blocks.insert(m_blocks.begin() + long(index) + 1, std::move(upper));
+        m_offsets.insert(m_offsets.begin() + long(index) + 1, m_offsets[index] + BlockSize);
+    }
+}
+
+void RowIndex::remove(int id)
+{
+    if (m_blocks.empty()) {
+        return;
+    }
+    size_t index = blockFor(id);
+    std::vector<int> &block = m_blocks[index];
+    auto it = std::lower_bound(block.begin(), block.end(), id);
+    if (it == block.end() || *it != id) {
+        return;
+    }
+    block.erase(it);
+    m_size--;
+    shiftOffsets(index, -1);
+    if (block.empty()) {
+        m_blocks.erase(m_blocks.begin() + long(index));
+        m_offsets.erase(m_offsets.begin() + long(index));
+    }
+}
+
+bool RowIndex::contains(int id) const
+{
+    return indexOf(id) > -1;
+}
+
+int RowIndex::at(int row) const
+{
+    if (row < 0 || row >= m_size) {
+        return -1;
+    }
+    // Last block starting at or before row
+    auto it = std::upper_bound(m_offsets.begin(), m_offsets.end(), row) - 1;
+    const size_t index = size_t(std::distance(m_offsets.begin(), it));
+    return m_blocks[index][size_t(row - *it)];
+}
+
+int RowIndex::indexOf(int id) const
+{
+    if (m_blocks.empty()) {
+        return -1;
+    }
+    size_t index = blockFor(id);
+    const std::vector<int> &block = m_blocks[index];
+    auto it = std::lower_bound(block.begin(), block.end(), id);
+    if (it == block.end() || *it != id) {
+        return -1;
+    }
+    return m_offsets[index] + int(std::distance(block.begin(), it));
+}
+
+int RowIndex::size() const
+{
+    return m_size;
+}
+
+void RowIndex::clear()
+{
+    m_blocks.clear();
+    m_offsets.clear();
+    m_size = 0;
+}
@@ -0,0 +1,45 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/** @class RowIndex
+    @brief Sorted set of item ids giving the row of an id and the id at a row.
+
+    The ids are stored in sorted blocks of bounded size, so that inserting or removing an id
+    only moves the content of one block instead of the whole list. The first row of each
+    block is kept, so that row lookups are binary searches over the blocks.
+ */
+class RowIndex
+{
+public:
+    /** @brief Inserts @p id, does nothing if it is already present */
+    void insert(int id);
+    /** @brief Removes @p id, does nothing if it is not present */
+    void remove(int id);
+    bool contains(int id) const;
+    /** @brief Returns the id at @p row, or -1 if the row does not exist */
+    int at(int row) const;
+    /** @brief Returns the row of @p id, or -1 if it is not present */
+    int indexOf(int id) const;
+    int size() const;
+    void clear();
+
+private:
+    /** @brief A block is split in two once it reaches twice this size */
+    static const int BlockSize = 128;
+    std::vector<std::vector<int>> m_blocks;
+    /** @brief Row of the first id of each block */
+    std::vector<int> m_offsets;
+    int m_size = 0;
+
+    /** @brief Returns the index of the block that holds or would hold @p id */
+    size_t blockFor(int id) const;
+    /** @brief Adds @p delta to the first row of the blocks after @p index */
+    void shiftOffsets(size_t index, int delta);
+};
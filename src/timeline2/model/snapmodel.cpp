@@ -4,46 +4,187 @@
 */
 #include "snapmodel.hpp"
 #include <QDebug>
+#include <algorithm>
 #include <climits>
 #include <cstdlib>
 
 SnapInterface::SnapInterface() = default;
 SnapInterface::~SnapInterface() = default;
 
+void SnapInterface::addPoints(const std::vector<int> &positions)
+{
+    for (int position : positions) {
+        addPoint(position);
+    }
+}
+
 SnapModel::SnapModel() = default;
 
+namespace {
+bool positionLess(const std::pair<int, int> &entry, int position)
+{
+    return entry.first < position;
+}
+} // namespace
+
+int SnapModel::mergeThreshold() const
+{
+    return 64 + int(m_snaps.size()) / 16;
+}
+
 void SnapModel::addPoint(int position)
 {
-    if (m_snaps.count(position) == 0) {
-        m_snaps[position] = 1;
-    } else {
-        m_snaps[position]++;
+    auto it = std::lower_bound(m_snaps.begin(), m_snaps.end(), position, positionLess);
+    if (it != m_snaps.end() && it->first == position) {
+        // Usually a point removed and added back while an item moves
+        if (it->second++ == 0) {
+            m_emptyEntries--;
+        }
+        return;
+    }
+    auto recent = std::lower_bound(m_recent.begin(), m_recent.end(), position, positionLess);
+    if (recent != m_recent.end() && recent->first == position) {
+        recent->second++;
+        return;
+    }
+    m_recent.emplace(recent, position, 1);
+    if (int(m_recent.size()) > mergeThreshold()) {
+        merge();
     }
 }
 
 void SnapModel::removePoint(int position)
 {
-    Q_ASSERT(m_snaps.count(position) > 0);
-    if (m_snaps[position] == 1) {
-        m_snaps.erase(position);
-    } else {
-        m_snaps[position]--;
+    auto it = std::lower_bound(m_snaps.begin(), m_snaps.end(), position, positionLess);
+    if (it != m_snaps.end() && it->first == position && it->second > 0) {
+        if (--it->second == 0) {
+            m_emptyEntries++;
+            if (m_emptyEntries > mergeThreshold()) {
+                merge();
+            }
+        }
+        return;
+    }
+    auto recent = std::lower_bound(m_recent.begin(), m_recent.end(), position, positionLess);
+    if (recent == m_recent.end() || recent->first != position) {
+        Q_ASSERT(false);
+        return;
+    }
+    if (--recent->second == 0) {
+        m_recent.erase(recent);
     }
 }
 
-int SnapModel::getClosestPoint(int position)
+void SnapModel::addPoints(const std::vector<int> &positions)
 {
-    if (m_snaps.empty()) {
-        return -1;
+    if (int(positions.size()) <= mergeThreshold()) {
+        for (int position : positions) {
+            addPoint(position);
+        }
+        return;
     }
-    auto it = m_snaps.lower_bound(position);
-    long long int prev = INT_MIN, next = INT_MAX;
-    if (it != m_snaps.end()) {
-        next = (*it).first;
+    // Many points, sort them once and merge everything in one pass
+    std::vector<std::pair<int, int>> added;
+    added.reserve(positions.size());
+    for (int position : positions) {
+        added.emplace_back(position, 1);
+    }
+    std::sort(added.begin(), added.end());
+    const auto middle = m_recent.insert(m_recent.end(), added.begin(), added.end());
+    std::inplace_merge(m_recent.begin(), middle, m_recent.end());
+    merge();
+}
+
+void SnapModel::removePoints(const std::vector<int> &positions)
+{
+    for (int position : positions) {
+        removePoint(position);
+    }
+}
+
+void SnapModel::merge()
+{
+    std::vector<std::pair<int, int>> merged;
+    merged.reserve(m_snaps.size() + m_recent.size());
+    auto it = m_snaps.cbegin();
+    auto recent = m_recent.cbegin();
+    while (it != m_snaps.cend() || recent != m_recent.cend()) {
+        int position = (recent == m_recent.cend() || (it != m_snaps.cend() && it->first <= recent->first)) ? it->first : recent->first;
+        int count = 0;
+        if (it != m_snaps.cend() && it->first == position) {
+            count += it->second;
+            ++it;
+        }
+        while (recent != m_recent.cend() && recent->first == position) {
+            count += recent->second;
+            ++recent;
+        }
+        if (count > 0) {
+            merged.emplace_back(position, count);
+        }
     }
-    if (it != m_snaps.begin()) {
-        --it;
-        prev = (*it).first;
+    m_snaps.swap(merged);
+    m_recent.clear();
+    m_emptyEntries = 0;
+}
+
+int SnapModel::available(const std::pair<int, int> &entry) const
+{
+    if (m_ignore.empty()) {
+        return entry.second;
+    }
+    auto range = std::equal_range(m_ignore.cbegin(), m_ignore.cend(), entry.first);
+    return entry.second - int(std::distance(range.first, range.second));
+}
+
+std::map<int, int> SnapModel::_snaps()
+{
+    std::map<int, int> snaps;
+    for (const auto *entries : {&m_snaps, &m_recent}) {
+        for (const auto &entry : *entries) {
+            int count = available(entry);
+            if (count > 0) {
+                snaps[entry.first] += count;
+            }
+        }
+    }
+    return snaps;
+}
+
+void SnapModel::closestPoints(const std::vector<std::pair<int, int>> &entries, int position, int maxDistance, long long &prev, long long &next) const
+{
+    auto it = std::lower_bound(entries.cbegin(), entries.cend(), position, positionLess);
+    // Only ignored and removed points are skipped, so these loops stay short
+    for (auto n = it; n != entries.cend() && n->first - (long long)position <= maxDistance && n->first < next; ++n) {
+        if (available(*n) > 0) {
+            next = n->first;
+            break;
+        }
+    }
+    for (auto p = it; p != entries.cbegin();) {
+        --p;
+        if ((long long)position - p->first > maxDistance || p->first <= prev) {
+            break;
+        }
+        if (available(*p) > 0) {
+            prev = p->first;
+            break;
+        }
+    }
+}
+
+int SnapModel::getClosestPoint(int position)
+{
+    return getClosestPoint(position, INT_MAX);
+}
+
+int SnapModel::getClosestPoint(int position, int maxDistance)
+{
+    long long int prev = INT_MIN, next = INT_MAX;
+    closestPoints(m_snaps, position, maxDistance, prev, next);
+    closestPoints(m_recent, position, maxDistance, prev, next);
+    if (prev == INT_MIN && next == INT_MAX) {
+        return -1;
     }
     if (std::llabs(position - prev) < std::llabs(position - next)) {
         return int(prev);
@@ -51,46 +192,63 @@ int SnapModel::getClosestPoint(int position)
     return int(next);
 }
 
-int SnapModel::getNextPoint(int position)
+std::vector<int> SnapModel::getPoints(int from, int to)
 {
-    if (m_snaps.empty()) {
-        return position;
+    std::vector<int> points;
+    for (const auto *entries : {&m_snaps, &m_recent}) {
+        const auto middle = points.size();
+        for (auto it = std::lower_bound(entries->cbegin(), entries->cend(), from, positionLess); it != entries->cend() && it->first <= to; ++it) {
+            if (available(*it) > 0) {
+                points.push_back(it->first);
+            }
+        }
+        // Both lists are sorted and don't share positions
+        std::inplace_merge(points.begin(), points.begin() + long(middle), points.end());
     }
-    auto it = m_snaps.lower_bound(position + 1);
-    long long int next = position;
-    if (it != m_snaps.end()) {
-        next = (*it).first;
+    return points;
+}
+
+int SnapModel::getNextPoint(int position)
+{
+    long long int next = INT_MAX;
+    for (const auto *entries : {&m_snaps, &m_recent}) {
+        for (auto it = std::lower_bound(entries->cbegin(), entries->cend(), position + 1, positionLess); it != entries->cend() && it->first < next; ++it) {
+            if (available(*it) > 0) {
+                next = it->first;
+                break;
+            }
+        }
     }
-    return int(next);
+    return next == INT_MAX ? position : int(next);
 }
 
 int SnapModel::getPreviousPoint(int position)
 {
-    if (m_snaps.empty()) {
-        return 0;
-    }
-    auto it = m_snaps.lower_bound(position);
-    long long int prev = 0;
-    if (it != m_snaps.begin()) {
-        --it;
-        prev = (*it).first;
+    long long int prev = INT_MIN;
+    for (const auto *entries : {&m_snaps, &m_recent}) {
+        for (auto it = std::lower_bound(entries->cbegin(), entries->cend(), position, positionLess); it != entries->cbegin();) {
+            --it;
+            if (it->first <= prev) {
+                break;
+            }
+            if (available(*it) > 0) {
+                prev = it->first;
+                break;
+            }
+        }
     }
-    return int(prev);
+    return prev == INT_MIN ? 0 : int(prev);
 }
 
 void SnapModel::ignore(const std::vector<int> &pts)
 {
-    for (int pt : pts) {
-        removePoint(pt);
-        m_ignore.push_back(pt);
-    }
+    const auto middle = m_ignore.insert(m_ignore.end(), pts.begin(), pts.end());
+    std::sort(middle, m_ignore.end());
+    std::inplace_merge(m_ignore.begin(), middle, m_ignore.end());
 }
 
 void SnapModel::unIgnore()
 {
-    for (const auto &pt : m_ignore) {
-        addPoint(pt);
-    }
     m_ignore.clear();
 }
 
@@ -100,14 +258,14 @@ int SnapModel::proposeSize(int in, int out, int size, bool right, int maxSnapDis
     int proposed_size = -1;
     if (right) {
         int target_pos = in + size - 1;
-        int snapped_pos = getClosestPoint(target_pos);
-        if (snapped_pos != -1 && qAbs(target_pos - snapped_pos) <= maxSnapDist) {
+        int snapped_pos = getClosestPoint(target_pos, maxSnapDist);
+        if (snapped_pos != -1) {
             proposed_size = snapped_pos - in;
         }
     } else {
         int target_pos = out + 1 - size;
-        int snapped_pos = getClosestPoint(target_pos);
-        if (snapped_pos != -1 && qAbs(target_pos - snapped_pos) <= maxSnapDist) {
+        int snapped_pos = getClosestPoint(target_pos, maxSnapDist);
+        if (snapped_pos != -1) {
             proposed_size = out - snapped_pos;
         }
     }
@@ -121,14 +279,14 @@ int SnapModel::proposeSize(int in, int out, const std::vector<int> &boundaries,
     int proposed_size = -1;
     if (right) {
         int target_pos = in + size - 1;
-        int snapped_pos = getClosestPoint(target_pos);
-        if (snapped_pos != -1 && qAbs(target_pos - snapped_pos) <= maxSnapDist) {
+        int snapped_pos = getClosestPoint(target_pos, maxSnapDist);
+        if (snapped_pos != -1) {
             proposed_size = snapped_pos - in;
         }
     } else {
         int target_pos = out + 1 - size;
-        int snapped_pos = getClosestPoint(target_pos);
-        if (snapped_pos != -1 && qAbs(target_pos - snapped_pos) <= maxSnapDist) {
+        int snapped_pos = getClosestPoint(target_pos, maxSnapDist);
+        if (snapped_pos != -1) {
             proposed_size = out - snapped_pos;
         }
     }
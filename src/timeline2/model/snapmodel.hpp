@@ -22,11 +22,20 @@ public:
 
     /** @brief Removes a snappoint from given position */
     virtual void removePoint(int position) = 0;
+
+    /** @brief Adds several snappoints at once */
+    virtual void addPoints(const std::vector<int> &positions);
 };
 
 /** @class SnapModel
     @brief This class represents the snap points of the timeline.
     Basically, one can add or remove snap points, and query the closest snap point to a given location
+
+    The points are stored in a flat sorted vector. Removed points only decrement their count, and
+    a point added back at a known position increments it, so moving an item does not shift the
+    vector. Points at new positions go to a small sorted vector that the queries search as well,
+    it is merged in the main one once it grows past a fraction of its size. Ignored points are
+    kept aside and skipped by the queries instead of being removed.
  */
 class SnapModel : public virtual SnapInterface
 {
@@ -39,9 +48,21 @@ public:
     /** @brief Removes a snappoint from given position */
     void removePoint(int position) override;
 
+    /** @brief Adds several snappoints at once */
+    void addPoints(const std::vector<int> &positions) override;
+
+    /** @brief Removes several snappoints at once */
+    void removePoints(const std::vector<int> &positions);
+
     /** @brief Retrieves closest point. Returns -1 if there is no snappoint available */
     int getClosestPoint(int position);
 
+    /** @brief Retrieves the closest point at most @p maxDistance frames away. Returns -1 if there is none */
+    int getClosestPoint(int position, int maxDistance);
+
+    /** @brief Retrieves the snappoints in the range [from, to], without duplicates */
+    std::vector<int> getPoints(int from, int to);
+
     /** @brief Retrieves next snap point. Returns position if there is no snappoint available */
     int getNextPoint(int position);
 
@@ -50,7 +71,7 @@ public:
 
     /** @brief Ignores the given positions until unIgnore() is called
        You can make several call to this before unIgnoring
-       Note that you cannot remove ignored points.
+       Each position hides one snappoint at this position, the points themselves are not modified.
        @param points list of point to ignore
      */
     void ignore(const std::vector<int> &pts);
@@ -70,12 +91,26 @@ public:
     int proposeSize(int in, int out, const std::vector<int> &boundaries, int size, bool right, int maxSnapDist);
 
     // For testing only
-    std::map<int, int> _snaps() { return m_snaps; }
+    std::map<int, int> _snaps();
 
 private:
-    /** This represents the snappoints internally. The keys are the positions and the values are the number of elements at this
-     * position. Note that it is important that the datastructure is ordered. QMap is NOT ordered, and therefore not suitable.
+    /** This represents the snappoints internally. Each entry is a position and the number of elements at this
+     * position, sorted by position. Entries whose count dropped to 0 are kept until the next merge().
      */
-    std::map<int, int> m_snaps;
+    std::vector<std::pair<int, int>> m_snaps;
+    /** Entries added since the last merge(), sorted, at positions that are not in m_snaps */
+    std::vector<std::pair<int, int>> m_recent;
+    /** Number of entries of m_snaps whose count is 0 */
+    int m_emptyEntries{0};
+    /** Sorted ignored positions, a position appears once per ignored point */
     std::vector<int> m_ignore;
+
+    /** @brief Number of recent or empty entries above which they are merged in m_snaps */
+    int mergeThreshold() const;
+    /** @brief Merge the recent entries and drop the empty ones */
+    void merge();
+    /** @brief Narrow @p prev and @p next to the closest available points of @p entries around @p position */
+    void closestPoints(const std::vector<std::pair<int, int>> &entries, int position, int maxDistance, long long &prev, long long &next) const;
+    /** @brief Number of points available at an entry, once the ignored points are hidden */
+    int available(const std::pair<int, int> &entry) const;
 };
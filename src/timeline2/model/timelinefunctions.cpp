@@ -1610,7 +1610,8 @@ bool TimelineFunctions::pasteClips(const std::shared_ptr<TimelineItemModel> &tim
     std::function<bool(void)> undo = []() { return true; };
     std::function<bool(void)> redo = []() { return true; };
     if (TimelineFunctions::pasteClips(timeline, pasteString, trackId, position, undo, redo)) {
-        pCore->pushUndo(undo, redo, i18n("Paste clips"));
+        // The pasted clips are kept alive by the undo functions
+        pCore->pushUndo(undo, redo, i18n("Paste clips"), pasteString.size() * qint64(sizeof(QChar)));
         return true;
     }
     return false;
@@ -634,6 +634,9 @@ bool TimelineItemModel::loadGroups(const QString &groupsData)
 
 void TimelineItemModel::notifyChange(const QModelIndex &topleft, const QModelIndex &bottomright, bool start, bool duration, bool updateThumb)
 {
+    if (m_bulkLoading) {
+        return;
+    }
     QVector<int> roles;
     if (start) {
         roles.push_back(TimelineModel::StartRole);
@@ -652,6 +655,9 @@ void TimelineItemModel::notifyChange(const QModelIndex &topleft, const QModelInd
 
 void TimelineItemModel::notifyChange(const QModelIndex &topleft, const QModelIndex &bottomright, const QVector<int> &roles)
 {
+    if (m_bulkLoading) {
+        return;
+    }
     emit dataChanged(topleft, bottomright, roles);
 }
 
@@ -720,32 +726,61 @@ void TimelineItemModel::buildTrackCompositing(bool rebuild)
 
 void TimelineItemModel::notifyChange(const QModelIndex &topleft, const QModelIndex &bottomright, int role)
 {
+    if (m_bulkLoading) {
+        return;
+    }
     emit dataChanged(topleft, bottomright, {role});
 }
 
 void TimelineItemModel::_beginRemoveRows(const QModelIndex &i, int j, int k)
 {
     // qDebug()<<"FORWARDING beginRemoveRows"<<i<<j<<k;
+    if (m_bulkLoading) {
+        // The view is reset at the end of the loading
+        return;
+    }
     beginRemoveRows(i, j, k);
 }
 void TimelineItemModel::_beginInsertRows(const QModelIndex &i, int j, int k)
 {
     // qDebug()<<"FORWARDING beginInsertRows"<<i<<j<<k;
+    if (m_bulkLoading) {
+        return;
+    }
     beginInsertRows(i, j, k);
 }
 void TimelineItemModel::_endRemoveRows()
 {
     // qDebug()<<"FORWARDING endRemoveRows";
+    if (m_bulkLoading) {
+        return;
+    }
     endRemoveRows();
 }
 void TimelineItemModel::_endInsertRows()
 {
     // qDebug()<<"FORWARDING endinsertRows";
+    if (m_bulkLoading) {
+        return;
+    }
     endInsertRows();
 }
 
 void TimelineItemModel::_resetView()
+{
+    if (m_bulkLoading) {
+        return;
+    }
+    beginResetModel();
+    endResetModel();
+}
+
+void TimelineItemModel::_beginResetView()
 {
     beginResetModel();
+}
+
+void TimelineItemModel::_endResetView()
+{
     endResetModel();
 }
@@ -124,6 +124,7 @@ TimelineModel::TimelineModel(Mlt::Profile *profile, std::weak_ptr<DocUndoStack>
     , m_videoTarget(-1)
     , m_editMode(TimelineMode::NormalEdit)
     , m_closing(false)
+    , m_bulkLoading(false)
 {
     // Create black background track
     m_blackClip->set("id", "black_track");
@@ -1954,6 +1955,31 @@ bool TimelineModel::requestClipInsertion(const QString &binClipId, int trackId,
     return true;
 }
 
+qint64 TimelineModel::undoMemoryEstimate(int itemId) const
+{
+    READ_LOCK();
+    qint64 memory = 0;
+    if (isGroup(itemId)) {
+        for (int id : m_groups->getLeaves(itemId)) {
+            memory += undoMemoryEstimate(id);
+        }
+    } else if (isClip(itemId)) {
+        memory = UndoMemory::TimelineItem + m_allClips.at(itemId)->m_effectStack->memoryEstimate();
+    } else if (isComposition(itemId)) {
+        memory = UndoMemory::TimelineItem + m_allCompositions.at(itemId)->memoryEstimate();
+    } else if (isTrack(itemId)) {
+        std::shared_ptr<TrackModel> track = getTrackById_const(itemId);
+        memory = UndoMemory::TimelineItem + track->m_effectStack->memoryEstimate();
+        for (const auto &clip : track->m_allClips) {
+            memory += undoMemoryEstimate(clip.first);
+        }
+        for (const auto &compo : track->m_allCompositions) {
+            memory += undoMemoryEstimate(compo.first);
+        }
+    }
+    return memory;
+}
+
 bool TimelineModel::requestItemDeletion(int itemId, Fun &undo, Fun &redo, bool logUndo)
 {
     QWriteLocker locker(&m_lock);
@@ -1992,9 +2018,11 @@ bool TimelineModel::requestItemDeletion(int itemId, bool logUndo)
     }
     Fun undo = []() { return true; };
     Fun redo = []() { return true; };
+    // The deleted items are kept alive by the undo functions
+    qint64 memory = logUndo ? undoMemoryEstimate(m_groups->isInGroup(itemId) ? m_groups->getRootId(itemId) : itemId) : 0;
     bool res = requestItemDeletion(itemId, undo, redo, logUndo);
     if (res && logUndo) {
-        PUSH_UNDO(undo, redo, actionLabel);
+        PUSH_UNDO_MEMORY(undo, redo, actionLabel, memory);
     }
     TRACE_RES(res);
     return res;
@@ -4123,6 +4151,10 @@ bool TimelineModel::requestTrackInsertion(int position, int &id, const QString &
     };
 
     Fun local_name_update = [position, audioTrack, this]() {
+        if (m_bulkLoading) {
+            // The view is reset at the end of the loading
+            return true;
+        }
         if (KdenliveSettings::audiotracksbelow() == 0) {
             _resetView();
         } else {
@@ -4178,6 +4210,7 @@ bool TimelineModel::requestTrackDeletion(int trackId)
     TRACE(trackId);
     Fun undo = []() { return true; };
     Fun redo = []() { return true; };
+    qint64 memory = undoMemoryEstimate(trackId);
     bool result = requestTrackDeletion(trackId, undo, redo);
     if (result) {
         if (m_videoTarget == trackId) {
@@ -4186,7 +4219,7 @@ bool TimelineModel::requestTrackDeletion(int trackId)
         if (m_audioTarget.contains(trackId)) {
             m_audioTarget.remove(trackId);
         }
-        PUSH_UNDO(undo, redo, i18n("Delete Track"));
+        PUSH_UNDO_MEMORY(undo, redo, i18n("Delete Track"), memory);
     }
     TRACE_RES(result);
     return result;
@@ -4582,7 +4615,7 @@ bool TimelineModel::isGroup(int id) const
 
 void TimelineModel::updateDuration()
 {
-    if (m_closing) {
+    if (m_closing || m_bulkLoading) {
         return;
     }
     int current = m_blackClip->get_playtime() - TimelineModel::seekDuration;
@@ -4604,6 +4637,31 @@ void TimelineModel::updateDuration()
     }
 }
 
+void TimelineModel::setBulkLoading(bool loading)
+{
+    if (loading == m_bulkLoading) {
+        return;
+    }
+    if (loading) {
+        // The view must not query the model while rows are inserted without notification
+        _beginResetView();
+        m_bulkLoading = true;
+    } else {
+        m_bulkLoading = false;
+        updateDuration();
+        _endResetView();
+    }
+}
+
+bool TimelineModel::requestLoadedClipInsertion(int clipId, int trackId, int position, Fun &undo, Fun &redo)
+{
+    Q_ASSERT(isClip(clipId) && getClipTrackId(clipId) == -1);
+    if (!isTrack(trackId)) {
+        return false;
+    }
+    return getTrackById(trackId)->requestClipInsertion(clipId, position, false, true, undo, redo);
+}
+
 int TimelineModel::duration() const
 {
     int duration = 0;
@@ -4668,6 +4726,26 @@ int TimelineModel::suggestSnapPoint(int pos, int snapDistance)
     return (qAbs(snapped - pos) < snapDistance ? snapped : pos);
 }
 
+int TimelineModel::getClosestCut(int pos, int maxDistance)
+{
+    READ_LOCK();
+    // Snap points also contain guides, markers and the zone, only clip boundaries are cuts
+    int best = -1;
+    for (const auto &clip : m_allClips) {
+        const int trackId = clip.second->getCurrentTrackId();
+        if (trackId == -1 || getTrackById_const(trackId)->isAudioTrack()) {
+            continue;
+        }
+        const int start = clip.second->getPosition();
+        for (int cut : {start, start + clip.second->getPlaytime()}) {
+            if (qAbs(cut - pos) <= maxDistance && (best == -1 || qAbs(cut - pos) < qAbs(best - pos))) {
+                best = cut;
+            }
+        }
+    }
+    return best;
+}
+
 int TimelineModel::getBestSnapPos(int referencePos, int diff, std::vector<int> pts, int cursorPosition, int snapDistance)
 {
     if (!pts.empty()) {
@@ -4684,7 +4762,11 @@ int TimelineModel::getBestSnapPos(int referencePos, int diff, std::vector<int> p
     int closest = -1;
     int lowestDiff = snapDistance + 1;
     for (int point : pts) {
-        int snapped = m_snaps->getClosestPoint(point + diff);
+        // Only look for points closer than the best match so far
+        int snapped = m_snaps->getClosestPoint(point + diff, lowestDiff - 1);
+        if (snapped == -1) {
+            continue;
+        }
         int currentDiff = qAbs(point + diff - snapped);
         if (currentDiff < lowestDiff) {
             lowestDiff = currentDiff;
@@ -5437,6 +5519,12 @@ const QString TimelineModel::sceneList(const QString &root, const QString &fullP
     return playlist;
 }
 
+const QString TimelineModel::lockedSceneList(const QString &root)
+{
+    READ_LOCK();
+    return sceneList(root);
+}
+
 void TimelineModel::checkRefresh(int start, int end)
 {
     if (m_blockRefresh) {
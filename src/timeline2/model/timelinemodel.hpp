@@ -274,6 +274,8 @@ public:
     /** @brief Returns the closest snap point within snapDistance
      */
     Q_INVOKABLE int suggestSnapPoint(int pos, int snapDistance);
+    /** @brief Returns the boundary of a video clip closest to @p pos, at most @p maxDistance frames away, or -1 */
+    int getClosestCut(int pos, int maxDistance);
 
     /** @brief Return the previous track of same type as source trackId, or trackId if no track found */
     Q_INVOKABLE int getPreviousTrackId(int trackId);
@@ -458,6 +460,10 @@ public:
     /**  @brief Returns the current project xml playlist for saving
      */
     const QString sceneList(const QString &root, const QString &fullPath = QString(), const QString &filterData = QString());
+    /**  @brief Returns the current project xml playlist, can be called from another thread
+     *   Timeline operations wait until the playlist is built
+     */
+    const QString lockedSceneList(const QString &root);
 
 protected:
     /** @brief Creates a new clip instance without inserting it.
@@ -480,6 +486,8 @@ public:
        @param clipId is the ID of the clip/composition
        @param logUndo if set to false, no undo object is stored */
     Q_INVOKABLE bool requestItemDeletion(int itemId, bool logUndo = true);
+    /** @brief Returns an estimate of the memory kept by the undo history when deleting the given clip, composition, group or track, with its content */
+    qint64 undoMemoryEstimate(int itemId) const;
     /* Same function, but accumulates undo and redo*/
     bool requestItemDeletion(int itemId, Fun &undo, Fun &redo, bool logUndo = false);
 
@@ -791,6 +799,13 @@ public:
     void prepareClose();
     /** @brief Import project's master effects */
     void importMasterEffects(std::weak_ptr<Mlt::Service> service);
+    /** @brief Enable or disable bulk loading, used while the timeline is built from a project file.
+        Enabling it starts a reset of the view, so that inserted items are not notified one by one, and the timeline duration is not updated.
+        Disabling it updates the duration and ends the reset. */
+    void setBulkLoading(bool loading);
+    /** @brief Insert a clip read from a project file, which is on no track and in no group yet, without the checks and mix handling of a move.
+        Used while the timeline is built from a project file */
+    bool requestLoadedClipInsertion(int clipId, int trackId, int position, Fun &undo, Fun &redo);
     /** @brief Create a mix selection with currently selected clip. If delta = -1, mix with previous clip, +1 with next clip and 0 will check cursor position*/
     bool mixClip(int idToMove = -1, const QString &mixId = QStringLiteral("luma"), int delta = 0);
     Q_INVOKABLE bool resizeStartMix(int cid, int duration, bool singleResize);
@@ -973,6 +988,8 @@ protected:
     /// Timeline editing mode
     TimelineMode::EditMode m_editMode;
     bool m_closing;
+    /** @brief True while the timeline is built from a project file */
+    bool m_bulkLoading;
 
     // what follows are some virtual function that corresponds to the QML. They are implemented in TimelineItemModel
 protected:
@@ -989,4 +1006,7 @@ protected:
     virtual QModelIndex makeCompositionIndexFromID(int) const = 0;
     virtual QModelIndex makeTrackIndexFromID(int) const = 0;
     virtual void _resetView() = 0;
+    /** @brief Start and end a reset of the view, between them the view must not be notified of any change */
+    virtual void _beginResetView() = 0;
+    virtual void _endResetView() = 0;
 };
@@ -19,6 +19,8 @@
 #include "timelinemodel.hpp"
 #include <QDebug>
 #include <QModelIndex>
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <mlt++/MltTransition.h>
 
@@ -164,9 +166,11 @@ Fun TrackModel::requestClipInsertion_lambda(int clipId, int position, bool updat
     auto end_function = [clipId, this, position, updateView, finalMove](int subPlaylist) {
         if (auto ptr = m_parent.lock()) {
             std::shared_ptr<ClipModel> clip = ptr->getClipPtr(clipId);
+            int previousPosition = m_allClips.count(clipId) > 0 ? clip->getPosition() : -1;
             m_allClips[clip->getId()] = clip; // store clip
             // update clip position and track
             clip->setPosition(position);
+            updateClipIndex(clipId, previousPosition, position);
             if (finalMove) {
                 clip->setSubPlaylistIndex(subPlaylist, m_id);
             }
@@ -403,6 +407,7 @@ Fun TrackModel::requestClipDeletion_lambda(int clipId, bool updateView, bool fin
             m_playlists[target_track].consolidate_blanks();
             m_allClips[clipId]->setCurrentTrackId(-1);
             // m_allClips[clipId]->setSubPlaylistIndex(-1);
+            updateClipIndex(clipId, m_allClips[clipId]->getPosition(), -1);
             m_allClips.erase(clipId);
             delete prod;
             m_playlists[target_track].unlock();
@@ -665,7 +670,9 @@ Fun TrackModel::requestClipResize_lambda(int clipId, int in, int out, bool right
             // The second is parameter is delta - 1 because this function expects an out time, which is basically size - 1
             m_playlists[target_track].insert_blank(blank_index, delta - 1);
             if (!right) {
+                int previousPosition = m_allClips[clipId]->getPosition();
                 m_allClips[clipId]->setPosition(clip_position + delta);
+                updateClipIndex(clipId, previousPosition, clip_position + delta);
                 // Because we inserted blank before, the index of our clip has increased
                 target_clip_mutable++;
             }
@@ -760,7 +767,9 @@ Fun TrackModel::requestClipResize_lambda(int clipId, int in, int out, bool right
                     // m_track->unblock();
                 }
                 if (!right && err == 0) {
+                    int previousPosition = m_allClips[clipId]->getPosition();
                     m_allClips[clipId]->setPosition(m_playlists[target_track].clip_start(target_clip_mutable));
+                    updateClipIndex(clipId, previousPosition, m_allClips[clipId]->getPosition());
                 }
                 if (err == 0) {
                     update_snaps(m_allClips[clipId]->getPosition(), m_allClips[clipId]->getPosition() + out - in + 1);
@@ -786,10 +795,9 @@ int TrackModel::getId() const
 int TrackModel::getClipByStartPosition(int position) const
 {
     READ_LOCK();
-    for (auto &clip : m_allClips) {
-        if (clip.second->getPosition() == position) {
-            return clip.second->getId();
-        }
+    auto it = m_clipPos.lower_bound({position, std::numeric_limits<int>::min()});
+    if (it != m_clipPos.end() && it->first == position) {
+        return it->second;
     }
     return -1;
 }
@@ -841,14 +849,23 @@ QSharedPointer<Mlt::Producer> TrackModel::getClipProducer(int clipId)
 int TrackModel::getCompositionByPosition(int position)
 {
     READ_LOCK();
-    for (const auto &comp : m_compoPos) {
-        if (comp.first == position) {
-            return comp.second;
-        } else if (comp.first < position) {
-            if (comp.first + m_allCompositions[comp.second]->getPlaytime() >= position) {
-                return comp.second;
+    // Compositions cannot intersect, so only the last one starting before position and the one starting at position can match
+    auto it = m_compoPos.upper_bound(position);
+    if (it == m_compoPos.begin()) {
+        return -1;
+    }
+    --it;
+    if (it->first == position) {
+        if (it != m_compoPos.begin()) {
+            auto previous = std::prev(it);
+            if (previous->first + m_allCompositions[previous->second]->getPlaytime() >= position) {
+                return previous->second;
             }
         }
+        return it->second;
+    }
+    if (it->first + m_allCompositions[it->second]->getPlaytime() >= position) {
+        return it->second;
     }
     return -1;
 }
@@ -856,27 +873,27 @@ int TrackModel::getCompositionByPosition(int position)
 int TrackModel::getClipByRow(int row) const
 {
     READ_LOCK();
-    if (row >= static_cast<int>(m_allClips.size())) {
-        return -1;
-    }
-    auto it = m_allClips.cbegin();
-    std::advance(it, row);
-    return (*it).first;
+    return m_clipRows.at(row);
 }
 
 std::unordered_set<int> TrackModel::getClipsInRange(int position, int end)
 {
     READ_LOCK();
     std::unordered_set<int> ids;
-    for (const auto &clp : m_allClips) {
-        int pos = clp.second->getPosition();
-        int length = clp.second->getPlaytime();
-        if (end > -1 && pos >= end) {
-            continue;
+    auto it = m_clipPos.lower_bound({position, std::numeric_limits<int>::min()});
+    // Walk back over the clips starting before position that still overlap it
+    while (it != m_clipPos.begin()) {
+        auto previous = std::prev(it);
+        if (previous->first + m_allClips.at(previous->second)->getPlaytime() - 1 < position) {
+            break;
         }
-        if (pos >= position || pos + length - 1 >= position) {
-            ids.insert(clp.first);
+        it = previous;
+    }
+    for (; it != m_clipPos.end(); ++it) {
+        if (end > -1 && it->first >= end) {
+            break;
         }
+        ids.insert(it->second);
     }
     return ids;
 }
@@ -885,7 +902,20 @@ int TrackModel::getRowfromClip(int clipId) const
 {
     READ_LOCK();
     Q_ASSERT(m_allClips.count(clipId) > 0);
-    return int(std::distance(m_allClips.begin(), m_allClips.find(clipId)));
+    return m_clipRows.indexOf(clipId);
+}
+
+void TrackModel::updateClipIndex(int clipId, int oldPosition, int newPosition)
+{
+    if (oldPosition > -1) {
+        m_clipPos.erase({oldPosition, clipId});
+    }
+    if (newPosition > -1) {
+        m_clipPos.emplace(newPosition, clipId);
+        m_clipRows.insert(clipId);
+    } else {
+        m_clipRows.remove(clipId);
+    }
 }
 
 std::unordered_set<int> TrackModel::getCompositionsInRange(int position, int end)
@@ -893,16 +923,19 @@ std::unordered_set<int> TrackModel::getCompositionsInRange(int position, int end
     READ_LOCK();
     // TODO: this function doesn't take into accounts the fact that there are two tracks
     std::unordered_set<int> ids;
-    for (const auto &compo : m_allCompositions) {
-        int pos = compo.second->getPosition();
-        int length = compo.second->getPlaytime();
-        if (end > -1 && pos >= end) {
-            continue;
+    auto it = m_compoPos.upper_bound(position);
+    if (it != m_compoPos.begin()) {
+        // Compositions cannot intersect, so only the previous one can overlap position
+        auto previous = std::prev(it);
+        if (previous->first + m_allCompositions.at(previous->second)->getPlaytime() - 1 >= position) {
+            it = previous;
         }
-        if (pos >= position || pos + length - 1 >= position) {
-
-            ids.insert(compo.first);
+    }
+    for (; it != m_compoPos.end(); ++it) {
+        if (end > -1 && it->first >= end) {
+            break;
         }
+        ids.insert(it->second);
     }
     return ids;
 }
@@ -911,7 +944,7 @@ int TrackModel::getRowfromComposition(int tid) const
 {
     READ_LOCK();
     Q_ASSERT(m_allCompositions.count(tid) > 0);
-    return int(m_allClips.size()) + int(std::distance(m_allCompositions.begin(), m_allCompositions.find(tid)));
+    return m_clipRows.size() + m_compoRows.indexOf(tid);
 }
 
 QVariant TrackModel::getProperty(const QString &name) const
@@ -962,6 +995,14 @@ bool TrackModel::checkConsistency()
         clips.emplace_back(c.second->getPosition(), c.first);
     }
     std::sort(clips.begin(), clips.end());
+    if (clips.size() != m_clipPos.size() || !std::equal(clips.begin(), clips.end(), m_clipPos.begin())) {
+        qDebug() << "Error: the clip position index doesn't match the clips of the track";
+        return false;
+    }
+    if (size_t(m_clipRows.size()) != m_allClips.size() || size_t(m_compoRows.size()) != m_allCompositions.size()) {
+        qDebug() << "Error: the row index doesn't match the number of items";
+        return false;
+    }
     int last_out = 0;
     for (size_t i = 0; i < clips.size(); ++i) {
         auto cur_clip = m_allClips[clips[i].second];
@@ -1393,6 +1434,7 @@ Fun TrackModel::requestCompositionDeletion_lambda(int compoId, bool updateView,
         }
         m_allCompositions[compoId]->setCurrentTrackId(-1);
         m_allCompositions.erase(compoId);
+        m_compoRows.remove(compoId);
         m_compoPos.erase(old_in);
         ptr->m_snaps->removePoint(old_in);
         ptr->m_snaps->removePoint(old_out);
@@ -1406,13 +1448,11 @@ Fun TrackModel::requestCompositionDeletion_lambda(int compoId, bool updateView,
 int TrackModel::getCompositionByRow(int row) const
 {
     READ_LOCK();
-    if (row < int(m_allClips.size())) {
+    if (row < m_clipRows.size()) {
         return -1;
     }
-    Q_ASSERT(row <= int(m_allClips.size() + m_allCompositions.size()));
-    auto it = m_allCompositions.cbegin();
-    std::advance(it, row - int(m_allClips.size()));
-    return (*it).first;
+    Q_ASSERT(row <= m_clipRows.size() + m_compoRows.size());
+    return m_compoRows.at(row - m_clipRows.size());
 }
 
 int TrackModel::getCompositionsCount() const
@@ -1436,6 +1476,7 @@ Fun TrackModel::requestCompositionInsertion_lambda(int compoId, int position, bo
             if (auto ptr = m_parent.lock()) {
                 std::shared_ptr<CompositionModel> composition = ptr->getCompositionPtr(compoId);
                 m_allCompositions[composition->getId()] = composition; // store clip
+                m_compoRows.insert(composition->getId());
                 // update clip position and track
                 composition->setCurrentTrackId(getId());
                 int new_in = position;
@@ -2314,6 +2355,7 @@ void TrackModel::setMixDuration(int cid, int mixDuration, int mixCut)
 {
     m_allClips[cid]->setMixDuration(mixDuration, mixCut);
     m_sameCompositions[cid]->getAsset()->set("kdenlive:mixcut", mixCut);
+    m_sameCompositions[cid]->invalidateValues();
     int in = m_allClips[cid]->getPosition();
     int out = in + mixDuration;
     Mlt::Transition &transition = *static_cast<Mlt::Transition *>(m_sameCompositions[cid]->getAsset());
@@ -6,12 +6,14 @@
 #pragma once
 
 #include "definitions.h"
+#include "rowindex.hpp"
 #include "undohelper.hpp"
 #include <QReadWriteLock>
 #include <QSharedPointer>
 #include <memory>
 #include <mlt++/MltPlaylist.h>
 #include <mlt++/MltTractor.h>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -362,8 +364,18 @@ private:
      */
     std::map<int, int> m_compoPos;
 
+    /** We store the clips ordered by (position, id), so that position and range lookups don't have to walk m_allClips.
+     *  Both sub-playlists share this index: clips of a track only overlap their direct neighbour in a mix, so their ends follow the start order
+     */
+    std::set<std::pair<int, int>> m_clipPos;
+    /** Sorted ids of the clips and compositions, matching the row order of m_allClips and m_allCompositions */
+    RowIndex m_clipRows;
+    RowIndex m_compoRows;
+
     /// This is a lock that ensures safety in case of concurrent access
     mutable QReadWriteLock m_lock;
+    /** @brief Update the position index of a clip, use -1 as @p oldPosition when the clip is added to the track and as @p newPosition when it is removed */
+    void updateClipIndex(int clipId, int oldPosition, int newPosition);
     void reverseCompositionXml(const QString &composition, QDomElement xml);
     void updateCompositionDirection(Mlt::Transition &transition, bool reverse);
 
@@ -21,6 +21,8 @@
 #include <QMutexLocker>
 #include <QSaveFile>
 #include <QStandardPaths>
+#include <QThread>
+#include <algorithm>
 
 PreviewManager::PreviewManager(TimelineController *controller, Mlt::Tractor *tractor)
     : QObject()
@@ -30,11 +32,11 @@ PreviewManager::PreviewManager(TimelineController *controller, Mlt::Tractor *tra
     , m_previewTrack(nullptr)
     , m_overlayTrack(nullptr)
     , m_previewTrackIndex(-1)
+    , m_previewCrashed(false)
     , m_initialized(false)
 {
     m_previewGatherTimer.setSingleShot(true);
     m_previewGatherTimer.setInterval(200);
-    QObject::connect(&m_previewProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &PreviewManager::processEnded);
 
     // Find path for Kdenlive renderer
 #ifdef Q_OS_WIN
@@ -49,8 +51,6 @@ PreviewManager::PreviewManager(TimelineController *controller, Mlt::Tractor *tra
                                i18n("Could not find the kdenlive_render application, something is wrong with your installation. Rendering will not work"));
         }
     }
-    connect(this, &PreviewManager::abortPreview, &m_previewProcess, &QProcess::kill, Qt::DirectConnection);
-    connect(&m_previewProcess, &QProcess::readyReadStandardError, this, &PreviewManager::receivedStderr);
 }
 
 PreviewManager::~PreviewManager()
@@ -470,12 +470,12 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
     if (add) {
         qDebug() << "CHUNKS CHANGED: " << m_dirtyChunks;
         emit m_controller->dirtyChunksChanged();
-        if (m_previewProcess.state() == QProcess::NotRunning && KdenliveSettings::autopreview()) {
+        if (!isRendering() && KdenliveSettings::autopreview()) {
             m_previewTimer.start();
         }
     } else {
         // Remove processed chunks
-        bool isRendering = m_previewProcess.state() != QProcess::NotRunning;
+        bool wasRendering = isRendering();
         m_previewGatherTimer.stop();
         abortRendering();
         m_tractor->lock();
@@ -497,22 +497,34 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
         emit m_controller->renderedChunksChanged();
         emit m_controller->dirtyChunksChanged();
         m_tractor->unlock();
-        if (isRendering || KdenliveSettings::autopreview()) {
+        if (wasRendering || KdenliveSettings::autopreview()) {
             m_previewTimer.start();
         }
     }
 }
 
+bool PreviewManager::isRendering() const
+{
+    for (const auto &process : m_previewProcesses) {
+        if (process->state() != QProcess::NotRunning) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void PreviewManager::abortRendering()
 {
-    if (m_previewProcess.state() == QProcess::NotRunning) {
+    if (!isRendering()) {
         return;
     }
     emit abortPreview();
-    m_previewProcess.waitForFinished();
-    if (m_previewProcess.state() != QProcess::NotRunning) {
-        m_previewProcess.kill();
-        m_previewProcess.waitForFinished();
+    for (const auto &process : m_previewProcesses) {
+        process->waitForFinished();
+        if (process->state() != QProcess::NotRunning) {
+            process->kill();
+            process->waitForFinished();
+        }
     }
     // Re-init time estimation
     emit previewRender(-1, QString(), 1000);
@@ -555,16 +567,20 @@ void PreviewManager::startPreviewRender()
     }
 }
 
-void PreviewManager::receivedStderr()
+void PreviewManager::receivedStderr(int worker)
 {
-    QStringList resultList = QString::fromLocal8Bit(m_previewProcess.readAllStandardError()).split(QLatin1Char('\n'));
+    QStringList resultList = QString::fromLocal8Bit(m_previewProcesses.at(size_t(worker))->readAllStandardError()).split(QLatin1Char('\n'));
     resultList.removeAll(QString(""));
     for (auto &result : resultList) {
         if (result.startsWith(QLatin1String("START:"))) {
-            workingPreview = result.section(QLatin1String("START:"), 1).simplified().toInt();
-            emit m_controller->workingPreviewChanged();
+            m_workingChunks[size_t(worker)] = result.section(QLatin1String("START:"), 1).simplified().toInt();
+            updateWorkingPreview();
         } else if (result.startsWith(QLatin1String("DONE:"))) {
             int chunk = result.section(QLatin1String("DONE:"), 1).simplified().toInt();
+            if (m_workingChunks.at(size_t(worker)) == chunk) {
+                m_workingChunks[size_t(worker)] = -1;
+                updateWorkingPreview();
+            }
             m_processedChunks++;
             QString fileName = QStringLiteral("%1.%2").arg(chunk).arg(m_extension);
             qDebug() << "---------------\nJOB PROGRRESS: " << m_chunksToRender << ", " << m_processedChunks << " = "
@@ -583,45 +599,106 @@ void PreviewManager::doPreviewRender(const QString &scene)
         return;
     }
     QMutexLocker lock(&m_dirtyMutex);
-    Q_ASSERT(m_previewProcess.state() == QProcess::NotRunning);
+    Q_ASSERT(!isRendering());
     std::sort(m_dirtyChunks.begin(), m_dirtyChunks.end(), chunkSort);
     qDebug() << ":: got dirty chks: " << m_dirtyChunks;
-    const QStringList dirtyChunks = getCompressedList(m_dirtyChunks);
+    int chunkSize = KdenliveSettings::timelinechunks();
+    // Render the chunks nearest to the playhead first, starting with the one containing it
+    int position = pCore->getTimelinePosition();
+    std::vector<std::pair<int, int>> chunks; // (distance to playhead, chunk)
+    chunks.reserve(size_t(m_dirtyChunks.count()));
+    for (const QVariant &chunk : qAsConst(m_dirtyChunks)) {
+        int frame = chunk.toInt();
+        int distance = frame > position ? frame - position : qMax(0, position - (frame + chunkSize - 1));
+        chunks.emplace_back(distance, frame);
+    }
+    std::sort(chunks.begin(), chunks.end());
     m_chunksToRender = m_dirtyChunks.count();
     m_processedChunks = 0;
-    int chunkSize = KdenliveSettings::timelinechunks();
-    QStringList args{KdenliveSettings::rendererpath(),
-                     scene,
-                     m_cacheDir.absolutePath(),
-                     QStringLiteral("-split"),
-                     dirtyChunks.join(QLatin1Char(',')),
-                     QString::number(chunkSize - 1),
-                     pCore->getCurrentProfilePath(),
-                     m_extension,
-                     m_consumerParams.join(QLatin1Char(' '))};
-    qDebug() << " -  - -STARTING PREVIEW JOBS: " << args;
+    // Spread the chunks over the workers, so that each one starts near the playhead
+    int workers = previewWorkers(int(chunks.size()));
+    std::vector<QStringList> workerChunks(size_t(workers));
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        workerChunks[i % size_t(workers)] << QString::number(chunks.at(i).second);
+    }
+    // Processes of the previous rendering may still be delivering their last signals
+    for (auto &process : m_previewProcesses) {
+        process->disconnect(this);
+        process.release()->deleteLater();
+    }
+    m_previewProcesses.clear();
+    m_workingChunks.assign(size_t(workers), -1);
+    m_previewCrashed = false;
     pCore->currentDoc()->previewProgress(0);
-    m_previewProcess.start(m_renderer, args);
-    if (m_previewProcess.waitForStarted()) {
-        qDebug() << " -  - -STARTING PREVIEW JOBS . . . STARTED";
+    for (int i = 0; i < workers; ++i) {
+        QStringList args{KdenliveSettings::rendererpath(),
+                         scene,
+                         m_cacheDir.absolutePath(),
+                         QStringLiteral("-split"),
+                         workerChunks.at(size_t(i)).join(QLatin1Char(',')),
+                         QString::number(chunkSize - 1),
+                         pCore->getCurrentProfilePath(),
+                         m_extension,
+                         m_consumerParams.join(QLatin1Char(' '))};
+        qDebug() << " -  - -STARTING PREVIEW JOBS: " << args;
+        auto *process = new QProcess();
+        m_previewProcesses.emplace_back(process);
+        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+                [this, i](int, QProcess::ExitStatus status) { processEnded(i, status); });
+        connect(process, &QProcess::readyReadStandardError, this, [this, i]() { receivedStderr(i); });
+        connect(this, &PreviewManager::abortPreview, process, &QProcess::kill, Qt::DirectConnection);
+        process->start(m_renderer, args);
+        if (process->waitForStarted()) {
+            qDebug() << " -  - -STARTING PREVIEW JOBS . . . STARTED";
+        }
     }
 }
 
-void PreviewManager::processEnded(int, QProcess::ExitStatus status)
+int PreviewManager::previewWorkers(int chunks)
+{
+    int workers = KdenliveSettings::previewworkers();
+    if (workers <= 0) {
+        // Each MLT consumer already uses several threads to encode
+        workers = qBound(1, QThread::idealThreadCount() / 4, 8);
+    }
+    return qBound(1, workers, qMax(1, chunks));
+}
+
+void PreviewManager::updateWorkingPreview()
+{
+    int working = -1;
+    for (int chunk : m_workingChunks) {
+        if (chunk >= 0 && (working < 0 || chunk < working)) {
+            working = chunk;
+        }
+    }
+    if (working != workingPreview) {
+        workingPreview = working;
+        emit m_controller->workingPreviewChanged();
+    }
+}
+
+void PreviewManager::processEnded(int worker, QProcess::ExitStatus status)
 {
-    const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
-    QFile::remove(sceneList);
     if (status == QProcess::QProcess::CrashExit) {
-        pCore->currentDoc()->previewProgress(-1);
-        if (workingPreview >= 0) {
-            const QString fileName = QStringLiteral("%1.%2").arg(workingPreview).arg(m_extension);
+        m_previewCrashed = true;
+        int chunk = m_workingChunks.at(size_t(worker));
+        if (chunk >= 0) {
+            const QString fileName = QStringLiteral("%1.%2").arg(chunk).arg(m_extension);
             if (m_cacheDir.exists(fileName)) {
                 m_cacheDir.remove(fileName);
             }
         }
-    } else {
-        pCore->currentDoc()->previewProgress(1000);
     }
+    m_workingChunks[size_t(worker)] = -1;
+    if (isRendering()) {
+        // Other workers are still busy
+        updateWorkingPreview();
+        return;
+    }
+    const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
+    QFile::remove(sceneList);
+    pCore->currentDoc()->previewProgress(m_previewCrashed ? -1 : 1000);
     workingPreview = -1;
     emit m_controller->workingPreviewChanged();
 }
@@ -667,7 +744,7 @@ void PreviewManager::invalidatePreview(int startFrame, int endFrame)
 
     std::sort(m_renderedChunks.begin(), m_renderedChunks.end(), chunkSort);
     m_previewGatherTimer.stop();
-    bool stopPreview = m_previewProcess.state() == QProcess::Running;
+    bool stopPreview = isRendering();
     if (m_renderedChunks.isEmpty() || ((workingPreview < m_renderedChunks.first().toInt() || workingPreview > m_renderedChunks.last().toInt()) &&
                                        (end < m_renderedChunks.first().toInt() || start > m_renderedChunks.last().toInt()))) {
         // invalidated zone is not in the preview zone, don't stop process
@@ -778,7 +855,9 @@ void PreviewManager::gotPreviewRender(int frame, const QString &file, int progre
 void PreviewManager::corruptedChunk(int frame, const QString &fileName)
 {
     emit abortPreview();
-    m_previewProcess.waitForFinished();
+    for (const auto &process : m_previewProcesses) {
+        process->waitForFinished();
+    }
     if (workingPreview >= 0) {
         workingPreview = -1;
         emit m_controller->workingPreviewChanged();
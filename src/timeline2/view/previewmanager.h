@@ -13,6 +13,8 @@
 #include <QMutex>
 #include <QProcess>
 #include <QTimer>
+#include <memory>
+#include <vector>
 
 class TimelineController;
 
@@ -84,8 +86,12 @@ private:
     int m_previewTrackIndex;
     /** @brief: The kdenlive renderer app. */
     QString m_renderer;
-    /** @brief: The kdenlive timeline preview process. */
-    QProcess m_previewProcess;
+    /** @brief: The kdenlive timeline preview processes, each one renders a part of the dirty chunks. */
+    std::vector<std::unique_ptr<QProcess>> m_previewProcesses;
+    /** @brief: The chunk currently processed by each preview process, -1 if none. */
+    std::vector<int> m_workingChunks;
+    /** @brief: True if a preview process crashed during the current rendering. */
+    bool m_previewCrashed;
     /** @brief: The directory used to store the preview files. */
     QDir m_cacheDir;
     /** @brief: The directory used to store undo history of preview files (child of m_cacheDir). */
@@ -114,6 +120,12 @@ private:
     void enable();
     /** @brief: Temporarily disable timeline preview track. */
     void disable();
+    /** @brief: Returns true if a preview process is running. */
+    bool isRendering() const;
+    /** @brief: Returns the number of preview processes to start for @param chunks dirty chunks. */
+    static int previewWorkers(int chunks);
+    /** @brief: Set workingPreview to the first chunk being rendered. */
+    void updateWorkingPreview();
     /** @brief: Get a compressed list of chunks, like: "0-500,525,575". */
     const QStringList getCompressedList(const QVariantList items) const;
 
@@ -131,9 +143,9 @@ private slots:
     void slotRemoveInvalidUndo(int ix);
     /** @brief: When the timer collecting invalid zones is done, process. */
     void slotProcessDirtyChunks();
-    /** @brief: Process preview rendering output. */
-    void receivedStderr();
-    void processEnded(int, QProcess::ExitStatus status);
+    /** @brief: Process preview rendering output of a worker. */
+    void receivedStderr(int worker);
+    void processEnded(int worker, QProcess::ExitStatus status);
 
 public slots:
     /** @brief: Prepare and start rendering. */
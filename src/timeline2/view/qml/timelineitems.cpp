@@ -5,6 +5,7 @@
     SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 */
 
+#include "audio/audioPeaks.h"
 #include "bin/projectitemmodel.h"
 #include "capture/mediacapture.h"
 #include "core.h"
@@ -14,6 +15,7 @@
 #include <QPainterPath>
 #include <QQuickPaintedItem>
 #include <QtMath>
+#include <algorithm>
 #include <cmath>
 
 class TimelineTriangle : public QQuickPaintedItem
@@ -105,16 +107,16 @@ public:
         // setTextureSize(QSize(1, 1));
         connect(this, &TimelineWaveform::levelsChanged, [&]() {
             if (!m_binId.isEmpty()) {
-                if (m_audioLevels.isEmpty() && m_stream >= 0) {
+                if (!m_peaks && m_stream >= 0) {
                     update();
                 } else {
                     // Clip changed, reset levels
-                    m_audioLevels.clear();
+                    m_peaks.reset();
                 }
             }
         });
         connect(this, &TimelineWaveform::normalizeChanged, [&]() {
-            m_audioMax = KdenliveSettings::normalizechannels() ? pCore->projectItemModel()->getAudioMaxLevel(m_binId, m_stream) : 0;
+            m_audioMax = KdenliveSettings::normalizechannels() && m_peaks ? m_peaks->maximum() : 0;
             update();
         });
         connect(this, &TimelineWaveform::propertyChanged, this, static_cast<void (QQuickItem::*)()>(&QQuickItem::update));
@@ -125,15 +127,16 @@ public:
         if (m_binId.isEmpty()) {
             return;
         }
-        if (m_audioLevels.isEmpty() && m_stream >= 0) {
-            m_audioLevels = pCore->projectItemModel()->getAudioLevelsByBinID(m_binId, m_stream);
-            if (m_audioLevels.isEmpty()) {
+        if (!m_peaks && m_stream >= 0) {
+            m_peaks = pCore->projectItemModel()->getAudioPeaksByBinID(m_binId, m_stream);
+            if (!m_peaks || m_peaks->isEmpty()) {
+                m_peaks.reset();
                 return;
             }
-            m_audioMax = KdenliveSettings::normalizechannels() ? pCore->projectItemModel()->getAudioMaxLevel(m_binId, m_stream) : 0;
+            m_audioMax = KdenliveSettings::normalizechannels() ? m_peaks->maximum() : 0;
         }
 
-        if (m_outPoint == m_inPoint) {
+        if (!m_peaks || m_outPoint == m_inPoint) {
             return;
         }
         QRectF bgRect(0, 0, width(), height());
@@ -141,8 +144,11 @@ public:
             painter->fillRect(bgRect, m_bgColor);
         }
         QPen pen(painter->pen());
-        double increment = qMax(1., m_scale / m_channels);           // qMax(1., 1. / qAbs(indicesPrPixel));
-        qreal indicesPrPixel = m_channels / m_scale * qAbs(m_speed); // qreal(m_outPoint - m_inPoint) / width() * m_precisionFactor;
+        // Number of level 0 peak buckets covered by one pixel
+        double pointsPrPixel = m_peaks->subFrames() * qAbs(m_speed) / m_scale;
+        // When zoomed in, draw one column per bucket, otherwise one per pixel
+        double increment = qMax(1., 1. / pointsPrPixel);
+        double columnPoints = increment * pointsPrPixel;
         int h = int(height());
         double offset = 0;
         bool pathDraw = increment > 1.2;
@@ -159,43 +165,45 @@ public:
             pen.setColor(m_color);
         }
         painter->setPen(pen);
-        double scaleFactor = 255;
+        double scaleFactor = 127;
         if (m_audioMax > 1) {
             scaleFactor = m_audioMax;
         }
         bool reverse = m_speed < 0;
-        int maxLength = m_audioLevels.length();
+        int maxLength = m_peaks->size();
+        double startPos = double(m_inPoint) / m_channels * m_peaks->subFrames();
         if (reverse) {
-            m_inPoint = qMin(m_inPoint, maxLength - m_channels);
+            startPos = qMin(startPos, double(maxLength));
         }
-        int startPos = int(m_inPoint / indicesPrPixel);
+        // Returns the peak bucket range for the column starting at pixel i
+        auto columnRange = [&](double i, double &from, double &to) {
+            if (reverse) {
+                to = startPos - i * pointsPrPixel;
+                from = to - columnPoints;
+            } else {
+                from = startPos + i * pointsPrPixel;
+                to = from + columnPoints;
+            }
+            return from < maxLength && to > 0;
+        };
+        int channels = qMin(m_channels, m_peaks->channels());
         if (!KdenliveSettings::displayallchannels()) {
             // Draw merged channels
             double i = 0;
             int j = 0;
-            int idx = 0;
+            double from, to;
             QPainterPath path;
             if (pathDraw) {
                 path.moveTo(j - 1, height());
             }
             for (; i <= width(); j++) {
-                double level;
                 i = j * increment;
-                if (reverse) {
-                    idx = qCeil((startPos - i) * indicesPrPixel);
-                    idx -= idx % m_channels;
-                } else {
-                    idx = qCeil((startPos + i) * indicesPrPixel);
-                    idx += idx % m_channels;
-                }
-                i -= offset;
-                if (idx + m_channels >= maxLength || idx < 0) {
+                if (!columnRange(i, from, to)) {
                     break;
                 }
-                level = m_audioLevels.at(idx) / scaleFactor;
-                for (int k = 1; k < m_channels; k++) {
-                    level = qMax(level, m_audioLevels.at(idx + k) / scaleFactor);
-                }
+                i -= offset;
+                const AudioPeaks::Peak peak = m_peaks->peak(-1, from, to);
+                double level = qMin(1., qMax(int(peak.max), -int(peak.min)) / scaleFactor);
                 if (pathDraw) {
                     double val = height() - level * height();
                     path.lineTo(i, val);
@@ -209,18 +217,17 @@ public:
                 painter->drawPath(path);
             }
         } else {
-            double channelHeight = height() / m_channels;
+            double channelHeight = height() / channels;
             QPen pen(painter->pen());
             // Draw separate channels
             scaleFactor = channelHeight / (2 * scaleFactor);
             bgRect.setHeight(channelHeight);
-            // Path for vector drawing
-            for (int channel = 0; channel < m_channels; channel++) {
-                double level;
+            for (int channel = 0; channel < channels; channel++) {
                 // y is channel median pos
                 double y = (channel * channelHeight) + channelHeight / 2;
-                QPainterPath path;
-                path.moveTo(-1, y);
+                // Upper and lower outlines for vector drawing
+                QPolygonF upper;
+                QPolygonF lower;
                 if (channel % 2 == 0) {
                     // Add dark background on odd channels
                     painter->setOpacity(0.2);
@@ -239,32 +246,26 @@ public:
                 painter->setOpacity(1);
                 double i = 0;
                 int j = 0;
-                int idx = 0;
+                double from, to;
                 for (; i <= width(); j++) {
                     i = j * increment;
-                    if (reverse) {
-                        idx = qCeil((startPos - i) * indicesPrPixel);
-                        idx -= idx % m_channels;
-                    } else {
-                        idx = qCeil((startPos + i) * indicesPrPixel);
-                        idx += idx % m_channels;
+                    if (!columnRange(i, from, to)) {
+                        break;
                     }
                     i -= offset;
-                    idx += channel;
-                    if (idx >= maxLength || idx < 0) break;
+                    const AudioPeaks::Peak peak = m_peaks->peak(channel, from, to);
+                    double top = y - qMin(channelHeight / 2, peak.max * scaleFactor);
+                    double bottom = y - qMax(-channelHeight / 2, peak.min * scaleFactor);
                     if (pathDraw) {
-                        level = m_audioLevels.at(idx) * scaleFactor;
-                        path.lineTo(i, y - level);
+                        upper << QPointF(i, top) << QPointF(i + increment, top);
+                        lower << QPointF(i, bottom) << QPointF(i + increment, bottom);
                     } else {
-                        level = m_audioLevels.at(idx) * scaleFactor; // divide height by 510 (2*255) to get height
-                        painter->drawLine(int(i), int(y - level), int(i), int(y + level));
+                        painter->drawLine(int(i), int(top), int(i), int(bottom));
                     }
                 }
-                if (pathDraw) {
-                    path.lineTo(i, y);
-                    painter->drawPath(path);
-                    QTransform tr(1, 0, 0, -1, 0, 2 * y);
-                    painter->drawPath(tr.map(path));
+                if (pathDraw && !upper.isEmpty()) {
+                    std::reverse(lower.begin(), lower.end());
+                    painter->drawPolygon(upper + lower);
                 }
                 if (m_firstChunk && m_channels > 1 && m_channels < 7) {
                     const QStringList chanelNames{"L", "R", "C", "LFE", "BL", "BR"};
@@ -282,7 +283,7 @@ signals:
     void audioChannelsChanged();
 
 private:
-    QVector<uint8_t> m_audioLevels;
+    std::shared_ptr<const AudioPeaks> m_peaks;
     int m_inPoint;
     int m_outPoint;
     QString m_binId;
@@ -72,6 +72,11 @@ TimelineController::TimelineController(QObject *parent)
     connect(pCore.get(), &Core::finalizeRecording, this, &TimelineController::finishRecording);
     connect(pCore.get(), &Core::autoScrollChanged, this, &TimelineController::autoScrollChanged);
     connect(pCore.get(), &Core::recordAudio, this, &TimelineController::switchRecording);
+    m_taskFocusTimer.setSingleShot(true);
+    m_taskFocusTimer.setInterval(300);
+    connect(&m_taskFocusTimer, &QTimer::timeout, this, &TimelineController::updateTaskFocus);
+    connect(this, &TimelineController::seeked, this, &TimelineController::scheduleTaskFocus);
+    connect(this, &TimelineController::scaleFactorChanged, this, &TimelineController::scheduleTaskFocus);
 }
 
 TimelineController::~TimelineController() {}
@@ -129,6 +134,41 @@ void TimelineController::setModel(std::shared_ptr<TimelineItemModel> model)
     connect(m_model.get(), &TimelineModel::selectedMixChanged, this, &TimelineController::selectedMixChanged);
     connect(m_model.get(), &TimelineModel::dataChanged, this, &TimelineController::checkClipPosition);
     connect(m_model.get(), &TimelineModel::checkTrackDeletion, this, &TimelineController::checkTrackDeletion, Qt::DirectConnection);
+    connect(m_model.get(), &TimelineItemModel::rowsInserted, this, &TimelineController::scheduleTaskFocus);
+}
+
+void TimelineController::scheduleTaskFocus()
+{
+    // Don't restart the timer, so that the focus follows the playhead during playback
+    if (!m_taskFocusTimer.isActive()) {
+        m_taskFocusTimer.start();
+    }
+}
+
+void TimelineController::updateTaskFocus()
+{
+    if (!m_root || !m_model || m_scale <= 0 || !pCore->taskManager.hasQueuedTasks()) {
+        return;
+    }
+    QVariant returnedValue;
+    QMetaObject::invokeMethod(m_root, "getScrollPos", Q_RETURN_ARG(QVariant, returnedValue));
+    int start = int(returnedValue.toInt() / m_scale);
+    // The root item also contains the track headers, so this slightly overestimates the visible range
+    int end = start + int(m_root->width() / m_scale) + 1;
+    int position = pCore->getTimelinePosition();
+    QSet<int> binIds;
+    for (int trackId : m_model->getAllTracksIds()) {
+        auto track = m_model->getTrackById_const(trackId);
+        std::unordered_set<int> clips = track->getClipsInRange(start, end);
+        if (position < start || position >= end) {
+            std::unordered_set<int> current = track->getClipsInRange(position, position + 1);
+            clips.insert(current.begin(), current.end());
+        }
+        for (int cid : clips) {
+            binIds.insert(m_model->getClipBinId(cid).toInt());
+        }
+    }
+    pCore->taskManager.setTimelineFocus(binIds);
 }
 
 void TimelineController::restoreTargetTracks()
@@ -763,8 +803,10 @@ void TimelineController::deleteMultipleTracks(int tid)
     QPointer<TrackDialog> d = new TrackDialog(m_model, tid, qApp->activeWindow(), true, m_activeTrack);
     if (d->exec() == QDialog::Accepted) {
         bool result = true;
+        qint64 memory = 0;
         QList<int> allIds = d->toDeleteTrackIds();
         for (int selectedTrackIx : qAsConst(allIds)) {
+            memory += m_model->undoMemoryEstimate(selectedTrackIx);
             result = m_model->requestTrackDeletion(selectedTrackIx, undo, redo);
             if (!result) {
                 break;
@@ -774,7 +816,7 @@ void TimelineController::deleteMultipleTracks(int tid)
             }
         }
         if (result) {
-            pCore->pushUndo(undo, redo, allIds.count() > 1 ? i18n("Delete Tracks") : i18n("Delete Track"));
+            pCore->pushUndo(undo, redo, allIds.count() > 1 ? i18n("Delete Tracks") : i18n("Delete Track"), memory);
         }
     }
 }
@@ -3222,6 +3264,7 @@ void TimelineController::alignAudio(int clipId)
         clipsToAnalyse.insert(clipId);
     }
     QList<int> processedGroups;
+    QList<AudioEnvelope *> envelopes;
     int processed = 0;
     for (int cid : clipsToAnalyse) {
         if (!m_model->isClip(cid) || cid == m_audioRef) {
@@ -3259,10 +3302,11 @@ void TimelineController::alignAudio(int clipId)
         }
         processed++;
         // Perform audio calculation
-        auto *envelope =
-            new AudioEnvelope(otherBinId, cid, size_t(m_model->getClipIn(cid)), size_t(m_model->getClipPlaytime(cid)), size_t(m_model->getClipPosition(cid)));
-        m_audioCorrelator->addChild(envelope);
+        envelopes << new AudioEnvelope(otherBinId, cid, size_t(m_model->getClipIn(cid)), size_t(m_model->getClipPlaytime(cid)),
+                                       size_t(m_model->getClipPosition(cid)));
     }
+    // All the clips are correlated against the same cached reference transform
+    m_audioCorrelator->addChildren(envelopes);
     if (processed == 0) {
         // TODO: improve feedback message after freeze
         pCore->displayMessage(i18n("Select a clip to apply an effect"), ErrorMessage, 500);
@@ -3539,11 +3583,13 @@ void TimelineController::deleteEffects(int targetId)
     }
     std::function<bool(void)> undo = []() { return true; };
     std::function<bool(void)> redo = []() { return true; };
+    qint64 memory = 0;
     for (int target : targetIds) {
         std::shared_ptr<EffectStackModel> destStack = m_model->getClipEffectStackModel(target);
+        memory += destStack->memoryEstimate();
         destStack->removeAllEffects(undo, redo);
     }
-    pCore->pushUndo(undo, redo, i18n("Delete effects"));
+    pCore->pushUndo(undo, redo, i18n("Delete effects"), memory);
 }
 
 void TimelineController::pasteEffects(int targetId)
@@ -4722,10 +4768,11 @@ void TimelineController::expandActiveClip()
                 }
                 int pos = clip->getPosition();
                 QDomDocument doc = TimelineFunctions::extractClip(m_model, id, getClipBinId(id));
+                qint64 memory = m_model->undoMemoryEstimate(id);
                 m_model->requestClipDeletion(id, undo, redo);
                 result = TimelineFunctions::pasteClips(m_model, doc.toString(), m_activeTrack, pos, undo, redo);
                 if (result) {
-                    pCore->pushUndo(undo, redo, i18n("Expand clip"));
+                    pCore->pushUndo(undo, redo, i18n("Expand clip"), memory);
                 } else {
                     undo();
                     pCore->displayMessage(i18n("Could not expand clip"), ErrorMessage, 500);
@@ -12,6 +12,7 @@
 #include <KActionCollection>
 #include <QApplication>
 #include <QDir>
+#include <QTimer>
 
 class PreviewManager;
 class QAction;
@@ -701,9 +702,13 @@ public slots:
     void updateTrimmingMode();
     /** @brief When a clip or composition is moved, inform asset panel to update cursor position in keyframe views. */
     void checkClipPosition(const QModelIndex &topLeft, const QModelIndex &, const QVector<int> &roles);
+    /** @brief Request an update of the bin clips whose tasks are started first, see TaskManager::setTimelineFocus. */
+    void scheduleTaskFocus();
 
 private slots:
     void updateClipActions();
+    /** @brief Pass the bin clips used around the playhead and in the visible part of the timeline to the task manager. */
+    void updateTaskFocus();
     void updateVideoTarget();
     void updateAudioTarget();
     /** @brief Dis / enable multi track view. */
@@ -751,6 +756,7 @@ private:
     QVariantList m_masterEffectZones;
     /** @brief The clip that is displayed in the preview monitor during a trimming operation*/
     int m_trimmingMainClip;
+    QTimer m_taskFocusTimer;
 
     void initializePreview();
     int getMenuOrTimelinePos() const;
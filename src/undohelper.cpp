@@ -9,11 +9,19 @@
 #endif
 #include <QDebug>
 #include <utility>
+
+namespace {
+// Delay during which commands with the same merge key are merged
+const int MergeDelay = 1000;
+} // namespace
+
 FunctionalUndoCommand::FunctionalUndoCommand(Fun undo, Fun redo, const QString &text, QUndoCommand *parent)
     : QUndoCommand(parent)
     , m_undo(std::move(undo))
     , m_redo(std::move(redo))
     , m_undone(false)
+    , m_timestamp(QTime::currentTime())
+    , m_memory(UndoMemory::Command + text.size() * qint64(sizeof(QChar)))
 {
     setText(text);
 }
@@ -25,13 +33,17 @@ void FunctionalUndoCommand::undo()
     Logger::log_undo(true);
 #endif
     m_undone = true;
+    if (!m_undo) {
+        // Released by the undo stack, which will delete the command
+        return;
+    }
     bool res = m_undo();
     Q_ASSERT(res);
 }
 
 void FunctionalUndoCommand::redo()
 {
-    if (m_undone) {
+    if (m_undone && m_redo) {
         // qDebug() << "REDOING " <<text();
 #ifdef CRASH_AUTO_TEST
         Logger::log_undo(false);
@@ -40,3 +52,58 @@ void FunctionalUndoCommand::redo()
         Q_ASSERT(res);
     }
 }
+
+int FunctionalUndoCommand::id() const
+{
+    return m_mergeKey.isEmpty() ? -1 : 4;
+}
+
+bool FunctionalUndoCommand::mergeWith(const QUndoCommand *other)
+{
+    if (other->id() != id() || m_undone) {
+        return false;
+    }
+    auto *command = static_cast<const FunctionalUndoCommand *>(other);
+    if (command->m_mergeKey != m_mergeKey || m_timestamp.msecsTo(command->m_timestamp) > MergeDelay || !m_undo || !command->m_undo) {
+        return false;
+    }
+    // Both operations are already applied, redo them in order and undo them in reverse order
+    Fun undo = m_undo;
+    Fun redo = m_redo;
+    Fun otherUndo = command->m_undo;
+    Fun otherRedo = command->m_redo;
+    m_undo = [undo, otherUndo]() {
+        bool res = otherUndo();
+        return undo() && res;
+    };
+    m_redo = [redo, otherRedo]() {
+        bool res = redo();
+        return otherRedo() && res;
+    };
+    m_timestamp = command->m_timestamp;
+    m_memory += command->m_memory;
+    return true;
+}
+
+void FunctionalUndoCommand::setMergeKey(const QString &key)
+{
+    m_mergeKey = key;
+}
+
+void FunctionalUndoCommand::addMemoryHint(qint64 bytes)
+{
+    m_memory += bytes;
+}
+
+qint64 FunctionalUndoCommand::memoryEstimate() const
+{
+    return m_memory;
+}
+
+void FunctionalUndoCommand::release()
+{
+    m_undo = Fun();
+    m_redo = Fun();
+    m_memory = UndoMemory::Command + text().size() * qint64(sizeof(QChar));
+    setObsolete(true);
+}
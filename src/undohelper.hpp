@@ -25,12 +25,29 @@ using Fun = std::function<bool(void)>;
         return v && lambda();                                                                                                                                  \
     };
 
+#include <QTime>
 #include <QUndoCommand>
 
+/** @brief Rough memory kept alive by undo functions, for the data that can not be measured.
+    Operations that capture large objects pass an estimate built from these with the command (see PUSH_UNDO_MEMORY).
+ */
+namespace UndoMemory {
+/** @brief A command and its functors */
+const qint64 Command = 1024;
+/** @brief A deleted timeline clip, composition or track: its model and MLT service, without its effects */
+const qint64 TimelineItem = 4096;
+/** @brief The master producer of a deleted bin clip, which keeps its decoder open */
+const qint64 Producer = 1024 * 1024;
+/** @brief One asset parameter: its row, its DOM element and its value */
+const qint64 AssetParameter = 512;
+} // namespace UndoMemory
+
 /** @brief this is a generic class that takes fonctors as undo and redo actions. It just executes them when required by Qt
   Note that QUndoStack actually executes redo() when we push the undoCommand to the stack
   This is bad for us because we execute the command as we construct the undo Function. So to prevent it to be executed twice, there is a small hack in this
   command that prevent redoing if it has not been undone before.
+  Since the functors can capture large objects (clip models, xml snapshots...), each command carries an estimate of the memory it
+  keeps alive, used by DocUndoStack to release the oldest commands when the history grows too large.
  */
 class FunctionalUndoCommand : public QUndoCommand
 {
@@ -38,8 +55,24 @@ public:
     FunctionalUndoCommand(Fun undo, Fun redo, const QString &text, QUndoCommand *parent = nullptr);
     void undo() override;
     void redo() override;
+    int id() const override;
+    bool mergeWith(const QUndoCommand *other) override;
+
+    /** @brief Allow this command to absorb the next one pushed with the same @p key shortly after, so that repeated small edits
+        (like dragging a keyframe) produce a single history entry */
+    void setMergeKey(const QString &key);
+    /** @brief Add @p bytes to the memory estimate of the command, for data captured by the functors.
+        Must be called before the command is pushed */
+    void addMemoryHint(qint64 bytes);
+    /** @brief Estimated memory kept alive by this command, in bytes */
+    qint64 memoryEstimate() const;
+    /** @brief Destroy the functors and the data they captured. The command can not be undone anymore */
+    void release();
 
 private:
     Fun m_undo, m_redo;
     bool m_undone;
+    QString m_mergeKey;
+    QTime m_timestamp;
+    qint64 m_memory;
 };
@@ -0,0 +1,272 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "mediaprobecache.hpp"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+std::unique_ptr<MediaProbeCache> MediaProbeCache::instance;
+std::once_flag MediaProbeCache::m_onceFlag;
+
+namespace {
+const quint32 CacheMagic = 0x6b6d7063; // "kmpc"
+const qint32 CacheVersion = 2;
+} // namespace
+
+MediaProbeCache::MediaProbeCache() = default;
+
+MediaProbeCache::~MediaProbeCache() = default;
+
+std::unique_ptr<MediaProbeCache> &MediaProbeCache::get()
+{
+    std::call_once(m_onceFlag, [] { instance.reset(new MediaProbeCache()); });
+    return instance;
+}
+
+bool MediaProbeCache::Identity::operator==(const Identity &other) const
+{
+    return size == other.size && modified == other.modified && inode == other.inode;
+}
+
+// static
+bool MediaProbeCache::identity(const QString &path, Identity &id)
+{
+    if (path.isEmpty()) {
+        return false;
+    }
+#ifdef Q_OS_UNIX
+    struct stat info;
+    if (::stat(QFile::encodeName(path).constData(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+    id.size = qint64(info.st_size);
+#if defined(Q_OS_MACOS)
+    id.modified = qint64(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+    id.modified = qint64(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+    id.inode = quint64(info.st_ino);
+#else
+    QFileInfo info(path);
+    if (!info.isFile()) {
+        return false;
+    }
+    id.size = info.size();
+    id.modified = info.lastModified().toMSecsSinceEpoch();
+    id.inode = 0;
+#endif
+    return true;
+}
+
+// static
+QString MediaProbeCache::cacheFile()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).absoluteFilePath(QStringLiteral("mediaprobe.cache"));
+}
+
+void MediaProbeCache::load()
+{
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+    QFile file(cacheFile());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+    quint32 magic;
+    qint32 version;
+    qint32 count;
+    stream >> magic >> version >> count;
+    if (stream.status() != QDataStream::Ok || magic != CacheMagic || version != CacheVersion || count < 0) {
+        qDebug() << "// Discarding invalid media probe cache" << file.fileName();
+        return;
+    }
+    m_entries.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        QString path;
+        Entry entry;
+        qint32 streamCount;
+        stream >> path >> entry.identity.size >> entry.identity.modified >> entry.identity.inode >> entry.hash >> entry.hashSize >> streamCount;
+        for (int j = 0; j < streamCount && stream.status() == QDataStream::Ok; ++j) {
+            QString selection;
+            StreamInfo info;
+            stream >> selection >> info.hasAudio >> info.hasVideo >> info.duration >> info.fps >> info.codec;
+            entry.streams.insert(selection, info);
+        }
+        stream >> entry.lastUsed;
+        if (stream.status() != QDataStream::Ok) {
+            qDebug() << "// Truncated media probe cache" << file.fileName();
+            break;
+        }
+        m_entries.insert(path, entry);
+    }
+}
+
+MediaProbeCache::Entry *MediaProbeCache::lookup(const QString &path)
+{
+    load();
+    auto it = m_entries.find(path);
+    if (it == m_entries.end()) {
+        return nullptr;
+    }
+    Identity id;
+    if (!identity(path, id) || id != it->identity) {
+        // The file was modified or removed
+        m_entries.erase(it);
+        m_dirty = true;
+        return nullptr;
+    }
+    // Not worth a write on its own, it is saved with the next change
+    it->lastUsed = QDateTime::currentSecsSinceEpoch();
+    return &(*it);
+}
+
+MediaProbeCache::Entry *MediaProbeCache::entryForWrite(const QString &path)
+{
+    load();
+    Identity id;
+    if (!identity(path, id)) {
+        m_entries.remove(path);
+        return nullptr;
+    }
+    Entry &entry = m_entries[path];
+    if (entry.identity != id) {
+        entry = Entry();
+        entry.identity = id;
+    }
+    entry.lastUsed = QDateTime::currentSecsSinceEpoch();
+    m_dirty = true;
+    return &entry;
+}
+
+bool MediaProbeCache::fileHash(const QString &path, QByteArray &hash, qint64 &size)
+{
+    QMutexLocker lock(&m_mutex);
+    Entry *entry = lookup(path);
+    if (entry == nullptr || entry->hash.isEmpty()) {
+        return false;
+    }
+    hash = entry->hash;
+    size = entry->hashSize;
+    return true;
+}
+
+void MediaProbeCache::storeFileHash(const QString &path, const QByteArray &hash, qint64 size)
+{
+    if (hash.isEmpty()) {
+        return;
+    }
+    QMutexLocker lock(&m_mutex);
+    Entry *entry = entryForWrite(path);
+    if (entry) {
+        entry->hash = hash;
+        entry->hashSize = size;
+    }
+}
+
+bool MediaProbeCache::streams(const QString &path, const QString &selection, StreamInfo &info)
+{
+    QMutexLocker lock(&m_mutex);
+    Entry *entry = lookup(path);
+    if (entry == nullptr) {
+        return false;
+    }
+    auto it = entry->streams.constFind(selection);
+    if (it == entry->streams.constEnd()) {
+        return false;
+    }
+    info = it.value();
+    return true;
+}
+
+void MediaProbeCache::storeStreams(const QString &path, const QString &selection, const StreamInfo &info)
+{
+    QMutexLocker lock(&m_mutex);
+    Entry *entry = entryForWrite(path);
+    if (entry) {
+        entry->streams.insert(selection, info);
+    }
+}
+
+int MediaProbeCache::count()
+{
+    QMutexLocker lock(&m_mutex);
+    load();
+    return m_entries.size();
+}
+
+void MediaProbeCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_entries.clear();
+    m_loaded = true;
+    m_dirty = false;
+    QFile::remove(cacheFile());
+}
+
+void MediaProbeCache::save()
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_dirty) {
+        return;
+    }
+    if (m_entries.size() > MaxEntries) {
+        // Drop the least recently used files
+        std::vector<qint64> times;
+        times.reserve(size_t(m_entries.size()));
+        for (const Entry &entry : qAsConst(m_entries)) {
+            times.push_back(entry.lastUsed);
+        }
+        auto limit = times.begin() + (times.size() - MaxEntries);
+        std::nth_element(times.begin(), limit, times.end());
+        const qint64 oldest = *limit;
+        for (auto it = m_entries.begin(); it != m_entries.end() && m_entries.size() > MaxEntries;) {
+            if (it->lastUsed < oldest) {
+                it = m_entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    const QString fileName = cacheFile();
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "// Cannot write media probe cache" << fileName;
+        return;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream << CacheMagic << CacheVersion << qint32(m_entries.size());
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        const Entry &entry = it.value();
+        stream << it.key() << entry.identity.size << entry.identity.modified << entry.identity.inode << entry.hash << entry.hashSize
+               << qint32(entry.streams.size());
+        for (auto info = entry.streams.cbegin(); info != entry.streams.cend(); ++info) {
+            stream << info.key() << info->hasAudio << info->hasVideo << info->duration << info->fps << info->codec;
+        }
+        stream << entry.lastUsed;
+    }
+    if (file.commit()) {
+        m_dirty = false;
+    }
+}
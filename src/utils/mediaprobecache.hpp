@@ -0,0 +1,107 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <memory>
+#include <mutex>
+
+/** @class MediaProbeCache
+    @brief Persistent cache of the information that is slow to gather on media files: their hash and the
+    result of the stream probe, which requires decoding a frame.
+    Entries are keyed by the file path and only used while the size, modification time and inode of the file
+    are unchanged, so that checking an entry only requires a stat of the file instead of reading it.
+    A file can have one probe result per stream selection (video_index, audio_index...).
+    The cache is loaded on first use and written to the user cache folder by save().
+ * Note that this class is a Singleton
+ */
+class MediaProbeCache
+{
+
+public:
+    // Returns the instance of the Singleton
+    static std::unique_ptr<MediaProbeCache> &get();
+
+    /** @brief Look up the hash of a file, as computed by ProjectClip::calculateHash
+       @return false if the file is unknown or changed since it was cached */
+    bool fileHash(const QString &path, QByteArray &hash, qint64 &size);
+    void storeFileHash(const QString &path, const QByteArray &hash, qint64 size);
+
+    /** @brief Result of the stream probe of a media file */
+    struct StreamInfo
+    {
+        bool hasAudio = false;
+        bool hasVideo = false;
+        /** @brief Duration in seconds */
+        double duration = 0.;
+        /** @brief Frame rate of the video stream, 0 if there is none */
+        double fps = 0.;
+        /** @brief Codec of the video stream */
+        QString codec;
+    };
+
+    /** @brief Look up the stream probe of a media file for a stream @p selection, empty for the default streams
+       @return false if the file is unknown, changed since it was cached or was not probed with this selection */
+    bool streams(const QString &path, const QString &selection, StreamInfo &info);
+    void storeStreams(const QString &path, const QString &selection, const StreamInfo &info);
+
+    /** @brief Forget all entries, in memory and on disk */
+    void clear();
+
+    /** @brief Write the cache to disk if it changed */
+    void save();
+
+    /** @brief Number of cached files */
+    int count();
+
+    ~MediaProbeCache();
+
+protected:
+    // Constructor is protected because class is a Singleton
+    MediaProbeCache();
+
+    /** @brief What identifies a version of a file on disk */
+    struct Identity
+    {
+        qint64 size = -1;
+        qint64 modified = 0;
+        quint64 inode = 0;
+        bool operator==(const Identity &other) const;
+        bool operator!=(const Identity &other) const { return !(*this == other); }
+    };
+    struct Entry
+    {
+        Identity identity;
+        QByteArray hash;
+        qint64 hashSize = -1;
+        // Probe results by stream selection
+        QHash<QString, StreamInfo> streams;
+        // Seconds since epoch of the last lookup, used to drop old entries
+        qint64 lastUsed = 0;
+    };
+
+    /** @brief Read the identity of @p path, returns false if it is not a file */
+    static bool identity(const QString &path, Identity &id);
+    /** @brief Returns the valid entry of @p path, or nullptr. Must be called with m_mutex locked */
+    Entry *lookup(const QString &path);
+    /** @brief Returns the entry of @p path, reset if the file changed, or nullptr if it is not a file. Must be called with m_mutex locked */
+    Entry *entryForWrite(const QString &path);
+    void load();
+    static QString cacheFile();
+
+    static std::unique_ptr<MediaProbeCache> instance;
+    static std::once_flag m_onceFlag; // flag to create the repository only once;
+    // Maximum number of files remembered, the least recently used are dropped when saving
+    static const int MaxEntries = 50000;
+
+    QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    bool m_loaded{false};
+    bool m_dirty{false};
+};
@@ -8,18 +8,80 @@
 #include "bin/projectitemmodel.h"
 #include "core.h"
 #include "doc/kdenlivedoc.h"
+#include "kdenlive_thumbcache_debug.h"
+#include "kdenlivesettings.h"
 #include "project/projectmanager.h"
 #include <QDir>
+#include <QFile>
 #include <QMutexLocker>
+#include <algorithm>
 #include <list>
+#include <mlt++/MltProfile.h>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_MAC)
+#include <sys/sysctl.h>
+#include <sys/types.h>
+#elif defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
 
 std::unique_ptr<ThumbnailCache> ThumbnailCache::instance;
 std::once_flag ThumbnailCache::m_onceFlag;
 
+namespace {
+QString thumbKey(const QString &prefix, int pos)
+{
+    return prefix + QString::number(pos) + QStringLiteral(".jpg");
+}
+
+void addPosition(std::vector<int> &positions, int pos)
+{
+    if (std::find(positions.begin(), positions.end(), pos) == positions.end()) {
+        positions.push_back(pos);
+    }
+}
+
+/** @brief Returns the amount of physical memory in bytes, or 0 if it cannot be found */
+qint64 physicalMemory()
+{
+#if defined(Q_OS_WIN)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status)) {
+        return qint64(status.ullTotalPhys);
+    }
+#elif defined(Q_OS_MAC)
+    int64_t memory = 0;
+    size_t length = sizeof(memory);
+    if (sysctlbyname("hw.memsize", &memory, &length, nullptr, 0) == 0) {
+        return qint64(memory);
+    }
+#elif defined(Q_OS_UNIX)
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && pageSize > 0) {
+        return qint64(pages) * pageSize;
+    }
+#endif
+    return 0;
+}
+} // namespace
+
 class ThumbnailCache::Cache_t
 {
 public:
-    Cache_t(int maxCost)
+    struct Entry
+    {
+        QImage img;
+        qint64 cost;
+        // Clip and position of the thumbnail, reported when it is evicted
+        QString binId;
+        int pos;
+    };
+
+    Cache_t(qint64 maxCost)
         : m_maxCost(maxCost)
     {
     }
@@ -32,23 +94,27 @@ public:
             return;
         }
         auto it = m_cache.at(key);
-        m_currentCost -= (*it).second.second;
-        m_data.erase(it);
+        m_currentCost -= (*it).second.cost;
         m_cache.erase(key);
+        m_data.erase(it);
     }
 
-    void insert(const QString &key, const QImage &img, int cost)
+    bool insert(const QString &key, const QImage &img, qint64 cost, const QString &binId, int pos, std::vector<std::pair<QString, int>> &evicted)
     {
         if (cost > m_maxCost) {
-            return;
+            return false;
         }
-        m_data.push_front({key, {img, cost}});
+        m_data.push_front({key, {img, cost, binId, pos}});
         auto it = m_data.begin();
         m_cache[key] = it;
         m_currentCost += cost;
         while (m_currentCost > m_maxCost) {
-            remove(m_data.back().first);
+            // copy the key, the list item is destroyed by remove
+            const QString last = m_data.back().first;
+            evicted.emplace_back(m_data.back().second.binId, m_data.back().second.pos);
+            remove(last);
         }
+        return true;
     }
 
     QImage get(const QString &key)
@@ -57,10 +123,10 @@ public:
             return QImage();
         }
         // when a get operation occurs, we put the corresponding list item in front to remember last access
-        std::pair<QString, std::pair<QImage, int>> data;
+        std::pair<QString, Entry> data;
         auto it = m_cache.at(key);
         std::swap(data, (*it));                                         // take data out without copy
-        QImage result = data.second.first;                              // a copy occurs here
+        QImage result = data.second.img;                                // a copy occurs here
         m_data.erase(it);                                               // delete old iterator
         m_cache[key] = m_data.emplace(m_data.begin(), std::move(data)); // reinsert without copy and store iterator
         return result;
@@ -71,31 +137,58 @@ public:
         m_cache.clear();
         m_currentCost = 0;
     }
+    void setMaxCost(qint64 maxCost) { m_maxCost = maxCost; }
+    qint64 currentCost() const { return m_currentCost; }
     bool checkIntegrity() const
     {
         if (m_data.size() != m_cache.size()) {
             // Cache is corrupted
             return false;
         }
+        qint64 cost = 0;
         for (const auto &d : m_data) {
             if (!contains(d.first)) {
                 return false;
             }
+            cost += d.second.cost;
         }
-        return true;
+        return cost == m_currentCost && m_currentCost <= m_maxCost;
     }
 
 protected:
-    int m_maxCost;
-    int m_currentCost{0};
+    qint64 m_maxCost;
+    qint64 m_currentCost{0};
 
-    std::list<std::pair<QString, std::pair<QImage, int>>> m_data; // the data is stored as (key,(image, cost))
+    std::list<std::pair<QString, Entry>> m_data; // the data is stored as (key, entry)
     std::unordered_map<QString, decltype(m_data.begin())> m_cache;
 };
 
+struct ThumbnailCache::Shard
+{
+    explicit Shard(qint64 maxCost)
+        : cache(maxCost)
+    {
+    }
+    QMutex mutex;
+    Cache_t cache;
+};
+
 ThumbnailCache::ThumbnailCache()
-    : m_volatileCache(new Cache_t(10000000))
+    : m_budget(memoryBudget())
+{
+    m_shards.reserve(ShardCount);
+    for (int i = 0; i < ShardCount; ++i) {
+        m_shards.emplace_back(new Shard(m_budget / ShardCount));
+    }
+    m_writePool.setMaxThreadCount(1);
+    m_readPool.setMaxThreadCount(2);
+}
+
+ThumbnailCache::~ThumbnailCache()
 {
+    m_readPool.clear();
+    m_readPool.waitForDone();
+    m_writePool.waitForDone();
 }
 
 std::unique_ptr<ThumbnailCache> &ThumbnailCache::get()
@@ -104,39 +197,149 @@ std::unique_ptr<ThumbnailCache> &ThumbnailCache::get()
     return instance;
 }
 
+// static
+qint64 ThumbnailCache::memoryBudget()
+{
+    const qint64 mb = 1024 * 1024;
+    if (KdenliveSettings::thumbnailcachesize() > 0) {
+        return KdenliveSettings::thumbnailcachesize() * mb;
+    }
+    // Try to keep a thousand thumbnails, they have the aspect ratio of the project
+    qint64 thumbSize = 256 * 144 * 4;
+    if (pCore) {
+        Mlt::Profile *profile = pCore->thumbProfile();
+        thumbSize = qint64(profile->width()) * profile->height() * 4;
+    }
+    qint64 budget = qMax(thumbSize * 1000, 64 * mb);
+    // but don't use more than 1/16 of the memory
+    qint64 memory = physicalMemory();
+    if (memory > 0) {
+        budget = qMin(budget, memory / 16);
+    }
+    return qBound(qint64(10000000), budget, 1024 * mb);
+}
+
+ThumbnailCache::Shard &ThumbnailCache::shard(const QString &key) const
+{
+    return *m_shards[qHash(key) % uint(ShardCount)];
+}
+
+bool ThumbnailCache::insertVolatile(const QString &key, const QImage &img, const QString &binId, int pos, std::vector<std::pair<QString, int>> &evicted) const
+{
+    Shard &s = shard(key);
+    QMutexLocker locker(&s.mutex);
+    bool existed = s.cache.contains(key);
+    // if volatile cache also contains this entry, update it
+    if (existed) {
+        s.cache.remove(key);
+    }
+    if (!s.cache.insert(key, img, img.sizeInBytes(), binId, pos, evicted)) {
+        if (existed) {
+            // The previous image is gone too
+            evicted.emplace_back(binId, pos);
+        }
+        return false;
+    }
+    return true;
+}
+
+void ThumbnailCache::pruneEvicted(const std::vector<std::pair<QString, int>> &evicted) const
+{
+    m_evictions += evicted.size();
+    for (const auto &item : evicted) {
+        auto it = m_storedVolatile.find(item.first);
+        if (it != m_storedVolatile.end()) {
+            it->second.erase(item.second);
+            if (it->second.empty()) {
+                m_storedVolatile.erase(it);
+            }
+        }
+    }
+}
+
+void ThumbnailCache::countLookup(std::atomic<quint64> &counter) const
+{
+    ++counter;
+    quint64 lookups = m_hits + m_diskHits + m_misses;
+    if (lookups % 1000 == 0) {
+        Stats current = stats();
+        qCDebug(KDENLIVE_THUMBCACHE_LOG) << "thumbnail cache: hits" << current.hits << "disk hits" << current.diskHits << "misses" << current.misses << "evictions"
+                                         << current.evictions << "memory" << current.memoryUsed << "/" << current.memoryBudget;
+    }
+}
+
+ThumbnailCache::Stats ThumbnailCache::stats() const
+{
+    Stats result;
+    result.hits = m_hits;
+    result.diskHits = m_diskHits;
+    result.misses = m_misses;
+    result.evictions = m_evictions;
+    result.memoryBudget = m_budget;
+    for (const auto &s : m_shards) {
+        QMutexLocker locker(&s->mutex);
+        result.memoryUsed += s->cache.currentCost();
+    }
+    return result;
+}
+
 bool ThumbnailCache::hasThumbnail(const QString &binId, int pos, bool volatileOnly) const
 {
-    QMutexLocker locker(&m_mutex);
     bool ok = false;
-    auto key = pos < 0 ? getAudioKey(binId, &ok).constFirst() : getKey(binId, pos, &ok);
-    if (ok && m_volatileCache->contains(key)) {
-        return true;
+    QString key;
+    if (pos < 0) {
+        const QStringList keys = getAudioKey(binId, &ok);
+        if (ok && !keys.isEmpty()) {
+            key = keys.constFirst();
+        }
+    } else {
+        key = getKey(binId, pos, &ok);
     }
-    if (!ok || volatileOnly) {
+    if (!ok || key.isEmpty()) {
         return false;
     }
+    Shard &s = shard(key);
+    QMutexLocker locker(&s.mutex);
+    if (s.cache.contains(key)) {
+        return true;
+    }
     locker.unlock();
+    if (volatileOnly) {
+        return false;
+    }
+    QMutexLocker pendingLocker(&m_pendingMutex);
+    if (m_pendingWrites.count(key) > 0) {
+        return true;
+    }
+    pendingLocker.unlock();
     QDir thumbFolder = getDir(pos < 0, &ok);
     return ok && thumbFolder.exists(key);
 }
 
 QImage ThumbnailCache::getAudioThumbnail(const QString &binId, bool volatileOnly) const
 {
-    QMutexLocker locker(&m_mutex);
     bool ok = false;
-    auto key = getAudioKey(binId, &ok).constFirst();
-    if (ok && m_volatileCache->contains(key)) {
-        return m_volatileCache->get(key);
+    const QStringList keys = getAudioKey(binId, &ok);
+    if (!ok || keys.isEmpty()) {
+        return QImage();
+    }
+    const QString &key = keys.constFirst();
+    Shard &s = shard(key);
+    QMutexLocker locker(&s.mutex);
+    if (s.cache.contains(key)) {
+        return s.cache.get(key);
     }
-    if (!ok || volatileOnly) {
+    locker.unlock();
+    if (volatileOnly) {
         return QImage();
     }
     QDir thumbFolder = getDir(true, &ok);
     if (ok && thumbFolder.exists(key)) {
+        QMutexLocker storedLocker(&m_mutex);
         if (std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), -1) != m_storedOnDisk[binId].end()) {
             m_storedOnDisk[binId].push_back(-1);
         }
-        locker.unlock();
+        storedLocker.unlock();
         return QImage(thumbFolder.absoluteFilePath(key));
     }
     return QImage();
@@ -163,84 +366,216 @@ QImage ThumbnailCache::getThumbnail(QString hash, const QString &binId, int pos,
     if (hash.isEmpty()) {
         return QImage();
     }
-    hash.append(QString("#%1.jpg").arg(pos));
-    QMutexLocker locker(&m_mutex);
-    if (m_volatileCache->contains(hash)) {
-        return m_volatileCache->get(hash);
+    hash.append(QLatin1Char('#'));
+    const QString key = thumbKey(hash, pos);
+    Shard &s = shard(key);
+    QMutexLocker locker(&s.mutex);
+    if (s.cache.contains(key)) {
+        QImage img = s.cache.get(key);
+        locker.unlock();
+        countLookup(m_hits);
+        return img;
     }
+    locker.unlock();
     if (volatileOnly) {
+        countLookup(m_misses);
         return QImage();
     }
     bool ok = false;
     QDir thumbFolder = getDir(false, &ok);
-    if (ok && thumbFolder.exists(hash)) {
-        if (m_storedOnDisk.find(binId) == m_storedOnDisk.end() ||
-            std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), pos) == m_storedOnDisk[binId].end()) {
-            m_storedOnDisk[binId].push_back(pos);
-        }
-        locker.unlock();
-        return QImage(thumbFolder.absoluteFilePath(hash));
+    QImage img;
+    if (ok) {
+        img = readFromDisk(binId, hash, pos, thumbFolder);
     }
-    locker.unlock();
-    return QImage();
+    countLookup(img.isNull() ? m_misses : m_diskHits);
+    return img;
 }
 
 QImage ThumbnailCache::getThumbnail(const QString &binId, int pos, bool volatileOnly) const
 {
-    QMutexLocker locker(&m_mutex);
     bool ok = false;
-    auto key = getKey(binId, pos, &ok);
-    if (ok && m_volatileCache->contains(key)) {
-        return m_volatileCache->get(key);
+    const QString prefix = getKeyPrefix(binId, &ok);
+    if (!ok) {
+        return QImage();
+    }
+    const QString key = thumbKey(prefix, pos);
+    Shard &s = shard(key);
+    QMutexLocker locker(&s.mutex);
+    if (s.cache.contains(key)) {
+        QImage img = s.cache.get(key);
+        locker.unlock();
+        countLookup(m_hits);
+        return img;
     }
-    if (!ok || volatileOnly) {
+    locker.unlock();
+    if (volatileOnly) {
+        countLookup(m_misses);
         return QImage();
     }
     QDir thumbFolder = getDir(false, &ok);
-    if (ok && thumbFolder.exists(key)) {
-        if (m_storedOnDisk.find(binId) == m_storedOnDisk.end() ||
-            std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), pos) == m_storedOnDisk[binId].end()) {
-            m_storedOnDisk[binId].push_back(pos);
+    QImage img;
+    if (ok) {
+        img = readFromDisk(binId, prefix, pos, thumbFolder);
+    }
+    countLookup(img.isNull() ? m_misses : m_diskHits);
+    return img;
+}
+
+QImage ThumbnailCache::readFromDisk(const QString &binId, const QString &prefix, int pos, const QDir &thumbFolder) const
+{
+    const QString key = thumbKey(prefix, pos);
+    QImage img;
+    QMutexLocker pendingLocker(&m_pendingMutex);
+    auto pending = m_pendingWrites.find(key);
+    if (pending != m_pendingWrites.end()) {
+        img = pending->second;
+    }
+    pendingLocker.unlock();
+    if (img.isNull()) {
+        if (!thumbFolder.exists(key)) {
+            return QImage();
+        }
+        // Decoding happens without holding any lock
+        img = QImage(thumbFolder.absoluteFilePath(key));
+        if (img.isNull()) {
+            return img;
         }
-        locker.unlock();
-        return QImage(thumbFolder.absoluteFilePath(key));
     }
-    return QImage();
+    QMutexLocker locker(&m_mutex);
+    addPosition(m_storedOnDisk[binId], pos);
+    // Keep the decoded image in memory so that it is not decoded again
+    std::vector<std::pair<QString, int>> evicted;
+    if (insertVolatile(key, img, binId, pos, evicted)) {
+        m_storedVolatile[binId].insert(pos);
+    }
+    pruneEvicted(evicted);
+    int step = 0;
+    auto last = m_lastDiskRead.find(binId);
+    if (last != m_lastDiskRead.end()) {
+        step = pos - last->second;
+    }
+    m_lastDiskRead[binId] = pos;
+    int generation = m_generation;
+    locker.unlock();
+    if (step != 0) {
+        scheduleReadAhead(binId, prefix, pos, step, generation, thumbFolder);
+    }
+    return img;
+}
+
+void ThumbnailCache::scheduleReadAhead(const QString &binId, const QString &prefix, int pos, int step, int generation, const QDir &thumbFolder) const
+{
+    // Thumbnails are usually requested at a constant interval while scrolling, so load the next ones in that direction
+    for (int i = 1; i <= ReadAhead; ++i) {
+        int next = pos + i * step;
+        if (next < 0) {
+            break;
+        }
+        const QString key = thumbKey(prefix, next);
+        Shard &s = shard(key);
+        QMutexLocker shardLocker(&s.mutex);
+        if (s.cache.contains(key)) {
+            continue;
+        }
+        shardLocker.unlock();
+        QMutexLocker pendingLocker(&m_pendingMutex);
+        if (m_pendingWrites.count(key) > 0 || !m_pendingReads.insert(key).second) {
+            continue;
+        }
+        pendingLocker.unlock();
+        const QString path = thumbFolder.absoluteFilePath(key);
+        m_readPool.start([this, binId, key, path, next, generation]() {
+            QImage img;
+            if (QFile::exists(path)) {
+                img = QImage(path);
+            }
+            QMutexLocker pending(&m_pendingMutex);
+            m_pendingReads.erase(key);
+            pending.unlock();
+            if (img.isNull()) {
+                return;
+            }
+            QMutexLocker locker(&m_mutex);
+            if (generation != m_generation) {
+                // Thumbnails were invalidated in the meantime
+                return;
+            }
+            Shard &target = shard(key);
+            QMutexLocker targetLocker(&target.mutex);
+            if (target.cache.contains(key)) {
+                return;
+            }
+            std::vector<std::pair<QString, int>> evicted;
+            bool added = target.cache.insert(key, img, img.sizeInBytes(), binId, next, evicted);
+            targetLocker.unlock();
+            if (added) {
+                m_storedVolatile[binId].insert(next);
+            }
+            addPosition(m_storedOnDisk[binId], next);
+            pruneEvicted(evicted);
+        });
+    }
 }
 
 void ThumbnailCache::storeThumbnail(const QString &binId, int pos, const QImage &img, bool persistent)
 {
-    QMutexLocker locker(&m_mutex);
     bool ok = false;
     const QString key = getKey(binId, pos, &ok);
     if (!ok) {
         return;
     }
-    // if volatile cache also contains this entry, update it
-    if (m_volatileCache->contains(key)) {
-        m_volatileCache->remove(key);
-    } else {
-        m_storedVolatile[binId].push_back(pos);
-    }
-    m_volatileCache->insert(key, img, (int)img.sizeInBytes());
+    std::vector<std::pair<QString, int>> evicted;
+    bool added = insertVolatile(key, img, binId, pos, evicted);
+    QDir thumbFolder;
     if (persistent) {
-        QDir thumbFolder = getDir(false, &ok);
-        if (ok) {
-            if (m_storedOnDisk.find(binId) == m_storedOnDisk.end() ||
-                std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), pos) == m_storedOnDisk[binId].end()) {
-                m_storedOnDisk[binId].push_back(pos);
-            }
-            locker.unlock();
-            if (!img.save(thumbFolder.absoluteFilePath(key))) {
-                qDebug() << ".............\n!!!!!!!! ERROR SAVING THUMB in: " << thumbFolder.absoluteFilePath(key);
-            }
-        }
+        thumbFolder = getDir(false, &ok);
     }
+    QMutexLocker locker(&m_mutex);
+    if (added) {
+        m_storedVolatile[binId].insert(pos);
+    }
+    pruneEvicted(evicted);
+    if (persistent && ok) {
+        addPosition(m_storedOnDisk[binId], pos);
+        locker.unlock();
+        queueWrite(thumbFolder, key, img);
+    }
+}
+
+void ThumbnailCache::queueWrite(const QDir &thumbFolder, const QString &key, const QImage &img)
+{
+    QMutexLocker locker(&m_pendingMutex);
+    m_pendingWrites[key] = img;
+    locker.unlock();
+    const QString path = thumbFolder.absoluteFilePath(key);
+    // Encoding and writing happen on the writer thread
+    m_writePool.start([this, key, path, img]() {
+        if (!img.save(path)) {
+            qDebug() << ".............\n!!!!!!!! ERROR SAVING THUMB in: " << path;
+        }
+        QMutexLocker pending(&m_pendingMutex);
+        auto it = m_pendingWrites.find(key);
+        // The thumbnail may have been replaced while we were writing it
+        if (it != m_pendingWrites.end() && it->second.cacheKey() == img.cacheKey()) {
+            m_pendingWrites.erase(it);
+        }
+    });
+}
+
+void ThumbnailCache::flush()
+{
+    m_writePool.waitForDone();
 }
 
 bool ThumbnailCache::checkIntegrity() const
 {
-    return m_volatileCache->checkIntegrity();
+    for (const auto &s : m_shards) {
+        QMutexLocker locker(&s->mutex);
+        if (!s->cache.checkIntegrity()) {
+            return false;
+        }
+    }
+    return true;
 }
 
 void ThumbnailCache::saveCachedThumbs(const std::unordered_map<QString, std::vector<int>> &keys)
@@ -250,91 +585,163 @@ void ThumbnailCache::saveCachedThumbs(const std::unordered_map<QString, std::vec
     if (!ok) {
         return;
     }
-    QMutexLocker locker(&m_mutex);
     for (auto &key : keys) {
-        bool ok;
         for (const auto &pos : key.second) {
-            if (m_storedOnDisk.find(key.first) == m_storedOnDisk.end() ||
-                std::find(m_storedOnDisk[key.first].begin(), m_storedOnDisk[key.first].end(), pos) == m_storedOnDisk[key.first].end()) {
-                const QString thumbKey = getKey(key.first, pos, &ok);
-                if (!ok) {
-                    continue;
-                }
-                if (!thumbFolder.exists(thumbKey) && m_volatileCache->contains(thumbKey)) {
-                    QImage img = m_volatileCache->get(thumbKey);
-                    if (!img.save(thumbFolder.absoluteFilePath(thumbKey))) {
-                        qDebug() << "// Error writing thumbnails to " << thumbFolder.absolutePath();
-                        break;
-                    } else {
-                        m_storedOnDisk[key.first].push_back(pos);
-                    }
-                }
+            QMutexLocker locker(&m_mutex);
+            if (m_storedOnDisk.find(key.first) != m_storedOnDisk.end() &&
+                std::find(m_storedOnDisk[key.first].begin(), m_storedOnDisk[key.first].end(), pos) != m_storedOnDisk[key.first].end()) {
+                continue;
+            }
+            locker.unlock();
+            const QString thumbnailKey = getKey(key.first, pos, &ok);
+            if (!ok || thumbFolder.exists(thumbnailKey)) {
+                continue;
+            }
+            Shard &s = shard(thumbnailKey);
+            QMutexLocker shardLocker(&s.mutex);
+            if (!s.cache.contains(thumbnailKey)) {
+                continue;
             }
+            QImage img = s.cache.get(thumbnailKey);
+            shardLocker.unlock();
+            locker.relock();
+            m_storedOnDisk[key.first].push_back(pos);
+            locker.unlock();
+            queueWrite(thumbFolder, thumbnailKey, img);
         }
     }
+    // The document is being saved, make sure all thumbnails are on disk
+    flush();
 }
 
 void ThumbnailCache::invalidateThumbsForClip(const QString &binId)
 {
     QMutexLocker locker(&m_mutex);
+    // Drop the thumbnails that are being loaded in the background
+    ++m_generation;
+    std::unordered_set<int> volatilePositions;
+    std::vector<int> diskPositions;
     if (m_storedVolatile.find(binId) != m_storedVolatile.end()) {
-        bool ok = false;
-        for (int pos : m_storedVolatile.at(binId)) {
-            auto key = getKey(binId, pos, &ok);
-            if (ok) {
-                m_volatileCache->remove(key);
-            }
-        }
+        volatilePositions = std::move(m_storedVolatile.at(binId));
         m_storedVolatile.erase(binId);
     }
+    if (m_storedOnDisk.find(binId) != m_storedOnDisk.end()) {
+        diskPositions = std::move(m_storedOnDisk.at(binId));
+        m_storedOnDisk.erase(binId);
+    }
+    m_lastDiskRead.erase(binId);
+    // Release mutex before computing the keys
+    locker.unlock();
     bool ok = false;
+    const QString prefix = getKeyPrefix(binId, &ok);
+    invalidateKeyPrefix(binId);
+    if (!ok) {
+        return;
+    }
+    for (int pos : volatilePositions) {
+        const QString key = thumbKey(prefix, pos);
+        Shard &s = shard(key);
+        QMutexLocker shardLocker(&s.mutex);
+        s.cache.remove(key);
+    }
     // Video thumbs
     QStringList files;
-    if (m_storedOnDisk.find(binId) != m_storedOnDisk.end()) {
-        // Remove persistent cache
-        for (const auto &pos : m_storedOnDisk.at(binId)) {
-            if (pos >= 0) {
-                auto key = getKey(binId, pos, &ok);
-                if (ok) {
-                    files << key;
-                }
-            }
+    QMutexLocker pendingLocker(&m_pendingMutex);
+    for (int pos : diskPositions) {
+        if (pos >= 0) {
+            const QString key = thumbKey(prefix, pos);
+            m_pendingWrites.erase(key);
+            files << key;
         }
-        m_storedOnDisk.erase(binId);
     }
-    // Release mutex before deleting files
-    locker.unlock();
+    pendingLocker.unlock();
     if (!files.isEmpty()) {
         QDir thumbFolder = getDir(false, &ok);
         if (ok) {
-            while (!files.isEmpty()) {
-                thumbFolder.remove(files.takeFirst());
-            }
+            // Remove persistent cache on the writer thread, after the pending writes
+            m_writePool.start([thumbFolder, files]() mutable {
+                while (!files.isEmpty()) {
+                    thumbFolder.remove(files.takeFirst());
+                }
+            });
         }
     }
 }
 
+void ThumbnailCache::invalidateKeyPrefix(const QString &binId)
+{
+    QWriteLocker locker(&m_prefixLock);
+    m_keyPrefixes.erase(binId);
+}
+
 void ThumbnailCache::clearCache()
 {
+    // Finish disk accesses, the cache folder may change after this
+    m_readPool.clear();
+    m_readPool.waitForDone();
+    m_writePool.waitForDone();
+    Stats current = stats();
+    qCDebug(KDENLIVE_THUMBCACHE_LOG) << "clearing thumbnail cache: hits" << current.hits << "disk hits" << current.diskHits << "misses" << current.misses
+                                     << "evictions" << current.evictions;
+    // The project resolution may have changed
+    m_budget = memoryBudget();
+    m_hits = 0;
+    m_diskHits = 0;
+    m_misses = 0;
+    m_evictions = 0;
     QMutexLocker locker(&m_mutex);
-    m_volatileCache->clear();
+    ++m_generation;
+    for (const auto &s : m_shards) {
+        QMutexLocker shardLocker(&s->mutex);
+        s->cache.clear();
+        s->cache.setMaxCost(m_budget / ShardCount);
+    }
     m_storedVolatile.clear();
     m_storedOnDisk.clear();
+    m_lastDiskRead.clear();
+    locker.unlock();
+    QMutexLocker pendingLocker(&m_pendingMutex);
+    m_pendingWrites.clear();
+    m_pendingReads.clear();
+    pendingLocker.unlock();
+    QWriteLocker prefixLocker(&m_prefixLock);
+    m_keyPrefixes.clear();
 }
 
-// static
-QString ThumbnailCache::getKey(const QString &binId, int pos, bool *ok)
+QString ThumbnailCache::getKey(const QString &binId, int pos, bool *ok) const
+{
+    const QString prefix = getKeyPrefix(binId, ok);
+    if (!*ok) {
+        return QString();
+    }
+    return thumbKey(prefix, pos);
+}
+
+QString ThumbnailCache::getKeyPrefix(const QString &binId, bool *ok) const
 {
     if (binId.isEmpty()) {
         *ok = false;
         return QString();
     }
+    QReadLocker readLocker(&m_prefixLock);
+    auto it = m_keyPrefixes.find(binId);
+    if (it != m_keyPrefixes.end()) {
+        *ok = true;
+        return it->second;
+    }
+    readLocker.unlock();
     auto binClip = pCore->projectItemModel()->getClipByBinID(binId);
     *ok = binClip != nullptr && binClip->statusReady();
     if (!*ok) {
         return QString();
     }
-    return binClip->hashForThumbs() + QLatin1Char('#') + QString::number(pos) + QStringLiteral(".jpg");
+    const QString hash = binClip->hashForThumbs();
+    const QString prefix = hash + QLatin1Char('#');
+    if (!hash.isEmpty()) {
+        QWriteLocker locker(&m_prefixLock);
+        m_keyPrefixes[binId] = prefix;
+    }
+    return prefix;
 }
 
 // static
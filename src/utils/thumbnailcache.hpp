@@ -9,10 +9,14 @@
 #include <QDir>
 #include <QImage>
 #include <QMutex>
+#include <QReadWriteLock>
+#include <QThreadPool>
 #include <QUrl>
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 /** @class ThumbnailCache
@@ -22,12 +26,25 @@
     Note that for the volatile cache uses a custom implementation.
     QCache is not suitable since it operates on pointers and since the object is removed from the cache when accessed.
     KImageCache is not suitable since it lacks a way to remove objects from the cache.
+    The volatile cache is split in shards that each have their own lock, so that concurrent thumbnail providers don't wait on each other.
+    Disk writes are queued to a background writer thread, and disk hits trigger a read-ahead of the next thumbnails of the clip.
  * Note that this class is a Singleton
  */
 class ThumbnailCache
 {
 
 public:
+    /** @brief Usage counters of the volatile cache */
+    struct Stats
+    {
+        quint64 hits = 0;
+        quint64 diskHits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        qint64 memoryUsed = 0;
+        qint64 memoryBudget = 0;
+    };
+
     // Returns the instance of the Singleton
     static std::unique_ptr<ThumbnailCache> &get();
 
@@ -64,15 +81,32 @@ public:
     /** @brief Reset cache (discarding all thumbs stored in memory) */
     void clearCache();
 
+    /** @brief Forget the key prefix computed for a clip, must be called when its hash changes */
+    void invalidateKeyPrefix(const QString &binId);
+
+    /** @brief Wait until all queued disk writes are done */
+    void flush();
+
+    /** @brief Returns the hit, miss and eviction counters since the cache was last cleared */
+    Stats stats() const;
+
+    /** @brief Compute the memory budget of the volatile cache, from the thumbnailcachesize setting,
+        or from the physical memory and thumbnail size when it is not set */
+    static qint64 memoryBudget();
+
     /** @brief Ensure the cache is not corrupted */
     bool checkIntegrity() const;
 
+    ~ThumbnailCache();
+
 protected:
     // Constructor is protected because class is a Singleton
     ThumbnailCache();
 
     // Return the key associated to a thumbnail
-    static QString getKey(const QString &binId, int pos, bool *ok);
+    QString getKey(const QString &binId, int pos, bool *ok) const;
+    // Return the part of the thumbnail keys that is common to all the thumbnails of a clip
+    QString getKeyPrefix(const QString &binId, bool *ok) const;
     static QStringList getAudioKey(const QString &binId, bool *ok);
 
     // Return the dir where the persistent cache lives
@@ -82,11 +116,57 @@ protected:
     static std::once_flag m_onceFlag; // flag to create the repository only once;
 
     class Cache_t;
-    std::unique_ptr<Cache_t> m_volatileCache;
+    struct Shard;
+    // Number of independent volatile caches, each protected by its own mutex
+    static const int ShardCount = 8;
+    // Number of thumbnails loaded in the background after a disk hit
+    static const int ReadAhead = 4;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    // Return the shard storing a given key
+    Shard &shard(const QString &key) const;
+
+    // Key prefix (clip hash) of each clip, so that computing a key doesn't query the clip
+    mutable QReadWriteLock m_prefixLock;
+    mutable std::unordered_map<QString, QString> m_keyPrefixes;
+
+    // Protects the following bookkeeping maps
     mutable QMutex m_mutex;
-
     // the following maps keeps track of the positions that we store for each clip in volatile caches.
-    // Note that we don't track deletions due to items dropped from the cache. So the maps can contain more items that are currently stored.
-    std::unordered_map<QString, std::vector<int>> m_storedVolatile;
+    // Items dropped from the volatile cache are removed from m_storedVolatile, but m_storedOnDisk is not pruned when files are deleted outside of Kdenlive.
+    mutable std::unordered_map<QString, std::unordered_set<int>> m_storedVolatile;
     mutable std::unordered_map<QString, std::vector<int>> m_storedOnDisk;
+    // Last position read from disk for each clip, used to guess which thumbnails will be requested next
+    mutable std::unordered_map<QString, int> m_lastDiskRead;
+    // Incremented when thumbnails are invalidated, so that background reads started before are dropped
+    int m_generation{0};
+
+    // Images queued for writing, by key. They are still served to readers until the write is done
+    mutable QMutex m_pendingMutex;
+    std::unordered_map<QString, QImage> m_pendingWrites;
+    // Keys of the thumbnails currently loaded by the read-ahead
+    mutable std::unordered_set<QString> m_pendingReads;
+    // A single thread performs the writes and removals, so that they happen in the order they were requested
+    mutable QThreadPool m_writePool;
+    mutable QThreadPool m_readPool;
+
+    // Memory allowed to the volatile cache, split between the shards
+    std::atomic<qint64> m_budget;
+    // Usage counters, see Stats
+    mutable std::atomic<quint64> m_hits{0};
+    mutable std::atomic<quint64> m_diskHits{0};
+    mutable std::atomic<quint64> m_misses{0};
+    mutable std::atomic<quint64> m_evictions{0};
+    // Count a lookup, and periodically log the counters
+    void countLookup(std::atomic<quint64> &counter) const;
+
+    // Store an image in the volatile cache, returns false if the image is larger than the cache.
+    // The positions of the thumbnails dropped to make room, or replaced by a rejected image, are appended to evicted
+    bool insertVolatile(const QString &key, const QImage &img, const QString &binId, int pos, std::vector<std::pair<QString, int>> &evicted) const;
+    // Remove evicted thumbnails from m_storedVolatile, m_mutex must be locked
+    void pruneEvicted(const std::vector<std::pair<QString, int>> &evicted) const;
+    // Queue the disk write of a thumbnail
+    void queueWrite(const QDir &thumbFolder, const QString &key, const QImage &img);
+    // Load a thumbnail from the disk cache or the pending writes, and schedule the read-ahead of the next ones
+    QImage readFromDisk(const QString &binId, const QString &prefix, int pos, const QDir &thumbFolder) const;
+    void scheduleReadAhead(const QString &binId, const QString &prefix, int pos, int step, int generation, const QDir &thumbFolder) const;
 };
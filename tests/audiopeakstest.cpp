@@ -0,0 +1,160 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "test_utils.hpp"
+
+#include "lib/audio/audioPeaks.h"
+#include <QDir>
+#include <QTemporaryFile>
+
+TEST_CASE("Audio peak pyramid", "[AudioPeaks]")
+{
+    SECTION("Legacy frame levels round trip")
+    {
+        QVector<uint8_t> levels;
+        for (int i = 0; i < 1000; ++i) {
+            levels << uint8_t(i % 200) << uint8_t(255 - i % 200);
+        }
+        AudioPeaks peaks = AudioPeaks::fromFrameLevels(levels, 2);
+        REQUIRE(peaks.channels() == 2);
+        REQUIRE(peaks.subFrames() == 1);
+        REQUIRE(peaks.frameCount() == 1000);
+        REQUIRE(peaks.levelCount() > 1);
+        CHECK(peaks.frameLevels() == levels);
+    }
+
+    SECTION("Zoomed out ranges keep the peaks")
+    {
+        QVector<uint8_t> levels(4096, 0);
+        // A single loud frame in silence
+        levels[1234] = 254;
+        AudioPeaks peaks = AudioPeaks::fromFrameLevels(levels, 1);
+        CHECK(peaks.maximum() == 127);
+        CHECK(peaks.peak(0, 0, 4096).max == 127);
+        CHECK(peaks.peak(0, 1000, 1300).max == 127);
+        CHECK(peaks.peak(0, 1234, 1235).max == 127);
+        CHECK(peaks.peak(0, 1235, 1236).max == 0);
+        CHECK(peaks.peak(-1, 1200, 1300).min == -127);
+    }
+
+    SECTION("Sub-frame peaks from samples")
+    {
+        AudioPeaks peaks(2);
+        std::vector<int16_t> samples(2 * 1920, 0);
+        // Full scale positive peak on the left channel in the last quarter of the frame
+        samples[2 * 1900] = 32767;
+        // Negative peak on the right channel in the first quarter
+        samples[2 * 10 + 1] = -32768;
+        peaks.appendFrame(samples.data(), 1920);
+        peaks.repeatLastFrame();
+        peaks.build();
+        REQUIRE(peaks.frameCount() == 2);
+        REQUIRE(peaks.size() == 2 * AudioPeaks::SubFrames);
+        CHECK(peaks.peak(0, 3, 4).max > 100);
+        CHECK(peaks.peak(0, 0, 3).max == 0);
+        CHECK(peaks.peak(1, 0, 1).min < -100);
+        CHECK(peaks.peak(1, 0, 1).max == 0);
+        CHECK(peaks.peak(0, 7, 8).max == peaks.peak(0, 3, 4).max);
+        QVector<uint8_t> levels = peaks.frameLevels();
+        REQUIRE(levels.size() == 4);
+        CHECK(levels.at(0) > 0);
+    }
+
+    SECTION("Vectorized s16 kernel matches the float path")
+    {
+        std::mt19937 g(42);
+        std::uniform_int_distribution<int> dist(-32768, 32767);
+        for (int channels : {1, 2, 3, 6, 8}) {
+            AudioPeaks fromS16(channels);
+            AudioPeaks fromFloat(channels);
+            for (int frame = 0; frame < 5; ++frame) {
+                int samples = 1601 + frame;
+                std::vector<int16_t> s16(size_t(samples * channels));
+                std::vector<float> f32(s16.size());
+                for (size_t i = 0; i < s16.size(); ++i) {
+                    s16[i] = int16_t(dist(g) / (frame + 1));
+                    f32[i] = s16[i] / 32768.f;
+                }
+                fromS16.appendFrame(s16.data(), samples);
+                fromFloat.appendFrame(f32.data(), samples);
+            }
+            REQUIRE(fromS16.size() == fromFloat.size());
+            for (int i = 0; i < fromS16.size(); ++i) {
+                for (int c = 0; c < channels; ++c) {
+                    const AudioPeaks::Peak a = fromS16.peak(c, i, i + 1);
+                    const AudioPeaks::Peak b = fromFloat.peak(c, i, i + 1);
+                    CHECK(a.min == b.min);
+                    CHECK(a.max == b.max);
+                    CHECK(qAbs(a.rms - b.rms) <= 1);
+                }
+            }
+        }
+    }
+
+    SECTION("Levels convert back to amplitudes")
+    {
+        CHECK(AudioPeaks::levelAmplitude(0) == 0.);
+        for (double amplitude : {0.001, 0.01, 0.05, 0.2, 0.5, 0.9}) {
+            const uint8_t level = AudioPeaks::scaleLevel(amplitude);
+            // One level step is less than 1 dB in this range
+            CHECK(AudioPeaks::levelAmplitude(level) <= amplitude);
+            CHECK(AudioPeaks::levelAmplitude(uint8_t(level + 1)) > amplitude);
+            CHECK(AudioPeaks::levelAmplitude(level) > amplitude * 0.85);
+        }
+        for (int level = 1; level < 255; ++level) {
+            CHECK(AudioPeaks::scaleLevel(AudioPeaks::levelAmplitude(uint8_t(level)) * 1.0001) == level);
+        }
+    }
+
+    SECTION("Merged segments")
+    {
+        QVector<uint8_t> levels;
+        for (int i = 0; i < 2000; ++i) {
+            levels << uint8_t(i % 250);
+        }
+        AudioPeaks first = AudioPeaks::fromFrameLevels(levels.mid(0, 700), 1);
+        AudioPeaks second = AudioPeaks::fromFrameLevels(levels.mid(700), 1);
+        first.append(second);
+        first.build();
+        CHECK(first.frameLevels() == levels);
+        CHECK(first.maximum() == AudioPeaks::fromFrameLevels(levels, 1).maximum());
+    }
+
+    SECTION("Binary cache round trip")
+    {
+        QVector<uint8_t> levels;
+        for (int i = 0; i < 3000; ++i) {
+            levels << uint8_t(i % 255) << uint8_t(i % 7) << uint8_t(100);
+        }
+        AudioPeaks peaks = AudioPeaks::fromFrameLevels(levels, 3);
+        QTemporaryFile cacheFile(QDir::temp().filePath("kdenlive_test_XXXXXX.peaks"));
+        REQUIRE(cacheFile.open());
+        const QString path = cacheFile.fileName();
+        cacheFile.close();
+        REQUIRE(peaks.save(path));
+        std::shared_ptr<const AudioPeaks> loaded = AudioPeaks::load(path);
+        REQUIRE(loaded != nullptr);
+        CHECK(loaded->channels() == 3);
+        CHECK(loaded->levelCount() == peaks.levelCount());
+        CHECK(loaded->maximum() == peaks.maximum());
+        CHECK(loaded->frameLevels() == levels);
+        CHECK(loaded->peak(1, 10, 500).max == peaks.peak(1, 10, 500).max);
+
+        // The cache is replaced through a temporary file, the mapped version stays readable
+        AudioPeaks shorter = AudioPeaks::fromFrameLevels(levels.mid(0, 900), 3);
+        REQUIRE(shorter.save(path));
+        CHECK_FALSE(QFile::exists(path + QStringLiteral(".part")));
+        CHECK(loaded->frameLevels() == levels);
+        std::shared_ptr<const AudioPeaks> replaced = AudioPeaks::load(path);
+        REQUIRE(replaced != nullptr);
+        CHECK(replaced->frameCount() == 300);
+
+        // Truncated files are rejected
+        QFile file(path);
+        REQUIRE(file.open(QIODevice::ReadWrite));
+        file.resize(file.size() - 1);
+        file.close();
+        CHECK(AudioPeaks::load(path) == nullptr);
+    }
+}
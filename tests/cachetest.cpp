@@ -17,7 +17,10 @@
 #define private public
 #define protected public
 #include "core.h"
+#include "kdenlivesettings.h"
+#include "utils/mediaprobecache.hpp"
 #include "utils/thumbnailcache.hpp"
+#include <QTemporaryFile>
 
 Mlt::Profile profile_cache;
 
@@ -56,6 +59,45 @@ TEST_CASE("Cache insert-remove", "[Cache]")
         ThumbnailCache::get()->storeThumbnail(binId, 0, img, false);
         REQUIRE(ThumbnailCache::get()->checkIntegrity());
     }
+    SECTION("Evicted thumbnails are removed from bookkeeping")
+    {
+        // 1 MiB budget, a few images per shard
+        KdenliveSettings::setThumbnailcachesize(1);
+        ThumbnailCache::get()->clearCache();
+        QImage img(100, 100, QImage::Format_ARGB32_Premultiplied);
+        img.fill(Qt::red);
+        for (int i = 0; i < 200; ++i) {
+            ThumbnailCache::get()->storeThumbnail(binId, i, img, false);
+        }
+        REQUIRE(ThumbnailCache::get()->checkIntegrity());
+        ThumbnailCache::Stats stats = ThumbnailCache::get()->stats();
+        REQUIRE(stats.evictions > 0);
+        REQUIRE(stats.memoryUsed <= stats.memoryBudget);
+        size_t stored = ThumbnailCache::get()->m_storedVolatile[binId].size();
+        REQUIRE(stored == size_t(stats.memoryUsed / img.sizeInBytes()));
+        REQUIRE(stored + stats.evictions == 200);
+        REQUIRE(ThumbnailCache::get()->getThumbnail(binId, 199).isNull() == false);
+        KdenliveSettings::setThumbnailcachesize(0);
+        ThumbnailCache::get()->clearCache();
+    }
+    SECTION("Images larger than the cache are not recorded")
+    {
+        KdenliveSettings::setThumbnailcachesize(1);
+        ThumbnailCache::get()->clearCache();
+        QImage img(100, 100, QImage::Format_ARGB32_Premultiplied);
+        img.fill(Qt::red);
+        QImage big(1000, 1000, QImage::Format_ARGB32_Premultiplied);
+        big.fill(Qt::blue);
+        ThumbnailCache::get()->storeThumbnail(binId, 0, img, false);
+        ThumbnailCache::get()->storeThumbnail(binId, 1, big, false);
+        REQUIRE(ThumbnailCache::get()->m_storedVolatile[binId].size() == 1);
+        // Replacing a stored thumbnail with a rejected image drops it
+        ThumbnailCache::get()->storeThumbnail(binId, 0, big, false);
+        REQUIRE(ThumbnailCache::get()->m_storedVolatile.count(binId) == 0);
+        REQUIRE(ThumbnailCache::get()->checkIntegrity());
+        KdenliveSettings::setThumbnailcachesize(0);
+        ThumbnailCache::get()->clearCache();
+    }
     binModel->clean();
     pCore->m_projectManager = nullptr;
 }
@@ -103,3 +145,62 @@ TEST_CASE("getAudioKey() should dereference `ok` param", "ThumbnailCache") {
     binModel->clean();
     pCore->m_projectManager = nullptr;
 }
+
+TEST_CASE("Media probe cache follows file changes", "[MediaProbeCache]")
+{
+    QTemporaryFile file;
+    REQUIRE(file.open());
+    file.write(QByteArray(1000, 'a'));
+    file.flush();
+    const QString path = file.fileName();
+
+    QByteArray hash;
+    qint64 size = 0;
+    MediaProbeCache::StreamInfo info;
+    REQUIRE_FALSE(MediaProbeCache::get()->fileHash(path, hash, size));
+    REQUIRE_FALSE(MediaProbeCache::get()->streams(path, QString(), info));
+
+    SECTION("Computed hash is reused")
+    {
+        QPair<QByteArray, qint64> hashData = ProjectClip::calculateHash(path);
+        REQUIRE(hashData.second == 1000);
+        REQUIRE(MediaProbeCache::get()->fileHash(path, hash, size));
+        REQUIRE(hash == hashData.first);
+        REQUIRE(size == 1000);
+        REQUIRE(ProjectClip::calculateHash(path) == hashData);
+    }
+    SECTION("Modified file is probed again")
+    {
+        MediaProbeCache::StreamInfo probe;
+        probe.hasAudio = true;
+        probe.duration = 12.5;
+        MediaProbeCache::get()->storeStreams(path, QString(), probe);
+        REQUIRE(MediaProbeCache::get()->streams(path, QString(), info));
+        REQUIRE(info.hasAudio);
+        REQUIRE_FALSE(info.hasVideo);
+        REQUIRE(info.duration == 12.5);
+        file.write("b");
+        file.flush();
+        REQUIRE_FALSE(MediaProbeCache::get()->streams(path, QString(), info));
+    }
+    SECTION("Each stream selection has its own probe")
+    {
+        MediaProbeCache::StreamInfo probe;
+        probe.hasAudio = true;
+        probe.hasVideo = true;
+        probe.fps = 25.;
+        probe.codec = QStringLiteral("h264");
+        MediaProbeCache::get()->storeStreams(path, QString(), probe);
+        REQUIRE_FALSE(MediaProbeCache::get()->streams(path, QStringLiteral("video_index=-1;"), info));
+        probe.hasVideo = false;
+        probe.fps = 0.;
+        probe.codec.clear();
+        MediaProbeCache::get()->storeStreams(path, QStringLiteral("video_index=-1;"), probe);
+        REQUIRE(MediaProbeCache::get()->streams(path, QStringLiteral("video_index=-1;"), info));
+        REQUIRE_FALSE(info.hasVideo);
+        REQUIRE(MediaProbeCache::get()->streams(path, QString(), info));
+        REQUIRE(info.hasVideo);
+        REQUIRE(info.fps == 25.);
+        REQUIRE(info.codec == QLatin1String("h264"));
+    }
+}
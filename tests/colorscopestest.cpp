@@ -9,6 +9,8 @@
 #include "scopes/colorscopes/waveformgenerator.h"
 #include "scopes/colorscopes/rgbparadegenerator.h"
 #include "scopes/colorscopes/histogramgenerator.h"
+#include "scopes/colorscopes/scopekernels.h"
+#include "scopes/colorscopes/scopeframe.h"
 
 // test for a bug where pixels were assumed to be RGB which was not true on
 // Windows, resulting in red and blue switched. BUG: 453149
@@ -80,3 +82,107 @@ TEST_CASE("Colorscope RGB/BGR handling")
         CHECK(rgbScope == bgrScope);
     }
 }
+
+// the vectorized kernels must give exactly the same values as the scalar formulas
+TEST_CASE("Colorscope kernels match the scalar formulas")
+{
+    std::vector<QRgb> pixels;
+    for (int i = 0; i < 1001; ++i) {
+        pixels.push_back(qRgb((i * 37) % 256, (i * 101) % 256, (i * 211) % 256));
+    }
+    const int count = int(pixels.size());
+
+    SECTION("Luma")
+    {
+        std::vector<float> luma(pixels.size());
+        ScopeKernels::lumaValues(pixels.data(), count, ITURec::Rec_601, luma.data());
+        for (int i = 0; i < count; ++i) {
+            const QRgb px = pixels[size_t(i)];
+            CHECK(luma[size_t(i)] == REC_601_R * qRed(px) + REC_601_G * qGreen(px) + REC_601_B * qBlue(px));
+        }
+    }
+
+    SECTION("Chroma")
+    {
+        std::vector<double> u(pixels.size());
+        std::vector<double> v(pixels.size());
+        ScopeKernels::chromaValues(pixels.data(), count, false, u.data(), v.data());
+        for (int i = 0; i < count; ++i) {
+            const int r = qRed(pixels[size_t(i)]);
+            const int g = qGreen(pixels[size_t(i)]);
+            const int b = qBlue(pixels[size_t(i)]);
+            CHECK(u[size_t(i)] == -0.0005781 * r - 0.001135 * g + 0.001713 * b);
+            CHECK(v[size_t(i)] == 0.002411 * r - 0.002019 * g - 0.0003921 * b);
+        }
+    }
+
+    SECTION("Sampling")
+    {
+        // walking the rows from their first sample visits the same pixels as walking the whole image
+        const int width = 37;
+        const uint accelFactor = 5;
+        int visited = 0;
+        for (int y = 0; y < 11; ++y) {
+            for (int x = ScopeKernels::firstSample(y, width, accelFactor); x < width; x += int(accelFactor)) {
+                CHECK((y * width + x) % int(accelFactor) == 0);
+                visited++;
+            }
+        }
+        CHECK(visited == (width * 11 + int(accelFactor) - 1) / int(accelFactor));
+    }
+}
+
+TEST_CASE("Shared frame conversion cache", "[Scopes]")
+{
+    Mlt::Profile profile;
+    Mlt::Producer producer(profile, "color", "red");
+    REQUIRE(producer.is_valid());
+    QScopedPointer<Mlt::Frame> frame(producer.get_frame());
+    // Render the frame in its native format, like the monitor does
+    mlt_image_format format = mlt_image_yuv422;
+    int width = profile.width();
+    int height = profile.height();
+    REQUIRE(frame->get_image(format, width, height) != nullptr);
+    SharedFrame shared(*frame);
+    const uint8_t *native = shared.get_image(mlt_image_none);
+    REQUIRE(native != nullptr);
+
+    SECTION("Same format returns the cached conversion")
+    {
+        const uint8_t *rgba = shared.get_image(mlt_image_rgba);
+        REQUIRE(rgba != nullptr);
+        CHECK(rgba != native);
+        CHECK(shared.get_image(mlt_image_rgba) == rgba);
+        // Copies wrap the same frame and share the cache
+        SharedFrame copy(shared);
+        CHECK(copy.get_image(mlt_image_rgba) == rgba);
+        // Red, opaque pixel
+        CHECK(rgba[0] > 200);
+        CHECK(rgba[1] < 50);
+        CHECK(rgba[2] < 50);
+        CHECK(rgba[3] == 255);
+    }
+
+    SECTION("Another format is converted again")
+    {
+        const uint8_t *rgba = shared.get_image(mlt_image_rgba);
+        const uint8_t *rgb = shared.get_image(mlt_image_rgb);
+        REQUIRE(rgb != nullptr);
+        CHECK(rgb != rgba);
+        CHECK(rgb != native);
+        CHECK(shared.get_image(mlt_image_rgb) == rgb);
+        CHECK(shared.get_image(mlt_image_rgba) == rgba);
+        CHECK(shared.get_image(mlt_image_none) == native);
+    }
+
+    SECTION("Scope frame converts once for all scopes")
+    {
+        ScopeFrame scopeFrame(shared);
+        QImage image = scopeFrame.image();
+        REQUIRE(image.size() == QSize(width, height));
+        CHECK(image.format() == QImage::Format_ARGB32);
+        CHECK(qRed(image.pixel(0, 0)) > 200);
+        CHECK(qGreen(image.pixel(0, 0)) < 50);
+        CHECK(scopeFrame.image().cacheKey() == image.cacheKey());
+    }
+}
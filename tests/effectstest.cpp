@@ -57,6 +57,12 @@ TEST_CASE("Effects stack", "[Effects]")
     REQUIRE(timeline->requestClipInsertion(binId, tid1, 100, cid1));
     std::shared_ptr<ProjectClip> clip = binModel->getClipByBinID(binId);
 
+    // Lookups are counted, misses separately
+    auto lookups = binModel->clipLookupStats();
+    REQUIRE(binModel->getClipByBinID(QStringLiteral("-1")) == nullptr);
+    REQUIRE(binModel->clipLookupStats().first > lookups.first);
+    REQUIRE(binModel->clipLookupStats().second > lookups.second);
+
     auto model = clip->m_effectStack;
 
     REQUIRE(model->checkConsistency());
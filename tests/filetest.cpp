@@ -8,6 +8,8 @@
 #define protected public
 
 #include "bin/binplaylist.hpp"
+#include "doc/documentscanner.h"
+#include "doc/documentvalidator.h"
 #include "doc/kdenlivedoc.h"
 #include "timeline2/model/builders/meltBuilder.hpp"
 #include "xml/xml.hpp"
@@ -493,3 +495,47 @@ TEST_CASE("Opening Mix", "[OPENMIX]")
     }
     pCore->m_projectManager = nullptr;
 }
+
+TEST_CASE("Scan project files", "[SCAN]")
+{
+    SECTION("Collect counts and substrings in one pass")
+    {
+        const QByteArray data("<mlt><producer id=\"p1\"><property name=\"resource\">a.mp4</property></producer>"
+                              "<playlist id=\"pl\"><entry producer=\"p1\"/><filter id=\"movit.blur\"/></playlist>"
+                              "<tractor><track producer=\"pl\"/></tractor></mlt>");
+        DocumentScanner scanner(data);
+        REQUIRE(scanner.isValid());
+        REQUIRE(scanner.producerCount() == 1);
+        REQUIRE(scanner.playlistCount() == 1);
+        REQUIRE(scanner.entryCount() == 1);
+        REQUIRE(scanner.trackCount() == 1);
+        REQUIRE(scanner.filterCount() == 1);
+        REQUIRE(scanner.usesMovit());
+        REQUIRE_FALSE(scanner.hasFontSize());
+    }
+
+    SECTION("Changed documents are searched instead of the scan")
+    {
+        const QByteArray data("<mlt root=\"/tmp\"><playlist id=\"pl\"><filter id=\"f1\"><property name=\"mlt_service\">movit.blur</property></filter></playlist>"
+                              "<tractor><track producer=\"pl\"/></tractor></mlt>");
+        DocumentScanner scanner(data);
+        QDomDocument doc;
+        REQUIRE(doc.setContent(data));
+        DocumentValidator validator(doc, QUrl::fromLocalFile(QStringLiteral("/tmp/test.kdenlive")), &scanner);
+        REQUIRE(validator.m_scanner != nullptr);
+        REQUIRE(validator.documentContains(QStringLiteral("movit.")));
+        // An upgrade step removes the filter
+        QDomElement filter = doc.elementsByTagName(QStringLiteral("filter")).at(0).toElement();
+        filter.parentNode().removeChild(filter);
+        validator.m_scanner = nullptr;
+        REQUIRE_FALSE(validator.documentContains(QStringLiteral("movit.")));
+        REQUIRE(validator.documentContains(QStringLiteral("/tmp")));
+    }
+
+    SECTION("Malformed files are reported")
+    {
+        DocumentScanner scanner(QByteArray("<mlt><producer></mlt>"));
+        REQUIRE_FALSE(scanner.isValid());
+        REQUIRE(scanner.errorLine() == 1);
+    }
+}
@@ -7,6 +7,8 @@
 
 #include "test_utils.hpp"
 
+#include "assets/keyframes/model/keyframecurve.hpp"
+
 using namespace fakeit;
 
 bool test_model_equality(const std::shared_ptr<KeyframeModel> &m1, const std::shared_ptr<KeyframeModel> &m2)
@@ -262,5 +264,85 @@ TEST_CASE("Keyframe model", "[KeyframeModel]")
         undoStack->undo();
         state1(6.1);
     }
+
+    SECTION("Interpolated ranges follow the asset values")
+    {
+        REQUIRE(model->addKeyframe(GenTime(1.), KeyframeType::Linear, 42));
+        REQUIRE(model->addKeyframe(GenTime(3.), KeyframeType::Discrete, 10));
+        QVector<double> values = model->getInterpolatedValues(0, 100);
+        REQUIRE(values.size() == 100);
+        for (int frame = 0; frame < 100; ++frame) {
+            CHECK(values.at(frame) == Approx(model->getInterpolatedValue(frame).toDouble()));
+        }
+        REQUIRE(model->getInterpolatedValues(0, 0).isEmpty());
+        REQUIRE(model->getInterpolatedValues(0, 10, 1).isEmpty());
+
+        // Values written directly on the asset are seen once the model is told about them
+        const QString name = effect->data(index, AssetParameterModel::NameRole).toString();
+        effect->getAsset()->set(name.toUtf8().constData(), "0=10;50=20");
+        effect->invalidateValues();
+        values = model->getInterpolatedValues(0, 51);
+        CHECK(values.at(0) == Approx(10));
+        CHECK(values.at(25) == Approx(15));
+        CHECK(values.at(50) == Approx(20));
+
+        // Replacing the asset also invalidates the compiled curve
+        effect->unplant(producer);
+        std::unique_ptr<Mlt::Properties> asset = EffectsRepository::get()->getEffect(effect->getAssetId());
+        asset->inherit(effect->filter());
+        asset->set(name.toUtf8().constData(), "0=30;50=40");
+        effect->resetAsset(std::move(asset));
+        effect->plant(producer);
+        values = model->getInterpolatedValues(0, 51);
+        CHECK(values.at(0) == Approx(30));
+        CHECK(values.at(50) == Approx(40));
+    }
     pCore->m_projectManager = nullptr;
 }
+
+TEST_CASE("Compiled keyframe curves", "[KeyframeModel]")
+{
+    auto checkScalar = [](const char *anim, int duration) {
+        Mlt::Properties props;
+        props.set("key", anim);
+        (void)props.anim_get_double("key", 0, duration);
+        std::shared_ptr<const KeyframeCurve> curve = KeyframeCurve::compile(props, "key", false);
+        std::vector<double> range(size_t(duration + 20));
+        curve->values(-10, duration + 20, 0, range.data());
+        for (int frame = -10; frame < duration + 10; ++frame) {
+            const double expected = props.anim_get_double("key", frame);
+            CHECK(curve->value(frame) == expected);
+            CHECK(range[size_t(frame + 10)] == expected);
+        }
+    };
+
+    SECTION("Scalar animations match MLT")
+    {
+        checkScalar("0=0; 20=100; 50=-30; 80=12.5", 100);
+        checkScalar("0|=0; 20|=100; 50|=-30; 80|=12.5", 100);
+        checkScalar("0~=0; 20~=100; 50~=-30; 80~=12.5", 100);
+        checkScalar("10=5; 25~=80; 40|=20; 60~=60; 61=0; 90~=100", 100);
+        checkScalar("0~=1; 99~=2", 100);
+        checkScalar("42", 100);
+    }
+
+    SECTION("Rect animations match MLT")
+    {
+        Mlt::Properties props;
+        props.set("key", "0=0 0 1920 1080 1; 30~=100 -50 960 540 0.5; 70|=10 10 100 100 0; 90=-20 30 1920 1080 1");
+        (void)props.anim_get_double("key", 0, 100);
+        std::shared_ptr<const KeyframeCurve> curve = KeyframeCurve::compile(props, "key", true);
+        REQUIRE(curve->components() == 5);
+        REQUIRE(curve->keyCount() == 4);
+        for (int frame = 0; frame < 100; ++frame) {
+            const mlt_rect rect = props.anim_get_rect("key", frame);
+            double values[5];
+            curve->value(frame, values);
+            CHECK(values[0] == rect.x);
+            CHECK(values[1] == rect.y);
+            CHECK(values[2] == rect.w);
+            CHECK(values[3] == rect.h);
+            CHECK(values[4] == rect.o);
+        }
+    }
+}
@@ -251,6 +251,115 @@ TEST_CASE("Basic creation/deletion of a clip", "[ClipModel]")
     pCore->m_projectManager = nullptr;
 }
 
+TEST_CASE("Track item lookup", "[TrackModel]")
+{
+    SECTION("Row index matches a sorted list")
+    {
+        RowIndex index;
+        std::vector<int> ids;
+        for (int i = 0; i < 1000; ++i) {
+            ids.push_back(3 * i);
+        }
+        std::shuffle(ids.begin(), ids.end(), g);
+        for (int id : ids) {
+            index.insert(id);
+        }
+        index.insert(ids.front());
+        std::sort(ids.begin(), ids.end());
+        REQUIRE(index.size() == 1000);
+        for (int row = 0; row < 1000; row += 37) {
+            REQUIRE(index.at(row) == ids[size_t(row)]);
+            REQUIRE(index.indexOf(ids[size_t(row)]) == row);
+        }
+        REQUIRE(index.at(1000) == -1);
+        REQUIRE(index.indexOf(1) == -1);
+        // Remove every other id
+        for (size_t i = 0; i < ids.size(); i += 2) {
+            index.remove(ids[i]);
+        }
+        index.remove(1);
+        REQUIRE(index.size() == 500);
+        for (int row = 0; row < 500; row += 23) {
+            REQUIRE(index.at(row) == ids[size_t(2 * row + 1)]);
+            REQUIRE(index.indexOf(ids[size_t(2 * row + 1)]) == row);
+        }
+        REQUIRE_FALSE(index.contains(ids[0]));
+        REQUIRE(index.contains(ids[1]));
+        // Empty the first blocks, the rows of the following ones are shifted
+        for (size_t i = 1; i < 601; i += 2) {
+            index.remove(ids[i]);
+        }
+        REQUIRE(index.size() == 200);
+        for (int row = 0; row < 200; ++row) {
+            REQUIRE(index.at(row) == ids[size_t(2 * row + 601)]);
+            REQUIRE(index.indexOf(ids[size_t(2 * row + 601)]) == row);
+        }
+        REQUIRE(index.at(200) == -1);
+    }
+
+    SECTION("Track lookups follow moves and deletions")
+    {
+        auto binModel = pCore->projectItemModel();
+        std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+        std::shared_ptr<MarkerListModel> guideModel = std::make_shared<MarkerListModel>(undoStack);
+        std::shared_ptr<TimelineItemModel> timeline = TimelineItemModel::construct(&profile_model, guideModel, undoStack);
+
+        Mock<ProjectManager> pmMock;
+        When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+        When(Method(pmMock, cacheDir)).AlwaysReturn(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)));
+        ProjectManager &mocked = pmMock.get();
+        pCore->m_projectManager = &mocked;
+
+        QString binId = createProducer(profile_model, "red", binModel);
+        int tid1;
+        REQUIRE(timeline->requestTrackInsertion(-1, tid1));
+        int cid1 = ClipModel::construct(timeline, binId, -1, PlaylistState::VideoOnly);
+        int cid2 = ClipModel::construct(timeline, binId, -1, PlaylistState::VideoOnly);
+        int cid3 = ClipModel::construct(timeline, binId, -1, PlaylistState::VideoOnly);
+        // Clips are 20 frames long
+        REQUIRE(timeline->requestClipMove(cid3, tid1, 0));
+        REQUIRE(timeline->requestClipMove(cid1, tid1, 50));
+        REQUIRE(timeline->requestClipMove(cid2, tid1, 20));
+        REQUIRE(timeline->checkConsistency());
+        auto track = timeline->getTrackById(tid1);
+
+        REQUIRE(track->getClipByStartPosition(0) == cid3);
+        REQUIRE(track->getClipByStartPosition(20) == cid2);
+        REQUIRE(track->getClipByStartPosition(50) == cid1);
+        REQUIRE(track->getClipByStartPosition(10) == -1);
+        REQUIRE(track->getClipsInRange(10, 30) == std::unordered_set<int>{cid3, cid2});
+        REQUIRE(track->getClipsInRange(40, 60) == std::unordered_set<int>{cid1});
+        REQUIRE(track->getClipsInRange(45) == std::unordered_set<int>{cid1});
+        REQUIRE(track->getClipsInRange(70).empty());
+        // Rows follow the id order, whatever the position
+        for (int cid : {cid1, cid2, cid3}) {
+            REQUIRE(track->getClipByRow(track->getRowfromClip(cid)) == cid);
+        }
+        REQUIRE(track->getRowfromClip(cid1) < track->getRowfromClip(cid2));
+        REQUIRE(track->getRowfromClip(cid2) < track->getRowfromClip(cid3));
+
+        REQUIRE(timeline->requestClipMove(cid2, tid1, 100));
+        REQUIRE(timeline->checkConsistency());
+        REQUIRE(track->getClipByStartPosition(20) == -1);
+        REQUIRE(track->getClipByStartPosition(100) == cid2);
+        REQUIRE(track->getClipsInRange(10, 30) == std::unordered_set<int>{cid3});
+
+        REQUIRE(timeline->requestItemDeletion(cid3));
+        REQUIRE(timeline->checkConsistency());
+        REQUIRE(track->getClipByStartPosition(0) == -1);
+        REQUIRE(track->getClipByRow(0) == cid1);
+        REQUIRE(track->getClipByRow(1) == cid2);
+        REQUIRE(track->getClipByRow(2) == -1);
+
+        undoStack->undo();
+        REQUIRE(timeline->checkConsistency());
+        REQUIRE(track->getClipByStartPosition(0) == cid3);
+        REQUIRE(track->getClipByRow(2) == cid3);
+        binModel->clean();
+        pCore->m_projectManager = nullptr;
+    }
+}
+
 TEST_CASE("Clip manipulation", "[ClipModel]")
 {
     auto binModel = pCore->projectItemModel();
@@ -1922,6 +2031,16 @@ TEST_CASE("Snapping", "[Snapping]")
             }
         }
     }
+    SECTION("Closest cut ignores guides")
+    {
+        REQUIRE(timeline->requestClipMove(cid1, tid1, 100));
+        REQUIRE(guideModel->addMarker(GenTime(100 + length / 2, profile_model.fps()), QStringLiteral("guide")));
+        // The guide is a snap point but not a cut
+        REQUIRE(timeline->getClosestCut(100 + length / 2, length / 2 - 1) == -1);
+        REQUIRE(timeline->getClosestCut(100 + length / 2 + 1, length) == 100 + length);
+        REQUIRE(timeline->getClosestCut(98, 5) == 100);
+        REQUIRE(timeline->checkConsistency());
+    }
     binModel->clean();
     pCore->m_projectManager = nullptr;
 }
@@ -0,0 +1,319 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "catch.hpp"
+
+#include "renderer/rendersegments.h"
+
+#include <QCoreApplication>
+#include <QDomDocument>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalSocket>
+#include <QTemporaryDir>
+#define private public
+#include "renderer/renderqueue.h"
+#include "renderer/rendertelemetry.h"
+#undef private
+
+namespace {
+QDomDocument renderPlaylist(const QString &consumerAttributes)
+{
+    QDomDocument doc;
+    doc.setContent(QStringLiteral("<mlt><profile frame_rate_num=\"25\" frame_rate_den=\"1\"/>"
+                                  "<consumer mlt_service=\"avformat\" in=\"0\" out=\"299\" real_time=\"-8\" target=\"out.mp4\" %1/>"
+                                  "<tractor id=\"maintractor\"/></mlt>")
+                       .arg(consumerAttributes));
+    return doc;
+}
+
+QDomElement consumerOf(const QDomDocument &doc)
+{
+    return doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+}
+
+// Wait for the next reply of a render queue running in this thread
+QJsonObject queueReply(QLocalSocket &socket)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!socket.canReadLine() && timer.elapsed() < 5000) {
+        QCoreApplication::processEvents();
+        socket.waitForReadyRead(10);
+    }
+    return QJsonDocument::fromJson(socket.readLine()).object();
+}
+
+QJsonObject queueRequest(QLocalSocket &socket, const QJsonObject &request)
+{
+    socket.write(QJsonDocument(request).toJson(QJsonDocument::Compact) + '\n');
+    socket.flush();
+    return queueReply(socket);
+}
+} // namespace
+
+TEST_CASE("Render segments", "[Render]")
+{
+    SECTION("Split the range at the cuts")
+    {
+        auto parts = RenderSegments::split(0, 299, {100, 200}, true);
+        REQUIRE(parts.size() == 4);
+        REQUIRE((parts[0].in == 0 && parts[0].out == 99 && !parts[0].audio));
+        REQUIRE((parts[1].in == 100 && parts[1].out == 199 && !parts[1].audio));
+        REQUIRE((parts[2].in == 200 && parts[2].out == 299 && !parts[2].audio));
+        // The audio is rendered once for the whole range
+        REQUIRE((parts[3].in == 0 && parts[3].out == 299 && parts[3].audio));
+
+        parts = RenderSegments::split(0, 299, {100, 200}, false);
+        REQUIRE(parts.size() == 3);
+        REQUIRE(!parts.back().audio);
+
+        // Cuts outside the range or not increasing are ignored
+        parts = RenderSegments::split(50, 299, {20, 150, 120, 400}, false);
+        REQUIRE(parts.size() == 2);
+        REQUIRE((parts[0].in == 50 && parts[0].out == 149));
+        REQUIRE((parts[1].in == 150 && parts[1].out == 299));
+
+        // A single part is not worth splitting
+        REQUIRE(RenderSegments::split(0, 299, {}, true).empty());
+        REQUIRE(RenderSegments::split(0, 299, {400}, true).empty());
+    }
+
+    SECTION("Part playlists")
+    {
+        QDomDocument doc = renderPlaylist(QStringLiteral("vcodec=\"libx264\" acodec=\"aac\" ab=\"160k\""));
+        REQUIRE(RenderSegments::hasAudio(consumerOf(doc)));
+        REQUIRE_FALSE(RenderSegments::hasAudio(consumerOf(renderPlaylist(QStringLiteral("an=\"1\"")))));
+        REQUIRE_FALSE(RenderSegments::hasAudio(consumerOf(renderPlaylist(QStringLiteral("audio_off=\"1\"")))));
+
+        QDomElement video = consumerOf(RenderSegments::partPlaylist(doc, {100, 199, false}, QStringLiteral("part1.mp4"), 2));
+        REQUIRE(video.attribute(QStringLiteral("in")) == QLatin1String("100"));
+        REQUIRE(video.attribute(QStringLiteral("out")) == QLatin1String("199"));
+        REQUIRE(video.attribute(QStringLiteral("target")) == QLatin1String("part1.mp4"));
+        REQUIRE(video.attribute(QStringLiteral("real_time")) == QLatin1String("-2"));
+        REQUIRE(video.attribute(QStringLiteral("an")) == QLatin1String("1"));
+        REQUIRE(video.attribute(QStringLiteral("vcodec")) == QLatin1String("libx264"));
+
+        QDomElement audio = consumerOf(RenderSegments::partPlaylist(doc, {0, 299, true}, QStringLiteral("audio.mka"), 2));
+        REQUIRE(audio.attribute(QStringLiteral("in")) == QLatin1String("0"));
+        REQUIRE(audio.attribute(QStringLiteral("out")) == QLatin1String("299"));
+        REQUIRE(audio.attribute(QStringLiteral("vn")) == QLatin1String("1"));
+        REQUIRE(audio.attribute(QStringLiteral("acodec")) == QLatin1String("flac"));
+        REQUIRE(audio.attribute(QStringLiteral("f")) == QLatin1String("matroska"));
+        REQUIRE_FALSE(audio.hasAttribute(QStringLiteral("an")));
+        REQUIRE_FALSE(audio.hasAttribute(QStringLiteral("ab")));
+
+        // The original playlist is left untouched
+        QDomElement consumer = consumerOf(doc);
+        REQUIRE(consumer.attribute(QStringLiteral("out")) == QLatin1String("299"));
+        REQUIRE(consumer.attribute(QStringLiteral("acodec")) == QLatin1String("aac"));
+        REQUIRE_FALSE(consumer.hasAttribute(QStringLiteral("an")));
+    }
+
+    SECTION("Join arguments")
+    {
+        QDomDocument doc = renderPlaylist(QStringLiteral("vcodec=\"libx264\" acodec=\"aac\" ab=\"160k\""));
+        QStringList args = RenderSegments::concatArguments(consumerOf(doc), QStringLiteral("parts.txt"), QStringLiteral("audio.mka"), QStringLiteral("out.mp4"));
+        // Video parts are copied, the audio is encoded with the requested codec
+        REQUIRE(args.join(QLatin1Char(' ')) ==
+                QLatin1String("-y -v error -f concat -safe 0 -i parts.txt -i audio.mka -map 0:v -map 1:a -c:v copy -c:a aac -b:a 160k out.mp4"));
+
+        doc = renderPlaylist(QStringLiteral("vcodec=\"libx264\" acodec=\"libvorbis\" aq=\"5\""));
+        args = RenderSegments::concatArguments(consumerOf(doc), QStringLiteral("parts.txt"), QStringLiteral("audio.mka"), QStringLiteral("out.mkv"));
+        REQUIRE(args.join(QLatin1Char(' ')) ==
+                QLatin1String("-y -v error -f concat -safe 0 -i parts.txt -i audio.mka -map 0:v -map 1:a -c:v copy -c:a libvorbis -q:a 5 out.mkv"));
+
+        // Without audio, the parts are joined as they are
+        doc = renderPlaylist(QStringLiteral("vcodec=\"libx264\" an=\"1\""));
+        args = RenderSegments::concatArguments(consumerOf(doc), QStringLiteral("parts.txt"), QString(), QStringLiteral("out.mp4"));
+        REQUIRE(args.join(QLatin1Char(' ')) == QLatin1String("-y -v error -f concat -safe 0 -i parts.txt -map 0 -c copy out.mp4"));
+    }
+}
+
+TEST_CASE("Render queue", "[Render]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString queueFile = dir.filePath(QStringLiteral("renderqueue.json"));
+    // Jobs fail to start, the tests do not render anything
+    const QString melt = dir.filePath(QStringLiteral("missing-melt"));
+
+    SECTION("Protocol round trip")
+    {
+        QFile playlist(dir.filePath(QStringLiteral("job.mlt")));
+        REQUIRE(playlist.open(QIODevice::WriteOnly));
+        playlist.write(renderPlaylist(QStringLiteral("vcodec=\"libx264\"")).toByteArray());
+        playlist.close();
+
+        RenderQueue queue(melt, 1, 0, queueFile);
+        const QString server = QStringLiteral("kdenlive-renderqueue-test-%1").arg(QCoreApplication::applicationPid());
+        REQUIRE(queue.listen(server));
+        QLocalSocket socket;
+        socket.connectToServer(server);
+        REQUIRE(socket.waitForConnected(1000));
+
+        QJsonObject reply = queueRequest(socket, {{QStringLiteral("command"), QStringLiteral("submit")}, {QStringLiteral("playlist"), playlist.fileName()}});
+        REQUIRE(reply.value(QStringLiteral("ok")).toBool());
+        const int id = reply.value(QStringLiteral("id")).toInt();
+        REQUIRE(id > 0);
+
+        reply = queueRequest(socket, {{QStringLiteral("command"), QStringLiteral("status")}, {QStringLiteral("id"), id}});
+        REQUIRE(reply.value(QStringLiteral("ok")).toBool());
+        const QJsonArray jobs = reply.value(QStringLiteral("jobs")).toArray();
+        REQUIRE(jobs.count() == 1);
+        REQUIRE(jobs.at(0).toObject().value(QStringLiteral("id")).toInt() == id);
+        REQUIRE(jobs.at(0).toObject().value(QStringLiteral("playlist")).toString() == playlist.fileName());
+        REQUIRE(jobs.at(0).toObject().value(QStringLiteral("target")).toString() == QLatin1String("out.mp4"));
+
+        // Errors are reported in the reply
+        reply = queueRequest(socket, {{QStringLiteral("command"), QStringLiteral("submit")}, {QStringLiteral("playlist"), dir.filePath(QStringLiteral("none.mlt"))}});
+        REQUIRE_FALSE(reply.value(QStringLiteral("ok")).toBool());
+        REQUIRE_FALSE(reply.value(QStringLiteral("error")).toString().isEmpty());
+        reply = queueRequest(socket, {{QStringLiteral("command"), QStringLiteral("unknown")}});
+        REQUIRE_FALSE(reply.value(QStringLiteral("ok")).toBool());
+        socket.write("not json\n");
+        socket.flush();
+        REQUIRE_FALSE(queueReply(socket).value(QStringLiteral("ok")).toBool());
+        REQUIRE(queueRequest(socket, {{QStringLiteral("command"), QStringLiteral("clear")}}).value(QStringLiteral("ok")).toBool());
+    }
+
+    SECTION("Jobs are saved and resumed")
+    {
+        {
+            RenderQueue queue(melt, 1, 0, queueFile);
+            RenderQueue::Job waiting;
+            waiting.playlist = QStringLiteral("/tmp/a.mlt");
+            waiting.target = QStringLiteral("/tmp/a.mp4");
+            waiting.submitted = QDateTime(QDate(2022, 6, 1), QTime(21, 0));
+            RenderQueue::Job running = waiting;
+            running.target = QStringLiteral("/tmp/b.mp4");
+            running.status = RenderQueue::JobStatus::Running;
+            running.progress = 42;
+            running.frame = 1260;
+            RenderQueue::Job failed = waiting;
+            failed.target = QStringLiteral("/tmp/c.mp4");
+            failed.status = RenderQueue::JobStatus::Failed;
+            failed.error = QStringLiteral("melt error");
+            queue.m_jobs.emplace(3, waiting);
+            queue.m_jobs.emplace(4, running);
+            queue.m_jobs.emplace(6, failed);
+            queue.m_nextId = 7;
+            queue.save();
+        }
+        RenderQueue queue(melt, 1, 0, queueFile);
+        REQUIRE(queue.m_nextId == 7);
+        REQUIRE(queue.m_jobs.size() == 3);
+        const RenderQueue::Job &waiting = queue.m_jobs.at(3);
+        REQUIRE(waiting.status == RenderQueue::JobStatus::Waiting);
+        REQUIRE(waiting.playlist == QLatin1String("/tmp/a.mlt"));
+        REQUIRE(waiting.target == QLatin1String("/tmp/a.mp4"));
+        REQUIRE(waiting.submitted == QDateTime(QDate(2022, 6, 1), QTime(21, 0)));
+        // An interrupted job is rendered again from the start
+        const RenderQueue::Job &running = queue.m_jobs.at(4);
+        REQUIRE(running.status == RenderQueue::JobStatus::Waiting);
+        REQUIRE(running.progress == 0);
+        REQUIRE(running.frame == 0);
+        const RenderQueue::Job &failed = queue.m_jobs.at(6);
+        REQUIRE(failed.status == RenderQueue::JobStatus::Failed);
+        REQUIRE(failed.error == QLatin1String("melt error"));
+    }
+}
+
+TEST_CASE("Render telemetry", "[Render]")
+{
+    SECTION("Sections are interpolated from the samples")
+    {
+        RenderTelemetry telemetry;
+        // 10 ms per frame up to frame 100, then 20 ms per frame
+        telemetry.m_samples[0] = {{0, 0}, {1000, 100}, {3000, 200}};
+        const std::vector<RenderTelemetry::Sample> &samples = telemetry.m_samples[0];
+        REQUIRE(RenderTelemetry::timeAt(samples, 50) == Approx(500));
+        REQUIRE(RenderTelemetry::timeAt(samples, 150) == Approx(2000));
+        REQUIRE(RenderTelemetry::timeAt(samples, -10) == Approx(0));
+        REQUIRE(RenderTelemetry::timeAt(samples, 250) == Approx(3000));
+
+        // 200 frames in sections of 2 frames
+        std::vector<RenderTelemetry::Section> sections = telemetry.sections();
+        REQUIRE(sections.size() == 100);
+        REQUIRE(sections.front().start == 0);
+        REQUIRE(sections.front().end == 1);
+        REQUIRE(sections.front().seconds == Approx(0.02));
+        REQUIRE(sections[50].start == 100);
+        REQUIRE(sections[50].seconds == Approx(0.04));
+        REQUIRE(sections.back().end == 199);
+
+        // Segments rendered in parallel are sorted by position
+        telemetry.m_samples[1] = {{0, 200}, {2000, 400}};
+        sections = telemetry.sections();
+        REQUIRE(sections.size() == 100);
+        for (size_t i = 1; i < sections.size(); ++i) {
+            REQUIRE(sections[i].start > sections[i - 1].start);
+        }
+        REQUIRE(sections.back().end == 399);
+        REQUIRE(sections.back().seconds == Approx(0.04));
+    }
+
+    SECTION("Stalls are reported")
+    {
+        RenderTelemetry telemetry;
+        telemetry.m_samples[0] = {{500, 0}, {1000, 10}, {13000, 11}, {14000, 20}};
+        const QJsonObject report = telemetry.report(QString());
+        REQUIRE(report.value(QStringLiteral("frames")).toInt() == 21);
+        REQUIRE(report.value(QStringLiteral("startup")).toDouble() == Approx(0.5));
+        const QJsonArray stalls = report.value(QStringLiteral("stalls")).toArray();
+        REQUIRE(stalls.count() == 1);
+        REQUIRE(stalls.at(0).toObject().value(QStringLiteral("frame")).toInt() == 11);
+        REQUIRE(stalls.at(0).toObject().value(QStringLiteral("seconds")).toDouble() == Approx(12));
+        REQUIRE_FALSE(report.value(QStringLiteral("slowest")).toArray().isEmpty());
+    }
+
+    SECTION("Clips and compositions of a range")
+    {
+        QDomDocument doc;
+        REQUIRE(doc.setContent(QStringLiteral(
+            "<mlt><profile frame_rate_num=\"25\" frame_rate_den=\"1\"/>"
+            "<producer id=\"producer0\"><property name=\"resource\">/media/a.mp4</property></producer>"
+            "<chain id=\"chain0\"><property name=\"resource\">/media/b.mov</property><property name=\"kdenlive:clipname\">Interview</property></chain>"
+            "<playlist id=\"main_bin\"><entry producer=\"producer0\" in=\"0\" out=\"99\"/></playlist>"
+            "<playlist id=\"playlist0\">"
+            "<entry producer=\"producer0\" in=\"0\" out=\"49\"><filter id=\"filter0\"><property name=\"mlt_service\">frei0r.glow</property></filter></entry>"
+            "<blank length=\"25\"/>"
+            "<entry producer=\"chain0\" in=\"10\" out=\"59\"/>"
+            "</playlist>"
+            "<tractor id=\"tractor0\"><property name=\"kdenlive:track_name\">V1</property><track producer=\"playlist0\"/></tractor>"
+            "<tractor id=\"maintractor\"><track producer=\"tractor0\"/>"
+            "<transition id=\"transition0\" in=\"00:00:02.400\" out=\"80\"><property name=\"mlt_service\">affine</property>"
+            "<property name=\"kdenlive_id\">composite</property></transition>"
+            "<transition id=\"transition1\" in=\"0\" out=\"200\"><property name=\"mlt_service\">mix</property>"
+            "<property name=\"internal_added\">237</property></transition>"
+            "</tractor></mlt>")));
+
+        // The first clip with its effect, named from its resource
+        QJsonArray clips = RenderTelemetry::clipsInRange(doc, 10, 20);
+        REQUIRE(clips.count() == 1);
+        QJsonObject clip = clips.at(0).toObject();
+        REQUIRE(clip.value(QStringLiteral("clip")).toString() == QLatin1String("a.mp4"));
+        REQUIRE(clip.value(QStringLiteral("track")).toString() == QLatin1String("V1"));
+        REQUIRE(clip.value(QStringLiteral("start")).toInt() == 0);
+        REQUIRE(clip.value(QStringLiteral("end")).toInt() == 49);
+        REQUIRE(clip.value(QStringLiteral("effects")).toArray() == QJsonArray({QStringLiteral("frei0r.glow")}));
+
+        // The composition, whose start is a clock value, and the clip after the blank; the track compositing is ignored
+        clips = RenderTelemetry::clipsInRange(doc, 60, 80);
+        REQUIRE(clips.count() == 2);
+        const QJsonObject composition = clips.at(0).toObject();
+        REQUIRE(composition.value(QStringLiteral("composition")).toString() == QLatin1String("composite"));
+        REQUIRE(composition.value(QStringLiteral("start")).toInt() == 60);
+        REQUIRE(composition.value(QStringLiteral("end")).toInt() == 80);
+        clip = clips.at(1).toObject();
+        REQUIRE(clip.value(QStringLiteral("clip")).toString() == QLatin1String("Interview"));
+        REQUIRE(clip.value(QStringLiteral("start")).toInt() == 75);
+        REQUIRE(clip.value(QStringLiteral("end")).toInt() == 124);
+        REQUIRE(clip.value(QStringLiteral("effects")).toArray().isEmpty());
+
+        REQUIRE(RenderTelemetry::clipsInRange(doc, 200, 300).isEmpty());
+    }
+}
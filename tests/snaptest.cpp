@@ -126,4 +126,85 @@ TEST_CASE("Snap points model test", "[SnapModel]")
         REQUIRE(snap.getClosestPoint(9) == 15);
         REQUIRE(snap.getClosestPoint(999) == 15);
     }
+
+    SECTION("Bulk registration and range queries")
+    {
+        std::vector<int> points;
+        for (int i = 0; i < 1000; ++i) {
+            points.push_back(i * 10);
+        }
+        snap.addPoints(points);
+        snap.addPoint(500);
+        REQUIRE(snap._snaps().size() == 1000);
+        REQUIRE(snap._snaps().at(500) == 2);
+        REQUIRE(snap.getPoints(95, 131) == std::vector<int>({100, 110, 120, 130}));
+        REQUIRE(snap.getClosestPoint(503, 2) == -1);
+        REQUIRE(snap.getClosestPoint(503, 3) == 500);
+        REQUIRE(snap.getClosestPoint(505, 5) == 510);
+
+        // Ignoring a group hides one point per position
+        snap.ignore({500, 510, 520});
+        REQUIRE(snap.getClosestPoint(514, 20) == 500);
+        REQUIRE(snap.getClosestPoint(518, 5) == -1);
+        REQUIRE(snap.getPoints(495, 525) == std::vector<int>({500}));
+        REQUIRE(snap.getNextPoint(500) == 530);
+        REQUIRE(snap.getPreviousPoint(530) == 500);
+        snap.unIgnore();
+        REQUIRE(snap.getPoints(495, 525) == std::vector<int>({500, 510, 520}));
+
+        snap.removePoints(points);
+        REQUIRE(snap._snaps().size() == 1);
+        REQUIRE(snap.getClosestPoint(0) == 500);
+        snap.removePoint(500);
+        REQUIRE(snap.getClosestPoint(0) == -1);
+    }
+
+    SECTION("Moving points between queries")
+    {
+        std::vector<int> points;
+        for (int i = 0; i < 1000; ++i) {
+            points.push_back(i * 10);
+        }
+        snap.addPoints(points);
+        // Drag the points at 500 and 520 by one frame at a time, querying at each step like a timeline move
+        int in = 500;
+        int out = 520;
+        for (int step = 1; step <= 8; ++step) {
+            snap.removePoint(in);
+            snap.removePoint(out);
+            in++;
+            out++;
+            snap.addPoint(in);
+            snap.addPoint(out);
+            REQUIRE(snap.getClosestPoint(in, 0) == in);
+            REQUIRE(snap.getClosestPoint(out, 0) == out);
+            REQUIRE(snap.getPoints(495, 535) == std::vector<int>({in, 510, out, 530}));
+            REQUIRE(snap.getNextPoint(510) == out);
+            REQUIRE(snap.getPreviousPoint(510) == in);
+        }
+        REQUIRE(snap._snaps().size() == 1000);
+        REQUIRE(snap._snaps().count(500) == 0);
+        // Move back to the original positions, that are still known
+        snap.removePoint(in);
+        snap.removePoint(out);
+        snap.addPoint(500);
+        snap.addPoint(520);
+        REQUIRE(snap.getPoints(495, 535) == std::vector<int>({500, 510, 520, 530}));
+        REQUIRE(snap.getClosestPoint(507) == 510);
+        REQUIRE(snap.getClosestPoint(504) == 500);
+        REQUIRE(snap._snaps().size() == 1000);
+
+        // Enough new positions to be merged in the main list
+        std::vector<int> odd;
+        for (int i = 0; i < 500; ++i) {
+            odd.push_back(i * 10 + 5);
+            snap.addPoint(i * 10 + 5);
+        }
+        REQUIRE(snap._snaps().size() == 1500);
+        REQUIRE(snap.getClosestPoint(4993, 1) == -1);
+        REQUIRE(snap.getClosestPoint(4993, 2) == 4995);
+        snap.removePoints(odd);
+        REQUIRE(snap._snaps().size() == 1000);
+        REQUIRE(snap.getClosestPoint(4993, 2) == -1);
+    }
 }
@@ -0,0 +1,113 @@
+/*
+    SPDX-FileCopyrightText: 2022 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "test_utils.hpp"
+
+#include "doc/docundostack.hpp"
+#include "undohelper.hpp"
+
+TEST_CASE("Undo history merging and memory limit", "[Undo]")
+{
+    DocUndoStack stack(nullptr);
+    stack.setMemoryLimit(0);
+    int value = 0;
+    auto pushChange = [&](int newValue, const QString &mergeKey, qint64 memory = 0) {
+        int oldValue = value;
+        Fun undo = [&value, oldValue]() {
+            value = oldValue;
+            return true;
+        };
+        Fun redo = [&value, newValue]() {
+            value = newValue;
+            return true;
+        };
+        redo();
+        auto *command = new FunctionalUndoCommand(undo, redo, QStringLiteral("change"));
+        command->setMergeKey(mergeKey);
+        command->addMemoryHint(memory);
+        stack.push(command);
+    };
+    // Memory of the stack computed from scratch, to check the running total
+    auto scannedUsage = [&]() {
+        qint64 total = 0;
+        for (int i = 0; i < stack.count(); ++i) {
+            total += static_cast<const FunctionalUndoCommand *>(stack.command(i))->memoryEstimate();
+        }
+        return total;
+    };
+
+    SECTION("Commands with the same key are merged")
+    {
+        pushChange(1, QStringLiteral("a"));
+        pushChange(2, QStringLiteral("a"));
+        pushChange(3, QStringLiteral("a"));
+        pushChange(4, QStringLiteral("b"));
+        REQUIRE(stack.count() == 2);
+        stack.undo();
+        REQUIRE(value == 3);
+        stack.undo();
+        REQUIRE(value == 0);
+        stack.redo();
+        REQUIRE(value == 3);
+        stack.redo();
+        REQUIRE(value == 4);
+    }
+
+    SECTION("Memory estimates are passed with the command")
+    {
+        pushChange(1, QString());
+        const qint64 base = stack.memoryUsage();
+        pushChange(2, QString(), 2 << 20);
+        REQUIRE(stack.memoryUsage() == 2 * base + (2 << 20));
+        pushChange(3, QString());
+        REQUIRE(stack.memoryUsage() == 3 * base + (2 << 20));
+        REQUIRE(stack.memoryUsage() == scannedUsage());
+        // A large capture alone brings the history over its budget
+        stack.setMemoryLimit(1 << 20);
+        REQUIRE(stack.memoryUsage() <= 1 << 20);
+        stack.undo();
+        REQUIRE(value == 2);
+    }
+
+    SECTION("The memory total follows merges, undone commands and clearing")
+    {
+        pushChange(1, QStringLiteral("a"), 1000);
+        pushChange(2, QStringLiteral("a"), 2000);
+        REQUIRE(stack.count() == 1);
+        REQUIRE(stack.memoryUsage() == scannedUsage());
+        pushChange(3, QString(), 3000);
+        pushChange(4, QString(), 4000);
+        stack.undo();
+        stack.undo();
+        // Pushing deletes the undone commands
+        pushChange(5, QString(), 5000);
+        REQUIRE(stack.count() == 2);
+        REQUIRE(stack.memoryUsage() == scannedUsage());
+        stack.clear();
+        REQUIRE(stack.memoryUsage() == 0);
+        pushChange(6, QString());
+        REQUIRE(stack.memoryUsage() == scannedUsage());
+    }
+
+    SECTION("Oldest commands are released above the memory limit")
+    {
+        for (int i = 1; i <= 10; ++i) {
+            pushChange(i, QString());
+        }
+        REQUIRE(stack.count() == 10);
+        const qint64 usage = stack.memoryUsage();
+        stack.setMemoryLimit(usage / 2);
+        REQUIRE(stack.memoryUsage() <= usage / 2);
+        REQUIRE(stack.count() == 10);
+        // Recent commands still work, released ones are dropped without effect
+        stack.undo();
+        REQUIRE(value == 9);
+        while (stack.canUndo()) {
+            stack.undo();
+        }
+        REQUIRE(value > 0);
+        REQUIRE(stack.count() < 10);
+        REQUIRE(stack.memoryUsage() == scannedUsage());
+    }
+}